@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <cctype>
+#include <exception>
 
 #include <graphene/app/api.hpp>
 #include <graphene/app/api_access.hpp>
@@ -185,6 +186,41 @@ namespace graphene { namespace app {
        _app.p2p_node()->broadcast_transaction(trx);
     }
 
+    void network_broadcast_api::broadcast_transactions(const vector<precomputable_transaction>& trxs)
+    {
+       FC_ASSERT( _app.p2p_node() != nullptr, "Not connected to P2P network, can't broadcast!" );
+       const auto& db = _app.chain_database();
+       vector< fc::future<void> > precomputed;
+       precomputed.reserve( trxs.size() );
+       for( const auto& trx : trxs )
+          precomputed.push_back( db->precompute_parallel( trx ) );
+       // the precomputations refer to trxs, so all of them have to finish before an exception is passed on
+       std::exception_ptr failure;
+       for( auto& f : precomputed )
+       {
+          try
+          {
+             f.wait();
+          }
+          catch( ... )
+          {
+             if( !failure )
+                failure = std::current_exception();
+          }
+       }
+       if( failure )
+          std::rethrow_exception( failure );
+       for( size_t i = 0; i < trxs.size(); ++i )
+       {
+          try
+          {
+             db->push_transaction( trxs[i] );
+          }
+          FC_CAPTURE_AND_RETHROW( (i)(trxs[i].id()) )
+          _app.p2p_node()->broadcast_transaction( trxs[i] );
+       }
+    }
+
     fc::variant network_broadcast_api::broadcast_transaction_synchronous(const precomputable_transaction& trx)
     {
        fc::promise<fc::variant>::ptr prom = fc::promise<fc::variant>::create();
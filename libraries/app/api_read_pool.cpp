@@ -0,0 +1,37 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <graphene/app/api_read_pool.hpp>
+
+namespace graphene { namespace app {
+
+api_read_pool::api_read_pool( graphene::chain::database& db, uint32_t num_threads ) : _db( db )
+{
+   FC_ASSERT( num_threads > 0, "An API read pool needs at least one thread" );
+   _threads.reserve( num_threads );
+   for( uint32_t i = 0; i < num_threads; ++i )
+      _threads.push_back( std::make_unique<fc::thread>( "api_read_" + std::to_string( i ) ) );
+}
+
+api_read_pool::~api_read_pool()
+{
+   for( auto& thread : _threads )
+      thread->quit();
+}
+
+} } // graphene::app
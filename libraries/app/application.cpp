@@ -24,7 +24,9 @@
  */
 #include <graphene/app/api.hpp>
 #include <graphene/app/api_access.hpp>
+#include <graphene/app/api_read_pool.hpp>
 #include <graphene/app/application.hpp>
+#include <graphene/app/changed_objects_cache.hpp>
 #include <graphene/app/plugin.hpp>
 
 #include <graphene/chain/db_with.hpp>
@@ -255,6 +257,15 @@ void application_impl::initialize(const fc::path& data_dir, shared_ptr<boost::pr
    if ( _options->count("enable-subscribe-to-all") > 0 )
       _app_options.enable_subscribe_to_all = _options->at( "enable-subscribe-to-all" ).as<bool>();
 
+   if( _options->count("transaction-ingress-batch-size") > 0 )
+   {
+      _ingress_batch_size = _options->at("transaction-ingress-batch-size").as<uint32_t>();
+      FC_ASSERT( _ingress_batch_size > 0, "transaction-ingress-batch-size must be positive" );
+   }
+
+   if( _options->count("transaction-ingress-max-delay-ms") > 0 )
+      _ingress_max_delay = fc::milliseconds( _options->at("transaction-ingress-max-delay-ms").as<uint32_t>() );
+
    set_api_limit();
 
    if( is_plugin_enabled( "market_history" ) )
@@ -391,6 +402,10 @@ void application_impl::set_api_limit() {
       _app_options.api_limit_get_collateral_bids =
             _options->at("api-limit-get-collateral-bids").as<uint64_t>();
    }
+   if(_options->count("api-read-max-items") > 0) {
+      _app_options.api_read_max_items =
+            _options->at("api-read-max-items").as<uint64_t>();
+   }
    if(_options->count("api-limit-get-top-markets") > 0) {
       _app_options.api_limit_get_top_markets =
             _options->at("api-limit-get-top-markets").as<uint64_t>();
@@ -495,6 +510,36 @@ void application_impl::open_chain_database() const
       _chain_db->enable_standby_votes_tracking( _options->at("enable-standby-votes-tracking").as<bool>() );
    }
 
+   if( _options->count("enable-speculative-authority-checks") > 0 )
+   {
+      _chain_db->enable_speculative_authority_checks(
+            _options->at("enable-speculative-authority-checks").as<bool>() );
+   }
+
+   if( _options->count("enable-block-write-behind") > 0 )
+      _chain_db->enable_block_write_behind( _options->at("enable-block-write-behind").as<bool>() );
+
+   if( _options->count("signature-cache-size") > 0 )
+      _chain_db->get_signature_cache().set_capacity( _options->at("signature-cache-size").as<uint32_t>() );
+
+   if( _options->count("pending-transactions-max-size-mb") > 0
+         || _options->count("pending-transactions-max-per-account") > 0 )
+   {
+      uint64_t max_size = _chain_db->get_pending_transactions().max_size();
+      uint32_t max_per_account = _chain_db->get_pending_transactions().max_per_account();
+      if( _options->count("pending-transactions-max-size-mb") > 0 )
+         max_size = uint64_t( _options->at("pending-transactions-max-size-mb").as<uint32_t>() ) * 1024 * 1024;
+      if( _options->count("pending-transactions-max-per-account") > 0 )
+         max_per_account = _options->at("pending-transactions-max-per-account").as<uint32_t>();
+      _chain_db->set_pending_transaction_limits( max_size, max_per_account );
+   }
+
+   if( _options->count("change-log-interval") > 0 )
+      _chain_db->set_change_log_interval( _options->at("change-log-interval").as<uint32_t>() );
+   if( _options->count("change-log-compaction-size-mb") > 0 )
+      _chain_db->set_change_log_compaction_size(
+            uint64_t( _options->at("change-log-compaction-size-mb").as<uint32_t>() ) * 1024 * 1024 );
+
    if( _options->count("replay-blockchain") > 0 || _options->count("revalidate-blockchain") > 0 )
       _chain_db->wipe( _data_dir / "blockchain", false );
 
@@ -543,6 +588,12 @@ void application_impl::startup()
 
    open_chain_database();
 
+   // shared by the API sessions, which are created from here on
+   _app_options.changed_objects = std::make_shared<changed_objects_cache>( *_chain_db );
+   if( _options->count("api-read-threads") > 0 && _options->at("api-read-threads").as<uint16_t>() > 0 )
+      _app_options.read_pool = std::make_shared<api_read_pool>( *_chain_db,
+                                                                 _options->at("api-read-threads").as<uint16_t>() );
+
    startup_plugins();
 
    if( enable_p2p_network && _active_plugins.find( "delayed_node" ) == _active_plugins.end() )
@@ -683,10 +734,116 @@ void application_impl::handle_transaction(const graphene::net::trx_message& tran
       trx_count = 0;
    }
 
-   _chain_db->precompute_parallel( transaction_message.trx ).wait();
-   _chain_db->push_transaction( transaction_message.trx );
+   // The signatures are recovered on the thread pool right away, while process_ingress_queue pushes the
+   // transactions in the order they arrived
+   ingress_transaction item;
+   item.trx = std::make_shared<graphene::chain::precomputable_transaction>( transaction_message.trx );
+   item.received_time = now;
+   item.precomputed = _chain_db->precompute_parallel( *item.trx );
+   item.pushed = fc::promise<void>::create( "handle_transaction" );
+   fc::future<void> pushed( item.pushed );
+   _ingress_queue.push_back( std::move( item ) );
+   if( !_ingress_task.valid() || _ingress_task.ready() )
+      _ingress_task = fc::async( [this](){ process_ingress_queue(); }, "process_ingress_queue" );
+   pushed.wait();
 } FC_CAPTURE_AND_RETHROW( (transaction_message) ) }
 
+void application_impl::process_ingress_queue()
+{
+   try
+   {
+      while( !_ingress_queue.empty() )
+      {
+         // optionally wait for a fuller batch, but not longer than the oldest transaction may wait
+         const fc::time_point deadline = _ingress_queue.front().received_time + _ingress_max_delay;
+         for( fc::time_point now = fc::time_point::now();
+              _ingress_queue.size() < _ingress_batch_size && now < deadline;
+              now = fc::time_point::now() )
+            fc::usleep( std::min( deadline - now, fc::microseconds(500) ) );
+
+         const size_t batch_size = std::min<size_t>( _ingress_queue.size(), _ingress_batch_size );
+         for( size_t i = 0; i < batch_size; ++i )
+         {
+            ingress_transaction item = std::move( _ingress_queue.front() );
+            _ingress_queue.pop_front();
+            try
+            {
+               const fc::time_point taken = fc::time_point::now();
+               _ingress_queue_latency.record( taken - item.received_time );
+               item.precomputed.wait();
+               const fc::time_point precomputed = fc::time_point::now();
+               _ingress_precompute_latency.record( precomputed - taken );
+               _chain_db->push_transaction( *item.trx );
+               const fc::time_point pushed = fc::time_point::now();
+               _ingress_push_latency.record( pushed - precomputed );
+               _ingress_total_latency.record( pushed - item.received_time );
+               item.pushed->set_value();
+            }
+            catch( const fc::canceled_exception& e )
+            {
+               item.pushed->set_exception( e.dynamic_copy_exception() );
+               throw;
+            }
+            catch( const fc::exception& e )
+            {
+               item.pushed->set_exception( e.dynamic_copy_exception() );
+            }
+            catch( const std::exception& e )
+            {
+               item.pushed->set_exception( std::make_shared<fc::unhandled_exception>(
+                     FC_LOG_MESSAGE( warn, "${e}", ("e", e.what()) ) ) );
+            }
+            catch( ... )
+            {
+               // the caller waits for the promise, it must be completed whatever went wrong
+               item.pushed->set_exception( std::make_shared<fc::unhandled_exception>(
+                     FC_LOG_MESSAGE( warn, "${e}", ("e", fc::except_str()) ) ) );
+            }
+         }
+
+         report_ingress_latencies();
+         // let block processing and the other tasks run between batches
+         fc::yield();
+      }
+   }
+   catch( const fc::canceled_exception& e )
+   {
+      for( auto& item : _ingress_queue )
+         item.pushed->set_exception( e.dynamic_copy_exception() );
+      _ingress_queue.clear();
+      throw;
+   }
+}
+
+void application_impl::report_ingress_latencies()
+{
+   const fc::time_point now = fc::time_point::now();
+   if( now - _ingress_last_report < fc::minutes(1) )
+      return;
+   _ingress_last_report = now;
+
+   const auto cache_stats = _chain_db->get_signature_cache().get_statistics();
+   const uint64_t hits = cache_stats.hits - _signature_cache_last_report.hits;
+   const uint64_t lookups = hits + ( cache_stats.misses - _signature_cache_last_report.misses );
+   _signature_cache_last_report = cache_stats;
+   if( lookups > 0 )
+      ilog( "Signature cache: ${h} of ${l} transactions found (${r}%), ${s} transactions cached",
+            ("h", hits)("l", lookups)("r", hits * 100 / lookups)("s", cache_stats.size) );
+
+   if( _ingress_total_latency.count() == 0 )
+      return;
+   ilog( "Latencies of transactions from the network: queued ${q}, waiting for signatures ${s}, "
+         "push_transaction ${p}, total ${t}",
+         ("q", _ingress_queue_latency.to_variant_object())
+         ("s", _ingress_precompute_latency.to_variant_object())
+         ("p", _ingress_push_latency.to_variant_object())
+         ("t", _ingress_total_latency.to_variant_object()) );
+   _ingress_queue_latency.reset();
+   _ingress_precompute_latency.reset();
+   _ingress_push_latency.reset();
+   _ingress_total_latency.reset();
+}
+
 void application_impl::handle_message(const message& message_to_process)
 {
    // not a transaction, not a block
@@ -765,13 +922,16 @@ message application_impl::get_item(const item_id& id)
   // ilog("Request for item ${id}", ("id", id));
    if( id.item_type == graphene::net::block_message_type )
    {
-      auto opt_block = _chain_db->fetch_block_by_id(id.item_hash);
-      if( !opt_block )
+      // serve the block as stored, a block_message is packed as the block followed by its id
+      auto packed_block = _chain_db->fetch_packed_block_by_id(id.item_hash);
+      if( !packed_block )
          elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
               ("id", id.item_hash)("id2", _chain_db->get_block_id_for_num(block_header::num_from_id(id.item_hash))));
-      FC_ASSERT( opt_block.valid() );
-      // ilog("Serving up block #${num}", ("num", opt_block->block_num()));
-      return block_message(std::move(*opt_block));
+      FC_ASSERT( packed_block.valid() );
+      // ilog("Serving up block #${num}", ("num", block_header::num_from_id(id.item_hash)));
+      const auto packed_id = fc::raw::pack( id.item_hash );
+      packed_block->insert( packed_block->end(), packed_id.begin(), packed_id.end() );
+      return message( block_message::type, std::move(*packed_block) );
    }
    return trx_message( _chain_db->get_recent_transaction( id.item_hash ) );
 } FC_CAPTURE_AND_RETHROW( (id) ) }
@@ -1029,6 +1189,19 @@ void application_impl::shutdown()
    ilog( "Shutting down plugins" );
    shutdown_plugins();
 
+   if( _ingress_task.valid() && !_ingress_task.ready() )
+   {
+      ilog( "Stopping to push transactions from the network" );
+      try
+      {
+         _ingress_task.cancel_and_wait( __FUNCTION__ );
+      }
+      catch( const fc::exception& e )
+      {
+         wlog( "Exception thrown while stopping the transaction ingress, ignoring: ${e}", ("e", e) );
+      }
+   }
+
    if( _p2p_network )
    {
       ilog( "Disconnecting from P2P network" );
@@ -1039,6 +1212,13 @@ void application_impl::shutdown()
    else
       ilog( "P2P network is disabled" );
 
+   if( _app_options.read_pool )
+   {
+      ilog( "Stopping API read threads" );
+      _app_options.read_pool.reset();
+   }
+   _app_options.changed_objects.reset();
+
    if( _chain_db )
    {
       ilog( "Closing chain database" );
@@ -1148,6 +1328,40 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("enable-standby-votes-tracking", bpo::value<bool>()->implicit_value(true),
           "Whether to enable tracking of votes of standby witnesses and committee members. "
           "Set it to true to provide accurate data to API clients, set to false for slightly better performance.")
+         ("enable-speculative-authority-checks", bpo::value<bool>()->implicit_value(true),
+          "Whether to verify the authorities of all transactions of a received block in parallel before applying "
+          "the block. Speeds up syncing and revalidating the blockchain when signatures are checked.")
+         ("enable-block-write-behind", bpo::value<bool>()->implicit_value(true),
+          "Whether to write received and generated blocks to disk on a background thread, so that applying a "
+          "block does not wait for the disk. Blocks are written at the latest when they become irreversible. "
+          "A block which can not be written is retried, meanwhile no more blocks are accepted. Disabled by default.")
+         ("transaction-ingress-batch-size", bpo::value<uint32_t>()->default_value(64),
+          "Maximum number of transactions received from the P2P network that are pushed in one go, "
+          "their signatures are recovered in parallel beforehand")
+         ("transaction-ingress-max-delay-ms", bpo::value<uint32_t>()->default_value(0),
+          "How long a transaction received from the P2P network may wait for more transactions to fill its batch")
+         ("signature-cache-size", bpo::value<uint32_t>()->default_value(100000),
+          "Number of transactions whose public keys recovered from their signatures are kept, so that a "
+          "transaction seen again e.g. in a block is not recovered again. 0 disables the cache")
+         ("pending-transactions-max-size-mb", bpo::value<uint32_t>()->default_value(128),
+          "Maximum total size of the pending transactions in MiB, transactions with the lowest fee per byte are "
+          "evicted when it is exceeded. 0 means no limit")
+         ("pending-transactions-max-per-account", bpo::value<uint32_t>()->default_value(1000),
+          "Maximum number of pending transactions paid for by one account, 0 means no limit")
+         ("change-log-interval", bpo::value<uint32_t>()->default_value(0),
+          "Save the objects that have changed to a change log every N blocks once these are irreversible, so that "
+          "after a crash the node resumes from there instead of replaying all blocks since it was last shut down. "
+          "0 disables it")
+         ("change-log-compaction-size-mb", bpo::value<uint32_t>()->default_value(256),
+          "Size of the change log in MiB at which its records are merged into one")
+         ("api-read-threads", bpo::value<uint16_t>()->default_value(0),
+          "Number of threads that run read-only API calls, e.g. get_order_book or get_full_accounts without "
+          "subscribing, so that they do not wait for block processing and vice versa. "
+          "0 runs them on the thread that handles the request")
+         ("api-read-max-items", bpo::value<uint64_t>()->default_value(default_opts.api_read_max_items),
+          "Largest number of items, e.g. accounts or orders, a read-only API call may ask for to run on the API "
+          "read threads. Larger calls run on the thread that handles the request, because block processing waits "
+          "for the calls in progress on the API read threads")
          ("api-limit-get-account-history-operations",
           bpo::value<uint64_t>()->default_value(default_opts.api_limit_get_account_history_operations),
           "For history_api::get_account_history_operations to set max limit value")
@@ -1304,6 +1518,11 @@ std::shared_ptr<chain::database> application::chain_database() const
    return my->_chain_db;
 }
 
+chain::chain_id_type application::get_genesis_chain_id() const
+{
+   return my->initialize_genesis_state().initial_chain_id;
+}
+
 void application::set_block_production(bool producing_blocks)
 {
    my->set_block_production(producing_blocks);
@@ -8,6 +8,9 @@
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/protocol/types.hpp>
 #include <graphene/net/message.hpp>
+#include <graphene/utilities/latency_histogram.hpp>
+
+#include <deque>
 
 namespace graphene { namespace app { namespace detail {
 
@@ -206,6 +209,11 @@ class application_impl : public net::node_delegate, public std::enable_shared_fr
       /// Open the chain database. Called by @ref startup.
       void open_chain_database() const;
 
+      /// Pushes the transactions received from the network in batches, see @ref handle_transaction
+      void process_ingress_queue();
+      /// Logs the latencies of the transactions from the network and the use of the signature cache once a minute
+      void report_ingress_latencies();
+
       friend class graphene::app::application;
 
       application& _self;
@@ -224,6 +232,31 @@ class application_impl : public net::node_delegate, public std::enable_shared_fr
 
       bool _is_finished_syncing = false;
 
+      /// A transaction received from the network whose signatures are being recovered on the thread pool
+      struct ingress_transaction
+      {
+         std::shared_ptr<graphene::chain::precomputable_transaction> trx;
+         fc::time_point                                              received_time;
+         fc::future<void>                                            precomputed;
+         fc::promise<void>::ptr                                      pushed;
+      };
+      std::deque<ingress_transaction> _ingress_queue;
+      fc::future<void>                _ingress_task;
+      uint32_t                        _ingress_batch_size = 64;
+      fc::microseconds                _ingress_max_delay;
+
+      /// time from the arrival of a transaction until its batch is taken up
+      graphene::utilities::latency_histogram _ingress_queue_latency;
+      /// time the batch has to wait for the signatures of a transaction after being taken up
+      graphene::utilities::latency_histogram _ingress_precompute_latency;
+      /// time spent in push_transaction
+      graphene::utilities::latency_histogram _ingress_push_latency;
+      /// time from the arrival of a transaction until it is pushed
+      graphene::utilities::latency_histogram _ingress_total_latency;
+      fc::time_point                         _ingress_last_report;
+      /// signature cache counters at the last report
+      graphene::chain::signature_cache::statistics _signature_cache_last_report;
+
       fc::serial_valve valve;
    };
 
@@ -0,0 +1,54 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <graphene/app/changed_objects_cache.hpp>
+
+namespace graphene { namespace app {
+
+using graphene::chain::account_id_type;
+using graphene::db::object_id_type;
+using fc::flat_set;
+using std::vector;
+
+changed_objects_cache::changed_objects_cache( graphene::chain::database& db )
+{
+   // connected in front of the sessions, so that the cache is emptied before they are notified
+   _new_connection = db.new_objects.connect( [this]( const vector<object_id_type>&,
+                                                     const flat_set<account_id_type>& ) {
+                                _variants.clear();
+                             }, boost::signals2::at_front );
+   _change_connection = db.changed_objects.connect( [this]( const vector<object_id_type>&,
+                                                            const flat_set<account_id_type>& ) {
+                                _variants.clear();
+                             }, boost::signals2::at_front );
+   _removed_connection = db.removed_objects.connect( [this]( const vector<object_id_type>&,
+                                                             const vector<const graphene::db::object*>&,
+                                                             const flat_set<account_id_type>& ) {
+                                _variants.clear();
+                             }, boost::signals2::at_front );
+}
+
+const fc::variant& changed_objects_cache::to_variant( const graphene::db::object& obj )
+{
+   auto itr = _variants.find( obj.id );
+   if( itr == _variants.end() )
+      itr = _variants.emplace( obj.id, obj.to_variant() ).first;
+   return itr->second;
+}
+
+} } // graphene::app
@@ -57,6 +57,11 @@ database_api_impl::database_api_impl( graphene::chain::database& db, const appli
 :_db(db), _app_options(app_options)
 {
    dlog("creating database api ${x}", ("x",int64_t(this)) );
+   // sessions which are not created by an application convert the objects on their own
+   if( _app_options != nullptr && _app_options->changed_objects )
+      _changed_objects_cache = _app_options->changed_objects;
+   else
+      _changed_objects_cache = std::make_shared<changed_objects_cache>( _db );
    _new_connection = _db.new_objects.connect([this](const vector<object_id_type>& ids,
                                                     const flat_set<account_id_type>& impacted_accounts) {
                                 on_objects_new(ids, impacted_accounts);
@@ -474,7 +479,12 @@ vector<optional<account_object>> database_api_impl::get_accounts( const vector<s
 std::map<string,full_account> database_api::get_full_accounts( const vector<string>& names_or_ids,
                                                                optional<bool> subscribe )
 {
-   return my->get_full_accounts( names_or_ids, subscribe );
+   // subscriptions belong to the session, so calls which subscribe stay on the thread of the session
+   if( my->get_whether_to_subscribe( subscribe ) )
+      return my->get_full_accounts( names_or_ids, subscribe );
+   return my->read( names_or_ids.size(), [this,&names_or_ids,&subscribe]() {
+      return my->get_full_accounts( names_or_ids, subscribe );
+   } );
 }
 
 std::map<std::string, full_account> database_api_impl::get_full_accounts( const vector<std::string>& names_or_ids,
@@ -984,7 +994,7 @@ vector<optional<extended_asset_object>> database_api_impl::lookup_asset_symbols(
 
 vector<limit_order_object> database_api::get_limit_orders(std::string a, std::string b, uint32_t limit)const
 {
-   return my->get_limit_orders( a, b, limit );
+   return my->read( limit, [this,&a,&b,limit]() { return my->get_limit_orders( a, b, limit ); } );
 }
 
 vector<limit_order_object> database_api_impl::get_limit_orders( const std::string& a, const std::string& b,
@@ -1309,7 +1319,7 @@ void database_api_impl::unsubscribe_from_market(const std::string& a, const std:
 
 market_ticker database_api::get_ticker( const string& base, const string& quote )const
 {
-    return my->get_ticker( base, quote );
+    return my->read( 1, [this,&base,&quote]() { return my->get_ticker( base, quote ); } );
 }
 
 market_ticker database_api_impl::get_ticker( const string& base, const string& quote, bool skip_order_book )const
@@ -1362,7 +1372,7 @@ market_volume database_api_impl::get_24_volume( const string& base, const string
 
 order_book database_api::get_order_book( const string& base, const string& quote, unsigned limit )const
 {
-   return my->get_order_book( base, quote, limit);
+   return my->read( limit, [this,&base,&quote,limit]() { return my->get_order_book( base, quote, limit ); } );
 }
 
 order_book database_api_impl::get_order_book( const string& base, const string& quote, unsigned limit )const
@@ -1414,7 +1424,7 @@ order_book database_api_impl::get_order_book( const string& base, const string&
 
 vector<market_ticker> database_api::get_top_markets(uint32_t limit)const
 {
-   return my->get_top_markets(limit);
+   return my->read( limit, [this,limit]() { return my->get_top_markets( limit ); } );
 }
 
 vector<market_ticker> database_api_impl::get_top_markets(uint32_t limit)const
@@ -2016,7 +2026,7 @@ set<public_key_type> database_api_impl::get_required_signatures( const signed_tr
    bool allow_non_immediate_owner = true;
    bool ignore_custom_op_reqd_auths = false;
 
-   auto result = trx.get_required_signatures( _db.get_chain_id(),
+   auto result = with_signature_keys( trx ).get_required_signatures( _db.get_chain_id(),
                                        available_keys,
                                        [&]( account_id_type id ){ return &id(_db).active; },
                                        [&]( account_id_type id ){ return &id(_db).owner; },
@@ -2054,7 +2064,7 @@ set<public_key_type> database_api_impl::get_potential_signatures( const signed_t
       return &auth;
    };
 
-   trx.get_required_signatures( _db.get_chain_id(),
+   with_signature_keys( trx ).get_required_signatures( _db.get_chain_id(),
                                 flat_set<public_key_type>(),
                                 get_active, get_owner,
                                 allow_non_immediate_owner,
@@ -2092,7 +2102,7 @@ set<address> database_api_impl::get_potential_address_signatures( const signed_t
       return &auth;
    };
 
-   trx.get_required_signatures( _db.get_chain_id(),
+   with_signature_keys( trx ).get_required_signatures( _db.get_chain_id(),
                                 flat_set<public_key_type>(),
                                 get_active, get_owner,
                                 allow_non_immediate_owner,
@@ -2109,7 +2119,7 @@ bool database_api::verify_authority( const signed_transaction& trx )const
 bool database_api_impl::verify_authority( const signed_transaction& trx )const
 {
    bool allow_non_immediate_owner = true;
-   trx.verify_authority( _db.get_chain_id(),
+   with_signature_keys( trx ).verify_authority( _db.get_chain_id(),
                          [this]( account_id_type id ){ return &id(_db).active; },
                          [this]( account_id_type id ){ return &id(_db).owner; },
                          [this]( account_id_type id, const operation& op, rejected_predicate_map* rejects ) {
@@ -2119,6 +2129,13 @@ bool database_api_impl::verify_authority( const signed_transaction& trx )const
    return true;
 }
 
+precomputable_transaction database_api_impl::with_signature_keys( const signed_transaction& trx )const
+{
+   precomputable_transaction result( trx );
+   _db.get_signature_cache().get_signature_keys( result, _db.get_chain_id() );
+   return result;
+}
+
 bool database_api::verify_account_authority( const string& account_name_or_id,
                                              const flat_set<public_key_type>& signers )const
 {
@@ -2699,7 +2716,9 @@ fc::optional<content_card_v2_object> database_api_impl::get_content_card_v2_by_i
 vector<content_card_v2_object> database_api::get_content_cards_v2( const account_id_type subject_account,
                                                              const content_card_v2_id_type content_id, uint32_t limit ) const
 {
-   return my->get_content_cards_v2(subject_account, content_id, limit);
+   return my->read( limit, [this,subject_account,content_id,limit]() {
+      return my->get_content_cards_v2( subject_account, content_id, limit );
+   } );
 }
 
 vector<content_card_v2_object> database_api_impl::get_content_cards_v2( const account_id_type subject_account,
@@ -2968,7 +2987,7 @@ void database_api_impl::handle_object_changed( bool force_notify,
                auto obj = find_object(id);
                if( obj )
                {
-                  updates.emplace_back( obj->to_variant() );
+                  updates.emplace_back( _changed_objects_cache->to_variant( *obj ) );
                }
             }
             else
@@ -23,10 +23,14 @@
  * THE SOFTWARE.
  */
 
+#include <graphene/app/api_read_pool.hpp>
+#include <graphene/app/changed_objects_cache.hpp>
 #include <graphene/app/database_api.hpp>
 
 #include <fc/bloom_filter.hpp>
 
+#include <unordered_map>
+
 #define GET_REQUIRED_FEES_MAX_RECURSION 4
 
 namespace graphene { namespace app {
@@ -249,6 +253,13 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       vector<optional<extended_asset_object>> get_assets( const vector<asset_id_type>& asset_ids,
                                                           optional<bool> subscribe = optional<bool>() )const;
 
+      ////////////////////////////////////////////////
+      // Authority / validation
+      ////////////////////////////////////////////////
+
+      // helper function, @return a copy of trx with the keys of its signatures from the signature cache
+      precomputable_transaction with_signature_keys( const signed_transaction& trx )const;
+
       ////////////////////////////////////////////////
       // Markets
       ////////////////////////////////////////////////
@@ -257,6 +268,20 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       vector<limit_order_object> get_limit_orders( const asset_id_type a, const asset_id_type b,
                                                    const uint32_t limit )const;
 
+      ////////////////////////////////////////////////
+      // Threads
+      ////////////////////////////////////////////////
+
+      // Runs a call which only reads the state and asks for the given number of items on the API read threads,
+      // or right here if there are none or the call asks for too many items
+      template<typename Call>
+      auto read( uint64_t items, Call&& call )const -> decltype( call() )
+      {
+         if( _app_options == nullptr || !_app_options->read_pool || items > _app_options->api_read_max_items )
+            return call();
+         return _app_options->read_pool->run( std::forward<Call>( call ) );
+      }
+
       ////////////////////////////////////////////////
       // Subscription
       ////////////////////////////////////////////////
@@ -338,7 +363,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 
          auto sub = _market_subscriptions.find( market );
          if( sub != _market_subscriptions.end() ) {
-            queue[market].emplace_back( full_object ? obj->to_variant() : fc::variant(obj->id, 1) );
+            queue[market].emplace_back( full_object ? _changed_objects_cache->to_variant( *obj )
+                                                    : fc::variant(obj->id, 1) );
          }
       }
 
@@ -371,6 +397,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       std::function<void(const fc::variant&)> _pending_trx_callback;
       std::function<void(const fc::variant&)> _block_applied_callback;
 
+      std::shared_ptr<changed_objects_cache> _changed_objects_cache;
+
       boost::signals2::scoped_connection _new_connection;
       boost::signals2::scoped_connection _change_connection;
       boost::signals2::scoped_connection _removed_connection;
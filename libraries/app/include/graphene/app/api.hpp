@@ -275,6 +275,17 @@ namespace graphene { namespace app {
           */
          void broadcast_transaction(const precomputable_transaction& trx);
 
+         /**
+          * @brief Broadcast a batch of transactions to the network
+          * @param trxs The transactions to broadcast, in the order they are to be applied
+          *
+          * The signatures of all transactions are checked in parallel, then the transactions are applied to the
+          * local database and broadcast one after another, in the given order, so a transaction may depend on
+          * the ones before it. If a transaction fails to apply locally, an error will be thrown, the transactions
+          * before it stay broadcast and the transactions after it will not be broadcast.
+          */
+         void broadcast_transactions(const vector<precomputable_transaction>& trxs);
+
          /** This version of broadcast transaction registers a callback method that will be called when the
           * transaction is included into a block.  The callback method includes the transaction id, block number,
           * and transaction number in the block.
@@ -652,6 +663,7 @@ FC_API(graphene::app::block_api,
      )
 FC_API(graphene::app::network_broadcast_api,
        (broadcast_transaction)
+       (broadcast_transactions)
        (broadcast_transaction_with_callback)
        (broadcast_transaction_synchronous)
        (broadcast_block)
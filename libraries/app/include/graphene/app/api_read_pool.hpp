@@ -0,0 +1,65 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace graphene { namespace app {
+
+   /**
+    *  @brief Threads which run API calls that only read the state
+    *
+    *  API calls are handled on the thread which also applies blocks and transactions, so a heavy call holds up
+    *  block processing and the other way round. Calls given to the pool run on one of its threads instead, while
+    *  holding a read scope of the database's @ref graphene::chain::state_lock. They see the state between two
+    *  changes, and the calling task waits for the result without blocking its thread.
+    *
+    *  Before the state is changed, the thread which applies blocks blocks until the calls in progress are done, so
+    *  only calls of bounded size must be given to the pool, see @ref application_options::api_read_max_items.
+    *  Calls must not change anything which is used by the thread that applies blocks, e.g. subscriptions.
+    */
+   class api_read_pool
+   {
+      public:
+         api_read_pool( graphene::chain::database& db, uint32_t num_threads );
+         ~api_read_pool();
+
+         template<typename Call>
+         auto run( Call&& call ) -> decltype( call() )
+         {
+            fc::thread& worker = *_threads[ _next++ % _threads.size() ];
+            graphene::chain::state_lock& lock = _db.get_state_lock();
+            return worker.async( [&call,&lock]() {
+               graphene::chain::state_lock::read_scope read( lock );
+               return call();
+            }, "api read" ).wait();
+         }
+
+      private:
+         graphene::chain::database&                 _db;
+         std::vector< std::unique_ptr<fc::thread> > _threads;
+         std::atomic<uint32_t>                      _next{0};
+   };
+
+} } // graphene::app
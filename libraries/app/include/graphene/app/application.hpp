@@ -34,6 +34,8 @@ namespace graphene { namespace app {
    using std::string;
 
    class abstract_plugin;
+   class api_read_pool;
+   class changed_objects_cache;
 
    class application_options
    {
@@ -43,6 +45,14 @@ namespace graphene { namespace app {
          bool has_api_helper_indexes_plugin = false;
          bool has_market_history_plugin = false;
 
+         /// Threads that run read-only API calls, if null the calls run on the thread that handles the request
+         std::shared_ptr<api_read_pool> read_pool;
+         /// Largest number of items, e.g. accounts or orders, a call may ask for to run on the @ref read_pool.
+         /// The thread which applies blocks waits for the calls in progress there, so this bounds how long it waits.
+         uint64_t api_read_max_items = 100;
+         /// Objects converted for the subscriptions, shared by all API sessions
+         std::shared_ptr<changed_objects_cache> changed_objects;
+
          uint64_t api_limit_get_account_history_operations = 100;
          uint64_t api_limit_get_account_history = 100;
          uint64_t api_limit_get_grouped_limit_orders = 101;
@@ -132,6 +142,8 @@ namespace graphene { namespace app {
 
          net::node_ptr                    p2p_node();
          std::shared_ptr<chain::database> chain_database()const;
+         /// @return the ID of the chain the node is configured for by its genesis state, known before it is opened
+         chain::chain_id_type get_genesis_chain_id()const;
          void set_api_limit();
          void set_block_production(bool producing_blocks);
          fc::optional< api_access_info > get_api_access_info( const string& username )const;
@@ -0,0 +1,49 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+
+#include <unordered_map>
+
+namespace graphene { namespace app {
+
+   /**
+    *  @brief Variants of the objects which are reported by one notification of the database
+    *
+    *  All API sessions of an application share one cache, so that a changed object is converted only once per
+    *  notification, no matter how many sessions are subscribed to it. The sessions keep copies of the variant,
+    *  which share the converted data. The cache is emptied before every notification.
+    */
+   class changed_objects_cache
+   {
+      public:
+         explicit changed_objects_cache( graphene::chain::database& db );
+
+         /// @return the variant of @p obj, valid until the end of the current notification
+         const fc::variant& to_variant( const graphene::db::object& obj );
+
+      private:
+         std::unordered_map<graphene::db::object_id_type, fc::variant> _variants;
+
+         boost::signals2::scoped_connection _new_connection;
+         boost::signals2::scoped_connection _change_connection;
+         boost::signals2::scoped_connection _removed_connection;
+   };
+
+} } // graphene::app
@@ -23,9 +23,23 @@
  */
 #include <graphene/chain/block_database.hpp>
 #include <graphene/protocol/fee_schedule.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 #include <fc/io/raw.hpp>
 #include <boost/endian/buffers.hpp>
 
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace graphene { namespace chain {
 
 struct index_entry
@@ -41,7 +55,227 @@ struct index_entry
  }}
 FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
 
-namespace graphene { namespace chain {
+namespace graphene { namespace chain { namespace detail {
+
+/**
+ * A read-only memory mapping of a file that is only ever appended to (or overwritten in place).
+ *
+ * The mapping is created larger than the file itself, so that data appended by the writer becomes visible
+ * to readers without remapping. Only when the file outgrows the mapping does the writer create a new one
+ * of twice the size. Superseded mappings are kept alive until the file is closed, so a reader that still
+ * holds a pointer into an older mapping is never invalidated, and readers never need to take a lock.
+ */
+class mapped_block_file
+{
+   public:
+      mapped_block_file( const fc::path& filename, uint64_t min_capacity )
+         : _filename( filename ), _min_capacity( min_capacity ) {}
+
+      /// Makes sure that the first @p size bytes of the file are mapped. Must only be called by the writer.
+      void reserve( uint64_t size )
+      {
+         const mapping* current = _current.load( std::memory_order_relaxed );
+         if( current != nullptr && current->capacity >= size )
+            return;
+         uint64_t capacity = ( current != nullptr ? current->capacity : _min_capacity );
+         while( capacity < size )
+            capacity *= 2;
+         std::unique_ptr<mapping> m( new mapping( _filename, capacity ) );
+         _current.store( m.get(), std::memory_order_release );
+         _mappings.push_back( std::move(m) );
+      }
+
+      /// Returns a pointer to the data at @p pos. The caller must make sure the data has been published.
+      const char* data( uint64_t pos )const
+      {
+         return _current.load( std::memory_order_acquire )->address + pos;
+      }
+
+   private:
+      struct mapping
+      {
+         mapping( const fc::path& filename, uint64_t cap )
+            : file( filename.generic_string().c_str(), fc::read_only ),
+              region( file, fc::read_only, 0, cap ),
+              address( (const char*)region.get_address() ),
+              capacity( cap ) {}
+
+         fc::file_mapping  file;
+         fc::mapped_region region;
+         const char*       address;
+         uint64_t          capacity;
+      };
+
+      const fc::path                         _filename;
+      const uint64_t                         _min_capacity;
+      std::atomic<const mapping*>            _current { nullptr };
+      std::vector<std::unique_ptr<mapping>>  _mappings;
+};
+
+/**
+ * The blocks waiting to be written by a block database with write-behind enabled.
+ *
+ * A single background thread writes the blocks in the order they were stored, so that a block which is stored
+ * again (e.g. after a fork switch) ends up on disk in its latest version. The newest queued version of each block
+ * number is kept in a map for readers, and removed from it only after it has been written and published.
+ *
+ * A block which fails to be written stays at the front of the queue and is retried every write_retry_interval.
+ * Until it is written, the error is rethrown to the callers of push() and wait(), so that no more blocks are taken
+ * on which might never reach the disk. The error is cleared once the block has been written.
+ */
+class block_write_queue
+{
+   public:
+      static constexpr std::chrono::milliseconds write_retry_interval { 500 };
+
+      struct queued_block
+      {
+         uint64_t      sequence;
+         block_id_type id;
+         signed_block  block;
+      };
+      typedef std::function<void( const block_id_type&, const signed_block& )> writer_type;
+
+      explicit block_write_queue( writer_type writer )
+         : _write( std::move(writer) )
+      {
+         _thread = std::thread( [this]() { run(); } );
+      }
+
+      /// Writes out all queued blocks before it returns
+      ~block_write_queue()
+      {
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _stop = true;
+         }
+         _queue_cv.notify_one();
+         _thread.join();
+      }
+
+      void push( const block_id_type& id, const signed_block& b )
+      {
+         auto item = std::make_shared<queued_block>();
+         item->id = id;
+         item->block = b;
+         {
+            std::lock_guard<std::mutex> lock( _mutex );
+            if( _error )
+               std::rethrow_exception( _error );
+            item->sequence = ++_queued_sequence;
+            _queue.push_back( item );
+            _by_num[ block_header::num_from_id(id) ] = item;
+         }
+         _queue_cv.notify_one();
+      }
+
+      /// @return the newest queued version of the given block number, or nullptr if it is not queued
+      std::shared_ptr<const queued_block> find( uint32_t block_num )const
+      {
+         std::lock_guard<std::mutex> lock( _mutex );
+         auto itr = _by_num.find( block_num );
+         return itr != _by_num.end() ? itr->second : nullptr;
+      }
+
+      /// Waits until the blocks queued so far with a number up to @p block_num have been written
+      void wait( uint32_t block_num )const
+      {
+         std::unique_lock<std::mutex> lock( _mutex );
+         uint64_t target = 0;
+         for( const auto& item : _queue )
+            if( block_header::num_from_id( item->id ) <= block_num )
+               target = item->sequence;
+         _written_cv.wait( lock, [this,target]() { return _written_sequence >= target || _error; } );
+         if( _error )
+            std::rethrow_exception( _error );
+      }
+
+   private:
+      void run()
+      {
+         std::unique_lock<std::mutex> lock( _mutex );
+         while( true )
+         {
+            _queue_cv.wait( lock, [this]() { return _stop || !_queue.empty(); } );
+            if( _queue.empty() )
+               return;
+            std::shared_ptr<const queued_block> item = _queue.front();
+            lock.unlock();
+            std::exception_ptr error;
+            std::string error_details;
+            try
+            {
+               _write( item->id, item->block );
+            }
+            catch( const fc::exception& e )
+            {
+               error = std::current_exception();
+               error_details = e.to_detail_string();
+            }
+            catch( const std::exception& e )
+            {
+               error = std::current_exception();
+               error_details = e.what();
+            }
+            catch( ... )
+            {
+               error = std::current_exception();
+               error_details = "unknown exception";
+            }
+            lock.lock();
+            if( error )
+            {
+               if( !_error )
+                  elog( "Unable to write block ${id}, retrying: ${e}", ("id",item->id)("e",error_details) );
+               _error = error;
+               _written_cv.notify_all();
+               if( _stop )
+               {
+                  elog( "Giving up on writing ${n} queued blocks while shutting down, starting with block ${id}",
+                        ("n",_queue.size())("id",item->id) );
+                  return;
+               }
+               _queue_cv.wait_for( lock, write_retry_interval, [this]() { return _stop; } );
+               continue;
+            }
+            if( _error )
+            {
+               ilog( "Wrote block ${id} after an error", ("id",item->id) );
+               _error = nullptr;
+            }
+            _queue.pop_front();
+            auto itr = _by_num.find( block_header::num_from_id( item->id ) );
+            if( itr != _by_num.end() && itr->second == item )
+               _by_num.erase( itr );
+            _written_sequence = item->sequence;
+            _written_cv.notify_all();
+         }
+      }
+
+      const writer_type                                            _write;
+      mutable std::mutex                                           _mutex;
+      std::condition_variable                                      _queue_cv;
+      mutable std::condition_variable                              _written_cv;
+      std::deque< std::shared_ptr<const queued_block> >            _queue;
+      std::map< uint32_t, std::shared_ptr<const queued_block> >    _by_num;
+      uint64_t                                                     _queued_sequence = 0;
+      uint64_t                                                     _written_sequence = 0;
+      std::exception_ptr                                           _error;
+      bool                                                         _stop = false;
+      std::thread                                                  _thread;
+};
+
+constexpr std::chrono::milliseconds block_write_queue::write_retry_interval;
+
+} // detail
+
+static const uint64_t min_index_mapping  = 16 * 1024 * 1024;
+static const uint64_t min_blocks_mapping = 256 * 1024 * 1024;
+
+block_database::block_database()
+   : _blocks_size(0), _index_size(0), _index_version(0), _blocks_read_pos(0) {}
+
+block_database::~block_database() = default;
 
 void block_database::open( const fc::path& dbdir )
 { try {
@@ -50,16 +284,40 @@ void block_database::open( const fc::path& dbdir )
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
    _index_filename = dbdir / "index";
+   const fc::path blocks_filename = dbdir / "blocks";
    if( !fc::exists( _index_filename ) )
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+     _blocks.open( blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
    }
    else
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+     _blocks.open( blocks_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+   }
+
+   const uint64_t index_size = fc::file_size( _index_filename );
+   const uint64_t blocks_size = fc::file_size( blocks_filename );
+
+   _index_map.reset( new detail::mapped_block_file( _index_filename, min_index_mapping ) );
+   _index_map->reserve( index_size );
+   _blocks_map.reset( new detail::mapped_block_file( blocks_filename, min_blocks_mapping ) );
+   _blocks_map->reserve( blocks_size );
+
+   if( fc::exists( dbdir / "block_log" ) )
+   {
+      _archive.reset( new block_log_reader( dbdir / "block_log" ) );
+      ilog( "Using block log archive with ${n} blocks", ("n",_archive->last_block_num()) );
    }
+
+   _blocks_read_pos.store( 0, std::memory_order_relaxed );
+   _blocks_size.store( blocks_size, std::memory_order_release );
+   _index_size.store( index_size, std::memory_order_release );
+
+   if( _write_behind )
+      _write_queue.reset( new detail::block_write_queue( [this]( const block_id_type& id, const signed_block& b ) {
+         write_block( id, b );
+      } ) );
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
 bool block_database::is_open()const
@@ -69,16 +327,31 @@ bool block_database::is_open()const
 
 void block_database::close()
 {
+  // writes out the queued blocks
+  _write_queue.reset();
+  _index_size.store( 0, std::memory_order_release );
+  _blocks_size.store( 0, std::memory_order_release );
   _blocks.close();
   _block_num_to_pos.close();
+  _index_map.reset();
+  _blocks_map.reset();
+  _archive.reset();
 }
 
 void block_database::flush()
 {
+  if( _write_queue )
+     _write_queue->wait( std::numeric_limits<uint32_t>::max() );
   _blocks.flush();
   _block_num_to_pos.flush();
 }
 
+void block_database::wait_for_writes( uint32_t block_num )const
+{
+   if( _write_queue )
+      _write_queue->wait( block_num );
+}
+
 void block_database::store( const block_id_type& _id, const signed_block& b )
 {
    block_id_type id = _id;
@@ -87,33 +360,130 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
       id = b.id();
       elog( "id argument of block_database::store() was not initialized for block ${id}", ("id", id) );
    }
-   _block_num_to_pos.seekp( sizeof( index_entry ) * int64_t(block_header::num_from_id(id)) );
-   index_entry e;
-   _blocks.seekp( 0, _blocks.end );
+   if( _write_queue )
+      _write_queue->push( id, b );
+   else
+      write_block( id, b );
+}
+
+void block_database::write_block( const block_id_type& id, const signed_block& b )
+{
+   if( _simulated_write_latency.count() > 0 )
+      std::this_thread::sleep_for( std::chrono::microseconds( _simulated_write_latency.count() ) );
+   if( _simulated_write_errors > 0 )
+   {
+      --_simulated_write_errors;
+      FC_THROW( "Simulated error writing block ${id}", ("id",id) );
+   }
+   // a failed write may have left the streams in a failed state, the block is written again at the same place
+   _blocks.clear();
+   _block_num_to_pos.clear();
    auto vec = fc::raw::pack( b );
-   e.block_pos  = _blocks.tellp();
+   index_entry e;
+   e.block_pos  = _blocks_size.load( std::memory_order_relaxed );
    e.block_size = vec.size();
    e.block_id   = id;
+
+   // The data has to reach the OS before it is published, otherwise readers of the mapping won't see it
+   _blocks.seekp( e.block_pos.value() );
    _blocks.write( vec.data(), vec.size() );
-   _block_num_to_pos.write( (char*)&e, sizeof(e) );
+   _blocks.flush();
+   const uint64_t blocks_size = e.block_pos.value() + vec.size();
+   _blocks_map->reserve( blocks_size );
+   _blocks_size.store( blocks_size, std::memory_order_release );
+
+   write_index_entry( block_header::num_from_id(id), e );
+}
+
+void block_database::write_index_entry( uint32_t block_num, const index_entry& e )
+{
+   const uint64_t index_pos = sizeof(e) * uint64_t(block_num);
+   const uint64_t index_end = index_pos + sizeof(e);
+   // An entry that readers may see already is overwritten in place, e.g. by remove() or by a block of
+   // another fork. The version is odd while that happens, so that readers retry instead of using a torn entry.
+   const bool overwrite = index_end <= _index_size.load( std::memory_order_relaxed );
+   if( overwrite )
+   {
+      _index_version.store( _index_version.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_release );
+   }
+   try
+   {
+      _block_num_to_pos.seekp( index_pos );
+      _block_num_to_pos.write( (const char*)&e, sizeof(e) );
+      _block_num_to_pos.flush();
+   }
+   catch( ... )
+   {
+      // readers would wait for the version to become even forever
+      if( overwrite )
+         _index_version.store( _index_version.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+      throw;
+   }
+   if( overwrite )
+      _index_version.store( _index_version.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+
+   if( index_end > _index_size.load( std::memory_order_relaxed ) )
+   {
+      _index_map->reserve( index_end );
+      _index_size.store( index_end, std::memory_order_release );
+   }
+}
+
+bool block_database::read_index_entry( uint32_t block_num, index_entry& e )const
+{
+   const uint64_t index_pos = sizeof(e) * uint64_t(block_num);
+   if( _index_size.load( std::memory_order_acquire ) < index_pos + sizeof(e) )
+      return false;
+   while( true )
+   {
+      const uint64_t version = _index_version.load( std::memory_order_acquire );
+      if( version % 2 == 0 )
+      {
+         std::memcpy( (char*)&e, _index_map->data( index_pos ), sizeof(e) );
+         std::atomic_thread_fence( std::memory_order_acquire );
+         if( _index_version.load( std::memory_order_relaxed ) == version )
+            return true;
+      }
+      std::this_thread::yield();
+   }
+}
+
+optional<signed_block> block_database::read_block( const index_entry& e )const
+{
+   const uint64_t block_end = e.block_pos.value() + e.block_size.value();
+   if( e.block_size.value() == 0 || block_end > _blocks_size.load( std::memory_order_acquire ) )
+      return optional<signed_block>();
+
+   fc::datastream<const char*> ds( _blocks_map->data( e.block_pos.value() ), e.block_size.value() );
+   signed_block result;
+   fc::raw::unpack( ds, result );
+   FC_ASSERT( result.id() == e.block_id );
+   _blocks_read_pos.store( ( _archive ? _archive->file_size() : 0 ) + block_end, std::memory_order_relaxed );
+   return result;
+}
+
+optional<signed_block> block_database::fetch_from_archive( uint32_t block_num )const
+{
+   if( !_archive || block_num > _archive->last_block_num() )
+      return optional<signed_block>();
+   auto result = _archive->fetch_by_number( block_num );
+   _blocks_read_pos.store( _archive->position_of( block_num ), std::memory_order_relaxed );
+   return result;
 }
 
 void block_database::remove( const block_id_type& id )
 { try {
+   flush();
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= index_pos )
+   const uint32_t block_num = block_header::num_from_id(id);
+   if( !read_index_entry( block_num, e ) )
       FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block ${id} not contained in block database", ("id", id));
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
    if( e.block_id == id )
    {
       e.block_size = 0;
-      _block_num_to_pos.seekp( sizeof(e) * int64_t(block_header::num_from_id(id)) );
-      _block_num_to_pos.write( (char*)&e, sizeof(e) );
+      write_index_entry( block_num, e );
    }
 } FC_CAPTURE_AND_RETHROW( (id) ) }
 
@@ -123,28 +493,41 @@ bool block_database::contains( const block_id_type& id )const
       return false;
 
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() < int64_t(index_pos + sizeof(e)) )
-      return false;
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   const uint32_t block_num = block_header::num_from_id(id);
+   auto queued = _write_queue ? _write_queue->find( block_num ) : nullptr;
+   if( queued )
+      return queued->id == id;
+   if( read_index_entry( block_num, e ) && e.block_size.value() > 0 )
+      return e.block_id == id;
 
-   return e.block_id == id && e.block_size.value() > 0;
+   try
+   {
+      auto block = fetch_from_archive( block_num );
+      return block.valid() && block->id() == id;
+   }
+   catch (const fc::exception&)
+   {
+   }
+   return false;
 }
 
 block_id_type block_database::fetch_block_id( uint32_t block_num )const
 {
    assert( block_num != 0 );
+   auto queued = _write_queue ? _write_queue->find( block_num ) : nullptr;
+   if( queued )
+      return queued->id;
    index_entry e;
-   int64_t index_pos = sizeof(e) * int64_t(block_num);
-   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-   if ( _block_num_to_pos.tellg() <= index_pos )
+   const bool in_index = read_index_entry( block_num, e );
+   if( !in_index || e.block_id == block_id_type() )
+   {
+      auto block = fetch_from_archive( block_num );
+      if( block.valid() )
+         return block->id();
+   }
+   if( !in_index )
       FC_THROW_EXCEPTION(fc::key_not_found_exception, "Block number ${block_num} not contained in block database", ("block_num", block_num));
 
-   _block_num_to_pos.seekg( index_pos );
-   _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
    FC_ASSERT( e.block_id != block_id_type(), "Empty block_id in block_database (maybe corrupt on disk?)" );
    return e.block_id;
 }
@@ -154,23 +537,23 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
    try
    {
       index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_header::num_from_id(id));
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
+      const uint32_t block_num = block_header::num_from_id(id);
+      auto queued = _write_queue ? _write_queue->find( block_num ) : nullptr;
+      if( queued && queued->id == id )
+         return queued->block;
+      if( queued )
+         return optional<signed_block>();
+      if( !read_index_entry( block_num, e ) || e.block_size.value() == 0 )
+      {
+         auto block = fetch_from_archive( block_num );
+         if( block.valid() && block->id() == id )
+            return block;
          return {};
-
-      _block_num_to_pos.seekg( index_pos );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
+      }
 
       if( e.block_id != id ) return optional<signed_block>();
 
-      vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      if (e.block_size.value())
-         _blocks.read( data.data(), e.block_size.value() );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      return read_block( e );
    }
    catch (const fc::exception&)
    {
@@ -185,21 +568,14 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
 {
    try
    {
+      auto queued = _write_queue ? _write_queue->find( block_num ) : nullptr;
+      if( queued )
+         return queued->block;
       index_entry e;
-      int64_t index_pos = sizeof(e) * int64_t(block_num);
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      if ( _block_num_to_pos.tellg() <= index_pos )
-         return {};
+      if( !read_index_entry( block_num, e ) || e.block_size.value() == 0 )
+         return fetch_from_archive( block_num );
 
-      _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
-      _block_num_to_pos.read( (char*)&e, sizeof(e) );
-
-      vector<char> data( e.block_size.value() );
-      _blocks.seekg( e.block_pos.value() );
-      _blocks.read( data.data(), e.block_size.value() );
-      auto result = fc::raw::unpack<signed_block>(data);
-      FC_ASSERT( result.id() == e.block_id );
-      return result;
+      return read_block( e );
    }
    catch (const fc::exception&)
    {
@@ -210,45 +586,94 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    return optional<signed_block>();
 }
 
-optional<index_entry> block_database::last_index_entry()const {
+optional<vector<char>> block_database::fetch_packed( uint32_t block_num, const block_id_type* id )const
+{
    try
    {
+      auto queued = _write_queue ? _write_queue->find( block_num ) : nullptr;
+      if( queued && ( id == nullptr || queued->id == *id ) )
+         return fc::raw::pack( queued->block );
+      if( queued )
+         return optional<vector<char>>();
       index_entry e;
+      const bool in_index = read_index_entry( block_num, e ) && e.block_size.value() > 0;
+      if( !in_index && _archive && block_num <= _archive->last_block_num() )
+      {
+         auto packed = _archive->fetch_packed( block_num );
+         if( packed.valid() && id != nullptr )
+         {
+            fc::datastream<const char*> ds( packed->data(), packed->size() );
+            signed_block_header header;
+            fc::raw::unpack( ds, header );
+            if( header.id() != *id )
+               return optional<vector<char>>();
+         }
+         _blocks_read_pos.store( _archive->position_of( block_num ), std::memory_order_relaxed );
+         return packed;
+      }
+      if( !in_index || ( id != nullptr && e.block_id != *id ) )
+         return optional<vector<char>>();
+
+      const uint64_t block_end = e.block_pos.value() + e.block_size.value();
+      if( block_end > _blocks_size.load( std::memory_order_acquire ) )
+         return optional<vector<char>>();
+
+      const char* data = _blocks_map->data( e.block_pos.value() );
+      // The header is a prefix of the packed block, checking it is enough to detect a stale or torn entry
+      fc::datastream<const char*> ds( data, e.block_size.value() );
+      signed_block_header header;
+      fc::raw::unpack( ds, header );
+      FC_ASSERT( header.id() == e.block_id );
+
+      _blocks_read_pos.store( ( _archive ? _archive->file_size() : 0 ) + block_end, std::memory_order_relaxed );
+      return vector<char>( data, data + e.block_size.value() );
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<vector<char>>();
+}
 
-      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
-      std::streampos pos = _block_num_to_pos.tellg();
-      if( pos < long(sizeof(index_entry)) )
-         return optional<index_entry>();
+optional<vector<char>> block_database::fetch_packed_optional( const block_id_type& id )const
+{
+   return fetch_packed( block_header::num_from_id(id), &id );
+}
 
+optional<vector<char>> block_database::fetch_packed_by_number( uint32_t block_num )const
+{
+   return fetch_packed( block_num, nullptr );
+}
+
+optional<index_entry> block_database::last_index_entry()const {
+   // the last block may still be queued
+   wait_for_writes( std::numeric_limits<uint32_t>::max() );
+   try
+   {
+      index_entry e;
+
+      uint64_t pos = _index_size.load( std::memory_order_acquire );
       pos -= pos % sizeof(index_entry);
 
-      _blocks.seekg( 0, _block_num_to_pos.end );
-      const std::streampos blocks_size = _blocks.tellg();
-      while( pos > 0 )
+      while( pos >= sizeof(index_entry) )
       {
          pos -= sizeof(index_entry);
-         _block_num_to_pos.seekg( pos );
-         _block_num_to_pos.read( (char*)&e, sizeof(e) );
-         if( _block_num_to_pos.gcount() == sizeof(e) && e.block_size.value() > 0
-                && int64_t(e.block_pos.value() + e.block_size.value()) <= blocks_size )
-            try
-            {
-               vector<char> data( e.block_size.value() );
-               _blocks.seekg( e.block_pos.value() );
-               _blocks.read( data.data(), e.block_size.value() );
-               if( _blocks.gcount() == long(e.block_size.value()) )
-               {
-                  const signed_block block = fc::raw::unpack<signed_block>(data);
-                  if( block.id() == e.block_id )
-                     return e;
-               }
-            }
-            catch (const fc::exception&)
-            {
-            }
-            catch (const std::exception&)
-            {
-            }
+         std::memcpy( (char*)&e, _index_map->data( pos ), sizeof(e) );
+         try
+         {
+            if( read_block( e ).valid() )
+               return e;
+         }
+         catch (const fc::exception&)
+         {
+         }
+         catch (const std::exception&)
+         {
+         }
+         // Only happens for a damaged tail at startup, i. e. before there are any concurrent readers
+         _index_size.store( pos, std::memory_order_release );
          fc::resize_file( _index_filename, pos );
       }
    }
@@ -265,6 +690,7 @@ optional<signed_block> block_database::last()const
 {
    optional<index_entry> entry = last_index_entry();
    if( entry.valid() ) return fetch_by_number( block_header::num_from_id(entry->block_id) );
+   if( _archive ) return fetch_from_archive( _archive->last_block_num() );
    return optional<signed_block>();
 }
 
@@ -272,18 +698,22 @@ optional<block_id_type> block_database::last_id()const
 {
    optional<index_entry> entry = last_index_entry();
    if( entry.valid() ) return entry->block_id;
+   if( _archive )
+   {
+      auto block = fetch_from_archive( _archive->last_block_num() );
+      if( block.valid() ) return block->id();
+   }
    return optional<block_id_type>();
 }
 
 size_t block_database::blocks_current_position()const
 {
-   return (size_t)_blocks.tellg();
+   return (size_t)_blocks_read_pos.load( std::memory_order_relaxed );
 }
 
 size_t block_database::total_block_size()const
 {
-   _blocks.seekg( 0, _blocks.end );
-   return (size_t)_blocks.tellg();
+   return (size_t)( ( _archive ? _archive->file_size() : 0 ) + _blocks_size.load( std::memory_order_acquire ) );
 }
 
 } }
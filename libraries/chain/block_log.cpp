@@ -0,0 +1,623 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <graphene/chain/block_log.hpp>
+
+#include <fc/interprocess/file_mapping.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/endian/buffers.hpp>
+
+#include <zlib.h>
+#ifdef GRAPHENE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace graphene { namespace chain {
+
+bool is_block_log_compression_supported( block_log_compression compression )
+{
+   switch( compression )
+   {
+   case block_log_compression::none:
+   case block_log_compression::zlib:
+      return true;
+#ifdef GRAPHENE_HAVE_ZSTD
+   case block_log_compression::zstd:
+      return true;
+#endif
+   default:
+      return false;
+   }
+}
+
+uint32_t block_log_checksum( const char* data, size_t size )
+{
+   uLong crc = crc32( 0, Z_NULL, 0 );
+   // crc32() takes the size as uInt, larger data is fed in pieces
+   while( size > 0 )
+   {
+      const uInt piece = (uInt)std::min<size_t>( size, 1u << 30 );
+      crc = crc32( crc, (const Bytef*)data, piece );
+      data += piece;
+      size -= piece;
+   }
+   return (uint32_t)crc;
+}
+
+vector<char> compress_block_log_data( block_log_compression compression, const vector<char>& raw )
+{
+   vector<char> result;
+   switch( compression )
+   {
+   case block_log_compression::none:
+      result = raw;
+      break;
+   case block_log_compression::zlib:
+   {
+      uLongf size = compressBound( raw.size() );
+      result.resize( size );
+      int rc = compress2( (Bytef*)result.data(), &size, (const Bytef*)raw.data(), raw.size(), Z_BEST_COMPRESSION );
+      FC_ASSERT( rc == Z_OK, "zlib compression failed with error code ${rc}", ("rc",rc) );
+      result.resize( size );
+      break;
+   }
+#ifdef GRAPHENE_HAVE_ZSTD
+   case block_log_compression::zstd:
+   {
+      result.resize( ZSTD_compressBound( raw.size() ) );
+      size_t size = ZSTD_compress( result.data(), result.size(), raw.data(), raw.size(), 19 );
+      FC_ASSERT( !ZSTD_isError( size ), "zstd compression failed: ${e}", ("e",ZSTD_getErrorName( size )) );
+      result.resize( size );
+      break;
+   }
+#endif
+   default:
+      FC_THROW( "Unsupported block log compression ${c}", ("c",compression) );
+   }
+   return result;
+}
+
+void decompress_block_log_data( block_log_compression compression, const char* stored, size_t stored_size,
+                                vector<char>& raw )
+{
+   switch( compression )
+   {
+   case block_log_compression::none:
+      FC_ASSERT( stored_size == raw.size() );
+      std::memcpy( raw.data(), stored, stored_size );
+      break;
+   case block_log_compression::zlib:
+   {
+      uLongf size = raw.size();
+      int rc = uncompress( (Bytef*)raw.data(), &size, (const Bytef*)stored, stored_size );
+      FC_ASSERT( rc == Z_OK && size == raw.size(), "zlib decompression failed with error code ${rc}", ("rc",rc) );
+      break;
+   }
+#ifdef GRAPHENE_HAVE_ZSTD
+   case block_log_compression::zstd:
+   {
+      size_t size = ZSTD_decompress( raw.data(), raw.size(), stored, stored_size );
+      FC_ASSERT( !ZSTD_isError( size ) && size == raw.size(), "zstd decompression failed" );
+      break;
+   }
+#endif
+   default:
+      FC_THROW( "Unsupported block log compression ${c}", ("c",compression) );
+   }
+}
+
+namespace detail {
+
+static const char block_log_magic[8] = { 'R', 'P', 'B', 'L', 'O', 'G', '0', '1' };
+
+struct block_log_header
+{
+   char                               magic[8];
+   boost::endian::little_uint32_buf_t compression;
+   boost::endian::little_uint32_buf_t chunk_size;
+};
+
+struct block_log_chunk_header
+{
+   boost::endian::little_uint32_buf_t stored_size;
+   boost::endian::little_uint32_buf_t raw_size;
+   boost::endian::little_uint32_buf_t first_block_num;
+   boost::endian::little_uint32_buf_t block_count;
+   boost::endian::little_uint32_buf_t checksum;       ///< crc32 of the stored (compressed) data
+};
+
+struct block_log_index_entry
+{
+   boost::endian::little_uint64_buf_t position;       ///< of the chunk header in the log
+   boost::endian::little_uint32_buf_t first_block_num;
+   boost::endian::little_uint32_buf_t block_count;
+};
+
+/// A decompressed chunk, which holds the packed blocks back to back, each prefixed by its size
+struct block_log_chunk
+{
+   uint32_t         first_block_num = 0;
+   vector<char>     data;
+   vector<uint32_t> offsets;
+   vector<uint32_t> sizes;
+};
+
+static fc::path index_filename_of( const fc::path& filename )
+{
+   return fc::path( filename.generic_string() + ".index" );
+}
+
+class block_log_writer_impl
+{
+   public:
+      std::ofstream         log;
+      std::ofstream         index;
+      block_log_compression compression;
+      uint32_t              chunk_size;
+      uint64_t              log_pos = 0;
+      uint32_t              last_block_num = 0;
+      uint32_t              blocks_in_chunk = 0;
+      vector<char>          chunk;
+
+      void write_chunk()
+      {
+         if( blocks_in_chunk == 0 )
+            return;
+
+         const vector<char> stored = compress_block_log_data( compression, chunk );
+
+         block_log_chunk_header header;
+         header.stored_size     = stored.size();
+         header.raw_size        = chunk.size();
+         header.first_block_num = last_block_num - blocks_in_chunk + 1;
+         header.block_count     = blocks_in_chunk;
+         header.checksum        = block_log_checksum( stored.data(), stored.size() );
+
+         block_log_index_entry entry;
+         entry.position        = log_pos;
+         entry.first_block_num = header.first_block_num.value();
+         entry.block_count     = blocks_in_chunk;
+
+         log.write( (const char*)&header, sizeof(header) );
+         log.write( stored.data(), stored.size() );
+         index.write( (const char*)&entry, sizeof(entry) );
+         log_pos += sizeof(header) + stored.size();
+
+         chunk.clear();
+         blocks_in_chunk = 0;
+      }
+};
+
+class block_log_reader_impl
+{
+   public:
+      block_log_reader_impl( const fc::path& fn, uint32_t read_ahead_chunks )
+         : filename( fn ), read_ahead( read_ahead_chunks )
+      {
+         const uint64_t size = fc::file_size( filename );
+         FC_ASSERT( size >= sizeof(block_log_header), "${f} is not a block log", ("f",filename) );
+         file.reset( new fc::file_mapping( filename.generic_string().c_str(), fc::read_only ) );
+         region.reset( new fc::mapped_region( *file, fc::read_only, 0, size ) );
+         data = (const char*)region->get_address();
+         data_size = size;
+
+         block_log_header header;
+         std::memcpy( (char*)&header, data, sizeof(header) );
+         FC_ASSERT( std::memcmp( header.magic, block_log_magic, sizeof(block_log_magic) ) == 0,
+                    "${f} is not a block log", ("f",filename) );
+         compression = block_log_compression( header.compression.value() );
+         FC_ASSERT( is_block_log_compression_supported( compression ),
+                    "${f} uses compression ${c}, which is not supported by this build",
+                    ("f",filename)("c",compression) );
+
+         if( !load_index() )
+         {
+            wlog( "Chunk index of block log ${f} is missing or damaged, rebuilding it", ("f",filename) );
+            rebuild_index();
+         }
+
+         worker = std::thread( [this]() { read_ahead_loop(); } );
+      }
+
+      ~block_log_reader_impl()
+      {
+         {
+            std::lock_guard<std::mutex> lock( mtx );
+            stopping = true;
+         }
+         cv.notify_all();
+         worker.join();
+      }
+
+      /// Loads the chunk index file, checks that it matches the log
+      bool load_index()
+      {
+         const fc::path index_filename = index_filename_of( filename );
+         if( !fc::exists( index_filename ) )
+            return false;
+         const uint64_t size = fc::file_size( index_filename );
+         if( size % sizeof(block_log_index_entry) != 0 )
+            return false;
+
+         chunks.resize( size / sizeof(block_log_index_entry) );
+         std::ifstream in( index_filename.generic_string().c_str(), std::ios::binary );
+         in.read( (char*)chunks.data(), size );
+         if( !in )
+            return false;
+
+         uint64_t pos = sizeof(block_log_header);
+         uint32_t next_block_num = 1;
+         for( const auto& entry : chunks )
+         {
+            block_log_chunk_header header;
+            if( entry.position.value() != pos || pos + sizeof(header) > data_size )
+               return false;
+            std::memcpy( (char*)&header, data + pos, sizeof(header) );
+            if( entry.first_block_num.value() != next_block_num
+                  || header.first_block_num.value() != next_block_num
+                  || header.block_count.value() != entry.block_count.value() )
+               return false;
+            pos += sizeof(header) + header.stored_size.value();
+            next_block_num += entry.block_count.value();
+         }
+         return pos == data_size;
+      }
+
+      /// Scans the chunk headers of the log and writes a new chunk index, ignoring an incomplete chunk at the end
+      void rebuild_index()
+      {
+         chunks.clear();
+         uint64_t pos = sizeof(block_log_header);
+         uint32_t next_block_num = 1;
+         while( pos + sizeof(block_log_chunk_header) <= data_size )
+         {
+            block_log_chunk_header header;
+            std::memcpy( (char*)&header, data + pos, sizeof(header) );
+            if( header.first_block_num.value() != next_block_num
+                  || pos + sizeof(header) + header.stored_size.value() > data_size )
+               break;
+            block_log_index_entry entry;
+            entry.position        = pos;
+            entry.first_block_num = next_block_num;
+            entry.block_count     = header.block_count.value();
+            chunks.push_back( entry );
+            pos += sizeof(header) + header.stored_size.value();
+            next_block_num += header.block_count.value();
+         }
+         if( pos != data_size )
+            wlog( "Ignoring ${n} bytes of incomplete data at the end of block log ${f}",
+                  ("n",data_size - pos)("f",filename) );
+
+         std::ofstream out( index_filename_of( filename ).generic_string().c_str(),
+                            std::ios::binary | std::ios::trunc );
+         out.write( (const char*)chunks.data(), chunks.size() * sizeof(block_log_index_entry) );
+      }
+
+      uint32_t last_block_num()const
+      {
+         if( chunks.empty() )
+            return 0;
+         return chunks.back().first_block_num.value() + chunks.back().block_count.value() - 1;
+      }
+
+      /// @return the number of the chunk that contains block_num, or chunks.size() if there is none
+      size_t find_chunk( uint32_t block_num )const
+      {
+         if( block_num == 0 || block_num > last_block_num() )
+            return chunks.size();
+         auto itr = std::upper_bound( chunks.begin(), chunks.end(), block_num,
+                                      []( uint32_t num, const block_log_index_entry& e ) {
+                                         return num < e.first_block_num.value();
+                                      } );
+         return ( itr - chunks.begin() ) - 1;
+      }
+
+      std::shared_ptr<const block_log_chunk> decode( size_t chunk_num )const
+      {
+         const uint64_t pos = chunks[chunk_num].position.value();
+         block_log_chunk_header header;
+         std::memcpy( (char*)&header, data + pos, sizeof(header) );
+         const char* stored = data + pos + sizeof(header);
+         FC_ASSERT( block_log_checksum( stored, header.stored_size.value() ) == header.checksum.value(),
+                    "Checksum mismatch in chunk ${n} of block log ${f}", ("n",chunk_num)("f",filename) );
+
+         auto result = std::make_shared<block_log_chunk>();
+         result->first_block_num = header.first_block_num.value();
+         result->data.resize( header.raw_size.value() );
+         decompress_block_log_data( compression, stored, header.stored_size.value(), result->data );
+
+         const uint32_t count = header.block_count.value();
+         result->offsets.reserve( count );
+         result->sizes.reserve( count );
+         uint64_t offset = 0;
+         for( uint32_t i = 0; i < count; ++i )
+         {
+            boost::endian::little_uint32_buf_t size;
+            FC_ASSERT( offset + sizeof(size) <= result->data.size() );
+            std::memcpy( (char*)&size, result->data.data() + offset, sizeof(size) );
+            offset += sizeof(size);
+            FC_ASSERT( offset + size.value() <= result->data.size() );
+            result->offsets.push_back( offset );
+            result->sizes.push_back( size.value() );
+            offset += size.value();
+         }
+         FC_ASSERT( offset == result->data.size() );
+         return result;
+      }
+
+      /// Must be called with mtx held
+      void add_to_cache( size_t chunk_num, const std::shared_ptr<const block_log_chunk>& chunk )
+      {
+         cache[chunk_num] = chunk;
+         // prefer dropping chunks behind the reader, then the ones farthest ahead
+         while( cache.size() > read_ahead + 2 )
+         {
+            if( cache.begin()->first < last_requested )
+               cache.erase( cache.begin() );
+            else
+               cache.erase( std::prev( cache.end() ) );
+         }
+      }
+
+      std::shared_ptr<const block_log_chunk> get_chunk( size_t chunk_num )
+      {
+         std::shared_ptr<const block_log_chunk> result;
+         std::unique_lock<std::mutex> lock( mtx );
+         last_requested = chunk_num;
+         while( !result )
+         {
+            auto itr = cache.find( chunk_num );
+            if( itr != cache.end() )
+               result = itr->second;
+            else if( pending.find( chunk_num ) != pending.end() )
+               cv.wait( lock );
+            else
+            {
+               pending.insert( chunk_num );
+               lock.unlock();
+               std::shared_ptr<const block_log_chunk> chunk;
+               try
+               {
+                  chunk = decode( chunk_num );
+               }
+               catch( ... )
+               {
+                  lock.lock();
+                  pending.erase( chunk_num );
+                  cv.notify_all();
+                  throw;
+               }
+               lock.lock();
+               pending.erase( chunk_num );
+               add_to_cache( chunk_num, chunk );
+               cv.notify_all();
+               result = chunk;
+            }
+         }
+
+         bool scheduled = false;
+         for( size_t next = chunk_num + 1; next <= chunk_num + read_ahead && next < chunks.size(); ++next )
+         {
+            if( cache.find( next ) == cache.end() && pending.find( next ) == pending.end() )
+            {
+               pending.insert( next );
+               queue.push_back( next );
+               scheduled = true;
+            }
+         }
+         if( scheduled )
+            cv.notify_all();
+         return result;
+      }
+
+      void read_ahead_loop()
+      {
+         std::unique_lock<std::mutex> lock( mtx );
+         while( true )
+         {
+            cv.wait( lock, [this]() { return stopping || !queue.empty(); } );
+            if( stopping )
+               return;
+            const size_t chunk_num = queue.front();
+            queue.pop_front();
+            lock.unlock();
+            std::shared_ptr<const block_log_chunk> chunk;
+            try
+            {
+               chunk = decode( chunk_num );
+            }
+            catch( ... )
+            {
+               // the error will be reported when the chunk is actually requested
+            }
+            lock.lock();
+            pending.erase( chunk_num );
+            if( chunk )
+               add_to_cache( chunk_num, chunk );
+            cv.notify_all();
+         }
+      }
+
+      const fc::path                          filename;
+      const uint32_t                          read_ahead;
+      std::unique_ptr<fc::file_mapping>       file;
+      std::unique_ptr<fc::mapped_region>      region;
+      const char*                             data = nullptr;
+      uint64_t                                data_size = 0;
+      block_log_compression                   compression = block_log_compression::none;
+      vector<block_log_index_entry>           chunks;
+
+      std::mutex                              mtx;
+      std::condition_variable                 cv;
+      std::map<size_t, std::shared_ptr<const block_log_chunk>> cache;
+      std::set<size_t>                        pending;
+      std::deque<size_t>                      queue;
+      size_t                                  last_requested = 0;
+      bool                                    stopping = false;
+      std::thread                             worker;
+};
+
+} // detail
+
+constexpr uint32_t block_log_writer::default_chunk_size;
+
+block_log_writer::block_log_writer( const fc::path& filename, block_log_compression compression,
+                                    uint32_t chunk_size )
+   : my( new detail::block_log_writer_impl )
+{ try {
+   FC_ASSERT( is_block_log_compression_supported( compression ),
+              "Compression ${c} is not supported by this build", ("c",compression) );
+   FC_ASSERT( chunk_size > 0 );
+   my->compression = compression;
+   my->chunk_size = chunk_size;
+
+   my->log.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   my->index.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   my->log.open( filename.generic_string().c_str(), std::ios::binary | std::ios::trunc );
+   my->index.open( detail::index_filename_of( filename ).generic_string().c_str(),
+                   std::ios::binary | std::ios::trunc );
+
+   detail::block_log_header header;
+   std::memcpy( header.magic, detail::block_log_magic, sizeof(header.magic) );
+   header.compression = uint32_t( compression );
+   header.chunk_size = chunk_size;
+   my->log.write( (const char*)&header, sizeof(header) );
+   my->log_pos = sizeof(header);
+} FC_CAPTURE_AND_RETHROW( (filename)(compression)(chunk_size) ) }
+
+block_log_writer::~block_log_writer()
+{
+   try
+   {
+      close();
+   }
+   catch( const fc::exception& e )
+   {
+      elog( "Failed to close block log: ${e}", ("e",e.to_detail_string()) );
+   }
+   catch( const std::exception& e )
+   {
+      elog( "Failed to close block log: ${e}", ("e",e.what()) );
+   }
+}
+
+void block_log_writer::append( const signed_block& b )
+{
+   append_packed( b.block_num(), fc::raw::pack( b ) );
+}
+
+void block_log_writer::append_packed( uint32_t block_num, const vector<char>& packed_block )
+{
+   FC_ASSERT( my->log.is_open(), "Block log has already been closed" );
+   FC_ASSERT( block_num == my->last_block_num + 1, "Blocks must be appended in order without gaps",
+              ("expected",my->last_block_num + 1)("got",block_num) );
+
+   boost::endian::little_uint32_buf_t size;
+   size = packed_block.size();
+   my->chunk.insert( my->chunk.end(), (const char*)&size, (const char*)&size + sizeof(size) );
+   my->chunk.insert( my->chunk.end(), packed_block.begin(), packed_block.end() );
+   my->last_block_num = block_num;
+   ++my->blocks_in_chunk;
+
+   if( my->chunk.size() >= my->chunk_size )
+      my->write_chunk();
+}
+
+void block_log_writer::close()
+{
+   if( !my->log.is_open() )
+      return;
+   my->write_chunk();
+   my->log.close();
+   my->index.close();
+}
+
+uint32_t block_log_writer::last_block_num()const
+{
+   return my->last_block_num;
+}
+
+block_log_reader::block_log_reader( const fc::path& filename, uint32_t read_ahead_chunks )
+{ try {
+   my.reset( new detail::block_log_reader_impl( filename, read_ahead_chunks ) );
+} FC_CAPTURE_AND_RETHROW( (filename) ) }
+
+block_log_reader::~block_log_reader() = default;
+
+uint32_t block_log_reader::last_block_num()const
+{
+   return my->last_block_num();
+}
+
+optional<vector<char>> block_log_reader::fetch_packed( uint32_t block_num )const
+{
+   const size_t chunk_num = my->find_chunk( block_num );
+   if( chunk_num >= my->chunks.size() )
+      return optional<vector<char>>();
+   auto chunk = my->get_chunk( chunk_num );
+   const uint32_t i = block_num - chunk->first_block_num;
+   const char* begin = chunk->data.data() + chunk->offsets[i];
+   return vector<char>( begin, begin + chunk->sizes[i] );
+}
+
+optional<signed_block> block_log_reader::fetch_by_number( uint32_t block_num )const
+{
+   const size_t chunk_num = my->find_chunk( block_num );
+   if( chunk_num >= my->chunks.size() )
+      return optional<signed_block>();
+   auto chunk = my->get_chunk( chunk_num );
+   const uint32_t i = block_num - chunk->first_block_num;
+   fc::datastream<const char*> ds( chunk->data.data() + chunk->offsets[i], chunk->sizes[i] );
+   signed_block result;
+   fc::raw::unpack( ds, result );
+   FC_ASSERT( result.block_num() == block_num, "Unexpected block in block log",
+              ("expected",block_num)("got",result.block_num()) );
+   return result;
+}
+
+uint64_t block_log_reader::position_of( uint32_t block_num )const
+{
+   const size_t chunk_num = my->find_chunk( block_num );
+   if( chunk_num >= my->chunks.size() )
+      return my->data_size;
+   return my->chunks[chunk_num].position.value();
+}
+
+uint64_t block_log_reader::file_size()const
+{
+   return my->data_size;
+}
+
+block_log_compression block_log_reader::compression()const
+{
+   return my->compression;
+}
+
+} }
@@ -27,6 +27,7 @@
 #include <graphene/chain/hardfork.hpp>
 
 #include <graphene/chain/block_summary_object.hpp>
+#include <graphene/chain/custom_authority_object.hpp>
 #include <graphene/chain/global_property_object.hpp>
 #include <graphene/chain/operation_history_object.hpp>
 
@@ -39,9 +40,13 @@
 
 #include <graphene/protocol/fee_schedule.hpp>
 
+#include <graphene/db/parallel.hpp>
+
 #include <fc/io/raw.hpp>
 #include <fc/thread/parallel.hpp>
 
+#include <map>
+
 namespace graphene { namespace chain {
 
 bool database::is_known_block( const block_id_type& id )const
@@ -72,6 +77,14 @@ optional<signed_block> database::fetch_block_by_id( const block_id_type& id )con
    return b->data;
 }
 
+optional<vector<char>> database::fetch_packed_block_by_id( const block_id_type& id )const
+{
+   auto b = _fork_db.fetch_block( id );
+   if( !b )
+      return _block_id_to_block.fetch_packed_optional(id);
+   return fc::raw::pack( b->data );
+}
+
 optional<signed_block> database::fetch_block_by_number( uint32_t num )const
 {
    auto results = _fork_db.fetch_block_by_number(num);
@@ -116,13 +129,36 @@ std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of
 bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
 //   idump((new_block.block_num())(new_block.id())(new_block.timestamp)(new_block.previous));
+   state_lock::write_scope write( _state_lock );
    bool result;
    detail::with_skip_flags( *this, skip, [&]()
    {
-      detail::without_pending_transactions( *this, std::move(_pending_tx),
+      detail::without_pending_transactions( *this, _pending_tx,
       [&]()
       {
          result = _push_block(new_block);
+         // the pending transactions are not applied here, so only changes of blocks are saved
+         if( _change_log_interval > 0 )
+         {
+            try
+            {
+               if( head_block_num() % _change_log_interval == 0 )
+                  capture_changes( head_block_num() );
+               // the state is written once it can not be undone any more, there is no undo history on disk
+               const uint32_t last_irreversible = get_dynamic_global_properties().last_irreversible_block_num;
+               if( has_captured_changes( last_irreversible ) )
+               {
+                  // the block the state is saved at must be found on disk after a crash
+                  _block_id_to_block.flush();
+                  write_changes( last_irreversible );
+               }
+            }
+            catch( const fc::exception& e )
+            {
+               // the changes are kept and written by the next attempt
+               elog( "Unable to save the changes of the state: ${e}", ("e",e.to_detail_string()) );
+            }
+         }
       });
    });
    return result;
@@ -200,11 +236,14 @@ bool database::_push_block(const signed_block& new_block)
                      auto session = _undo_db.start_undo_session();
                      apply_block( (*ritr2)->data, skip );
                      _block_id_to_block.store( (*ritr2)->id, (*ritr2)->data );
+                     _block_id_to_block.wait_for_writes( get_dynamic_global_properties().last_irreversible_block_num );
                      session.commit();
                   }
                   throw *except;
                }
          }
+         // the new fork may have made blocks irreversible which are only queued for writing so far
+         _block_id_to_block.wait_for_writes( get_dynamic_global_properties().last_irreversible_block_num );
          return true;
       }
       else return false;
@@ -216,6 +255,8 @@ bool database::_push_block(const signed_block& new_block)
       if( new_block.timestamp.sec_since_epoch() > now - 86400 )
          update_witnesses( *new_head );
       _block_id_to_block.store(new_block.id(), new_block);
+      // irreversible blocks can not be recovered from the fork database, they have to be written by now
+      _block_id_to_block.wait_for_writes( get_dynamic_global_properties().last_irreversible_block_num );
       session.commit();
    } catch ( const fc::exception& e ) {
       elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
@@ -268,6 +309,7 @@ processed_transaction database::push_transaction( const precomputable_transactio
 { try {
    // see https://github.com/bitshares/bitshares-core/issues/1573
    FC_ASSERT( fc::raw::pack_size( trx ) < (1024 * 1024), "Transaction exceeds maximum transaction size." );
+   state_lock::write_scope write( _state_lock );
    processed_transaction result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -276,8 +318,47 @@ processed_transaction database::push_transaction( const precomputable_transactio
    return result;
 } FC_CAPTURE_AND_RETHROW( (trx) ) }
 
+namespace {
+   struct operation_fee_visitor
+   {
+      typedef pair<account_id_type, asset> result_type;
+      template<typename T>
+      result_type operator()( const T& op )const { return { op.fee_payer(), op.fee }; }
+   };
+
+   /// @return the fee payer of the first operation and the fees of all operations in core asset
+   pair<account_id_type, share_type> get_core_fees( const database& db, const transaction& trx )
+   {
+      pair<account_id_type, share_type> result;
+      if( !trx.operations.empty() )
+         result.first = trx.operations.front().visit( operation_fee_visitor() ).first;
+      for( const operation& op : trx.operations )
+      {
+         const asset fee = op.visit( operation_fee_visitor() ).second;
+         if( fee.asset_id == asset_id_type() )
+            result.second += fee.amount;
+         else
+         {
+            const asset_object* fee_asset = db.find( fee.asset_id );
+            if( fee_asset != nullptr )
+               result.second += ( fee * fee_asset->options.core_exchange_rate ).amount;
+         }
+      }
+      return result;
+   }
+}
+
 processed_transaction database::_push_transaction( const precomputable_transaction& trx )
 {
+   // Check the limits of the pending transactions before spending time on applying the transaction.
+   // Fees are bounded by the maximum share supply, so the multiplication does not overflow.
+   const auto payer_and_fees = get_core_fees( *this, trx );
+   const size_t trx_size = fc::raw::pack_size( trx );
+   const uint64_t fee_per_kb = uint64_t( std::max<int64_t>( 0, payer_and_fees.second.value ) ) * 1024
+                               / std::max<size_t>( 1, trx_size );
+   if( !trx.operations.empty() )
+      _pending_tx.check_admission( payer_and_fees.first, trx_size, fee_per_kb );
+
    // If this is the first transaction pushed after applying a block, start a new undo session.
    // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
    if( !_pending_tx_session.valid() )
@@ -290,7 +371,36 @@ processed_transaction database::_push_transaction( const precomputable_transacti
 
    auto temp_session = _undo_db.start_undo_session();
    auto processed_trx = _apply_transaction( trx );
-   _pending_tx.push_back(processed_trx);
+   _pending_tx.insert( processed_trx, payer_and_fees.first, fc::raw::pack_size( processed_trx ), fee_per_kb );
+
+   if( _pending_tx.needs_eviction() )
+   {
+      // The evicted transactions must not stay applied, otherwise API calls would still see their changes, they
+      // could not be pushed again and transactions depending on them would be accepted. The pool is evicted down
+      // to 90% of its limit, so this is rare and the pending state is rebuilt right away from the remaining
+      // transactions, the new one included. If only the new transaction is evicted, its changes are undone along
+      // with the temporary session.
+      const size_t evicted = _pending_tx.evict();
+      const transaction_id_type id = processed_trx.id();
+      const bool accepted = _pending_tx.contains( id );
+      dlog( "Evicted ${n} pending transactions, ${r} remaining", ("n",evicted)("r",_pending_tx.size()) );
+      if( evicted > ( accepted ? 0 : 1 ) )
+      {
+         temp_session.undo();
+         rebuild_pending_state();
+      }
+      GRAPHENE_ASSERT( accepted, transaction_pool_full,
+                       "Pending transactions are full, the transaction has been evicted",
+                       ("id",id) );
+      if( evicted > 0 )
+      {
+         const auto& by_id = _pending_tx.indices().get<transaction_pool::by_id>();
+         auto itr = by_id.find( id );
+         FC_ASSERT( itr != by_id.end(), "The transaction depends on an evicted transaction", ("id",id) );
+         processed_trx = itr->trx;
+      }
+   }
+   _pending_tx_skip_flags |= get_node_properties().skip_flags;
 
    // notify_changed_objects();
    // The transaction applied successfully. Merge its changes into the pending block session.
@@ -301,8 +411,37 @@ processed_transaction database::_push_transaction( const precomputable_transacti
    return processed_trx;
 }
 
+void database::rebuild_pending_state()
+{
+   transaction_pool remaining;
+   _pending_tx.move_to( remaining );
+   remaining.remove_expired( head_block_time() );
+
+   _pending_tx_session.reset();
+   _pending_tx_session = _undo_db.start_undo_session();
+   _pending_tx_skip_flags = get_node_properties().skip_flags;
+   _pending_tx_stale = false;
+
+   for( const pending_transaction& entry : remaining.indices().get<transaction_pool::by_sequence>() )
+   {
+      try
+      {
+         auto temp_session = _undo_db.start_undo_session();
+         processed_transaction ptx = _apply_transaction( entry.trx );
+         temp_session.merge();
+         const uint32_t size = fc::raw::pack_size( ptx );
+         _pending_tx.insert( std::move( ptx ), entry.fee_payer, size, entry.fee_per_kb );
+      }
+      catch( const fc::exception& )
+      { // drop transactions which depended on an evicted one
+      }
+   }
+}
+
 processed_transaction database::validate_transaction( const signed_transaction& trx )
 {
+   // the transaction is applied and undone, readers on other threads must not see it in between
+   state_lock::write_scope write( _state_lock );
    auto session = _undo_db.start_undo_session();
    return _apply_transaction( trx );
 }
@@ -361,6 +500,7 @@ signed_block database::generate_block(
    uint32_t skip /* = 0 */
    )
 { try {
+   state_lock::write_scope write( _state_lock );
    signed_block result;
    detail::with_skip_flags( *this, skip, [&]()
    {
@@ -382,31 +522,9 @@ signed_block database::_generate_block(
    witness_id_type scheduled_witness = get_scheduled_witness( slot_num );
    FC_ASSERT( scheduled_witness == witness_id );
 
-   //
-   // The following code throws away existing pending_tx_session and
-   // rebuilds it by re-applying pending transactions.
-   //
-   // This rebuild is necessary because pending transactions' validity
-   // and semantics may have changed since they were received, because
-   // time-based semantics are evaluated based on the current block
-   // time.  These changes can only be reflected in the database when
-   // the value of the "when" variable is known, which means we need to
-   // re-apply pending transactions in this method.
-   //
-
-   // pop pending state (reset to head block state)
-   _pending_tx_session.reset();
-
    // Check witness signing key
    if( !(skip & skip_witness_signature) )
-   {
-      // Note: if this check failed (which won't happen in normal situations),
-      // we would have temporarily broken the invariant that
-      // _pending_tx_session is the result of applying _pending_tx.
-      // In this case, when the node received a new block,
-      // the push_block() call will re-create the _pending_tx_session.
       FC_ASSERT( witness_id(*this).signing_key == block_signing_private_key.get_public_key() );
-   }
 
    static const size_t max_partial_block_header_size = fc::raw::pack_size( signed_block_header() )
                                                        - fc::raw::pack_size( witness_id_type() ) // witness_id
@@ -417,48 +535,87 @@ signed_block database::_generate_block(
    size_t total_block_size = max_block_header_size;
 
    signed_block pending_block;
-
-   _pending_tx_session = _undo_db.start_undo_session();
-
    uint64_t postponed_tx_count = 0;
-   for( const processed_transaction& tx : _pending_tx )
-   {
-      size_t new_total_size = total_block_size + fc::raw::pack_size( tx );
 
-      // postpone transaction if it would make block too big
-      if( new_total_size > maximum_block_size )
-      {
-         postponed_tx_count++;
-         continue;
-      }
+   //
+   // The transactions of a block are applied at the time of the head block, just like the pending
+   // transactions, and _pending_tx_session is the result of applying _pending_tx in order on top of the
+   // head block.  So if all pending transactions fit into the block, they and their results can go into
+   // the block as they are, as long as every check the block generation would do has been done on them,
+   // i.e. they were not pushed with a skip flag which is not also given here.
+   //
+   // Otherwise, the following code throws away existing pending_tx_session and
+   // rebuilds it by re-applying pending transactions, the ones with the highest fees first.
+   //
+   if( _pending_tx_session.valid() && !_pending_tx_stale
+       && ( _pending_tx_skip_flags & ~skip ) == 0
+       && total_block_size + _pending_tx.total_size() <= maximum_block_size )
+   {
+      pending_block.transactions.reserve( _pending_tx.size() );
+      for( const pending_transaction& entry : _pending_tx.indices().get<transaction_pool::by_sequence>() )
+         pending_block.transactions.push_back( entry.trx );
+      total_block_size += _pending_tx.total_size();
+   }
+   else
+   {
+      // pop pending state (reset to head block state)
+      _pending_tx_session.reset();
+      _pending_tx_session = _undo_db.start_undo_session();
 
-      try
-      {
-         auto temp_session = _undo_db.start_undo_session();
-         processed_transaction ptx = _apply_transaction( tx );
+      // @return false if the transaction failed
+      auto try_include = [&]( const pending_transaction& entry, bool log_failure ) {
+         const processed_transaction& tx = entry.trx;
+         size_t new_total_size = total_block_size + entry.size;
 
-         // We have to recompute pack_size(ptx) because it may be different
-         // than pack_size(tx) (i.e. if one or more results increased
-         // their size)
-         new_total_size = total_block_size + fc::raw::pack_size( ptx );
          // postpone transaction if it would make block too big
          if( new_total_size > maximum_block_size )
          {
             postponed_tx_count++;
-            continue;
+            return true;
          }
 
-         temp_session.merge();
+         try
+         {
+            auto temp_session = _undo_db.start_undo_session();
+            processed_transaction ptx = _apply_transaction( tx );
+
+            // We have to recompute pack_size(ptx) because it may be different
+            // than pack_size(tx) (i.e. if one or more results increased
+            // their size)
+            new_total_size = total_block_size + fc::raw::pack_size( ptx );
+            // postpone transaction if it would make block too big
+            if( new_total_size > maximum_block_size )
+            {
+               postponed_tx_count++;
+               return true;
+            }
+
+            temp_session.merge();
+
+            total_block_size = new_total_size;
+            pending_block.transactions.push_back( ptx );
+         }
+         catch ( const fc::exception& e )
+         {
+            if( !log_failure )
+               return false;
+            // Do nothing, transaction will not be re-applied
+            wlog( "Transaction was not processed while generating block due to ${e}", ("e", e) );
+            wlog( "The transaction was ${t}", ("t", tx) );
+         }
+         return true;
+      };
 
-         total_block_size = new_total_size;
-         pending_block.transactions.push_back( ptx );
-      }
-      catch ( const fc::exception& e )
+      // A transaction can fail because it depends on one with a lower fee which has not been applied yet,
+      // those are tried once more in the order of arrival.
+      std::map<uint64_t, const pending_transaction*> failed;
+      for( const pending_transaction& entry : _pending_tx.indices().get<transaction_pool::by_priority>() )
       {
-         // Do nothing, transaction will not be re-applied
-         wlog( "Transaction was not processed while generating block due to ${e}", ("e", e) );
-         wlog( "The transaction was ${t}", ("t", tx) );
+         if( !try_include( entry, false ) )
+            failed[entry.sequence] = &entry;
       }
+      for( const auto& item : failed )
+         try_include( *item.second, true );
    }
    if( postponed_tx_count > 0 )
    {
@@ -466,6 +623,7 @@ signed_block database::_generate_block(
    }
 
    _pending_tx_session.reset();
+   _pending_tx_stale = !_pending_tx.empty();
 
    // We have temporarily broken the invariant that
    // _pending_tx_session is the result of applying _pending_tx, as
@@ -492,6 +650,7 @@ signed_block database::_generate_block(
  */
 void database::pop_block()
 { try {
+   state_lock::write_scope write( _state_lock );
    _pending_tx_session.reset();
    auto fork_db_head = _fork_db.head();
    FC_ASSERT( fork_db_head, "Trying to pop() from empty fork database!?" );
@@ -503,13 +662,19 @@ void database::pop_block()
       FC_ASSERT( fork_db_head, "Trying to pop() block that's not in fork database!?" );
    }
    pop_undo();
+   if( tracking_changes() )
+      discard_changes_after( head_block_num() );
+   _pending_tx_stale = !_pending_tx.empty();
    _popped_tx.insert( _popped_tx.begin(), fork_db_head->data.transactions.begin(), fork_db_head->data.transactions.end() );
 } FC_CAPTURE_AND_RETHROW() }
 
 void database::clear_pending()
 { try {
    assert( (_pending_tx.size() == 0) || _pending_tx_session.valid() );
+   state_lock::write_scope write( _state_lock );
    _pending_tx.clear();
+   _pending_tx_skip_flags = 0;
+   _pending_tx_stale = false;
    _pending_tx_session.reset();
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -561,6 +726,116 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
    return;
 }
 
+namespace {
+
+/// Outcome of verifying the authorities of a transaction against the state before its block
+struct speculative_authority_check
+{
+   bool                      verified = false;
+   /// accounts whose active or owner authority was read
+   flat_set<account_id_type> accounts;
+   /// accounts whose custom authorities were looked up
+   flat_set<account_id_type> custom_accounts;
+};
+
+/// Collects the accounts whose authorities may have been changed by the transactions applied so far
+class authority_change_tracker : public graphene::db::undo_database::change_observer
+{
+   public:
+      authority_change_tracker( undo_database& undo_db, bool attach ) : _undo_db( attach ? &undo_db : nullptr )
+      {
+         if( _undo_db != nullptr )
+            _undo_db->set_change_observer( this );
+      }
+      ~authority_change_tracker()
+      {
+         if( _undo_db != nullptr )
+            _undo_db->set_change_observer( nullptr );
+      }
+
+      virtual void on_change( const object& obj ) override
+      {
+         if( obj.id.is<account_id_type>() )
+            _accounts.insert( account_id_type( obj.id ) );
+         else if( obj.id.is<custom_authority_id_type>() )
+            _custom_accounts.insert( static_cast<const custom_authority_object&>( obj ).account );
+      }
+
+      /// @return true if anything read by @p check may have changed since it was made
+      bool conflicts_with( const speculative_authority_check& check )const
+      {
+         for( const auto& id : check.accounts )
+            if( _accounts.find( id ) != _accounts.end() )
+               return true;
+         for( const auto& id : check.custom_accounts )
+            if( _custom_accounts.find( id ) != _custom_accounts.end() )
+               return true;
+         return false;
+      }
+
+   private:
+      undo_database*            _undo_db;
+      flat_set<account_id_type> _accounts;
+      flat_set<account_id_type> _custom_accounts;
+};
+
+/**
+ * Verifies the authorities of all transactions of @p block in parallel against the current state, recording
+ * which authorities each verification has read. The database must not be modified until this returns.
+ */
+vector<speculative_authority_check> verify_authorities_speculatively( const database& db, const signed_block& block )
+{
+   vector<speculative_authority_check> checks( block.transactions.size() );
+   const auto& custom_auths = db.get_index_type<custom_authority_index>().indices().get<by_account_custom>();
+   const chain_id_type& chain_id = db.get_chain_id();
+   const uint32_t max_depth = db.get_global_properties().parameters.max_authority_depth;
+
+   auto verify = [&]( size_t first, size_t count ) {
+      for( size_t i = first; i < first + count; ++i )
+      {
+         auto& check = checks[i];
+         bool custom_auths_found = false;
+         auto get_active = [&db,&check]( account_id_type id ) {
+            check.accounts.insert( id );
+            return &id(db).active;
+         };
+         auto get_owner = [&db,&check]( account_id_type id ) {
+            check.accounts.insert( id );
+            return &id(db).owner;
+         };
+         // Custom authorities build their predicates on first use, which must not happen concurrently.
+         // Transactions that a custom authority could apply to are left to the regular check.
+         auto get_custom = [&custom_auths,&check,&custom_auths_found]( account_id_type id, const operation& op,
+                                                                        rejected_predicate_map* ) {
+            check.custom_accounts.insert( id );
+            auto range = custom_auths.equal_range( boost::make_tuple( id, unsigned_int( op.which() ), true ) );
+            if( range.first != range.second )
+               custom_auths_found = true;
+            return vector<authority>();
+         };
+         try {
+            block.transactions[i].verify_authority( chain_id, get_active, get_owner, get_custom, true, false,
+                                                    max_depth );
+            check.verified = !custom_auths_found;
+         } catch( ... ) {
+            // the transaction is checked again when it is applied, that reports the error if there is one
+         }
+      }
+   };
+
+   const uint32_t chunks = fc::asio::default_io_service_scope::get_num_threads();
+   const size_t chunk_size = ( checks.size() + chunks - 1 ) / chunks;
+   // the block is being applied, the thread must not yield to other tasks which could modify the database
+   graphene::db::run_parallel( ( checks.size() + chunk_size - 1 ) / chunk_size,
+                               [&verify,&checks,chunk_size] ( size_t chunk ) {
+      const size_t base = chunk * chunk_size;
+      verify( base, std::min( chunk_size, checks.size() - base ) );
+   });
+   return checks;
+}
+
+} // anonymous namespace
+
 void database::_apply_block( const signed_block& next_block )
 { try {
    uint32_t next_block_num = next_block.block_num();
@@ -593,15 +868,30 @@ void database::_apply_block( const signed_block& next_block )
    _current_block_num    = next_block_num;
    _current_trx_in_block = 0;
 
+   // The authorities of the transactions are verified in parallel up front, see
+   // enable_speculative_authority_checks(). A transaction is verified again when it is applied if its
+   // speculative check failed, or if an earlier transaction of the block may have changed what it has read.
+   vector<speculative_authority_check> speculative_checks;
+   if( _speculative_authority_checks && !(skip & skip_transaction_signatures) && next_block.transactions.size() > 1 )
+      speculative_checks = verify_authorities_speculatively( *this, next_block );
+   authority_change_tracker authority_changes( _undo_db, !speculative_checks.empty() );
+
    for( const auto& trx : next_block.transactions )
    {
+      uint32_t trx_skip = skip;
+      if( !speculative_checks.empty() )
+      {
+         const auto& check = speculative_checks[_current_trx_in_block];
+         if( check.verified && !authority_changes.conflicts_with( check ) )
+            trx_skip |= skip_transaction_signatures;
+      }
       /* We do not need to push the undo state for each transaction
        * because they either all apply and are valid or the
        * entire block fails to apply.  We only need an "undo" state
        * for transactions when validating broadcast transactions or
        * when building a block.
        */
-      apply_transaction( trx, skip );
+      apply_transaction( trx, trx_skip );
       ++_current_trx_in_block;
    }
 
@@ -685,6 +975,10 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
          return get_viable_custom_authorities(id, op, rejects);
       };
 
+      // transactions which have not been precomputed still get their keys from the signature cache
+      const auto* precomputable_trx = dynamic_cast<const precomputable_transaction*>( &trx );
+      if( precomputable_trx != nullptr )
+         _signature_cache.get_signature_keys( *precomputable_trx, chain_id );
       trx.verify_authority(chain_id, get_active, get_owner, get_custom, allow_non_immediate_owner,
                            false, get_global_properties().parameters.max_authority_depth);
    }
@@ -807,7 +1101,7 @@ void database::_precompute_parallel( const Trx* trx, const size_t count, const u
       if( !(skip&skip_transaction_dupe_check) )
          trx->id();
       if( !(skip&skip_transaction_signatures) )
-         trx->get_signature_keys( get_chain_id() );
+         _signature_cache.get_signature_keys( *trx, get_chain_id() );
    }
 }
 
@@ -848,6 +1142,17 @@ fc::future<void> database::precompute_parallel( const signed_block& block, const
    return *first;
 } FC_LOG_AND_RETHROW() }
 
+void database::precompute_block( const signed_block& block, const uint32_t skip )const
+{
+   if( !block.transactions.empty() )
+      _precompute_parallel( &block.transactions[0], block.transactions.size(), skip );
+   if( !(skip&skip_witness_signature) )
+      block.signee();
+   if( !(skip&skip_merkle_check) )
+      block.calculate_merkle_root();
+   block.id();
+}
+
 fc::future<void> database::precompute_parallel( const precomputable_transaction& trx )const
 {
    return fc::do_parallel([this,&trx] () {
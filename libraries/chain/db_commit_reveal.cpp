@@ -57,70 +57,32 @@ namespace graphene
          return result;
       }
 
-      uint64_t database::get_commit_reveal_seed_v2(const vector<account_id_type> &accounts) const
+      commit_reveal_window_summary database::summarize_commit_reveal_window_v2(const vector<account_id_type> &accounts) const
       {
          const auto &cr_idx = get_index_type<commit_reveal_v2_index>();
-         const auto &by_op_idx = cr_idx.indices().get<by_account>();
+         const auto &by_time_idx = cr_idx.indices().get<by_maintenance_time>();
+         const flat_set<account_id_type> wanted(accounts.begin(), accounts.end());
 
-         uint64_t seed = 0;
+         // The window holds the commits for the next maintenance, since REVPOP_13 those
+         // made during the current maintenance interval
          uint32_t maintenance_time = get_dynamic_global_properties().next_maintenance_time.sec_since_epoch();
+         uint32_t window_begin = maintenance_time;
+         uint32_t window_end = maintenance_time + 1;
          if (HARDFORK_REVPOP_13_PASSED(head_block_time()))
          {
-            uint32_t prev_maintenance_time = maintenance_time - get_global_properties().parameters.maintenance_interval;
-            for (const auto &acc : accounts)
-            {
-               auto itr = by_op_idx.lower_bound(acc);
-               if (itr != by_op_idx.end() && itr->account == acc && prev_maintenance_time <= itr->maintenance_time && itr->maintenance_time < maintenance_time)
-               {
-                  seed += itr->value;
-               }
-            }
+            window_begin = maintenance_time - get_global_properties().parameters.maintenance_interval;
+            window_end = maintenance_time;
          }
-         else
-         {
-            for (const auto &acc : accounts)
-            {
-               auto itr = by_op_idx.lower_bound(acc);
-               if (itr != by_op_idx.end() && itr->account == acc && itr->maintenance_time == maintenance_time)
-               {
-                  seed += itr->value;
-               }
-            }
-         }
-         return seed;
-      }
 
-      vector<account_id_type> database::filter_commit_reveal_participant_v2(const vector<account_id_type> &accounts) const
-      {
-         const auto &cr_idx = get_index_type<commit_reveal_v2_index>();
-         const auto &by_op_idx = cr_idx.indices().get<by_account>();
-
-         vector<account_id_type> result;
-         uint32_t maintenance_time = get_dynamic_global_properties().next_maintenance_time.sec_since_epoch();
-         if (HARDFORK_REVPOP_13_PASSED(head_block_time()))
-         {
-            uint32_t prev_maintenance_time = maintenance_time - get_global_properties().parameters.maintenance_interval;
-            for (const auto &acc : accounts)
-            {
-               auto itr = by_op_idx.lower_bound(acc);
-               if (itr != by_op_idx.end() && itr->account == acc && itr->value != 0 && prev_maintenance_time <= itr->maintenance_time && itr->maintenance_time < maintenance_time)
-
-               {
-                  result.push_back(itr->account);
-               }
-            }
-         }
-         else
+         commit_reveal_window_summary result;
+         for (auto itr = by_time_idx.lower_bound(window_begin);
+              itr != by_time_idx.end() && itr->maintenance_time < window_end; ++itr)
          {
-            for (const auto &acc : accounts)
-            {
-               auto itr = by_op_idx.lower_bound(acc);
-               if (itr != by_op_idx.end() && itr->account == acc && itr->value != 0 && itr->maintenance_time == maintenance_time)
-
-               {
-                  result.push_back(itr->account);
-               }
-            }
+            if (wanted.find(itr->account) == wanted.end())
+               continue;
+            result.seed += itr->value;
+            if (itr->value != 0)
+               result.participants.insert(itr->account);
          }
          return result;
       }
@@ -194,6 +194,7 @@ void database::apply_debug_updates()
 
 void database::debug_update( const fc::variant_object& update )
 {
+   state_lock::write_scope write( _state_lock );
    block_id_type head_id = head_block_id();
    auto it = _node_property_object.debug_updates.find( head_id );
    if( it == _node_property_object.debug_updates.end() )
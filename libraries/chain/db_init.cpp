@@ -168,20 +168,23 @@ void database::initialize_evaluators()
 void database::initialize_indexes()
 {
    reset_indexes();
+   _vote_tally_cache.invalidate();
    _undo_db.set_max_size( GRAPHENE_MIN_UNDO_HISTORY );
 
    //Protocol object indexes
    add_index< primary_index<asset_index, 13> >(); // 8192 assets per chunk
    add_index< primary_index<force_settlement_index> >();
 
-   add_index< primary_index<account_index, 20> >(); // ~1 million accounts per chunk
+   auto acnt_idx = add_index< primary_index<account_index, 20> >(); // ~1 million accounts per chunk
+   acnt_idx->add_secondary_index<vote_tally_tracker>( &_vote_tally_cache );
    add_index< primary_index<committee_member_index, 8> >(); // 256 members per chunk
    add_index< primary_index<witness_index, 10> >(); // 1024 witnesses per chunk
    add_index< primary_index<limit_order_index > >();
    add_index< primary_index<call_order_index > >();
    add_index< primary_index<proposal_index > >();
    add_index< primary_index<withdraw_permission_index > >();
-   add_index< primary_index<vesting_balance_index> >();
+   auto vbal_idx = add_index< primary_index<vesting_balance_index> >();
+   vbal_idx->add_secondary_index<vote_tally_tracker>( &_vote_tally_cache );
    add_index< primary_index<worker_index> >();
    add_index< primary_index<balance_index> >();
    add_index< primary_index<blinded_balance_index> >();
@@ -198,7 +201,8 @@ void database::initialize_indexes()
    add_index< primary_index<asset_bitasset_data_index,                 13 > >(); // 8192
    add_index< primary_index<simple_index<global_property_object          >> >();
    add_index< primary_index<simple_index<dynamic_global_property_object  >> >();
-   add_index< primary_index<account_stats_index,                       20 > >(); // 1 Mi
+   auto stats_idx = add_index< primary_index<account_stats_index,                       20 > >(); // 1 Mi
+   stats_idx->add_secondary_index<vote_tally_tracker>( &_vote_tally_cache );
    add_index< primary_index<simple_index<asset_dynamic_data_object       >> >();
    add_index< primary_index<simple_index<block_summary_object            >> >();
    add_index< primary_index<simple_index<chain_property_object          > > >();
@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 
+#include <fc/asio.hpp>
 #include <fc/uint128.hpp>
 
 #include <graphene/chain/database.hpp>
@@ -45,6 +46,8 @@
 #include <graphene/chain/worker_object.hpp>
 #include <graphene/chain/custom_authority_object.hpp>
 
+#include <graphene/db/parallel.hpp>
+
 namespace graphene { namespace chain {
 
 template<class Index>
@@ -72,7 +75,7 @@ vector<std::reference_wrapper<const typename Index::object_type>> database::sort
 }
 
 template<class Type>
-void database::perform_account_maintenance(Type tally_helper)
+void database::perform_account_maintenance(Type& tally_helper)
 {
    const auto& bal_idx = get_index_type< account_balance_index >().indices().get< by_maintenance_flag >();
    if( bal_idx.begin() != bal_idx.end() )
@@ -261,9 +264,11 @@ void database::update_active_witnesses()
    }
 
    // RevPop: seed maintenance PRNG from commit-reveal scheme or chain_id + head block number
+   commit_reveal_window_summary cr_window;
    if (HARDFORK_REVPOP_11_PASSED(head_block_time()))
    {
-      uint64_t prng_seed = get_commit_reveal_seed_v2(wits_acc);
+      cr_window = summarize_commit_reveal_window_v2(wits_acc);
+      uint64_t prng_seed = cr_window.seed;
       if (prng_seed == 0)
       {
          // Fallback: seed PRNG from chain_id + head block num
@@ -284,18 +289,18 @@ void database::update_active_witnesses()
 
    // RevPop: remove from top list witnesses without reveals
    {
-      auto wits_acc_w_reveals = HARDFORK_REVPOP_11_PASSED(head_block_time()) ?
-                     filter_commit_reveal_participant_v2(wits_acc)
-                     :
-                     filter_commit_reveal_participant(wits_acc);
+      if (!HARDFORK_REVPOP_11_PASSED(head_block_time()))
+      {
+         const auto participants = filter_commit_reveal_participant(wits_acc);
+         cr_window.participants.insert(participants.begin(), participants.end());
+      }
+      const auto& wits_acc_w_reveals = cr_window.participants;
       decltype(wits) enabled_wits;
       enabled_wits.reserve( wits_acc_w_reveals.size() );
       std::copy_if( wits.begin(), wits.end(), std::back_inserter( enabled_wits ),
                     [&wits_acc_w_reveals]( const witness_object & wits )
       {
-         return std::find( wits_acc_w_reveals.begin(),
-                           wits_acc_w_reveals.end(),
-                           wits.witness_account ) != wits_acc_w_reveals.end();
+         return wits_acc_w_reveals.find( wits.witness_account ) != wits_acc_w_reveals.end();
       });
       if( !enabled_wits.empty() )
       {
@@ -992,6 +997,23 @@ namespace detail {
       static const vote_recalc_options worker();
       static const vote_recalc_options delegator();
 
+      /// @return the first time after @p now at which get_recalced_voting_stake() returns a different stake
+      time_point_sec get_next_recalc_time( const time_point_sec last_vote_time, const time_point_sec now ) const
+      {
+         const uint64_t first_step = uint64_t( last_vote_time.sec_since_epoch() ) + full_power_seconds;
+         uint64_t next = first_step;
+         if( now.sec_since_epoch() >= first_step )
+         {
+            const uint64_t steps = ( now.sec_since_epoch() - first_step ) / seconds_per_step + 1;
+            if( steps >= recalc_steps ) // already recalced to zero
+               return time_point_sec::maximum();
+            next += steps * seconds_per_step;
+         }
+         if( next >= time_point_sec::maximum().sec_since_epoch() )
+            return time_point_sec::maximum();
+         return time_point_sec( static_cast<uint32_t>( next ) );
+      }
+
       // return the stake that is "recalced to X"
       uint64_t get_recalced_voting_stake( const uint64_t stake, const time_point_sec last_vote_time,
                                          const vote_recalc_times& recalc_times ) const
@@ -1029,6 +1051,17 @@ namespace detail {
       static const vote_recalc_options o( 360*86400, 8, 45*86400 );
       return o;
    }
+
+   /// Below this number of voters per shard the vote tally is not worth spreading across threads
+   static constexpr size_t min_voters_per_tally_shard = 2000;
+
+   /// An account whose stake takes part in the vote tally
+   struct vote_tally_voter
+   {
+      const account_object*            stake_account;
+      const account_statistics_object* stats;
+      uint64_t                         cashback; ///< cashback vesting balance when the account was visited
+   };
 }
 
 void database::perform_chain_maintenance(const signed_block& next_block, const global_property_object& global_props)
@@ -1045,6 +1078,8 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
       const dynamic_global_property_object& dprops;
       const time_point_sec now;
       const bool pob_activated;
+      vote_tally_cache& cache;
+      vote_tally_parameters parameters;
 
       optional<detail::vote_recalc_times> witness_recalc_times;
       optional<detail::vote_recalc_times> committee_recalc_times;
@@ -1053,18 +1088,27 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
 
       vector<account_id_type> committee_members;
 
+      /// Whether all votes are counted, otherwise only those of accounts which changed since the last tally
+      bool full_recount = true;
+      /// Accounts which changed since the last tally, taken from the cache once balances are up to date
+      vote_tally_cache::account_set changed;
+      bool changes_taken = false;
+      /// Accounts to count, with their cashback balance when they were visited
+      vector<detail::vote_tally_voter> voters;
+      /// All voting accounts in maintenance order, only recorded to check the incremental tally
+      vector<detail::vote_tally_voter> all_voters;
+      bool done = false;
+
       vote_tally_helper( database& db )
          : d(db), props( d.get_global_properties() ), dprops( d.get_dynamic_global_properties() ),
            now( d.head_block_time() ),
-           pob_activated( dprops.total_pob > 0 || dprops.total_inactive > 0 )
+           pob_activated( dprops.total_pob > 0 || dprops.total_inactive > 0 ),
+           cache( d._vote_tally_cache )
       {
-         d._vote_tally_buffer.resize( props.next_available_vote_id, 0 );
-         d._cm_vote_for_worker_buffer.resize( props.next_available_vote_id, 0 );
-         d._cm_support_worker_buffer.resize( props.next_available_vote_id, {} );
-         d._witness_count_histogram_buffer.resize( props.parameters.maximum_witness_count / 2 + 1, 0 );
-         d._committee_count_histogram_buffer.resize( props.parameters.maximum_committee_count / 2 + 1, 0 );
-         d._total_voting_stake[0] = 0;
-         d._total_voting_stake[1] = 0;
+         parameters.pob_activated = pob_activated;
+         parameters.next_available_vote_id = props.next_available_vote_id;
+         parameters.maximum_witness_count = props.parameters.maximum_witness_count;
+         parameters.maximum_committee_count = props.parameters.maximum_committee_count;
          witness_recalc_times   = detail::vote_recalc_options::witness().get_vote_recalc_times( now );
          committee_recalc_times = detail::vote_recalc_options::committee().get_vote_recalc_times( now );
          worker_recalc_times    = detail::vote_recalc_options::worker().get_vote_recalc_times( now );
@@ -1083,142 +1127,345 @@ void database::perform_chain_maintenance(const signed_block& next_block, const g
             ilog( "         - ${n}", ("n", c(d).name) );
          }
          */
+
+         // Membership expires over time, so it is only tracked by recounting everything
+         full_recount = !d._incremental_vote_tally || !cache.is_valid() || cache.parameters() != parameters
+                        || now < cache.tally_time() || !props.parameters.count_non_member_votes;
+         cache.start_tracking();
       }
 
+      ~vote_tally_helper()
+      {
+         // the tally failed, the changes still have to be counted next time
+         if( !done )
+            for( account_id_type account : changed )
+               cache.mark( account );
+      }
+
+      /**
+       * Called for every voting account in maintenance order, interleaved with process_fees(). Paying out fees
+       * may deposit cashback to any account, so the cashback balance is recorded here. Nothing else the tally
+       * reads is changed by process_fees(), so the votes themselves are counted afterwards by @ref tally.
+       *
+       * Unless all votes are recounted, only accounts which changed are recorded; changes made by
+       * process_fees() before an account is visited are included.
+       */
       void operator()( const account_object& stake_account, const account_statistics_object& stats )
       {
-         // PoB activation
-         if( pob_activated && stats.total_core_pob == 0 && stats.total_core_inactive == 0 )
+         take_changes();
+         const bool count = full_recount || changed.find( stake_account.id ) != changed.end()
+                            || cache.is_marked( stake_account.id );
+         if( !count && !d._check_vote_tally )
             return;
 
-         if( props.parameters.count_non_member_votes || stake_account.is_member( now ) )
+         const detail::vote_tally_voter voter { &stake_account, &stats,
+               stake_account.cashback_vb.valid()
+                  ? static_cast<uint64_t>( (*stake_account.cashback_vb)(d).balance.amount.value )
+                  : 0 };
+         if( count )
+            voters.push_back( voter );
+         if( d._check_vote_tally )
+            all_voters.push_back( voter );
+      }
+
+      /// Takes the changes, after perform_account_maintenance() has updated the balances of the accounts
+      void take_changes()
+      {
+         if( changes_taken )
+            return;
+         changed = cache.take_marks();
+         changes_taken = true;
+      }
+
+      /**
+       * Updates the tally in the cache with the recorded voters, and with the voters whose contribution
+       * depends on a changed account, has decayed or depends on a change of the committee, then copies the
+       * tally into the database buffers.
+       *
+       * Contributions are computed in @p shards ranges of voters in parallel; 0 picks the number of shards by
+       * the number of voters and threads.
+       */
+      void tally( uint32_t shards )
+      {
+         take_changes();
+         if( full_recount )
+            cache.reset( parameters );
+         else
          {
-            // There may be a difference between the account whose stake is voting and the one specifying opinions.
-            // Usually they're the same, but if the stake account has specified a voting_account, that account is the
-            // one specifying the opinions.
-            bool directly_voting = ( stake_account.options.voting_account == GRAPHENE_PROXY_TO_SELF_ACCOUNT );
-            const account_object& opinion_account = ( directly_voting ? stake_account
-                                                      : d.get(stake_account.options.voting_account) );
-
-            uint64_t voting_stake[3]; // 0=committee, 1=witness, 2=worker, as in vote_id_type::vote_type
-            uint64_t num_committee_voting_stake; // number of committee members
-            voting_stake[2] = ( pob_activated ? 0 : stats.total_core_in_orders.value )
-                  + (stake_account.cashback_vb.valid() ? (*stake_account.cashback_vb)(d).balance.amount.value: 0)
-                  + stats.core_in_balance.value;
-
-            //PoB
-            const uint64_t pol_amount = stats.total_core_pol.value;
-            const uint64_t pol_value = stats.total_pol_value.value;
-            const uint64_t pob_amount = stats.total_core_pob.value;
-            const uint64_t pob_value = stats.total_pob_value.value;
-            if( pob_amount == 0 )
+            vote_tally_cache::account_set counted;
+            for( const auto& voter : voters )
+               counted.insert( voter.stake_account->id );
+            // changed accounts which have not been visited do not vote any more
+            for( account_id_type account : changed )
+               if( counted.insert( account ).second )
+                  cache.remove( account );
+
+            // All other voting accounts have been visited without having changed until then, so the cashback
+            // balance they have last been counted with is the one they had when visited
+            auto count_again = [this,&counted]( account_id_type account ) {
+               if( !counted.insert( account ).second )
+                  return;
+               const vote_tally_contribution* last = cache.find( account );
+               if( last == nullptr )
+                  return;
+               const account_object& stake_account = account(d);
+               voters.push_back( { &stake_account, &stake_account.statistics(d), last->cashback } );
+            };
+            for( account_id_type account : changed )
             {
-               voting_stake[2] += pol_value;
+               const flat_set<account_id_type>* delegators = cache.delegators_of( account );
+               if( delegators != nullptr )
+                  for( account_id_type delegator : *delegators )
+                     count_again( delegator );
             }
-            else if( pol_amount == 0 ) // and pob_amount > 0
+            for( account_id_type account : cache.expired( now ) )
+               count_again( account );
+            vector<account_id_type> committee_changes;
+            std::set_symmetric_difference( committee_members.begin(), committee_members.end(),
+                                           cache.committee_members().begin(), cache.committee_members().end(),
+                                           std::back_inserter( committee_changes ) );
+            for( account_id_type account : committee_changes )
+               count_again( account );
+         }
+
+         vector<vote_tally_contribution> contributions = compute( voters, shards );
+         for( size_t i = 0; i < voters.size(); ++i )
+            cache.update( voters[i].stake_account->id, std::move( contributions[i] ) );
+         cache.set_valid( now, committee_members );
+         done = true;
+
+         d._vote_tally_buffer                = cache.vote_tally();
+         d._witness_count_histogram_buffer   = cache.witness_count_histogram();
+         d._committee_count_histogram_buffer = cache.committee_count_histogram();
+         d._total_voting_stake[0] = cache.total_voting_stake()[0];
+         d._total_voting_stake[1] = cache.total_voting_stake()[1];
+         count_committee_votes( cache, d._cm_vote_for_worker_buffer, d._cm_support_worker_buffer );
+
+         if( d._check_vote_tally )
+            check( shards );
+      }
+
+      /// Adds up the worker votes of committee members in maintenance order, i.e. by account name
+      void count_committee_votes( const vote_tally_cache& tally, vector<uint64_t>& cm_vote_for_worker,
+                                  vector<vector<account_id_type>>& cm_support_worker )const
+      {
+         cm_vote_for_worker.assign( parameters.next_available_vote_id, 0 );
+         cm_support_worker.assign( parameters.next_available_vote_id, {} );
+
+         vector<const account_object*> members;
+         for( account_id_type account : committee_members )
+            if( tally.find( account ) != nullptr )
+               members.push_back( &account(d) );
+         std::sort( members.begin(), members.end(), []( const account_object* a, const account_object* b ) {
+            return a->name < b->name;
+         });
+         for( const account_object* member : members )
+         {
+            for( const auto& vote : tally.find( member->id )->cm_worker_votes )
             {
-               if( pob_amount <= voting_stake[2] )
-               {
-                  voting_stake[2] += ( pob_value - pob_amount );
-               }
-               else
-               {
-                  auto base_value = static_cast<fc::uint128_t>( voting_stake[2] ) * pob_value / pob_amount;
-                  voting_stake[2] = static_cast<uint64_t>( base_value );
-               }
+               cm_vote_for_worker[vote.first] += vote.second;
+               cm_support_worker[vote.first].push_back( member->id );
             }
-            else if( pob_amount <= pol_amount ) // pob_amount > 0 && pol_amount > 0
+         }
+      }
+
+      /// Compares the tally with a full recount
+      void check( uint32_t shards )const
+      {
+         vote_tally_cache full;
+         full.reset( parameters );
+         vector<vote_tally_contribution> contributions = compute( all_voters, shards );
+         for( size_t i = 0; i < all_voters.size(); ++i )
+            full.update( all_voters[i].stake_account->id, std::move( contributions[i] ) );
+         vector<uint64_t> cm_vote_for_worker;
+         vector<vector<account_id_type>> cm_support_worker;
+         count_committee_votes( full, cm_vote_for_worker, cm_support_worker );
+
+         FC_ASSERT( full.vote_tally() == cache.vote_tally()
+                    && full.witness_count_histogram() == cache.witness_count_histogram()
+                    && full.committee_count_histogram() == cache.committee_count_histogram()
+                    && full.total_voting_stake()[0] == cache.total_voting_stake()[0]
+                    && full.total_voting_stake()[1] == cache.total_voting_stake()[1]
+                    && cm_vote_for_worker == d._cm_vote_for_worker_buffer
+                    && cm_support_worker == d._cm_support_worker_buffer,
+                    "Incremental vote tally differs from a full recount" );
+      }
+
+      /// Computes the contributions of @p list, split into @p shards ranges which are computed in parallel
+      vector<vote_tally_contribution> compute( const vector<detail::vote_tally_voter>& list, uint32_t shards )const
+      {
+         vector<vote_tally_contribution> results( list.size() );
+         if( shards == 0 )
+            shards = std::min<size_t>( fc::asio::default_io_service_scope::get_num_threads(),
+                                       list.size() / detail::min_voters_per_tally_shard );
+         shards = std::max<size_t>( 1, std::min<size_t>( shards, list.size() ) );
+         const size_t shard_size = ( list.size() + shards - 1 ) / shards;
+
+         if( shards <= 1 )
+         {
+            for( size_t i = 0; i < list.size(); ++i )
+               results[i] = contribution_of( list[i] );
+            return results;
+         }
+
+         // Maintenance must not yield the thread, other tasks of it could modify the database in the meantime
+         graphene::db::run_parallel( ( list.size() + shard_size - 1 ) / shard_size,
+                                     [this,&list,&results,shard_size] ( size_t shard ) {
+            const size_t base = shard * shard_size;
+            for( size_t i = base; i < std::min( base + shard_size, list.size() ); ++i )
+               results[i] = contribution_of( list[i] );
+         });
+         return results;
+      }
+
+      /// Computes what the stake of one account adds to the tally, only reading from the database
+      vote_tally_contribution contribution_of( const detail::vote_tally_voter& voter )const
+      {
+         const account_object& stake_account = *voter.stake_account;
+         const account_statistics_object& stats = *voter.stats;
+         vote_tally_contribution c;
+         c.opinion_account = stake_account.id;
+         c.cashback = voter.cashback;
+
+         // PoB activation
+         if( pob_activated && stats.total_core_pob == 0 && stats.total_core_inactive == 0 )
+            return c;
+
+         if( !props.parameters.count_non_member_votes && !stake_account.is_member( now ) )
+            return c;
+
+         // There may be a difference between the account whose stake is voting and the one specifying opinions.
+         // Usually they're the same, but if the stake account has specified a voting_account, that account is the
+         // one specifying the opinions.
+         bool directly_voting = ( stake_account.options.voting_account == GRAPHENE_PROXY_TO_SELF_ACCOUNT );
+         const account_object& opinion_account = ( directly_voting ? stake_account
+                                                   : d.get(stake_account.options.voting_account) );
+         c.opinion_account = opinion_account.id;
+
+         uint64_t voting_stake[3]; // 0=committee, 1=witness, 2=worker, as in vote_id_type::vote_type
+         uint64_t num_committee_voting_stake; // number of committee members
+         voting_stake[2] = ( pob_activated ? 0 : stats.total_core_in_orders.value )
+               + voter.cashback
+               + stats.core_in_balance.value;
+
+         //PoB
+         const uint64_t pol_amount = stats.total_core_pol.value;
+         const uint64_t pol_value = stats.total_pol_value.value;
+         const uint64_t pob_amount = stats.total_core_pob.value;
+         const uint64_t pob_value = stats.total_pob_value.value;
+         if( pob_amount == 0 )
+         {
+            voting_stake[2] += pol_value;
+         }
+         else if( pol_amount == 0 ) // and pob_amount > 0
+         {
+            if( pob_amount <= voting_stake[2] )
             {
-               auto base_value = static_cast<fc::uint128_t>( pob_value ) * pol_value / pol_amount;
-               auto diff_value = static_cast<fc::uint128_t>( pob_amount ) * pol_value / pol_amount;
-               base_value += ( pol_value - diff_value );
-               voting_stake[2] += static_cast<uint64_t>( base_value );
+               voting_stake[2] += ( pob_value - pob_amount );
             }
-            else // pob_amount > pol_amount > 0
+            else
             {
-               auto base_value = static_cast<fc::uint128_t>( pol_value ) * pob_value / pob_amount;
-               fc::uint128_t diff_amount = pob_amount - pol_amount;
-               if( diff_amount <= voting_stake[2] )
-               {
-                  auto diff_value = static_cast<fc::uint128_t>( pol_amount ) * pob_value / pob_amount;
-                  base_value += ( pob_value - diff_value );
-                  voting_stake[2] += static_cast<uint64_t>( base_value - diff_amount );
-               }
-               else // diff_amount > voting_stake[2]
-               {
-                  base_value += static_cast<fc::uint128_t>( voting_stake[2] ) * pob_value / pob_amount;
-                  voting_stake[2] = static_cast<uint64_t>( base_value );
-               }
+               auto base_value = static_cast<fc::uint128_t>( voting_stake[2] ) * pob_value / pob_amount;
+               voting_stake[2] = static_cast<uint64_t>( base_value );
             }
-
-            // Shortcut
-            if( voting_stake[2] == 0 )
-               return;
-
-            // Recalculate votes
-            if( !directly_voting )
+         }
+         else if( pob_amount <= pol_amount ) // pob_amount > 0 && pol_amount > 0
+         {
+            auto base_value = static_cast<fc::uint128_t>( pob_value ) * pol_value / pol_amount;
+            auto diff_value = static_cast<fc::uint128_t>( pob_amount ) * pol_value / pol_amount;
+            base_value += ( pol_value - diff_value );
+            voting_stake[2] += static_cast<uint64_t>( base_value );
+         }
+         else // pob_amount > pol_amount > 0
+         {
+            auto base_value = static_cast<fc::uint128_t>( pol_value ) * pob_value / pob_amount;
+            fc::uint128_t diff_amount = pob_amount - pol_amount;
+            if( diff_amount <= voting_stake[2] )
             {
-               voting_stake[2] = detail::vote_recalc_options::delegator().get_recalced_voting_stake(
-                                       voting_stake[2], stats.last_vote_time, *delegator_recalc_times );
+               auto diff_value = static_cast<fc::uint128_t>( pol_amount ) * pob_value / pob_amount;
+               base_value += ( pob_value - diff_value );
+               voting_stake[2] += static_cast<uint64_t>( base_value - diff_amount );
             }
-            const account_statistics_object& opinion_account_stats = ( directly_voting ? stats
-                                       : opinion_account.statistics( d ) );
-            voting_stake[1] = detail::vote_recalc_options::witness().get_recalced_voting_stake(
-                                 voting_stake[2], opinion_account_stats.last_vote_time, *witness_recalc_times );
-            voting_stake[0] = detail::vote_recalc_options::committee().get_recalced_voting_stake(
-                                 voting_stake[2], opinion_account_stats.last_vote_time, *committee_recalc_times );
-            num_committee_voting_stake = voting_stake[0];
-            if( opinion_account.num_committee_voted > 1 )
-               voting_stake[0] /= opinion_account.num_committee_voted;
-            voting_stake[2] = detail::vote_recalc_options::worker().get_recalced_voting_stake(
-                                 voting_stake[2], opinion_account_stats.last_vote_time, *worker_recalc_times );
-
-            bool is_committee_members = false;
-            const account_id_type account = stake_account.id;
-            auto itr = std::lower_bound(committee_members.begin(), committee_members.end(), account);
-            if( itr != committee_members.end() && *itr == account ) is_committee_members = true;
-            for( vote_id_type id : opinion_account.options.votes )
+            else // diff_amount > voting_stake[2]
             {
-               uint32_t offset = id.instance();
-               uint32_t type = std::min( id.type(), vote_id_type::vote_type::worker ); // cap the data
-               // if they somehow managed to specify an illegal offset, ignore it.
-               if( offset >= d._vote_tally_buffer.size()
-                  || offset >= d._cm_vote_for_worker_buffer.size()
-                  || offset >= d._cm_support_worker_buffer.size() )
-                  continue;
-
-               if (is_committee_members && type == vote_id_type::vote_type::worker)
-               {
-                  // Add up only the committee members votes
-                  d._cm_vote_for_worker_buffer[offset] += voting_stake[type];
-                  d._cm_support_worker_buffer[offset].push_back(account);
-               }
-
-               d._vote_tally_buffer[offset] += voting_stake[type];
+               base_value += static_cast<fc::uint128_t>( voting_stake[2] ) * pob_value / pob_amount;
+               voting_stake[2] = static_cast<uint64_t>( base_value );
             }
+         }
 
-            // votes for a number greater than maximum_witness_count are skipped here
-            if( voting_stake[1] > 0
-                  && opinion_account.options.num_witness <= props.parameters.maximum_witness_count )
-            {
-               uint16_t offset = opinion_account.options.num_witness / 2;
-               d._witness_count_histogram_buffer[offset] += voting_stake[1];
-            }
-            // votes for a number greater than maximum_committee_count are skipped here
-            if( num_committee_voting_stake > 0
-                  && opinion_account.options.num_committee <= props.parameters.maximum_committee_count )
+         // Shortcut
+         if( voting_stake[2] == 0 )
+            return c;
+
+         // Recalculate votes
+         if( !directly_voting )
+         {
+            voting_stake[2] = detail::vote_recalc_options::delegator().get_recalced_voting_stake(
+                                    voting_stake[2], stats.last_vote_time, *delegator_recalc_times );
+            c.valid_until = detail::vote_recalc_options::delegator().get_next_recalc_time(
+                                    stats.last_vote_time, now );
+         }
+         const account_statistics_object& opinion_account_stats = ( directly_voting ? stats
+                                    : opinion_account.statistics( d ) );
+         voting_stake[1] = detail::vote_recalc_options::witness().get_recalced_voting_stake(
+                              voting_stake[2], opinion_account_stats.last_vote_time, *witness_recalc_times );
+         voting_stake[0] = detail::vote_recalc_options::committee().get_recalced_voting_stake(
+                              voting_stake[2], opinion_account_stats.last_vote_time, *committee_recalc_times );
+         num_committee_voting_stake = voting_stake[0];
+         if( opinion_account.num_committee_voted > 1 )
+            voting_stake[0] /= opinion_account.num_committee_voted;
+         voting_stake[2] = detail::vote_recalc_options::worker().get_recalced_voting_stake(
+                              voting_stake[2], opinion_account_stats.last_vote_time, *worker_recalc_times );
+         c.valid_until = std::min( { c.valid_until,
+               detail::vote_recalc_options::witness().get_next_recalc_time( opinion_account_stats.last_vote_time, now ),
+               detail::vote_recalc_options::committee().get_next_recalc_time( opinion_account_stats.last_vote_time, now ),
+               detail::vote_recalc_options::worker().get_next_recalc_time( opinion_account_stats.last_vote_time, now ) } );
+
+         bool is_committee_members = false;
+         const account_id_type account = stake_account.id;
+         auto itr = std::lower_bound(committee_members.begin(), committee_members.end(), account);
+         if( itr != committee_members.end() && *itr == account ) is_committee_members = true;
+         c.votes.reserve( opinion_account.options.votes.size() );
+         for( vote_id_type id : opinion_account.options.votes )
+         {
+            uint32_t offset = id.instance();
+            uint32_t type = std::min( id.type(), vote_id_type::vote_type::worker ); // cap the data
+            // if they somehow managed to specify an illegal offset, ignore it.
+            if( offset >= parameters.next_available_vote_id )
+               continue;
+
+            if (is_committee_members && type == vote_id_type::vote_type::worker)
             {
-               uint16_t offset = opinion_account.options.num_committee / 2;
-               d._committee_count_histogram_buffer[offset] += num_committee_voting_stake;
+               // Add up only the committee members votes
+               c.cm_worker_votes.emplace_back( offset, voting_stake[type] );
             }
 
-            d._total_voting_stake[0] += num_committee_voting_stake;
-            d._total_voting_stake[1] += voting_stake[1];
+            c.votes.emplace_back( offset, voting_stake[type] );
          }
+
+         // votes for a number greater than maximum_witness_count are skipped here
+         if( voting_stake[1] > 0
+               && opinion_account.options.num_witness <= props.parameters.maximum_witness_count )
+         {
+            uint16_t offset = opinion_account.options.num_witness / 2;
+            c.witness_count = std::make_pair( offset, voting_stake[1] );
+         }
+         // votes for a number greater than maximum_committee_count are skipped here
+         if( num_committee_voting_stake > 0
+               && opinion_account.options.num_committee <= props.parameters.maximum_committee_count )
+         {
+            uint16_t offset = opinion_account.options.num_committee / 2;
+            c.committee_count = std::make_pair( offset, num_committee_voting_stake );
+         }
+
+         c.total_voting_stake[0] = num_committee_voting_stake;
+         c.total_voting_stake[1] = voting_stake[1];
+         return c;
       }
    } tally_helper(*this);
 
    perform_account_maintenance( tally_helper );
+   tally_helper.tally( _vote_tally_shards );
 
    struct clear_canary {
       clear_canary(vector<uint64_t>& target): target(target){}
@@ -31,12 +31,16 @@
 
 #include <graphene/protocol/fee_schedule.hpp>
 
+#include <fc/asio.hpp>
 #include <fc/io/fstream.hpp>
+#include <fc/thread/parallel.hpp>
+#include <fc/thread/thread.hpp>
 
+#include <atomic>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <queue>
 #include <tuple>
 
 namespace graphene { namespace chain {
@@ -52,6 +56,31 @@ database::~database()
    clear_pending();
 }
 
+namespace {
+
+/// A block on its way through the replay pipeline
+struct replay_item
+{
+   explicit replay_item( uint32_t num ) : block_num( num ) {}
+
+   const uint32_t               block_num;
+   size_t                       position = 0;     ///< in the block database before this block was read
+   size_t                       packed_size = 0;
+   optional<signed_block>       block;            ///< empty if the block could not be read or unpacked
+   fc::future<fc::future<void>> ready;            ///< the read, which yields the unpack/precompute task
+};
+
+/// Time spent in the individual stages of the replay pipeline, in microseconds
+struct replay_stats
+{
+   std::atomic<int64_t> read_time { 0 };
+   std::atomic<int64_t> precompute_time { 0 };
+   int64_t              apply_time = 0;
+   int64_t              wait_time = 0;
+};
+
+} // anonymous namespace
+
 void database::reindex( fc::path data_dir )
 { try {
    auto last_block = _block_id_to_block.last();
@@ -77,29 +106,101 @@ void database::reindex( fc::path data_dir )
       _undo_db.disable();
 
    uint32_t skip = node_properties().skip_flags;
+   const uint32_t precompute_skip = skip;
+   const fc::time_point_sec dupe_check_start = last_block->timestamp
+                                               - get_global_properties().parameters.maximum_time_until_expiration;
+
+   // The replay runs in three stages: blocks are read from disk one after the other by a dedicated thread,
+   // unpacked and precomputed on the thread pool, and applied in order on this thread.
+   // The number of blocks in flight adapts to how long the apply stage has to wait for the others,
+   // within a memory budget.
+   const uint32_t num_threads = fc::asio::default_io_service_scope::get_num_threads();
+   const size_t min_depth = std::max<size_t>( 20, 2 * num_threads );
+   const size_t max_depth = 64 * min_depth;
+   const uint64_t memory_budget = 512 * 1024 * 1024;
+   const uint32_t adapt_interval = 1000;
+   size_t depth = min_depth;
+   uint64_t applied_bytes = 0;
+   uint64_t applied_blocks = 0;
 
-   size_t total_block_size = _block_id_to_block.total_block_size();
-   const auto& gpo = get_global_properties();
-   std::queue< std::tuple< size_t, signed_block, fc::future< void > > > blocks;
-   uint32_t next_block_num = head_block_num() + 1;
-   uint32_t i = next_block_num;
-   while( next_block_num <= last_block_num || !blocks.empty() )
+   fc::thread reader( "replay_reader" );
+   replay_stats stats;
+   std::deque< replay_item > blocks;
+   // the tasks refer to the queued items, so they must be finished before the queue goes away
+   auto drain = [&blocks]() {
+      for( auto& item : blocks )
+      {
+         try
+         {
+            fc::future<void> precomputed = item.ready.wait();
+            precomputed.wait();
+         }
+         catch( const fc::exception& )
+         {
+         }
+      }
+      blocks.clear();
+   };
+   auto schedule = [this,&reader,&stats,precompute_skip,dupe_check_start]( replay_item& item ) {
+      item.ready = reader.async( [this,&item,&stats,precompute_skip,dupe_check_start]() {
+         auto read_start = fc::time_point::now();
+         item.position = _block_id_to_block.blocks_current_position();
+         optional< vector<char> > packed = _block_id_to_block.fetch_packed_by_number( item.block_num );
+         stats.read_time += ( fc::time_point::now() - read_start ).count();
+         if( !packed.valid() )
+            return fc::future<void>( fc::promise<void>::create( true ) );
+         item.packed_size = packed->size();
+         return fc::do_parallel( [this,&item,&stats,precompute_skip,dupe_check_start,data=std::move(*packed)]() {
+            auto precompute_start = fc::time_point::now();
+            try
+            {
+               signed_block block = fc::raw::unpack<signed_block>( data );
+               uint32_t block_skip = precompute_skip;
+               if( block.timestamp >= dupe_check_start )
+                  block_skip &= ~skip_transaction_dupe_check;
+               precompute_block( block, block_skip );
+               item.block = std::move( block );
+            }
+            catch( const fc::exception& e )
+            {
+               wlog( "Failed to unpack block ${n}: ${e}", ("n",item.block_num)("e",e.to_detail_string()) );
+            }
+            stats.precompute_time += ( fc::time_point::now() - precompute_start ).count();
+         }, "replay_precompute" );
+      }, "replay_read" );
+   };
+
+   try
    {
-      if( next_block_num <= last_block_num && blocks.size() < 20 )
+      size_t total_block_size = _block_id_to_block.total_block_size();
+      uint32_t next_block_num = head_block_num() + 1;
+      uint32_t i = next_block_num;
+      replay_stats last_report;
+      uint32_t last_report_block = i;
+      int64_t interval_wait_time = 0;
+      auto interval_start = fc::time_point::now();
+      while( next_block_num <= last_block_num || !blocks.empty() )
       {
-         const size_t processed_block_size = _block_id_to_block.blocks_current_position();
-         fc::optional< signed_block > block = _block_id_to_block.fetch_by_number( next_block_num++ );
-         if( block.valid() )
+         while( next_block_num <= last_block_num && blocks.size() < depth )
          {
-            if( block->timestamp >= last_block->timestamp - gpo.parameters.maximum_time_until_expiration )
-               skip &= ~skip_transaction_dupe_check;
-            blocks.emplace( processed_block_size, std::move(*block), fc::future<void>() );
-            std::get<2>(blocks.back()) = precompute_parallel( std::get<1>(blocks.back()), skip );
+            blocks.emplace_back( next_block_num++ );
+            schedule( blocks.back() );
          }
-         else
+
+         replay_item& item = blocks.front();
+         auto wait_start = fc::time_point::now();
+         fc::future<void> precomputed = item.ready.wait();
+         precomputed.wait();
+         const int64_t waited = ( fc::time_point::now() - wait_start ).count();
+         stats.wait_time += waited;
+         interval_wait_time += waited;
+
+         if( !item.block.valid() )
          {
             wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
             uint32_t dropped_count = 0;
+            // blocks after the gap may still be read, don't touch the block database before they're done
+            drain();
             while( true )
             {
                fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
@@ -113,19 +214,18 @@ void database::reindex( fc::path data_dir )
                dropped_count++;
             }
             wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
-            next_block_num = last_block_num + 1; // don't load more blocks
+            break;
          }
-      }
-      else
-      {
-         std::get<2>(blocks.front()).wait();
-         const signed_block& block = std::get<1>(blocks.front());
+
+         const signed_block& block = *item.block;
+         if( block.timestamp >= dupe_check_start )
+            skip &= ~skip_transaction_dupe_check;
 
          if( i % 10000 == 0 )
          {
             std::stringstream bysize;
             std::stringstream bynum;
-            size_t current_pos = std::get<0>(blocks.front());
+            size_t current_pos = item.position;
             if( current_pos > total_block_size )
                total_block_size = current_pos;
             bysize << std::fixed << std::setprecision(5) << double(current_pos) / total_block_size * 100;
@@ -139,6 +239,27 @@ void database::reindex( fc::path data_dir )
                ("i", i)
                ("last", last_block_num)
             );
+            // throughput each stage could sustain on its own, and how long the apply stage was idle
+            const uint64_t count = i - last_report_block;
+            const int64_t read_time = stats.read_time - last_report.read_time;
+            const int64_t precompute_time = stats.precompute_time - last_report.precompute_time;
+            const int64_t apply_time = stats.apply_time - last_report.apply_time;
+            const int64_t wait_time = stats.wait_time - last_report.wait_time;
+            ilog(
+               "   [read: ${r} blocks/s]   [precompute: ${p} blocks/s on ${t} threads]   [apply: ${a} blocks/s, "
+               "waited ${w} ms]   [queue depth: ${d}]",
+               ("r", count * 1000000 / std::max<int64_t>( 1, read_time ))
+               ("p", count * 1000000 * num_threads / std::max<int64_t>( 1, precompute_time ))
+               ("t", num_threads)
+               ("a", count * 1000000 / std::max<int64_t>( 1, apply_time ))
+               ("w", wait_time / 1000)
+               ("d", depth)
+            );
+            last_report.read_time = stats.read_time.load();
+            last_report.precompute_time = stats.precompute_time.load();
+            last_report.apply_time = stats.apply_time;
+            last_report.wait_time = stats.wait_time;
+            last_report_block = i;
          }
          if( i == undo_point )
          {
@@ -146,6 +267,7 @@ void database::reindex( fc::path data_dir )
             flush();
             ilog( "Done" );
          }
+         auto apply_start = fc::time_point::now();
          if( i < undo_point )
             apply_block( block, skip );
          else
@@ -153,18 +275,47 @@ void database::reindex( fc::path data_dir )
             _undo_db.enable();
             push_block( block, skip );
          }
-         blocks.pop();
+         stats.apply_time += ( fc::time_point::now() - apply_start ).count();
+         applied_bytes += item.packed_size;
+         ++applied_blocks;
+         blocks.pop_front();
          i++;
+
+         if( i % adapt_interval == 0 )
+         {
+            // grow the queue while the apply stage has to wait for more than 5% of the time,
+            // shrink it slowly when it never waits, and always stay within the memory budget
+            const int64_t interval = std::max<int64_t>( 1, ( fc::time_point::now() - interval_start ).count() );
+            if( interval_wait_time * 20 > interval )
+               depth = std::min( depth * 2, max_depth );
+            else if( interval_wait_time * 200 < interval )
+               depth = std::max( depth - depth / 8, min_depth );
+            // unpacked blocks take up several times their packed size
+            const uint64_t avg_block_size = std::max<uint64_t>( 1, applied_bytes / applied_blocks );
+            depth = std::max<size_t>( min_depth, std::min<uint64_t>( depth, memory_budget / ( 4 * avg_block_size ) ) );
+            interval_wait_time = 0;
+            interval_start = fc::time_point::now();
+         }
       }
    }
+   catch( ... )
+   {
+      drain();
+      throw;
+   }
+   drain();
    _undo_db.enable();
    auto end = fc::time_point::now();
    ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
+   ilog( "Replay stage totals: read ${r} sec, precompute ${p} sec, apply ${a} sec, apply waited ${w} sec",
+         ("r",double(stats.read_time)/1000000.0)("p",double(stats.precompute_time)/1000000.0)
+         ("a",double(stats.apply_time)/1000000.0)("w",double(stats.wait_time)/1000000.0) );
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
 void database::wipe(const fc::path& data_dir, bool include_blocks)
 {
    ilog("Wiping database", ("include_blocks", include_blocks));
+   state_lock::write_scope write( _state_lock );
    if (_opened) {
      close();
    }
@@ -180,6 +331,9 @@ void database::open(
 {
    try
    {
+      state_lock::write_scope write( _state_lock );
+      // a state which has been loaded before opening, e.g. from a snapshot, takes the place of the one on disk
+      const bool state_loaded = ( find( global_property_id_type() ) != nullptr );
       bool wipe_object_db = false;
       if( !fc::exists( data_dir / "db_version" ) )
          wipe_object_db = true;
@@ -197,7 +351,14 @@ void database::open(
           version_file.write( db_version.c_str(), db_version.size() );
           version_file.close();
       }
+      else if( state_loaded ) {
+          ilog("Wiping object_database, it is replaced by the state loaded before opening it");
+          object_database::wipe( data_dir );
+      }
 
+      // the vote tally kept in memory does not match the state being loaded
+      _vote_tally_cache.invalidate();
+      track_changes( _change_log_interval > 0 );
       object_database::open(data_dir);
 
       _block_id_to_block.open(data_dir / "database" / "block_num_to_block");
@@ -214,6 +375,21 @@ void database::open(
          _p_witness_schedule_obj = &get( witness_schedule_id_type() );
       }
 
+      // The loaded state is only in memory. It is saved right away, otherwise the change log would be replayed
+      // on top of empty files after a crash.
+      if( state_loaded )
+         object_database::flush();
+
+      // only irreversible blocks are saved to the change log, but the block database may have lost the block
+      if( get_change_log_records() > 0 && head_block_num() > 0
+            && !_block_id_to_block.contains( head_block_id() ) )
+      {
+         discard_change_log();
+         FC_THROW( "The state restored from the change log at block ${n} is not part of the chain in the block "
+                   "database, the change log has been discarded, restart to resume from the last complete save",
+                   ("n",head_block_num())("id",head_block_id()) );
+      }
+
       fc::optional<block_id_type> last_block = _block_id_to_block.last_id();
       if( last_block.valid() )
       {
@@ -231,7 +407,9 @@ void database::close(bool rewind)
 {
    if (!_opened)
       return;
-      
+
+   state_lock::write_scope write( _state_lock );
+
    // TODO:  Save pending tx's on close()
    clear_pending();
 
@@ -38,6 +38,9 @@
 
 #include <graphene/protocol/fee_schedule.hpp>
 
+#include <algorithm>
+#include <map>
+
 namespace graphene { namespace chain {
 
 void database::update_global_dynamic_data( const signed_block& b, const uint32_t missed_blocks )
@@ -534,25 +537,45 @@ void database::clear_expired_htlcs()
    }
 }
 
+namespace {
+   /// Changes of the balance and the ticket statistics of one account, see @ref database::process_tickets
+   struct ticket_stats_delta
+   {
+      share_type withdrawn;
+      share_type core_inactive;
+      share_type core_pob;
+      share_type core_pol;
+      share_type pob_value;
+      share_type pol_value;
+   };
+}
+
 generic_operation_result database::process_tickets()
 {
    generic_operation_result result;
    share_type total_delta_pob;
    share_type total_delta_inactive;
+   // The balance and the statistics of an account are updated once, after all of its tickets are processed.
+   // Withdrawing may create a balance object, so the order of the first withdrawals is kept to assign the
+   // same object IDs as updating the balance for every single ticket does.
+   std::map<account_id_type, ticket_stats_delta> deltas;
+   vector<account_id_type> withdrawing_accounts;
+   vector<object_id_type> updated_tickets;
+   vector<object_id_type> removed_tickets;
    auto& idx = get_index_type<ticket_index>().indices().get<by_next_update>();
    while( !idx.empty() && idx.begin()->next_auto_update_time <= head_block_time() )
    {
       const ticket_object& ticket = *idx.begin();
-      const auto& stat = get_account_stats_by_owner( ticket.account );
+      ticket_stats_delta& delta = deltas[ticket.account];
       if( ticket.status == withdrawing && ticket.current_type == liquid )
       {
-         adjust_balance( ticket.account, ticket.amount );
+         if( delta.withdrawn == 0 )
+            withdrawing_accounts.push_back( ticket.account );
          // Note: amount.asset_id is checked when creating the ticket, so no check here
-         modify( stat, [&ticket](account_statistics_object& aso) {
-            aso.total_core_pol -= ticket.amount.amount;
-            aso.total_pol_value -= ticket.value;
-         });
-         result.removed_objects.insert( ticket.id );
+         delta.withdrawn += ticket.amount.amount;
+         delta.core_pol -= ticket.amount.amount;
+         delta.pol_value -= ticket.value;
+         removed_tickets.push_back( ticket.id );
          remove( ticket );
       }
       else
@@ -562,13 +585,7 @@ generic_operation_result database::process_tickets()
          modify( ticket, []( ticket_object& o ) {
             o.auto_update();
          });
-         result.updated_objects.insert( ticket.id );
-
-         share_type delta_inactive_amount;
-         share_type delta_forever_amount;
-         share_type delta_forever_value;
-         share_type delta_other_amount;
-         share_type delta_other_value;
+         updated_tickets.push_back( ticket.id );
 
          if( old_type == lock_forever ) // It implies that the new type is lock_forever too
          {
@@ -576,43 +593,57 @@ generic_operation_result database::process_tickets()
             {
                total_delta_pob -= ticket.amount.amount;
                total_delta_inactive += ticket.amount.amount;
-               delta_inactive_amount = ticket.amount.amount;
-               delta_forever_amount = -ticket.amount.amount;
+               delta.core_inactive += ticket.amount.amount;
+               delta.core_pob -= ticket.amount.amount;
             }
-            delta_forever_value = ticket.value - old_value;
+            delta.pob_value += ticket.value - old_value;
          }
          else // old_type != lock_forever
          {
             if( ticket.current_type == lock_forever )
             {
                total_delta_pob += ticket.amount.amount;
-               delta_forever_amount = ticket.amount.amount;
-               delta_forever_value = ticket.value;
-               delta_other_amount = -ticket.amount.amount;
-               delta_other_value = -old_value;
+               delta.core_pob += ticket.amount.amount;
+               delta.pob_value += ticket.value;
+               delta.core_pol -= ticket.amount.amount;
+               delta.pol_value -= old_value;
             }
             else // ticket.current_type != lock_forever
             {
-               delta_other_value = ticket.value - old_value;
+               delta.pol_value += ticket.value - old_value;
             }
          }
-
-         // Note: amount.asset_id is checked when creating the ticket, so no check here
-         modify( stat, [delta_inactive_amount,delta_forever_amount,delta_forever_value,
-                        delta_other_amount,delta_other_value](account_statistics_object& aso) {
-            aso.total_core_inactive += delta_inactive_amount;
-            aso.total_core_pob += delta_forever_amount;
-            aso.total_core_pol += delta_other_amount;
-            aso.total_pob_value += delta_forever_value;
-            aso.total_pol_value += delta_other_value;
-         });
-
       }
       // TODO if a lock_forever ticket lost all the value, remove it
    }
 
    // TODO merge stable tickets with the same account and the same type
 
+   for( const account_id_type& account : withdrawing_accounts )
+      adjust_balance( account, asset( deltas[account].withdrawn ) );
+
+   for( const auto& item : deltas )
+   {
+      const ticket_stats_delta& delta = item.second;
+      modify( get_account_stats_by_owner( item.first ), [&delta]( account_statistics_object& aso ) {
+         aso.total_core_inactive += delta.core_inactive;
+         aso.total_core_pob += delta.core_pob;
+         aso.total_core_pol += delta.core_pol;
+         aso.total_pob_value += delta.pob_value;
+         aso.total_pol_value += delta.pol_value;
+      });
+   }
+
+   // Inserting the IDs one by one into the flat sets would take quadratic time.
+   // A ticket is updated more than once if its next update is due already, e.g. after missed blocks.
+   std::sort( updated_tickets.begin(), updated_tickets.end() );
+   updated_tickets.erase( std::unique( updated_tickets.begin(), updated_tickets.end() ), updated_tickets.end() );
+   std::sort( removed_tickets.begin(), removed_tickets.end() );
+   result.updated_objects.insert( boost::container::ordered_unique_range,
+                                  updated_tickets.begin(), updated_tickets.end() );
+   result.removed_objects.insert( boost::container::ordered_unique_range,
+                                  removed_tickets.begin(), removed_tickets.end() );
+
    // Update global data
    if( total_delta_pob != 0 || total_delta_inactive != 0 )
    {
@@ -22,7 +22,10 @@
  * THE SOFTWARE.
  */
 #pragma once
+#include <atomic>
 #include <fstream>
+#include <memory>
+#include <graphene/chain/block_log.hpp>
 #include <graphene/protocol/block.hpp>
 
 #include <fc/filesystem.hpp>
@@ -31,14 +34,52 @@ namespace graphene { namespace chain {
    struct index_entry;
    using namespace graphene::protocol;
 
+   namespace detail {
+      class mapped_block_file;
+      class block_write_queue;
+   }
+
+   /**
+    *  @brief Stores signed blocks on disk, indexed by block number
+    *
+    *  The on-disk layout consists of two files: "blocks" holds the packed blocks back to back, and "index"
+    *  holds one fixed-size @ref index_entry per block number pointing into "blocks".
+    *
+    *  Writes (@ref store and @ref remove) must come from a single thread. All reads are served from
+    *  memory-mapped views of both files and may be performed concurrently from any number of threads
+    *  without locking. The logical length of both files is kept in memory, so lookups never have to
+    *  query the file system.
+    *
+    *  With write-behind enabled, @ref store only queues the block, and a background thread packs and writes the
+    *  queued blocks in order. Queued blocks are served from the queue until they have been written. @ref flush
+    *  and @ref wait_for_writes wait for the queue, @ref close writes out the whole queue. A block which can not
+    *  be written is retried until it is, meanwhile @ref store, @ref flush and @ref wait_for_writes throw the
+    *  error. Write-behind is disabled by default.
+    *
+    *  If the directory contains a compressed block log named "block_log" (see @ref block_log_writer), blocks
+    *  that are not in the index are read from it, so irreversible blocks can be archived in compressed form.
+    */
    class block_database 
    {
       public:
+         block_database();
+         ~block_database();
+
          void open( const fc::path& dbdir );
          bool is_open()const;
+         /// Waits until all stored blocks have been written, and flushes the files
          void flush();
          void close();
 
+         /// Whether to write blocks on a background thread, takes effect when the database is opened next
+         void enable_write_behind( bool enable ) { _write_behind = enable; }
+         /// Waits until the stored blocks with a number up to @p block_num have been written
+         void wait_for_writes( uint32_t block_num )const;
+         /// Makes every write of a block take @p latency longer, to measure the effect of slow storage in tests
+         void simulate_write_latency( fc::microseconds latency ) { _simulated_write_latency = latency; }
+         /// Makes the next @p count writes of a block fail, to test the recovery from write errors
+         void simulate_write_errors( uint32_t count ) { _simulated_write_errors = count; }
+
          void store( const block_id_type& id, const signed_block& b );
          void remove( const block_id_type& id );
 
@@ -46,14 +87,40 @@ namespace graphene { namespace chain {
          block_id_type          fetch_block_id( uint32_t block_num )const;
          optional<signed_block> fetch_optional( const block_id_type& id )const;
          optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         /// Returns the block exactly as it is stored on disk, i. e. in fc::raw packed form, without unpacking it
+         optional<vector<char>> fetch_packed_optional( const block_id_type& id )const;
+         optional<vector<char>> fetch_packed_by_number( uint32_t block_num )const;
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
          size_t                 blocks_current_position()const;
          size_t                 total_block_size()const;
       private:
          optional<index_entry> last_index_entry()const;
+         bool                  read_index_entry( uint32_t block_num, index_entry& e )const;
+         optional<signed_block> read_block( const index_entry& e )const;
+         void                  write_index_entry( uint32_t block_num, const index_entry& e );
+         optional<signed_block> fetch_from_archive( uint32_t block_num )const;
+         optional<vector<char>> fetch_packed( uint32_t block_num, const block_id_type* id )const;
+         void                  write_block( const block_id_type& id, const signed_block& b );
+
          fc::path _index_filename;
-         mutable std::fstream _blocks;
-         mutable std::fstream _block_num_to_pos;
+         std::fstream _blocks;
+         std::fstream _block_num_to_pos;
+
+         std::unique_ptr<detail::mapped_block_file> _blocks_map;
+         std::unique_ptr<detail::mapped_block_file> _index_map;
+         std::unique_ptr<block_log_reader>          _archive;
+         std::unique_ptr<detail::block_write_queue> _write_queue;
+         bool                                       _write_behind = false;
+         fc::microseconds                           _simulated_write_latency;
+         std::atomic<uint32_t>                      _simulated_write_errors { 0 };
+
+         /// Logical length of the "blocks" and "index" files, published after the data has been written
+         std::atomic<uint64_t> _blocks_size;
+         mutable std::atomic<uint64_t> _index_size;
+         /// Odd while an index entry that readers may see is overwritten, see @ref write_index_entry
+         std::atomic<uint64_t> _index_version;
+         /// End position of the most recently fetched block, used for progress reporting
+         mutable std::atomic<uint64_t> _blocks_read_pos;
    };
 } }
@@ -0,0 +1,110 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <graphene/protocol/block.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <memory>
+
+namespace graphene { namespace chain {
+   using namespace graphene::protocol;
+
+   namespace detail {
+      class block_log_writer_impl;
+      class block_log_reader_impl;
+   }
+
+   enum class block_log_compression : uint32_t
+   {
+      none = 0,
+      zlib = 1,
+      zstd = 2  ///< only available if built with GRAPHENE_HAVE_ZSTD
+   };
+
+   /// @return true if blocks can be compressed and decompressed with the given method in this build
+   bool is_block_log_compression_supported( block_log_compression compression );
+
+   /// Compresses @p raw like the chunks of a block log, for other files that are stored the same way
+   vector<char> compress_block_log_data( block_log_compression compression, const vector<char>& raw );
+   /// Decompresses @p stored into @p raw, which must already have the size of the uncompressed data
+   void decompress_block_log_data( block_log_compression compression, const char* stored, size_t stored_size,
+                                   vector<char>& raw );
+   /// @return the crc32 checksum which a block log stores for the given data
+   uint32_t block_log_checksum( const char* data, size_t size );
+
+   /**
+    *  @brief Writes an append-only, compressed archive of irreversible blocks
+    *
+    *  Blocks are collected into chunks of roughly @p chunk_size uncompressed bytes. Each chunk is compressed
+    *  as a whole and written to the log together with a small header that carries a checksum of the stored
+    *  data. A chunk index is written alongside the log (same file name with ".index" appended), mapping
+    *  block numbers to chunks. Blocks must be appended in order, starting at block 1 and without gaps.
+    */
+   class block_log_writer
+   {
+      public:
+         static constexpr uint32_t default_chunk_size = 1024 * 1024;
+
+         block_log_writer( const fc::path& filename, block_log_compression compression,
+                           uint32_t chunk_size = default_chunk_size );
+         ~block_log_writer();
+
+         void append( const signed_block& b );
+         void append_packed( uint32_t block_num, const vector<char>& packed_block );
+         /// Writes out the pending chunk and closes the files
+         void close();
+
+         uint32_t last_block_num()const;
+
+      private:
+         std::unique_ptr<detail::block_log_writer_impl> my;
+   };
+
+   /**
+    *  @brief Reads blocks from a block log created by @ref block_log_writer
+    *
+    *  The reader can be used from multiple threads. Decompressed chunks are cached, and whenever a chunk
+    *  is requested the following ones are decompressed ahead of time on a background thread, so that
+    *  sequential reads (e.g. during a replay) rarely have to wait for decompression.
+    *
+    *  If the chunk index is missing or damaged, it is rebuilt from the log.
+    */
+   class block_log_reader
+   {
+      public:
+         explicit block_log_reader( const fc::path& filename, uint32_t read_ahead_chunks = 4 );
+         ~block_log_reader();
+
+         /// @return the number of the last block in the log, or 0 if it is empty
+         uint32_t               last_block_num()const;
+         optional<vector<char>> fetch_packed( uint32_t block_num )const;
+         optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         /// @return the position of the chunk that contains @p block_num in the log file
+         uint64_t               position_of( uint32_t block_num )const;
+         uint64_t               file_size()const;
+         block_log_compression  compression()const;
+
+      private:
+         std::unique_ptr<detail::block_log_reader_impl> my;
+   };
+
+} }
+
+FC_REFLECT_ENUM( graphene::chain::block_log_compression, (none)(zlib)(zstd) )
@@ -46,7 +46,15 @@ namespace graphene { namespace chain {
             uint32_t        maintenance_time;
         };
 
+        /// The outcome of a commit-reveal window for a set of accounts
+        struct commit_reveal_window_summary
+        {
+            uint64_t                  seed = 0;      ///< sum of the revealed values
+            flat_set<account_id_type> participants;  ///< accounts which have revealed a value
+        };
+
         struct by_account;
+        struct by_maintenance_time;
 
         typedef multi_index_container<
                commit_reveal_v2_object,
@@ -56,6 +64,12 @@ namespace graphene { namespace chain {
                            composite_key< commit_reveal_v2_object,
                                  member< commit_reveal_v2_object, account_id_type, &commit_reveal_v2_object::account>
                            >
+                     >,
+                     ordered_unique< tag<by_maintenance_time>,
+                           composite_key< commit_reveal_v2_object,
+                                 member< commit_reveal_v2_object, uint32_t, &commit_reveal_v2_object::maintenance_time>,
+                                 member< commit_reveal_v2_object, account_id_type, &commit_reveal_v2_object::account>
+                           >
                      >
                >
         > commit_reveal_v2_multi_index_type;
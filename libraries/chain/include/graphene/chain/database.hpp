@@ -36,6 +36,10 @@
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/genesis_state.hpp>
 #include <graphene/chain/evaluator.hpp>
+#include <graphene/chain/signature_cache.hpp>
+#include <graphene/chain/state_lock.hpp>
+#include <graphene/chain/transaction_pool.hpp>
+#include <graphene/chain/vote_tally_cache.hpp>
 
 #include <graphene/db/object_database.hpp>
 #include <graphene/db/object.hpp>
@@ -139,6 +143,8 @@ namespace graphene { namespace chain {
          block_id_type              get_block_id_for_num( uint32_t block_num )const;
          optional<signed_block>     fetch_block_by_id( const block_id_type& id )const;
          optional<signed_block>     fetch_block_by_number( uint32_t num )const;
+         /// Same as @ref fetch_block_by_id, but returns the block in fc::raw packed form
+         optional<vector<char>>     fetch_packed_block_by_id( const block_id_type& id )const;
          const signed_transaction&  get_recent_transaction( const transaction_id_type& trx_id )const;
          std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
 
@@ -264,11 +270,12 @@ namespace graphene { namespace chain {
          void update_witness_schedule();
 
          //////////////////// db_commit_reveal.cpp ////////////////////
+         /// Sums up the values revealed by the given accounts in the current commit-reveal window
+         /// and collects the accounts which have revealed, in one pass over the window
+         commit_reveal_window_summary summarize_commit_reveal_window_v2(const vector<account_id_type>& accounts) const;
       private:
          uint64_t get_commit_reveal_seed(const vector<account_id_type>& accounts) const;
          vector<account_id_type> filter_commit_reveal_participant(const vector<account_id_type>& accounts) const;
-         uint64_t get_commit_reveal_seed_v2(const vector<account_id_type>& accounts) const;
-         vector<account_id_type> filter_commit_reveal_participant_v2(const vector<account_id_type>& accounts) const;
          //////////////////// db_getter.cpp ////////////////////
       public:
 
@@ -528,6 +535,45 @@ namespace graphene { namespace chain {
          /// Enable or disable tracking of votes of standby witnesses and committee members
          inline void enable_standby_votes_tracking(bool enable)  { _track_standby_votes = enable; }
 
+         /// Set the number of shards the vote tally is split into during chain maintenance.
+         /// 0 picks it by the number of voters and threads, 1 tallies on the current thread.
+         inline void set_vote_tally_shards(uint32_t shards)  { _vote_tally_shards = shards; }
+
+         /// Enable or disable counting only the votes of accounts which changed since the last maintenance
+         inline void enable_incremental_vote_tally(bool enable)  { _incremental_vote_tally = enable; }
+         /// Enable or disable comparing the incremental vote tally with a full recount, which is slow
+         inline void enable_vote_tally_check(bool enable)  { _check_vote_tally = enable; }
+
+         /// Enable or disable verifying the authorities of all transactions of an applied block in parallel,
+         /// before the transactions are applied in order. Only blocks whose signatures are checked are affected.
+         inline void enable_speculative_authority_checks(bool enable)  { _speculative_authority_checks = enable; }
+
+         /// Limit the total packed size of the pending transactions and the number of pending transactions
+         /// per fee payer, 0 means no limit. See @ref transaction_pool.
+         inline void set_pending_transaction_limits(uint64_t max_size, uint32_t max_per_account)
+         { _pending_tx.set_limits( max_size, max_per_account ); }
+         const transaction_pool& get_pending_transactions()const { return _pending_tx; }
+
+         /// Enable or disable writing blocks to disk on a background thread, see @ref block_database.
+         /// Must be set before open().
+         inline void enable_block_write_behind(bool enable)  { _block_id_to_block.enable_write_behind( enable ); }
+         /// The blocks stored on disk, for tests and tools that need to control how they are written
+         block_database& get_block_database() { return _block_id_to_block; }
+
+         /// Capture the objects which have changed every @p blocks blocks, and append them to the change log of the
+         /// object database once the block is irreversible, so that after a crash the node resumes from there
+         /// instead of replaying all blocks since it was last closed. 0 disables it. Must be set before open().
+         /// See @ref object_database::capture_changes.
+         inline void set_change_log_interval(uint32_t blocks)  { _change_log_interval = blocks; }
+
+         /// The public keys recovered from the signatures of transactions, shared by block and transaction
+         /// processing and the APIs. The cache is thread safe.
+         signature_cache& get_signature_cache()const { return _signature_cache; }
+
+         /// Held exclusively while blocks and transactions are pushed, generated or popped. Code which reads the
+         /// state on another thread than the one that changes it has to hold a @ref state_lock::read_scope.
+         state_lock& get_state_lock()const { return _state_lock; }
+
          /** Precomputes digests, signatures and operation validations depending
           *  on skip flags. "Expensive" computations may be done in a parallel
           *  thread.
@@ -551,6 +597,9 @@ namespace graphene { namespace chain {
          template<typename Trx>
          void _precompute_parallel( const Trx* trx, const size_t count, const uint32_t skip )const;
 
+         /// Performs all precomputations of @ref precompute_parallel for a block in the calling thread
+         void precompute_block( const signed_block& block, const uint32_t skip )const;
+
    protected:
          //Mark pop_undo() as protected -- we do not want outside calling pop_undo(); it should call pop_block() instead
          void pop_undo() { object_database::pop_undo(); }
@@ -576,6 +625,8 @@ namespace graphene { namespace chain {
       private:
          void                  _apply_block( const signed_block& next_block );
          processed_transaction _apply_transaction( const signed_transaction& trx );
+         /// Re-applies the transactions of the pool on top of the head block, dropping those which fail
+         void                  rebuild_pending_state();
          void                  _cancel_bids_and_revive_mpa( const asset_object& bitasset, const asset_bitasset_data_object& bad );
 
          ///Steps involved in applying a new block
@@ -626,11 +677,18 @@ namespace graphene { namespace chain {
          void process_bitassets();
 
          template<class Type>
-         void perform_account_maintenance( Type tally_helper );
+         void perform_account_maintenance( Type& tally_helper );
          ///@}
          ///@}
 
-         vector< processed_transaction >        _pending_tx;
+         transaction_pool                       _pending_tx;
+         /// Union of the skip flags the transactions in _pending_tx have been applied with
+         uint32_t                               _pending_tx_skip_flags = 0;
+         /// Set while _pending_tx_session is not the result of applying _pending_tx, i.e. after a block was popped
+         /// or generated
+         bool                                   _pending_tx_stale = false;
+         mutable signature_cache                _signature_cache;
+         mutable state_lock                     _state_lock;
          fork_database                          _fork_db;
 
          /**
@@ -673,6 +731,20 @@ namespace graphene { namespace chain {
          /// Set it to true to provide accurate data to API clients, set to false to have better performance.
          bool                              _track_standby_votes = true;
 
+         /// Number of shards the vote tally is split into, see @ref set_vote_tally_shards
+         uint32_t                          _vote_tally_shards = 0;
+
+         /// Vote tally of the last maintenance, see @ref enable_incremental_vote_tally
+         vote_tally_cache                  _vote_tally_cache;
+         bool                              _incremental_vote_tally = true;
+         bool                              _check_vote_tally = false;
+
+         /// Whether to verify transaction authorities in parallel, see @ref enable_speculative_authority_checks
+         bool                              _speculative_authority_checks = false;
+
+         /// Blocks between two saves to the change log, see @ref set_change_log_interval
+         uint32_t                          _change_log_interval = 0;
+
          /**
           * Whether database is successfully opened or not.
           *
@@ -68,9 +68,10 @@ struct skip_flags_restorer
  */
 struct pending_transactions_restorer
 {
-   pending_transactions_restorer( database& db, std::vector<processed_transaction>&& pending_transactions )
-      : _db(db), _pending_transactions( std::move(pending_transactions) )
+   pending_transactions_restorer( database& db, transaction_pool& pending_transactions )
+      : _db(db)
    {
+      pending_transactions.move_to( _pending_transactions );
       _db.clear_pending();
    }
 
@@ -86,12 +87,14 @@ struct pending_transactions_restorer
          }
       }
       _db._popped_tx.clear();
-      for( const processed_transaction& tx : _pending_transactions )
+      // transactions which expired with the new head block would fail anyway
+      _pending_transactions.remove_expired( _db.head_block_time() );
+      for( const pending_transaction& entry : _pending_transactions.indices().get<transaction_pool::by_sequence>() )
       {
          try
          {
-            if( !_db.is_known_transaction( tx.id() ) ) {
-               _db._push_transaction( tx );
+            if( !_db.is_known_transaction( entry.id ) ) {
+               _db._push_transaction( entry.trx );
             }
          }
          catch( const fc::exception& )
@@ -101,7 +104,7 @@ struct pending_transactions_restorer
    }
 
    database& _db;
-   std::vector< processed_transaction > _pending_transactions;
+   transaction_pool _pending_transactions;
 };
 
 /**
@@ -131,10 +134,10 @@ void with_skip_flags(
 template< typename Lambda >
 void without_pending_transactions(
    database& db,
-   std::vector<processed_transaction>&& pending_transactions,
+   transaction_pool& pending_transactions,
    Lambda callback )
 {
-    pending_transactions_restorer restorer( db, std::move(pending_transactions) );
+    pending_transactions_restorer restorer( db, pending_transactions );
     callback();
     return;
 }
@@ -122,6 +122,8 @@ namespace graphene { namespace chain {
    FC_DECLARE_DERIVED_EXCEPTION( insufficient_feeds,           chain_exception, 37006 )
 
    FC_DECLARE_DERIVED_EXCEPTION( duplicate_transaction,        transaction_process_exception, 3030001 )
+   FC_DECLARE_DERIVED_EXCEPTION( pending_transaction_limit_exceeded, transaction_process_exception, 3030002 )
+   FC_DECLARE_DERIVED_EXCEPTION( transaction_pool_full,        transaction_process_exception, 3030003 )
 
    FC_DECLARE_DERIVED_EXCEPTION( pop_empty_chain,              undo_database_exception, 3070001 )
 
@@ -0,0 +1,101 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <graphene/protocol/transaction.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace graphene { namespace chain {
+   using namespace graphene::protocol;
+
+   /**
+    *  @brief Public keys recovered from the signatures of transactions, shared by the whole node
+    *
+    *  A transaction usually has its signatures recovered when it arrives from the network, again when it arrives
+    *  inside a block, and maybe again when it is passed to an API call. The cache keeps the recovered keys by the
+    *  digest the signatures sign (which covers the transaction and the chain ID), together with the signatures,
+    *  so that each signature is recovered once.
+    *
+    *  The cache is split into shards with a lock each, so it can be used from the threads that precompute
+    *  transactions at the same time. Each shard keeps two generations of entries; when the current one is full
+    *  the previous one is dropped and the current one takes its place, and a hit in the previous generation
+    *  moves the entry back to the current one. This bounds the size without keeping an LRU list.
+    */
+   class signature_cache
+   {
+      public:
+         static constexpr size_t default_capacity = 100000;
+
+         explicit signature_cache( size_t capacity = default_capacity );
+
+         /// Sets the maximum number of transactions whose keys are kept, 0 disables the cache
+         void   set_capacity( size_t capacity );
+         size_t capacity()const { return _capacity; }
+
+         /**
+          *  Provides the public keys of the signatures of @p trx, from the cache or by recovering them, and sets
+          *  them in @p trx, so that later calls of @ref precomputable_transaction::get_signature_keys use them.
+          *  @throws tx_duplicate_sig like @ref signed_transaction::get_signature_keys
+          */
+         const flat_set<public_key_type>& get_signature_keys( const precomputable_transaction& trx,
+                                                              const chain_id_type& chain_id );
+
+         struct statistics
+         {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            size_t   size = 0;  ///< number of cached transactions
+         };
+         statistics get_statistics()const;
+
+         void clear();
+
+      private:
+         static constexpr size_t num_shards = 16;
+
+         struct entry
+         {
+            vector<signature_type>    signatures;
+            flat_set<public_key_type> keys;
+         };
+         /// The digests are hashes already, the shard is chosen by the first word and the bucket by the second
+         struct digest_hash
+         {
+            size_t operator()( const digest_type& digest )const { return size_t( digest._hash[1] ); }
+         };
+         typedef std::unordered_map<digest_type, entry, digest_hash> entry_map;
+
+         struct shard
+         {
+            mutable std::mutex mutex;
+            entry_map          current;
+            entry_map          previous;
+         };
+
+         shard& shard_of( const digest_type& digest ) { return _shards[ digest._hash[0] % num_shards ]; }
+         size_t generation_size()const { return ( _capacity + 2 * num_shards - 1 ) / ( 2 * num_shards ); }
+
+         size_t                _capacity;
+         shard                 _shards[num_shards];
+         std::atomic<uint64_t> _hits{0};
+         std::atomic<uint64_t> _misses{0};
+   };
+
+} } // graphene::chain
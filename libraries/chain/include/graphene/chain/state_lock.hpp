@@ -0,0 +1,77 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief Lets API calls read the state on other threads while blocks and transactions are applied
+    *
+    *  The thread which applies blocks and transactions holds the lock exclusively while it changes the state,
+    *  the readers on other threads share it, so they always see the state between two changes. A waiting writer
+    *  goes first, new readers wait until it is done, so that a steady stream of API calls can not hold up block
+    *  processing. Write scopes nest on the writing thread, also when tasks of that thread interleave.
+    *
+    *  The writing thread does not take read scopes, it sees its own changes anyway.
+    */
+   class state_lock
+   {
+      public:
+         class read_scope
+         {
+            public:
+               explicit read_scope( state_lock& lock ) : _lock( lock ) { _lock.lock_shared(); }
+               ~read_scope() { _lock.unlock_shared(); }
+               read_scope( const read_scope& ) = delete;
+               read_scope& operator=( const read_scope& ) = delete;
+            private:
+               state_lock& _lock;
+         };
+
+         class write_scope
+         {
+            public:
+               explicit write_scope( state_lock& lock ) : _lock( lock ) { _lock.lock(); }
+               ~write_scope() { _lock.unlock(); }
+               write_scope( const write_scope& ) = delete;
+               write_scope& operator=( const write_scope& ) = delete;
+            private:
+               state_lock& _lock;
+         };
+
+         void lock_shared();
+         void unlock_shared();
+         void lock();
+         void unlock();
+
+      private:
+         std::mutex              _mutex;
+         std::condition_variable _readers_done;
+         std::condition_variable _writer_done;
+         uint32_t                _readers = 0;
+         uint32_t                _waiting_writers = 0;
+         uint32_t                _write_depth = 0;
+         std::thread::id         _writer;
+   };
+
+} } // graphene::chain
@@ -0,0 +1,133 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <graphene/protocol/transaction.hpp>
+
+#include <graphene/chain/types.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+namespace graphene { namespace chain {
+   using boost::multi_index_container;
+   using namespace boost::multi_index;
+
+   /// A transaction in the @ref transaction_pool, along with what it is ordered by
+   struct pending_transaction
+   {
+      processed_transaction trx;
+      transaction_id_type   id;
+      account_id_type       fee_payer;       ///< fee payer of the first operation
+      time_point_sec        expiration;
+      uint64_t              sequence = 0;    ///< order of arrival, which is also the order of application
+      uint32_t              size = 0;        ///< packed size of trx
+      uint64_t              fee_per_kb = 0;  ///< fees in core asset per 1024 bytes of trx
+   };
+
+   /**
+    *  @brief The pending transactions of the database
+    *
+    *  The pool keeps the transactions in the order they have been applied to the pending state, and indexes
+    *  them by priority (fee per size), expiration and fee payer. It limits the total size of the transactions
+    *  and the number of transactions per fee payer. When it grows beyond its size limit, the transactions with
+    *  the lowest priority are evicted until it is back at 90% of the limit, so that the pending state does not
+    *  have to be rebuilt for every transaction that arrives while the pool is full.
+    *
+    *  A limit of 0 means there is no limit.
+    */
+   class transaction_pool
+   {
+      public:
+         struct by_sequence;
+         struct by_id;
+         struct by_priority;
+         struct by_expiration;
+         struct by_fee_payer;
+         typedef multi_index_container<
+            pending_transaction,
+            indexed_by<
+               ordered_unique< tag<by_sequence>, member< pending_transaction, uint64_t, &pending_transaction::sequence > >,
+               hashed_unique< tag<by_id>, member< pending_transaction, transaction_id_type, &pending_transaction::id >,
+                              std::hash<transaction_id_type> >,
+               ordered_unique< tag<by_priority>,
+                  composite_key< pending_transaction,
+                     member< pending_transaction, uint64_t, &pending_transaction::fee_per_kb >,
+                     member< pending_transaction, uint64_t, &pending_transaction::sequence >
+                  >,
+                  composite_key_compare< std::greater<uint64_t>, std::less<uint64_t> >
+               >,
+               ordered_non_unique< tag<by_expiration>,
+                  member< pending_transaction, time_point_sec, &pending_transaction::expiration > >,
+               ordered_unique< tag<by_fee_payer>,
+                  composite_key< pending_transaction,
+                     member< pending_transaction, account_id_type, &pending_transaction::fee_payer >,
+                     member< pending_transaction, uint64_t, &pending_transaction::sequence >
+                  >
+               >
+            >
+         > index_type;
+
+         void     set_limits( uint64_t max_size, uint32_t max_per_account );
+         uint64_t max_size()const        { return _max_size; }
+         uint32_t max_per_account()const { return _max_per_account; }
+
+         bool     empty()const      { return _index.empty(); }
+         size_t   size()const       { return _index.size(); }
+         /// @return the sum of the packed sizes of all transactions in the pool
+         uint64_t total_size()const { return _total_size; }
+         const index_type& indices()const { return _index; }
+
+         bool     contains( const transaction_id_type& id )const;
+         size_t   count_of( account_id_type fee_payer )const;
+
+         /**
+          *  Checks whether a transaction would be accepted by the pool.
+          *  @throws pending_transaction_limit_exceeded if the fee payer has too many pending transactions
+          *  @throws transaction_pool_full if the pool is full of transactions with the same or a higher priority
+          */
+         void     check_admission( account_id_type fee_payer, uint32_t size, uint64_t fee_per_kb )const;
+         /// Appends a transaction which has been applied on top of all others in the pool
+         const pending_transaction& insert( processed_transaction trx, account_id_type fee_payer,
+                                            uint32_t size, uint64_t fee_per_kb );
+         void     erase( const transaction_id_type& id );
+
+         /// @return true if the pool is larger than its size limit
+         bool     needs_eviction()const { return _max_size > 0 && _total_size > _max_size; }
+         /// Removes the transactions with the lowest priority until the pool is at 90% of its size limit
+         /// @return the number of removed transactions
+         size_t   evict();
+         /// Removes the transactions which expire before @p now
+         /// @return the number of removed transactions
+         size_t   remove_expired( time_point_sec now );
+
+         /// Moves all transactions to @p other, which must be empty. The limits of both pools are kept.
+         void     move_to( transaction_pool& other );
+         void     clear();
+
+      private:
+         index_type _index;
+         uint64_t   _total_size = 0;
+         uint64_t   _next_sequence = 0;
+         uint64_t   _max_size = 0;
+         uint32_t   _max_per_account = 0;
+   };
+
+} } // graphene::chain
@@ -0,0 +1,153 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <graphene/chain/types.hpp>
+#include <graphene/db/index.hpp>
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace graphene { namespace chain {
+   using graphene::db::object;
+   using graphene::db::secondary_index;
+
+   /// What the stake of one account adds to the vote tally, see @ref vote_tally_cache
+   struct vote_tally_contribution
+   {
+      account_id_type                    opinion_account; ///< the account whose opinions are voted with the stake
+      uint64_t                           cashback = 0;    ///< cashback vesting balance the stake was computed with
+      vector<pair<uint32_t,uint64_t>>    votes;           ///< stake added to the vote tally, by offset
+      vector<pair<uint32_t,uint64_t>>    cm_worker_votes; ///< stake added to worker votes of committee members
+      optional<pair<uint16_t,uint64_t>>  witness_count;   ///< witness count histogram offset and stake
+      optional<pair<uint16_t,uint64_t>>  committee_count; ///< committee count histogram offset and stake
+      uint64_t                           total_voting_stake[2] = { 0, 0 }; // 0=committee, 1=witness
+      /// Voting power decays over time, the contribution has to be recomputed from this time on
+      time_point_sec                     valid_until = time_point_sec::maximum();
+   };
+
+   /// Everything a tally depends on besides the accounts themselves; if any of it changes, all votes are recounted
+   struct vote_tally_parameters
+   {
+      bool     pob_activated = false;
+      uint32_t next_available_vote_id = 0;
+      uint16_t maximum_witness_count = 0;
+      uint16_t maximum_committee_count = 0;
+
+      bool operator==( const vote_tally_parameters& o )const
+      {
+         return pob_activated == o.pob_activated && next_available_vote_id == o.next_available_vote_id
+                && maximum_witness_count == o.maximum_witness_count
+                && maximum_committee_count == o.maximum_committee_count;
+      }
+      bool operator!=( const vote_tally_parameters& o )const { return !( *this == o ); }
+   };
+
+   /**
+    * @brief Keeps the vote tally from one maintenance interval to the next
+    *
+    * The cache stores the contribution of every voting account along with the sums over all of them, so that
+    * chain maintenance only needs to recompute the accounts which changed since the last tally. Changes are
+    * recorded by @ref vote_tally_tracker. Sums wrap around like the tally itself does, so replacing a
+    * contribution gives exactly the same sums as adding up all contributions again.
+    *
+    * The cache only lives in memory. It is not valid after the database has been opened, and the first chain
+    * maintenance then recounts all votes.
+    */
+   class vote_tally_cache
+   {
+      public:
+         using account_set = std::unordered_set<account_id_type, std::hash<object_id_type>>;
+
+         bool                         is_valid()const   { return _valid; }
+         const vote_tally_parameters& parameters()const { return _parameters; }
+         /// Time of the maintenance that computed the tally
+         time_point_sec               tally_time()const { return _tally_time; }
+         /// Active committee members at the time of the tally, sorted
+         const vector<account_id_type>& committee_members()const { return _committee_members; }
+
+         /// Drops the tally and stops recording changes
+         void invalidate();
+         /// Drops the tally and starts over with no contributions
+         void reset( const vote_tally_parameters& params );
+         /// Marks the tally complete as of the given maintenance
+         void set_valid( time_point_sec now, vector<account_id_type> committee_members );
+
+         /// Starts recording changed accounts, if not yet done
+         void start_tracking() { _tracking = true; }
+         void mark( account_id_type account ) { if( _tracking ) _marked.insert( account ); }
+         bool is_marked( account_id_type account )const { return _marked.find( account ) != _marked.end(); }
+         /// @return the accounts marked so far, which are no longer marked afterwards
+         account_set take_marks();
+
+         const vote_tally_contribution* find( account_id_type account )const;
+         /// Replaces the contribution of an account
+         void update( account_id_type account, vote_tally_contribution&& contribution );
+         void remove( account_id_type account );
+
+         /// @return the accounts which vote through the given account's opinions
+         const flat_set<account_id_type>* delegators_of( account_id_type opinion_account )const;
+         /// @return the accounts whose contributions are not valid at the given time any more
+         vector<account_id_type> expired( time_point_sec now )const;
+
+         const vector<uint64_t>& vote_tally()const                { return _vote_tally; }
+         const vector<uint64_t>& witness_count_histogram()const   { return _witness_count_histogram; }
+         const vector<uint64_t>& committee_count_histogram()const { return _committee_count_histogram; }
+         const uint64_t*         total_voting_stake()const        { return _total_voting_stake; }
+
+      private:
+         void add( account_id_type account, const vote_tally_contribution& c );
+         void subtract( account_id_type account, const vote_tally_contribution& c );
+
+         bool                                     _valid = false;
+         bool                                     _tracking = false;
+         vote_tally_parameters                    _parameters;
+         time_point_sec                           _tally_time;
+         vector<account_id_type>                  _committee_members;
+
+         std::unordered_map<account_id_type, vote_tally_contribution, std::hash<object_id_type>> _contributions;
+         std::unordered_map<account_id_type, flat_set<account_id_type>, std::hash<object_id_type>> _delegators;
+         std::set<pair<time_point_sec, account_id_type>> _expiry;
+         account_set                              _marked;
+
+         vector<uint64_t>                         _vote_tally;
+         vector<uint64_t>                         _witness_count_histogram;
+         vector<uint64_t>                         _committee_count_histogram;
+         uint64_t                                 _total_voting_stake[2] = { 0, 0 }; // 0=committee, 1=witness
+   };
+
+   /**
+    *  @brief This secondary index marks accounts in the @ref vote_tally_cache when objects their stake or
+    *  votes depend on are changed, i.e. accounts, account statistics and vesting balances.
+    */
+   class vote_tally_tracker : public secondary_index
+   {
+      public:
+         explicit vote_tally_tracker( vote_tally_cache* cache ) : _cache( *cache ) {}
+
+         virtual void object_inserted( const object& obj ) override;
+         virtual void object_removed( const object& obj ) override;
+         virtual void object_modified( const object& after  ) override;
+
+      private:
+         void mark_owner( const object& obj );
+
+         vote_tally_cache& _cache;
+   };
+
+} }
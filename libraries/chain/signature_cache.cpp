@@ -0,0 +1,98 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <graphene/chain/signature_cache.hpp>
+
+namespace graphene { namespace chain {
+
+signature_cache::signature_cache( size_t capacity ) : _capacity( capacity ) {}
+
+void signature_cache::set_capacity( size_t capacity )
+{
+   _capacity = capacity;
+   clear();
+}
+
+const flat_set<public_key_type>& signature_cache::get_signature_keys( const precomputable_transaction& trx,
+                                                                      const chain_id_type& chain_id )
+{
+   if( _capacity == 0 || trx.signatures.empty() || trx.has_signature_keys() )
+      return trx.get_signature_keys( chain_id );
+
+   const digest_type digest = trx.sig_digest( chain_id );
+   shard& s = shard_of( digest );
+   {
+      std::lock_guard<std::mutex> guard( s.mutex );
+      auto itr = s.current.find( digest );
+      if( itr == s.current.end() )
+      {
+         auto old = s.previous.find( digest );
+         if( old != s.previous.end() && old->second.signatures == trx.signatures )
+         {
+            itr = s.current.emplace( digest, std::move( old->second ) ).first;
+            s.previous.erase( old );
+         }
+      }
+      if( itr != s.current.end() && itr->second.signatures == trx.signatures )
+      {
+         ++_hits;
+         trx.set_signature_keys( itr->second.keys );
+         return trx.get_signature_keys( chain_id );
+      }
+   }
+
+   // Recover outside of the lock, this is what takes the time
+   ++_misses;
+   const flat_set<public_key_type>& keys = trx.get_signature_keys( chain_id );
+
+   std::lock_guard<std::mutex> guard( s.mutex );
+   if( s.current.size() >= generation_size() )
+   {
+      s.previous = std::move( s.current );
+      s.current.clear();
+   }
+   entry& e = s.current[digest];
+   e.signatures = trx.signatures;
+   e.keys = keys;
+   return keys;
+}
+
+signature_cache::statistics signature_cache::get_statistics()const
+{
+   statistics result;
+   result.hits = _hits;
+   result.misses = _misses;
+   for( const shard& s : _shards )
+   {
+      std::lock_guard<std::mutex> guard( s.mutex );
+      result.size += s.current.size() + s.previous.size();
+   }
+   return result;
+}
+
+void signature_cache::clear()
+{
+   for( shard& s : _shards )
+   {
+      std::lock_guard<std::mutex> guard( s.mutex );
+      s.current.clear();
+      s.previous.clear();
+   }
+}
+
+} } // graphene::chain
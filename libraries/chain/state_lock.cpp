@@ -0,0 +1,63 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <graphene/chain/state_lock.hpp>
+
+namespace graphene { namespace chain {
+
+void state_lock::lock_shared()
+{
+   std::unique_lock<std::mutex> guard( _mutex );
+   _writer_done.wait( guard, [this]() { return _write_depth == 0 && _waiting_writers == 0; } );
+   ++_readers;
+}
+
+void state_lock::unlock_shared()
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   if( --_readers == 0 )
+      _readers_done.notify_all();
+}
+
+void state_lock::lock()
+{
+   std::unique_lock<std::mutex> guard( _mutex );
+   if( _write_depth > 0 && _writer == std::this_thread::get_id() )
+   {
+      ++_write_depth;
+      return;
+   }
+   ++_waiting_writers;
+   _readers_done.wait( guard, [this]() { return _readers == 0 && _write_depth == 0; } );
+   --_waiting_writers;
+   _writer = std::this_thread::get_id();
+   _write_depth = 1;
+}
+
+void state_lock::unlock()
+{
+   std::lock_guard<std::mutex> guard( _mutex );
+   if( --_write_depth > 0 )
+      return;
+   _writer = std::thread::id();
+   // another writer may be waiting as well
+   _readers_done.notify_all();
+   _writer_done.notify_all();
+}
+
+} } // graphene::chain
@@ -0,0 +1,130 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <graphene/chain/transaction_pool.hpp>
+
+#include <graphene/chain/exceptions.hpp>
+
+namespace graphene { namespace chain {
+
+void transaction_pool::set_limits( uint64_t max_size, uint32_t max_per_account )
+{
+   _max_size = max_size;
+   _max_per_account = max_per_account;
+}
+
+bool transaction_pool::contains( const transaction_id_type& id )const
+{
+   const auto& idx = _index.get<by_id>();
+   return idx.find( id ) != idx.end();
+}
+
+size_t transaction_pool::count_of( account_id_type fee_payer )const
+{
+   return _index.get<by_fee_payer>().count( fee_payer );
+}
+
+void transaction_pool::check_admission( account_id_type fee_payer, uint32_t size, uint64_t fee_per_kb )const
+{
+   if( _max_per_account > 0 )
+      GRAPHENE_ASSERT( count_of( fee_payer ) < _max_per_account, pending_transaction_limit_exceeded,
+                       "Account ${a} has too many pending transactions", ("a",fee_payer)("max",_max_per_account) );
+   if( _max_size > 0 && _total_size + size > _max_size && !_index.empty() )
+   {
+      const pending_transaction& lowest = *_index.get<by_priority>().rbegin();
+      GRAPHENE_ASSERT( fee_per_kb > lowest.fee_per_kb, transaction_pool_full,
+                       "Pending transactions are full, the fee must be higher than ${f} per KiB",
+                       ("f",lowest.fee_per_kb)("size",_total_size)("max",_max_size) );
+   }
+}
+
+const pending_transaction& transaction_pool::insert( processed_transaction trx, account_id_type fee_payer,
+                                                     uint32_t size, uint64_t fee_per_kb )
+{
+   pending_transaction entry;
+   entry.id = trx.id();
+   entry.expiration = trx.expiration;
+   entry.trx = std::move( trx );
+   entry.fee_payer = fee_payer;
+   entry.sequence = _next_sequence++;
+   entry.size = size;
+   entry.fee_per_kb = fee_per_kb;
+
+   const transaction_id_type id = entry.id;
+   auto result = _index.insert( std::move( entry ) );
+   FC_ASSERT( result.second, "Transaction ${id} is pending already", ("id",id) );
+   _total_size += size;
+   return *result.first;
+}
+
+void transaction_pool::erase( const transaction_id_type& id )
+{
+   auto& idx = _index.get<by_id>();
+   auto itr = idx.find( id );
+   if( itr == idx.end() )
+      return;
+   _total_size -= itr->size;
+   idx.erase( itr );
+}
+
+size_t transaction_pool::evict()
+{
+   if( !needs_eviction() )
+      return 0;
+   const uint64_t low_water = _max_size - _max_size / 10;
+   auto& idx = _index.get<by_priority>();
+   size_t evicted = 0;
+   while( !idx.empty() && _total_size > low_water )
+   {
+      auto itr = std::prev( idx.end() );
+      _total_size -= itr->size;
+      idx.erase( itr );
+      ++evicted;
+   }
+   return evicted;
+}
+
+size_t transaction_pool::remove_expired( time_point_sec now )
+{
+   auto& idx = _index.get<by_expiration>();
+   size_t removed = 0;
+   while( !idx.empty() && idx.begin()->expiration < now )
+   {
+      _total_size -= idx.begin()->size;
+      idx.erase( idx.begin() );
+      ++removed;
+   }
+   return removed;
+}
+
+void transaction_pool::move_to( transaction_pool& other )
+{
+   FC_ASSERT( other.empty(), "The transactions can only be moved to an empty pool" );
+   other._index.swap( _index );
+   other._total_size = _total_size;
+   other._next_sequence = std::max( other._next_sequence, _next_sequence );
+   _total_size = 0;
+}
+
+void transaction_pool::clear()
+{
+   _index.clear();
+   _total_size = 0;
+}
+
+} } // graphene::chain
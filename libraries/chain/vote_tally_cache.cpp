@@ -0,0 +1,170 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <graphene/chain/vote_tally_cache.hpp>
+
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/vesting_balance_object.hpp>
+
+namespace graphene { namespace chain {
+
+void vote_tally_cache::invalidate()
+{
+   reset( vote_tally_parameters() );
+   _tracking = false;
+   _marked.clear();
+   _committee_members.clear();
+}
+
+void vote_tally_cache::reset( const vote_tally_parameters& params )
+{
+   _valid = false;
+   _parameters = params;
+   _contributions.clear();
+   _delegators.clear();
+   _expiry.clear();
+   _vote_tally.assign( params.next_available_vote_id, 0 );
+   _witness_count_histogram.assign( params.maximum_witness_count / 2 + 1, 0 );
+   _committee_count_histogram.assign( params.maximum_committee_count / 2 + 1, 0 );
+   _total_voting_stake[0] = 0;
+   _total_voting_stake[1] = 0;
+}
+
+void vote_tally_cache::set_valid( time_point_sec now, vector<account_id_type> committee_members )
+{
+   _valid = true;
+   _tally_time = now;
+   _committee_members = std::move( committee_members );
+}
+
+vote_tally_cache::account_set vote_tally_cache::take_marks()
+{
+   account_set result;
+   result.swap( _marked );
+   return result;
+}
+
+const vote_tally_contribution* vote_tally_cache::find( account_id_type account )const
+{
+   auto itr = _contributions.find( account );
+   return itr == _contributions.end() ? nullptr : &itr->second;
+}
+
+void vote_tally_cache::update( account_id_type account, vote_tally_contribution&& contribution )
+{
+   auto itr = _contributions.find( account );
+   if( itr == _contributions.end() )
+      itr = _contributions.emplace( account, std::move( contribution ) ).first;
+   else
+   {
+      subtract( account, itr->second );
+      itr->second = std::move( contribution );
+   }
+   add( account, itr->second );
+}
+
+void vote_tally_cache::remove( account_id_type account )
+{
+   auto itr = _contributions.find( account );
+   if( itr == _contributions.end() )
+      return;
+   subtract( account, itr->second );
+   _contributions.erase( itr );
+}
+
+const flat_set<account_id_type>* vote_tally_cache::delegators_of( account_id_type opinion_account )const
+{
+   auto itr = _delegators.find( opinion_account );
+   return itr == _delegators.end() ? nullptr : &itr->second;
+}
+
+vector<account_id_type> vote_tally_cache::expired( time_point_sec now )const
+{
+   vector<account_id_type> result;
+   for( auto itr = _expiry.begin(); itr != _expiry.end() && itr->first <= now; ++itr )
+      result.push_back( itr->second );
+   return result;
+}
+
+void vote_tally_cache::add( account_id_type account, const vote_tally_contribution& c )
+{
+   for( const auto& vote : c.votes )
+      _vote_tally[vote.first] += vote.second;
+   if( c.witness_count.valid() )
+      _witness_count_histogram[c.witness_count->first] += c.witness_count->second;
+   if( c.committee_count.valid() )
+      _committee_count_histogram[c.committee_count->first] += c.committee_count->second;
+   _total_voting_stake[0] += c.total_voting_stake[0];
+   _total_voting_stake[1] += c.total_voting_stake[1];
+
+   if( c.opinion_account != account )
+      _delegators[c.opinion_account].insert( account );
+   if( c.valid_until != time_point_sec::maximum() )
+      _expiry.emplace( c.valid_until, account );
+}
+
+void vote_tally_cache::subtract( account_id_type account, const vote_tally_contribution& c )
+{
+   for( const auto& vote : c.votes )
+      _vote_tally[vote.first] -= vote.second;
+   if( c.witness_count.valid() )
+      _witness_count_histogram[c.witness_count->first] -= c.witness_count->second;
+   if( c.committee_count.valid() )
+      _committee_count_histogram[c.committee_count->first] -= c.committee_count->second;
+   _total_voting_stake[0] -= c.total_voting_stake[0];
+   _total_voting_stake[1] -= c.total_voting_stake[1];
+
+   if( c.opinion_account != account )
+   {
+      auto itr = _delegators.find( c.opinion_account );
+      if( itr != _delegators.end() )
+      {
+         itr->second.erase( account );
+         if( itr->second.empty() )
+            _delegators.erase( itr );
+      }
+   }
+   if( c.valid_until != time_point_sec::maximum() )
+      _expiry.erase( std::make_pair( c.valid_until, account ) );
+}
+
+void vote_tally_tracker::object_inserted( const object& obj )
+{
+   mark_owner( obj );
+}
+
+void vote_tally_tracker::object_removed( const object& obj )
+{
+   mark_owner( obj );
+}
+
+void vote_tally_tracker::object_modified( const object& after )
+{
+   mark_owner( after );
+}
+
+void vote_tally_tracker::mark_owner( const object& obj )
+{
+   if( obj.id.is<account_id_type>() )
+      _cache.mark( account_id_type( obj.id ) );
+   else if( obj.id.is<account_statistics_id_type>() )
+      _cache.mark( static_cast<const account_statistics_object&>( obj ).owner );
+   else if( obj.id.is<vesting_balance_id_type>() )
+      _cache.mark( static_cast<const vesting_balance_object&>( obj ).owner );
+}
+
+} } // graphene::chain
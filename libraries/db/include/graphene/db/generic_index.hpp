@@ -54,6 +54,16 @@ namespace graphene { namespace db {
             return *insert_result.first;
          }
 
+         /// Inserts an object whose ID is higher than all IDs in the index, which is faster than insert()
+         const object& insert_in_order( object&& obj )
+         {
+            assert( nullptr != dynamic_cast<ObjectType*>(&obj) );
+            const auto old_size = _indices.size();
+            auto itr = _indices.insert( _indices.end(), std::move( static_cast<ObjectType&>(obj) ) );
+            FC_ASSERT( _indices.size() > old_size, "Could not insert object, most likely a uniqueness constraint was violated" );
+            return *itr;
+         }
+
          virtual const object&  create(const std::function<void(object&)>& constructor )override
          {
             ObjectType item;
@@ -29,8 +29,11 @@
 #include <fc/io/json.hpp>
 #include <fc/crypto/sha256.hpp>
 
+#include <algorithm>
 #include <fstream>
+#include <memory>
 #include <stack>
+#include <utility>
 
 namespace graphene { namespace db {
    class object_database;
@@ -81,6 +84,12 @@ namespace graphene { namespace db {
          virtual void           set_next_id( object_id_type id ) = 0;
 
          virtual const object&  load( const std::vector<char>& data ) = 0;
+         /// Unpacks an object right from @p data and inserts it like load( const std::vector<char>& )
+         virtual const object&  load( const char* data, size_t size ) = 0;
+         /// Like load(), but the secondary indexes are only told about the object by notify_loaded()
+         virtual const object&  load_deferred( const char* data, size_t size ) = 0;
+         /// Removes an object like remove(), but without undo history and without notifying observers, like load()
+         virtual void           unload( const object& obj ) = 0;
          /**
           *  Polymorphically insert by moving an object into the index.
           *  this should throw if the object is already in the database.
@@ -99,6 +108,26 @@ namespace graphene { namespace db {
          virtual void open( const fc::path& db ) = 0;
          virtual void save( const fc::path& db ) = 0;
 
+         /**
+          *  Opens the index in steps, so that loading large indexes can be spread over threads:
+          *  begin_load() maps the file and divides its objects into up to @p max_chunks chunks of similar size,
+          *  decode_chunk() unpacks the objects of a chunk right from the mapped file, different chunks may be
+          *  decoded at the same time, end_load() inserts all decoded objects in the order of the file.
+          *  end_load() does not touch the secondary indexes, so that different indexes can be filled at the same
+          *  time, notify_loaded() has to be called afterwards.
+          *  @return the number of chunks, 0 if there is no file
+          */
+         virtual uint32_t begin_load( const fc::path& db, uint32_t max_chunks ) = 0;
+         virtual void     decode_chunk( uint32_t chunk ) = 0;
+         /// @return the number of loaded objects
+         virtual uint64_t end_load() = 0;
+         /**
+          *  Tells the secondary indexes about the objects inserted by end_load() and load_deferred(), in the order
+          *  they were inserted. Secondary indexes may refer to other indexes or shared state, so this must not run
+          *  for several indexes at the same time.
+          */
+         virtual void     notify_loaded() = 0;
+
 
 
          /** @return the object with id or nullptr if not found */
@@ -343,22 +372,86 @@ namespace graphene { namespace db {
          }
 
          virtual void open( const path& db )override
-         { 
-            if( !fc::exists( db ) ) return;
-            fc::file_mapping fm( db.generic_string().c_str(), fc::read_only );
-            fc::mapped_region mr( fm, fc::read_only, 0, fc::file_size(db) );
-            fc::datastream<const char*> ds( (const char*)mr.get_address(), mr.get_size() );
+         {
+            if( begin_load( db, 1 ) > 0 )
+               decode_chunk( 0 );
+            end_load();
+            notify_loaded();
+         }
+
+         virtual uint32_t begin_load( const path& db, uint32_t max_chunks )override
+         {
+            _pending_load.reset();
+            if( !fc::exists( db ) ) return 0;
+            _pending_load = std::make_unique<pending_load>( db );
+            fc::datastream<const char*> ds( (const char*)_pending_load->region.get_address(),
+                                            _pending_load->region.get_size() );
             fc::sha256 open_ver;
 
             fc::raw::unpack(ds, _next_id);
             fc::raw::unpack(ds, open_ver);
             FC_ASSERT( open_ver == get_object_version(), "Incompatible Version, the serialization of objects in this index has changed" );
-            vector<char> tmp;
+
+            // only the sizes are read here, to find where the chunks begin
+            const size_t chunk_size = ds.remaining() / std::max<uint32_t>( max_chunks, 1 ) + 1;
+            const char* chunk_begin = ds.pos();
             while( ds.remaining() > 0 )
             {
-               fc::raw::unpack( ds, tmp );
-               load( tmp );
+               fc::unsigned_int size;
+               fc::raw::unpack( ds, size );
+               FC_ASSERT( ds.remaining() >= size.value, "The index file is truncated" );
+               ds.skip( size.value );
+               if( size_t( ds.pos() - chunk_begin ) >= chunk_size )
+               {
+                  _pending_load->chunks.emplace_back( chunk_begin, ds.pos() );
+                  chunk_begin = ds.pos();
+               }
+            }
+            if( ds.pos() != chunk_begin )
+               _pending_load->chunks.emplace_back( chunk_begin, ds.pos() );
+            _pending_load->decoded.resize( _pending_load->chunks.size() );
+            return _pending_load->chunks.size();
+         }
+
+         virtual void decode_chunk( uint32_t chunk )override
+         {
+            FC_ASSERT( _pending_load && chunk < _pending_load->chunks.size() );
+            const auto& range = _pending_load->chunks[chunk];
+            fc::datastream<const char*> ds( range.first, range.second - range.first );
+            vector<object_type>& objects = _pending_load->decoded[chunk];
+            while( ds.remaining() > 0 )
+            {
+               fc::unsigned_int size;
+               fc::raw::unpack( ds, size );
+               fc::datastream<const char*> object_ds( ds.pos(), size.value );
+               objects.emplace_back();
+               fc::raw::unpack( object_ds, objects.back() );
+               ds.skip( size.value );
+            }
+         }
+
+         virtual uint64_t end_load()override
+         {
+            if( !_pending_load ) return 0;
+            uint64_t count = 0;
+            for( auto& objects : _pending_load->decoded )
+            {
+               _not_notified.reserve( _not_notified.size() + objects.size() );
+               for( auto& obj : objects )
+                  _not_notified.push_back( &DerivedIndex::insert_in_order( std::move( obj ) ) );
+               count += objects.size();
+               vector<object_type>().swap( objects );
             }
+            _pending_load.reset();
+            return count;
+         }
+
+         virtual void notify_loaded()override
+         {
+            for( const object* obj : _not_notified )
+               for( const auto& item : _sindex )
+                  item->object_inserted( *obj );
+            vector<const object*>().swap( _not_notified );
          }
 
          virtual void save( const path& db ) override 
@@ -378,12 +471,36 @@ namespace graphene { namespace db {
 
          virtual const object&  load( const std::vector<char>& data )override
          {
-            const auto& result = DerivedIndex::insert( fc::raw::unpack<object_type>( data ) );
+            return load( data.data(), data.size() );
+         }
+
+         virtual const object&  load( const char* data, size_t size )override
+         {
+            fc::datastream<const char*> ds( data, size );
+            object_type obj;
+            fc::raw::unpack( ds, obj );
+            const auto& result = DerivedIndex::insert( std::move( obj ) );
             for( const auto& item : _sindex )
                item->object_inserted( result );
             return result;
          }
 
+         virtual const object&  load_deferred( const char* data, size_t size )override
+         {
+            fc::datastream<const char*> ds( data, size );
+            object_type obj;
+            fc::raw::unpack( ds, obj );
+            const auto& result = DerivedIndex::insert( std::move( obj ) );
+            _not_notified.push_back( &result );
+            return result;
+         }
+
+         virtual void unload( const object& obj )override
+         {
+            for( const auto& item : _sindex )
+               item->object_removed( obj );
+            DerivedIndex::remove( obj );
+         }
 
          virtual const object&  create(const std::function<void(object&)>& constructor )override
          {
@@ -446,8 +563,24 @@ namespace graphene { namespace db {
          }
 
       private:
+         /// A file which is being loaded, see begin_load()
+         struct pending_load
+         {
+            explicit pending_load( const path& db )
+            : file( db.generic_string().c_str(), fc::read_only ),
+              region( file, fc::read_only, 0, fc::file_size( db ) ) {}
+
+            fc::file_mapping                                   file;
+            fc::mapped_region                                  region;
+            vector< std::pair<const char*, const char*> >      chunks;
+            vector< vector<object_type> >                      decoded;
+         };
+
          object_id_type                                 _next_id;
          const direct_index< object_type, DirectBits >* _direct_by_id = nullptr;
+         std::unique_ptr<pending_load>                  _pending_load;
+         /// Loaded objects which the secondary indexes don't know about yet, see notify_loaded()
+         vector<const object*>                          _not_notified;
    };
 
 } } // graphene::db
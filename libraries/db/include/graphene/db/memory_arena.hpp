@@ -0,0 +1,95 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   /**
+    *  @brief Keeps memory blocks released by @ref memory_arena instances for reuse
+    *
+    *  All blocks handed out by the pool have the same size. At most @p max_free_blocks released blocks
+    *  are kept, the rest is returned to the system. The pool is not thread safe.
+    */
+   class memory_block_pool
+   {
+      public:
+         static constexpr size_t block_size = 16 * 1024;
+
+         explicit memory_block_pool( size_t max_free_blocks = 256 ) : _max_free_blocks( max_free_blocks ) {}
+         ~memory_block_pool();
+
+         memory_block_pool( const memory_block_pool& ) = delete;
+         memory_block_pool& operator=( const memory_block_pool& ) = delete;
+
+         char*  acquire();
+         void   release( char* block );
+         size_t free_blocks()const { return _free.size(); }
+
+      private:
+         std::vector<char*> _free;
+         size_t             _max_free_blocks;
+   };
+
+   /**
+    *  @brief A monotonic allocator that frees all of its memory at once
+    *
+    *  Memory is carved from blocks taken from a @ref memory_block_pool (or from the heap if there is no pool),
+    *  allocations bigger than a block get a block of their own. Nothing is freed before the arena is
+    *  released or destroyed; objects created in the arena must be destroyed explicitly before that.
+    */
+   class memory_arena
+   {
+      public:
+         explicit memory_arena( memory_block_pool* pool = nullptr ) : _pool( pool ) {}
+         ~memory_arena() { release(); }
+
+         memory_arena( const memory_arena& ) = delete;
+         memory_arena& operator=( const memory_arena& ) = delete;
+
+         void* allocate( size_t size, size_t alignment = alignof(std::max_align_t) );
+
+         template<typename T, typename... Args>
+         T* create( Args&&... args )
+         {
+            return new( allocate( sizeof(T), alignof(T) ) ) T( std::forward<Args>(args)... );
+         }
+
+         /// Returns all blocks to the pool (or to the system)
+         void   release();
+         /// @return the number of bytes taken from the pool and the system
+         size_t reserved_bytes()const { return _reserved; }
+
+      private:
+         struct block_header
+         {
+            block_header* next;
+            size_t        size;
+         };
+
+         memory_block_pool* _pool;
+         block_header*      _blocks = nullptr;
+         char*              _pos = nullptr;
+         char*              _end = nullptr;
+         size_t             _reserved = 0;
+   };
+
+} } // graphene::db
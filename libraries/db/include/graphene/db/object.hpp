@@ -23,6 +23,7 @@
  */
 #pragma once
 #include <boost/multiprecision/integer.hpp>
+#include <graphene/db/memory_arena.hpp>
 #include <graphene/protocol/object_id.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/crypto/city.hpp>
@@ -70,6 +71,10 @@ namespace graphene { namespace db {
 
          /// these methods are implemented for derived classes by inheriting abstract_object<DerivedClass>
          virtual unique_ptr<object> clone()const = 0;
+         /// copies the object into memory of @p arena, the copy must be destroyed explicitly
+         virtual object*            clone_into( memory_arena& arena )const = 0;
+         /// moves the object into memory of @p arena, the new object must be destroyed explicitly
+         virtual object*            move_into( memory_arena& arena ) = 0;
          virtual void               move_from( object& obj ) = 0;
          virtual variant            to_variant()const  = 0;
          virtual vector<char>       pack()const = 0;
@@ -90,6 +95,14 @@ namespace graphene { namespace db {
          {
             return unique_ptr<object>( std::make_unique<DerivedClass>( *static_cast<const DerivedClass*>(this) ) );
          }
+         virtual object* clone_into( memory_arena& arena )const
+         {
+            return arena.create<DerivedClass>( *static_cast<const DerivedClass*>(this) );
+         }
+         virtual object* move_into( memory_arena& arena )
+         {
+            return arena.create<DerivedClass>( std::move( static_cast<DerivedClass&>(*this) ) );
+         }
 
          virtual void    move_from( object& obj )
          {
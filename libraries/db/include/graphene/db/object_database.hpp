@@ -28,10 +28,24 @@
 
 #include <fc/log/logger.hpp>
 
+#include <deque>
 #include <map>
+#include <unordered_set>
 
 namespace graphene { namespace db {
 
+   /// How long it took to load an index when the object database was opened
+   struct index_load_timing
+   {
+      uint8_t          space_id = 0;
+      uint8_t          type_id = 0;
+      uint64_t         objects = 0;
+      uint32_t         chunks = 0;
+      fc::microseconds map_time;     ///< to map the file and divide it into chunks
+      fc::microseconds decode_time;  ///< to unpack the objects, summed up over all chunks
+      fc::microseconds insert_time;  ///< to insert the objects into the index and its secondary indexes
+   };
+
    /**
     *   @class object_database
     *   @brief maintains a set of indexed objects that can be modified with multi-level rollback support
@@ -44,12 +58,56 @@ namespace graphene { namespace db {
 
          void reset_indexes() { _index.clear(); _index.resize(255); }
 
+         /// Index files larger than this are unpacked by several threads when the database is opened
+         static constexpr uint64_t load_chunk_size = 4 * 1024 * 1024;
+
          void open(const fc::path& data_dir );
+         /// @return the timings of the indexes loaded by the last call to open()
+         const vector<index_load_timing>& get_load_timings()const { return _load_timings; }
 
          /**
           * Saves the complete state of the object_database to disk, this could take a while
           */
          void flush();
+
+         /// Change logs larger than this are compacted by the next write_changes()
+         static constexpr uint64_t default_change_log_compaction_size = 256 * 1024 * 1024;
+
+         /**
+          * Tracks which objects are created, modified and removed, so that capture_changes() can save them.
+          * The changes are tracked from the moment this is enabled, so it must be enabled before open(), or
+          * be followed by flush().
+          */
+         void track_changes( bool enable );
+         bool tracking_changes()const { return _track_changes; }
+         /**
+          * Packs the objects which have changed since the last flush() or capture_changes() into a record of
+          * the change log, which is kept in memory until write_changes() appends it. The record holds the state
+          * after block @p block_num, it must not be written before that block is irreversible, because the
+          * undo history needed to leave a fork is not saved with it.
+          */
+         void capture_changes( uint32_t block_num );
+         /// @return true if a record captured at or before block @p up_to has not been written yet
+         bool has_captured_changes( uint32_t up_to )const;
+         /**
+          * Appends the records captured at or before block @p up_to to the change log in the object_database
+          * directory, which open() applies on top of the files written by flush(). Each record of the log
+          * carries a checksum, a record which has been written only partially (e.g. when the node crashed) is
+          * dropped by open(). Records which could not be written are kept for the next call. When the log has
+          * grown beyond its compaction size, it is compacted first.
+          */
+         void write_changes( uint32_t up_to );
+         /// Drops the records captured after block @p block_num, e.g. when the block has been popped; the objects
+         /// they contain are saved with the next record instead
+         void discard_changes_after( uint32_t block_num );
+         /// Merges the records of the change log into one which holds the latest version of each object
+         void compact_change_log();
+         void set_change_log_compaction_size( uint64_t bytes ) { _change_log_compaction_size = bytes; }
+         uint64_t change_log_size()const { return _change_log_size; }
+         /// @return the number of change log records applied by the last call to open()
+         uint32_t get_change_log_records()const { return _change_log_records; }
+         /// Removes the change log, so that the next open() loads the state saved by the last flush()
+         void discard_change_log();
          void wipe(const fc::path& data_dir); // remove from disk
          void close();
 
@@ -75,8 +133,24 @@ namespace graphene { namespace db {
          const index&  get_index()const { return get_index(T::space_id,T::type_id); }
          const index&  get_index(uint8_t space_id, uint8_t type_id)const;
          const index&  get_index(object_id_type id)const { return get_index(id.space(),id.type()); }
+         /// @return the index of the given space and type, or nullptr if there is none
+         const index*  find_index(uint8_t space_id, uint8_t type_id)const;
+         /// Calls @p inspector for every index, ordered by space and type
+         void          inspect_all_indexes( const std::function<void(const index&)>& inspector )const;
          /// @}
 
+         /**
+          * Loads objects into an index like open() does, i.e. without undo history and without notifying observers.
+          * @p data holds the packed objects back to back, each prefixed by its size, like the files written by flush().
+          * The index must not contain any of the objects yet. Different indexes may be loaded at the same time,
+          * the secondary indexes only learn about the objects when notify_loaded() is called afterwards.
+          * @return the number of loaded objects
+          */
+         uint64_t load_objects( uint8_t space_id, uint8_t type_id, object_id_type next_id,
+                                const char* data, size_t size );
+         /// Lets the secondary indexes of all indexes know about the objects given to load_objects(), one by one
+         void     notify_loaded();
+
          const object& get_object( object_id_type id )const;
          const object* find_object( object_id_type id )const;
 
@@ -174,8 +248,28 @@ namespace graphene { namespace db {
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
 
+         fc::path change_log_file()const { return _data_dir / "object_database" / "changes.log"; }
+         void     replay_change_log();
+
+         /// A record of the change log which has been captured but not written yet
+         struct captured_changes
+         {
+            uint32_t               block_num = 0;
+            vector<object_id_type> objects;   ///< the IDs of the changed objects
+            vector<char>           data;      ///< the packed record, including its header
+         };
+
          fc::path                                                  _data_dir;
          vector< vector< unique_ptr<index> > >                     _index;
+         vector<index_load_timing>                                 _load_timings;
+         bool                                                      _track_changes = false;
+         std::unordered_set<object_id_type>                        _changed_objects;
+         uint64_t                                                  _change_log_compaction_size = default_change_log_compaction_size;
+         uint64_t                                                  _change_log_size = 0;
+         /// the size of the log after it was last compacted, it is not compacted again before it has doubled
+         uint64_t                                                  _compacted_change_log_size = 0;
+         std::deque<captured_changes>                              _captured_changes;
+         uint32_t                                                  _change_log_records = 0;
    };
 
 } } // graphene::db
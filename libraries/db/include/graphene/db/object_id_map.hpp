@@ -0,0 +1,279 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <graphene/db/memory_arena.hpp>
+#include <graphene/protocol/object_id.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+namespace graphene { namespace db {
+
+   using graphene::protocol::object_id_type;
+
+   /**
+    *  @brief An open-addressing hash map from object IDs to trivially copyable values
+    *
+    *  The slots are allocated from a @ref memory_arena and are never freed individually, so the map is meant
+    *  for short-lived, insert-mostly use such as tracking the changes of an undo session. Erased entries
+    *  leave a tombstone behind. Iterators are invalidated by insertions.
+    */
+   template<typename Value>
+   class object_id_map
+   {
+      static_assert( std::is_trivially_copyable<Value>::value, "values must be trivially copyable" );
+
+      public:
+         struct value_type
+         {
+            object_id_type first;
+            Value          second;
+         };
+
+         template<bool Const>
+         class basic_iterator
+         {
+            public:
+               using iterator_category = std::forward_iterator_tag;
+               using value_type        = typename object_id_map::value_type;
+               using difference_type   = std::ptrdiff_t;
+               using pointer           = typename std::conditional<Const, const value_type*, value_type*>::type;
+               using reference         = typename std::conditional<Const, const value_type&, value_type&>::type;
+
+               basic_iterator() = default;
+               basic_iterator( const object_id_map* map, size_t pos ) : _map( map ), _pos( pos ) { skip(); }
+               template<bool C = Const, typename = typename std::enable_if<C>::type>
+               basic_iterator( const basic_iterator<false>& other ) : _map( other._map ), _pos( other._pos ) {}
+
+               reference operator*()const  { return _map->_slots[_pos]; }
+               pointer   operator->()const { return &**this; }
+               basic_iterator& operator++() { ++_pos; skip(); return *this; }
+               basic_iterator  operator++(int) { auto tmp = *this; ++*this; return tmp; }
+
+               bool operator==( const basic_iterator& other )const { return _pos == other._pos; }
+               bool operator!=( const basic_iterator& other )const { return _pos != other._pos; }
+
+            private:
+               friend class object_id_map;
+               friend class basic_iterator<!Const>;
+
+               void skip()
+               {
+                  while( _pos < _map->_capacity && _map->_states[_pos] != used )
+                     ++_pos;
+               }
+
+               const object_id_map* _map = nullptr;
+               size_t               _pos = 0;
+         };
+
+         using iterator       = basic_iterator<false>;
+         using const_iterator = basic_iterator<true>;
+
+         explicit object_id_map( memory_arena& arena ) : _arena( &arena ) {}
+
+         object_id_map( const object_id_map& ) = delete;
+         object_id_map& operator=( const object_id_map& ) = delete;
+
+         iterator       begin()       { return iterator( this, 0 ); }
+         iterator       end()         { return iterator( this, _capacity ); }
+         const_iterator begin()const  { return const_iterator( this, 0 ); }
+         const_iterator end()const    { return const_iterator( this, _capacity ); }
+
+         size_t size()const  { return _size; }
+         bool   empty()const { return _size == 0; }
+
+         iterator find( object_id_type id )
+         {
+            return iterator( this, locate( id ) );
+         }
+         const_iterator find( object_id_type id )const
+         {
+            return const_iterator( this, locate( id ) );
+         }
+         size_t count( object_id_type id )const { return locate( id ) != _capacity ? 1 : 0; }
+
+         /// Inserts @p value unless @p id is in the map already
+         std::pair<iterator,bool> insert( object_id_type id, const Value& value )
+         {
+            size_t pos = locate( id );
+            if( pos != _capacity )
+               return std::make_pair( iterator( this, pos ), false );
+            reserve( _size + 1 );
+            pos = slot_for( id );
+            if( _states[pos] == erased )
+               --_erased;
+            _states[pos] = used;
+            new( &_slots[pos] ) value_type{ id, value };
+            ++_size;
+            return std::make_pair( iterator( this, pos ), true );
+         }
+
+         Value& operator[]( object_id_type id )
+         {
+            return insert( id, Value() ).first->second;
+         }
+
+         void erase( iterator itr )
+         {
+            _states[itr._pos] = erased;
+            --_size;
+            ++_erased;
+         }
+         size_t erase( object_id_type id )
+         {
+            size_t pos = locate( id );
+            if( pos == _capacity )
+               return 0;
+            erase( iterator( this, pos ) );
+            return 1;
+         }
+
+         /// Makes room for @p n entries without further allocations
+         void reserve( size_t n )
+         {
+            if( ( n + _erased ) * 4 < _capacity * 3 )
+               return;
+            size_t capacity = 8;
+            while( n * 4 >= capacity * 3 )
+               capacity *= 2;
+            rehash( capacity );
+         }
+
+      private:
+         enum slot_state : uint8_t { free_slot = 0, used = 1, erased = 2 };
+
+         size_t hash( object_id_type id )const
+         {
+            // Fibonacci hashing spreads the sequential instance numbers of an object type over the table
+            return size_t( ( uint64_t( id ) * UINT64_C(0x9E3779B97F4A7C15) ) >> ( 64 - _shift ) );
+         }
+
+         /// @return the position of @p id, or _capacity if it isn't in the map
+         size_t locate( object_id_type id )const
+         {
+            if( _size == 0 )
+               return _capacity;
+            for( size_t pos = hash( id ); ; pos = ( pos + 1 ) & ( _capacity - 1 ) )
+            {
+               if( _states[pos] == free_slot )
+                  return _capacity;
+               if( _states[pos] == used && _slots[pos].first == id )
+                  return pos;
+            }
+         }
+
+         /// @return the first free or erased slot in the probe sequence of @p id
+         size_t slot_for( object_id_type id )const
+         {
+            size_t pos = hash( id );
+            while( _states[pos] == used )
+               pos = ( pos + 1 ) & ( _capacity - 1 );
+            return pos;
+         }
+
+         void rehash( size_t capacity )
+         {
+            value_type* old_slots = _slots;
+            uint8_t*    old_states = _states;
+            size_t      old_capacity = _capacity;
+
+            _slots = static_cast<value_type*>( _arena->allocate( sizeof(value_type) * capacity,
+                                                                 alignof(value_type) ) );
+            _states = static_cast<uint8_t*>( _arena->allocate( capacity, 1 ) );
+            std::memset( _states, free_slot, capacity );
+            _capacity = capacity;
+            _shift = 0;
+            while( ( size_t(1) << _shift ) < capacity )
+               ++_shift;
+            _erased = 0;
+
+            for( size_t i = 0; i < old_capacity; ++i )
+            {
+               if( old_states[i] != used )
+                  continue;
+               size_t pos = slot_for( old_slots[i].first );
+               _states[pos] = used;
+               new( &_slots[pos] ) value_type( old_slots[i] );
+            }
+         }
+
+         memory_arena* _arena;
+         value_type*   _slots = nullptr;
+         uint8_t*      _states = nullptr;
+         size_t        _capacity = 0;
+         size_t        _shift = 0;
+         size_t        _size = 0;
+         size_t        _erased = 0;
+   };
+
+   /**
+    *  @brief A set of object IDs, based on @ref object_id_map
+    */
+   class object_id_set
+   {
+      struct no_value {};
+      using map_type = object_id_map<no_value>;
+
+      public:
+         class const_iterator
+         {
+            public:
+               using iterator_category = std::forward_iterator_tag;
+               using value_type        = object_id_type;
+               using difference_type   = std::ptrdiff_t;
+               using pointer           = const object_id_type*;
+               using reference         = const object_id_type&;
+
+               const_iterator() = default;
+               explicit const_iterator( map_type::const_iterator itr ) : _itr( itr ) {}
+
+               reference operator*()const  { return _itr->first; }
+               pointer   operator->()const { return &_itr->first; }
+               const_iterator& operator++() { ++_itr; return *this; }
+               const_iterator  operator++(int) { auto tmp = *this; ++_itr; return tmp; }
+
+               bool operator==( const const_iterator& other )const { return _itr == other._itr; }
+               bool operator!=( const const_iterator& other )const { return _itr != other._itr; }
+
+            private:
+               map_type::const_iterator _itr;
+         };
+         using iterator = const_iterator;
+
+         explicit object_id_set( memory_arena& arena ) : _map( arena ) {}
+
+         const_iterator begin()const { return const_iterator( _map.begin() ); }
+         const_iterator end()const   { return const_iterator( _map.end() ); }
+
+         size_t size()const  { return _map.size(); }
+         bool   empty()const { return _map.empty(); }
+
+         const_iterator find( object_id_type id )const { return const_iterator( _map.find( id ) ); }
+         size_t         count( object_id_type id )const { return _map.count( id ); }
+         bool           insert( object_id_type id ) { return _map.insert( id, no_value() ).second; }
+         size_t         erase( object_id_type id ) { return _map.erase( id ); }
+         void           reserve( size_t n ) { _map.reserve( n ); }
+
+      private:
+         map_type _map;
+   };
+
+} } // graphene::db
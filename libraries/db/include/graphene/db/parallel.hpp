@@ -0,0 +1,77 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <fc/thread/parallel.hpp>
+
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   /**
+    *  Runs task(i) for every i below @p count on the thread pool of fc::do_parallel, then rethrows the first
+    *  error of the tasks.
+    *
+    *  The calling thread is blocked until all tasks are done. Waiting on fc futures instead would let other tasks
+    *  of the calling fc thread run in between, which could change the database while it is being read or
+    *  written. The tasks usually refer to data of the caller, so the error is only rethrown once all of them
+    *  have finished.
+    */
+   template<typename Task>
+   void run_parallel( size_t count, const Task& task )
+   {
+      std::vector<std::future<void>> workers;
+      workers.reserve( count );
+      for( size_t i = 0; i < count; ++i )
+      {
+         auto done = std::make_shared<std::promise<void>>();
+         workers.push_back( done->get_future() );
+         fc::do_parallel( [&task,i,done] () {
+            try
+            {
+               task( i );
+               done->set_value();
+            }
+            catch( ... )
+            {
+               done->set_exception( std::current_exception() );
+            }
+         });
+      }
+
+      std::exception_ptr error;
+      for( auto& worker : workers )
+      {
+         try
+         {
+            worker.get();
+         }
+         catch( ... )
+         {
+            if( !error )
+               error = std::current_exception();
+         }
+      }
+      if( error )
+         std::rethrow_exception( error );
+   }
+
+} } // graphene::db
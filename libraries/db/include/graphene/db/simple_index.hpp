@@ -69,6 +69,12 @@ namespace graphene { namespace db {
             return *_objects[instance];
          }
 
+         /// Objects are stored by instance anyway, so the order does not matter
+         const object& insert_in_order( object&& obj )
+         {
+            return insert( std::move( obj ) );
+         }
+
          virtual void remove( const object& obj ) override
          {
             assert( nullptr != dynamic_cast<const T*>(&obj) );
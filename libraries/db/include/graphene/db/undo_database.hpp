@@ -23,6 +23,7 @@
  */
 #pragma once
 #include <graphene/db/object.hpp>
+#include <graphene/db/object_id_map.hpp>
 #include <deque>
 #include <fc/exception/exception.hpp>
 
@@ -32,12 +33,26 @@ namespace graphene { namespace db {
    using fc::flat_set;
    class object_database;
 
+   /**
+    *  The changes recorded by one undo session.
+    *
+    *  All memory of a state, the hash tables as well as the snapshots of old and removed objects, is taken from
+    *  the state's arena and released in one go when the state is destroyed. The snapshots are owned by the state.
+    */
    struct undo_state
    {
-      unordered_map<object_id_type, unique_ptr<object> > old_values;
-      unordered_map<object_id_type, object_id_type>      old_index_next_ids;
-      std::unordered_set<object_id_type>                 new_ids;
-      unordered_map<object_id_type, unique_ptr<object> > removed;
+      explicit undo_state( memory_block_pool* pool )
+      : arena( pool ), old_values( arena ), old_index_next_ids( arena ), new_ids( arena ), removed( arena ) {}
+      ~undo_state();
+
+      undo_state( const undo_state& ) = delete;
+      undo_state& operator=( const undo_state& ) = delete;
+
+      memory_arena                   arena;
+      object_id_map<object*>         old_values;
+      object_id_map<object_id_type>  old_index_next_ids;
+      object_id_set                  new_ids;
+      object_id_map<object*>         removed;
    };
 
 
@@ -81,6 +96,19 @@ namespace graphene { namespace db {
                bool _disable_on_exit = false;
          };
 
+         /**
+          * Receives every change of the database, also while undo is disabled
+          */
+         class change_observer
+         {
+            public:
+               virtual ~change_observer() = default;
+               /// Called just after an object is created, and just before it is modified or removed
+               virtual void on_change( const object& obj ) = 0;
+         };
+
+         void    set_change_observer( change_observer* observer ) { _observer = observer; }
+
          void    disable();
          void    enable();
          bool    enabled()const { return !_disabled; }
@@ -130,9 +158,11 @@ namespace graphene { namespace db {
 
          uint32_t                _active_sessions = 0;
          bool                    _disabled = true;
+         memory_block_pool       _block_pool;
          std::deque<undo_state>  _stack;
          object_database&        _db;
          size_t                  _max_size = 256;
+         change_observer*        _observer = nullptr;
    };
 
 } } // graphene::db
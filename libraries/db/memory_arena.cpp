@@ -0,0 +1,104 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <graphene/db/memory_arena.hpp>
+
+#include <cstdint>
+
+namespace graphene { namespace db {
+
+namespace {
+   constexpr size_t header_size = ( sizeof(void*) + sizeof(size_t) + alignof(std::max_align_t) - 1 )
+                                  & ~( alignof(std::max_align_t) - 1 );
+
+   char* align_up( char* p, size_t alignment )
+   {
+      auto addr = reinterpret_cast<uintptr_t>( p );
+      return p + ( ( alignment - addr % alignment ) % alignment );
+   }
+}
+
+memory_block_pool::~memory_block_pool()
+{
+   for( char* block : _free )
+      delete[] block;
+}
+
+char* memory_block_pool::acquire()
+{
+   if( _free.empty() )
+      return new char[block_size];
+   char* block = _free.back();
+   _free.pop_back();
+   return block;
+}
+
+void memory_block_pool::release( char* block )
+{
+   if( _free.size() < _max_free_blocks )
+      _free.push_back( block );
+   else
+      delete[] block;
+}
+
+void* memory_arena::allocate( size_t size, size_t alignment )
+{
+   char* result = align_up( _pos, alignment );
+   if( _pos != nullptr && result + size <= _end )
+   {
+      _pos = result + size;
+      return result;
+   }
+
+   const size_t needed = header_size + size + alignment;
+   const bool pooled = needed <= memory_block_pool::block_size;
+   const size_t block_size = pooled ? size_t( memory_block_pool::block_size ) : needed;
+   char* data = ( pooled && _pool != nullptr ) ? _pool->acquire() : new char[block_size];
+   _reserved += block_size;
+
+   auto header = reinterpret_cast<block_header*>( data );
+   header->size = block_size;
+   header->next = _blocks;
+   _blocks = header;
+
+   result = align_up( data + header_size, alignment );
+   if( pooled )
+   {
+      // only regular blocks are used for further allocations, a dedicated block is full already
+      _pos = result + size;
+      _end = data + block_size;
+   }
+   return result;
+}
+
+void memory_arena::release()
+{
+   while( _blocks != nullptr )
+   {
+      block_header* header = _blocks;
+      _blocks = header->next;
+      char* data = reinterpret_cast<char*>( header );
+      if( header->size == memory_block_pool::block_size && _pool != nullptr )
+         _pool->release( data );
+      else
+         delete[] data;
+   }
+   _pos = _end = nullptr;
+   _reserved = 0;
+}
+
+} } // graphene::db
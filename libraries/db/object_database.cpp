@@ -22,11 +22,43 @@
  * THE SOFTWARE.
  */
 #include <graphene/db/object_database.hpp>
+#include <graphene/db/parallel.hpp>
 
+#include <fc/asio.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/container/flat.hpp>
 #include <fc/thread/parallel.hpp>
 
+#include <algorithm>
+#include <fstream>
+
+namespace graphene { namespace db { namespace detail {
+
+   /// The changes of one index in a record of the change log
+   struct change_log_section
+   {
+      uint8_t                space_id = 0;
+      uint8_t                type_id = 0;
+      object_id_type         next_id;
+      vector<uint64_t>       removed;   ///< instances of the removed objects
+      vector< vector<char> > objects;   ///< the created and modified objects, packed
+   };
+
+   /// A record of the change log is stored as its size, the sha256 hash of the packed record, and the packed record
+   struct change_log_record
+   {
+      vector<change_log_section> sections;
+   };
+
+   static constexpr size_t change_log_header_size = sizeof(uint64_t) + sizeof(fc::sha256);
+
+} } } // graphene::db::detail
+
+FC_REFLECT( graphene::db::detail::change_log_section, (space_id)(type_id)(next_id)(removed)(objects) )
+FC_REFLECT( graphene::db::detail::change_log_record, (sections) )
+
 namespace graphene { namespace db {
 
 object_database::object_database()
@@ -40,6 +72,7 @@ object_database::~object_database(){}
 
 void object_database::close()
 {
+   _captured_changes.clear();
 }
 
 const object* object_database::find_object( object_id_type id )const
@@ -59,6 +92,48 @@ const index& object_database::get_index(uint8_t space_id, uint8_t type_id)const
    FC_ASSERT( tmp );
    return *tmp;
 }
+const index* object_database::find_index(uint8_t space_id, uint8_t type_id)const
+{
+   if( _index.size() <= space_id || _index[space_id].size() <= type_id )
+      return nullptr;
+   return _index[space_id][type_id].get();
+}
+
+void object_database::inspect_all_indexes( const std::function<void(const index&)>& inspector )const
+{
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            inspector( *idx );
+}
+
+uint64_t object_database::load_objects( uint8_t space_id, uint8_t type_id, object_id_type next_id,
+                                        const char* data, size_t size )
+{ try {
+   index& idx = get_mutable_index( space_id, type_id );
+   fc::datastream<const char*> ds( data, size );
+   uint64_t count = 0;
+   while( ds.remaining() > 0 )
+   {
+      fc::unsigned_int object_size;
+      fc::raw::unpack( ds, object_size );
+      FC_ASSERT( ds.remaining() >= object_size.value, "The data is truncated" );
+      idx.load_deferred( ds.pos(), object_size.value );
+      ds.skip( object_size.value );
+      ++count;
+   }
+   idx.set_next_id( next_id );
+   return count;
+} FC_CAPTURE_AND_RETHROW( (space_id)(type_id)(next_id)(size) ) }
+
+void object_database::notify_loaded()
+{
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            idx->notify_loaded();
+}
+
 index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
 {
    FC_ASSERT( _index.size() > space_id, "", ("space_id",space_id)("type_id",type_id)("index.size",_index.size()) );
@@ -89,10 +164,261 @@ void object_database::flush()
    fc::remove_all( _data_dir / "object_database.tmp" / "lock" );
    if( fc::exists( _data_dir / "object_database" ) )
       fc::rename( _data_dir / "object_database", _data_dir / "object_database.old" );
+   // the change log is not copied to the new directory, it is replaced by the complete state
    fc::rename( _data_dir / "object_database.tmp", _data_dir / "object_database" );
    fc::remove_all( _data_dir / "object_database.old" );
+   _changed_objects.clear();
+   _captured_changes.clear();
+   _change_log_size = 0;
+   _compacted_change_log_size = 0;
+}
+
+void object_database::track_changes( bool enable )
+{
+   _track_changes = enable;
+   if( !enable )
+   {
+      _changed_objects.clear();
+      _captured_changes.clear();
+   }
+}
+
+/// @return the header and the body of a record of the change log
+static vector<char> pack_change_log_record( const detail::change_log_record& record )
+{
+   const vector<char> body = fc::raw::pack( record );
+   const uint64_t body_size = body.size();
+   const fc::sha256 checksum = fc::sha256::hash( body.data(), body.size() );
+   vector<char> data( detail::change_log_header_size + body.size() );
+   fc::datastream<char*> ds( data.data(), data.size() );
+   fc::raw::pack( ds, body_size );
+   fc::raw::pack( ds, checksum );
+   ds.write( body.data(), body.size() );
+   return data;
+}
+
+/// Calls @p apply for each complete record at the beginning of @p content
+/// @return the size of these records, an incomplete or damaged record and everything after it are ignored
+static uint64_t read_change_log( const std::string& content,
+                                 const std::function<void(const detail::change_log_record&)>& apply )
+{
+   uint64_t valid_size = 0;
+   fc::datastream<const char*> ds( content.data(), content.size() );
+   while( ds.remaining() >= detail::change_log_header_size )
+   {
+      uint64_t body_size;
+      fc::sha256 checksum;
+      fc::raw::unpack( ds, body_size );
+      fc::raw::unpack( ds, checksum );
+      if( ds.remaining() < body_size || fc::sha256::hash( ds.pos(), body_size ) != checksum )
+         break;
+
+      detail::change_log_record record;
+      fc::datastream<const char*> body( ds.pos(), body_size );
+      fc::raw::unpack( body, record );
+      apply( record );
+      ds.skip( body_size );
+      valid_size = content.size() - ds.remaining();
+   }
+   return valid_size;
+}
+
+/// @return the ID a packed object starts with
+static object_id_type packed_object_id( const vector<char>& packed )
+{
+   object_id_type id;
+   fc::datastream<const char*> ds( packed.data(), packed.size() );
+   fc::raw::unpack( ds, id );
+   return id;
+}
+
+void object_database::capture_changes( uint32_t block_num )
+{ try {
+   FC_ASSERT( _track_changes, "Changes are not tracked" );
+
+   // group the changes by index, the next IDs of all indexes are stored because undo may have reset them
+   detail::change_log_record record;
+   std::map< std::pair<uint8_t,uint8_t>, size_t > sections;
+   inspect_all_indexes( [&record,&sections]( const index& idx ) {
+      sections[ std::make_pair( idx.object_space_id(), idx.object_type_id() ) ] = record.sections.size();
+      record.sections.emplace_back();
+      detail::change_log_section& section = record.sections.back();
+      section.space_id = idx.object_space_id();
+      section.type_id = idx.object_type_id();
+      section.next_id = idx.get_next_id();
+   });
+   for( const object_id_type& id : _changed_objects )
+   {
+      auto itr = sections.find( std::make_pair( id.space(), id.type() ) );
+      if( itr == sections.end() )
+         continue;
+      detail::change_log_section& section = record.sections[itr->second];
+      const object* obj = find_object( id );
+      if( obj != nullptr )
+         section.objects.push_back( obj->pack() );
+      else
+         section.removed.push_back( id.instance() );
+   }
+
+   captured_changes captured;
+   captured.block_num = block_num;
+   captured.objects.assign( _changed_objects.begin(), _changed_objects.end() );
+   captured.data = pack_change_log_record( record );
+   _captured_changes.push_back( std::move( captured ) );
+   _changed_objects.clear();
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+bool object_database::has_captured_changes( uint32_t up_to )const
+{
+   return !_captured_changes.empty() && _captured_changes.front().block_num <= up_to;
+}
+
+void object_database::write_changes( uint32_t up_to )
+{ try {
+   FC_ASSERT( !_data_dir.empty(), "The object database has not been opened" );
+   if( !has_captured_changes( up_to ) )
+      return;
+   if( _change_log_size >= std::max( _change_log_compaction_size, 2 * _compacted_change_log_size ) )
+      compact_change_log();
+
+   fc::create_directories( _data_dir / "object_database" );
+   std::ofstream out( change_log_file().generic_string(),
+                      std::ofstream::binary | std::ofstream::out | std::ofstream::app );
+   FC_ASSERT( out, "Unable to open ${f}", ("f",change_log_file()) );
+   uint64_t written = 0;
+   size_t records = 0;
+   for( ; records < _captured_changes.size() && _captured_changes[records].block_num <= up_to; ++records )
+   {
+      const vector<char>& data = _captured_changes[records].data;
+      out.write( data.data(), data.size() );
+      written += data.size();
+   }
+   out.close();
+   if( !out )
+   {
+      // records after a partially written one would be dropped by open()
+      fc::resize_file( change_log_file(), _change_log_size );
+      FC_THROW( "Unable to write ${f}", ("f",change_log_file()) );
+   }
+
+   _change_log_size += written;
+   _captured_changes.erase( _captured_changes.begin(), _captured_changes.begin() + records );
+} FC_CAPTURE_AND_RETHROW( (up_to) ) }
+
+void object_database::discard_changes_after( uint32_t block_num )
+{
+   while( !_captured_changes.empty() && _captured_changes.back().block_num > block_num )
+   {
+      // undo restores the objects without marking them as changed
+      _changed_objects.insert( _captured_changes.back().objects.begin(), _captured_changes.back().objects.end() );
+      _captured_changes.pop_back();
+   }
+}
+
+void object_database::compact_change_log()
+{ try {
+   const fc::path file = change_log_file();
+   if( !fc::exists( file ) )
+      return;
+   ilog( "Compacting the change log of the object database, ${s} bytes", ("s",_change_log_size) );
+
+   std::string content;
+   fc::read_file_contents( file, content );
+   // per index the latest next ID, and per instance the latest packed object or an empty one if it was removed
+   std::map< std::pair<uint8_t,uint8_t>, std::pair< object_id_type, std::map< uint64_t, vector<char> > > > merged;
+   const uint64_t valid_size = read_change_log( content, [&merged]( const detail::change_log_record& record ) {
+      for( const auto& section : record.sections )
+      {
+         auto& index_changes = merged[ std::make_pair( section.space_id, section.type_id ) ];
+         index_changes.first = section.next_id;
+         for( uint64_t instance : section.removed )
+            index_changes.second[instance].clear();
+         for( const auto& packed : section.objects )
+            index_changes.second[ packed_object_id( packed ).instance() ] = packed;
+      }
+   });
+   content.clear();
+
+   detail::change_log_record record;
+   for( auto& index_changes : merged )
+   {
+      record.sections.emplace_back();
+      detail::change_log_section& section = record.sections.back();
+      section.space_id = index_changes.first.first;
+      section.type_id = index_changes.first.second;
+      section.next_id = index_changes.second.first;
+      for( auto& change : index_changes.second.second )
+      {
+         if( change.second.empty() )
+            section.removed.push_back( change.first );
+         else
+            section.objects.push_back( std::move( change.second ) );
+      }
+   }
+   merged.clear();
+   const vector<char> data = valid_size > 0 ? pack_change_log_record( record ) : vector<char>();
+
+   // the log is replaced at once, so that a crash leaves either the old or the new one
+   const fc::path tmp_file = _data_dir / "object_database" / "changes.log.tmp";
+   std::ofstream out( tmp_file.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+   FC_ASSERT( out, "Unable to open ${f}", ("f",tmp_file) );
+   out.write( data.data(), data.size() );
+   out.close();
+   FC_ASSERT( out, "Unable to write ${f}", ("f",tmp_file) );
+   fc::rename( tmp_file, file );
+
+   _change_log_size = data.size();
+   _compacted_change_log_size = data.size();
+} FC_CAPTURE_AND_RETHROW() }
+
+void object_database::discard_change_log()
+{
+   fc::remove_all( change_log_file() );
+   _change_log_size = 0;
+   _compacted_change_log_size = 0;
 }
 
+void object_database::replay_change_log()
+{ try {
+   const fc::path file = change_log_file();
+   if( !fc::exists( file ) )
+      return;
+
+   std::string content;
+   fc::read_file_contents( file, content );
+   _change_log_size = read_change_log( content, [this]( const detail::change_log_record& record ) {
+      for( const auto& section : record.sections )
+      {
+         // the index may have been provided by a plugin which is not enabled any more
+         if( find_index( section.space_id, section.type_id ) == nullptr )
+            continue;
+         index& idx = get_mutable_index( section.space_id, section.type_id );
+         for( uint64_t instance : section.removed )
+         {
+            const object* obj = idx.find( object_id_type( section.space_id, section.type_id, instance ) );
+            if( obj != nullptr )
+               idx.unload( *obj );
+         }
+         for( const auto& packed : section.objects )
+         {
+            const object* obj = idx.find( packed_object_id( packed ) );
+            if( obj != nullptr )
+               idx.unload( *obj );
+            idx.load( packed.data(), packed.size() );
+         }
+         idx.set_next_id( section.next_id );
+      }
+      ++_change_log_records;
+   });
+
+   if( _change_log_size < content.size() )
+   {
+      wlog( "Dropping ${n} bytes of an incomplete or damaged record at the end of the change log",
+            ("n",content.size() - _change_log_size) );
+      fc::resize_file( file, _change_log_size );
+   }
+} FC_CAPTURE_AND_RETHROW() }
+
 void object_database::wipe(const fc::path& data_dir)
 {
    close();
@@ -104,23 +430,97 @@ void object_database::wipe(const fc::path& data_dir)
 void object_database::open(const fc::path& data_dir)
 { try {
    _data_dir = data_dir;
+   _load_timings.clear();
+   _change_log_size = 0;
+   _compacted_change_log_size = 0;
+   _change_log_records = 0;
+   _captured_changes.clear();
    if( fc::exists( _data_dir / "object_database" / "lock" ) )
    {
        wlog("Ignoring locked object_database");
        return;
    }
-   std::vector<fc::future<void>> tasks;
-   tasks.reserve(200);
    ilog("Opening object database from ${d} ...", ("d", data_dir));
-   for( uint32_t space = 0; space < _index.size(); ++space )
-      for( uint32_t type = 0; type  < _index[space].size(); ++type )
-         if( _index[space][type] )
-            tasks.push_back( fc::do_parallel( [this,space,type] () {
-               _index[space][type]->open( _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type) );
-            } ) );
-   for( auto& task : tasks )
-      task.wait();
-   ilog( "Done opening object database." );
+   const auto start = fc::time_point::now();
+
+   std::vector<index*> indexes;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            indexes.push_back( idx.get() );
+   _load_timings.resize( indexes.size() );
+   std::vector<uint32_t> chunk_counts( indexes.size() );
+   const uint32_t num_threads = fc::asio::default_io_service_scope::get_num_threads();
+
+   // Large indexes are divided into chunks, so that their objects can be unpacked by several threads.
+   // Inserting the objects into an index can not be divided, but different indexes are filled in parallel.
+   run_parallel( indexes.size(), [this,&indexes,&chunk_counts,num_threads] ( size_t i ) {
+      index& idx = *indexes[i];
+      index_load_timing& timing = _load_timings[i];
+      timing.space_id = idx.object_space_id();
+      timing.type_id = idx.object_type_id();
+      const fc::path file = _data_dir / "object_database" / fc::to_string( uint32_t( timing.space_id ) )
+                                      / fc::to_string( uint32_t( timing.type_id ) );
+      const uint64_t file_size = fc::exists( file ) ? fc::file_size( file ) : 0;
+      const uint32_t max_chunks = uint32_t( std::min<uint64_t>( num_threads, file_size / load_chunk_size + 1 ) );
+      const auto begin = fc::time_point::now();
+      chunk_counts[i] = idx.begin_load( file, max_chunks );
+      timing.map_time = fc::time_point::now() - begin;
+      timing.chunks = chunk_counts[i];
+   });
+
+   std::vector< std::vector<fc::microseconds> > decode_times( indexes.size() );
+   std::vector< std::pair<size_t,uint32_t> > chunks; // index and chunk
+   for( size_t i = 0; i < indexes.size(); ++i )
+   {
+      decode_times[i].resize( chunk_counts[i] );
+      for( uint32_t chunk = 0; chunk < chunk_counts[i]; ++chunk )
+         chunks.emplace_back( i, chunk );
+   }
+   run_parallel( chunks.size(), [&indexes,&decode_times,&chunks] ( size_t n ) {
+      const size_t i = chunks[n].first;
+      const uint32_t chunk = chunks[n].second;
+      const auto begin = fc::time_point::now();
+      indexes[i]->decode_chunk( chunk );
+      decode_times[i][chunk] = fc::time_point::now() - begin;
+   });
+
+   run_parallel( indexes.size(), [this,&indexes,&decode_times] ( size_t i ) {
+      index_load_timing& timing = _load_timings[i];
+      for( const auto& t : decode_times[i] )
+         timing.decode_time += t;
+      const auto begin = fc::time_point::now();
+      timing.objects = indexes[i]->end_load();
+      timing.insert_time = fc::time_point::now() - begin;
+   });
+
+   // the secondary indexes may depend on each other, they are filled one index after the other
+   for( size_t i = 0; i < indexes.size(); ++i )
+   {
+      const auto begin = fc::time_point::now();
+      indexes[i]->notify_loaded();
+      _load_timings[i].insert_time += fc::time_point::now() - begin;
+   }
+
+   uint64_t objects = 0;
+   for( const auto& timing : _load_timings )
+   {
+      objects += timing.objects;
+      if( timing.objects > 0 )
+         dlog( "Loaded ${n} objects of ${s}.${t} in ${c} chunks, mapped in ${m}ms, "
+               "unpacked in ${d}ms, inserted in ${i}ms",
+               ("n",timing.objects)("s",timing.space_id)("t",timing.type_id)("c",timing.chunks)
+               ("m",timing.map_time.count()/1000)("d",timing.decode_time.count()/1000)
+               ("i",timing.insert_time.count()/1000) );
+   }
+
+   replay_change_log();
+   if( _change_log_records > 0 )
+      ilog( "Applied ${r} records of the change log", ("r",_change_log_records) );
+   _changed_objects.clear();
+
+   ilog( "Done opening object database, loaded ${n} objects in ${t}ms.",
+         ("n",objects)("t",( fc::time_point::now() - start ).count()/1000) );
 
 } FC_CAPTURE_AND_RETHROW( (data_dir) ) }
 
@@ -132,16 +532,22 @@ void object_database::pop_undo()
 
 void object_database::save_undo( const object& obj )
 {
+   if( _track_changes )
+      _changed_objects.insert( obj.id );
    _undo_db.on_modify( obj );
 }
 
 void object_database::save_undo_add( const object& obj )
 {
+   if( _track_changes )
+      _changed_objects.insert( obj.id );
    _undo_db.on_create( obj );
 }
 
 void object_database::save_undo_remove(const object& obj)
 {
+   if( _track_changes )
+      _changed_objects.insert( obj.id );
    _undo_db.on_remove( obj );
 }
 
@@ -27,6 +27,14 @@
 
 namespace graphene { namespace db {
 
+undo_state::~undo_state()
+{
+   for( auto& item : old_values )
+      item.second->~object();
+   for( auto& item : removed )
+      item.second->~object();
+}
+
 void undo_database::enable()  { _disabled = false; }
 void undo_database::disable() { _disabled = true; }
 
@@ -53,16 +61,18 @@ undo_database::session undo_database::start_undo_session( bool force_enable )
    while( size() > max_size() )
       _stack.pop_front();
 
-   _stack.emplace_back();
+   _stack.emplace_back( &_block_pool );
    ++_active_sessions;
    return session(*this, disable_on_exit );
 }
 void undo_database::on_create( const object& obj )
 {
+   if( _observer != nullptr )
+      _observer->on_change( obj );
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_block_pool );
    auto& state = _stack.back();
    auto index_id = object_id_type( obj.id.space(), obj.id.type(), 0 );
    auto itr = state.old_index_next_ids.find( index_id );
@@ -72,37 +82,39 @@ void undo_database::on_create( const object& obj )
 }
 void undo_database::on_modify( const object& obj )
 {
+   if( _observer != nullptr )
+      _observer->on_change( obj );
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_block_pool );
    auto& state = _stack.back();
    if( state.new_ids.find(obj.id) != state.new_ids.end() )
       return;
    auto itr =  state.old_values.find(obj.id);
    if( itr != state.old_values.end() ) return;
-   state.old_values[obj.id] = obj.clone();
+   state.old_values.insert( obj.id, obj.clone_into( state.arena ) );
 }
 void undo_database::on_remove( const object& obj )
 {
+   if( _observer != nullptr )
+      _observer->on_change( obj );
    if( _disabled ) return;
 
    if( _stack.empty() )
-      _stack.emplace_back();
+      _stack.emplace_back( &_block_pool );
    undo_state& state = _stack.back();
-   if( state.new_ids.count(obj.id) > 0 )
-   {
-      state.new_ids.erase(obj.id);
+   if( state.new_ids.erase(obj.id) > 0 )
       return;
-   }
-   if( state.old_values.count(obj.id) > 0 )
+   auto itr = state.old_values.find(obj.id);
+   if( itr != state.old_values.end() )
    {
-      state.removed[obj.id] = std::move(state.old_values[obj.id]);
-      state.old_values.erase(obj.id);
+      state.removed.insert( obj.id, itr->second );
+      state.old_values.erase( itr );
       return;
    }
    if( state.removed.count(obj.id) > 0 ) return;
-   state.removed[obj.id] = obj.clone();
+   state.removed.insert( obj.id, obj.clone_into( state.arena ) );
 }
 
 void undo_database::undo()
@@ -114,7 +126,7 @@ void undo_database::undo()
    auto& state = _stack.back();
    for( auto& item : state.old_values )
    {
-      _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
+      _db.modify( _db.get_object( item.first ), [&]( object& obj ){ obj.move_from( *item.second ); } );
    }
 
    for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
@@ -190,23 +202,26 @@ void undo_database::merge()
 
    // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to iterate through B's three containers.
 
+   // Snapshots that are handed over to prev_state are moved into its arena, so that the memory of state
+   // can be released as a whole.
+
    // *+upd
    for( auto& obj : state.old_values )
    {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
+      if( prev_state.new_ids.count(obj.first) > 0 )
       {
          // new+upd -> new, type A
          continue;
       }
-      if( prev_state.old_values.find(obj.second->id) != prev_state.old_values.end() )
+      if( prev_state.old_values.count(obj.first) > 0 )
       {
          // upd(was=X) + upd(was=Y) -> upd(was=X), type A
          continue;
       }
       // del+upd -> N/A
-      assert( prev_state.removed.find(obj.second->id) == prev_state.removed.end() );
+      assert( prev_state.removed.find(obj.first) == prev_state.removed.end() );
       // nop+upd(was=Y) -> upd(was=Y), type B
-      prev_state.old_values[obj.second->id] = std::move(obj.second);
+      prev_state.old_values.insert( obj.first, obj.second->move_into( prev_state.arena ) );
    }
 
    // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
@@ -219,7 +234,7 @@ void undo_database::merge()
       if( prev_state.old_index_next_ids.find( item.first ) == prev_state.old_index_next_ids.end() )
       {
          // nop+upd(was=Y) -> upd(was=Y), type B
-         prev_state.old_index_next_ids[item.first] = item.second;
+         prev_state.old_index_next_ids.insert( item.first, item.second );
          continue;
       }
       else
@@ -233,24 +248,23 @@ void undo_database::merge()
    // *+del
    for( auto& obj : state.removed )
    {
-      if( prev_state.new_ids.find(obj.second->id) != prev_state.new_ids.end() )
+      if( prev_state.new_ids.erase(obj.first) > 0 )
       {
          // new + del -> nop (type C)
-         prev_state.new_ids.erase(obj.second->id);
          continue;
       }
-      auto it = prev_state.old_values.find(obj.second->id);
+      auto it = prev_state.old_values.find(obj.first);
       if( it != prev_state.old_values.end() )
       {
          // upd(was=X) + del(was=Y) -> del(was=X)
-         prev_state.removed[obj.second->id] = std::move(it->second);
-         prev_state.old_values.erase(obj.second->id);
+         prev_state.removed.insert( obj.first, it->second );
+         prev_state.old_values.erase( it );
          continue;
       }
       // del + del -> N/A
-      assert( prev_state.removed.find( obj.second->id ) == prev_state.removed.end() );
+      assert( prev_state.removed.find( obj.first ) == prev_state.removed.end() );
       // nop + del(was=Y) -> del(was=Y)
-      prev_state.removed[obj.second->id] = std::move(obj.second);
+      prev_state.removed.insert( obj.first, obj.second->move_into( prev_state.arena ) );
    }
    _stack.pop_back();
    --_active_sessions;
@@ -272,7 +286,7 @@ void undo_database::pop_commit()
 
       for( auto& item : state.old_values )
       {
-         _db.modify( _db.get_object( item.second->id ), [&]( object& obj ){ obj.move_from( *item.second ); } );
+         _db.modify( _db.get_object( item.first ), [&]( object& obj ){ obj.move_from( *item.second ); } );
       }
 
       for( auto ritr = state.new_ids.begin(); ritr != state.new_ids.end(); ++ritr  )
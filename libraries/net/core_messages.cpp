@@ -46,11 +46,48 @@ namespace graphene { namespace net {
   const core_message_type_enum check_firewall_reply_message::type            = core_message_type_enum::check_firewall_reply_message_type;
   const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
   const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
+  const core_message_type_enum compact_block_message::type                   = core_message_type_enum::compact_block_message_type;
+  const core_message_type_enum fetch_compact_block_transactions_message::type = core_message_type_enum::fetch_compact_block_transactions_message_type;
+  const core_message_type_enum compact_block_transactions_message::type      = core_message_type_enum::compact_block_transactions_message_type;
+
+  compact_block_message::compact_block_message(const item_hash_t& block_message_hash, const signed_block& blk) :
+    block_message_hash(block_message_hash),
+    header(blk)
+  {
+    short_transaction_ids.reserve(blk.transactions.size());
+    operation_results.reserve(blk.transactions.size());
+    for (const auto& trx : blk.transactions)
+    {
+      short_transaction_ids.push_back(get_short_transaction_id(trx.id()));
+      operation_results.push_back(trx.operation_results);
+    }
+  }
+
+  uint64_t compact_block_message::get_short_transaction_id(const transaction_id_type& id)
+  {
+    // independent of the byte order of the platform
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(id.data());
+    uint64_t result = 0;
+    for (int i = 0; i < 8; ++i)
+      result = (result << 8) | bytes[i];
+    return result;
+  }
 
 } } // graphene::net
 
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::trx_message, BOOST_PP_SEQ_NIL, (trx) )
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::block_message, BOOST_PP_SEQ_NIL, (block)(block_id) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::compact_block_message, BOOST_PP_SEQ_NIL,
+                                (block_message_hash)
+                                (header)
+                                (short_transaction_ids)
+                                (operation_results) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::fetch_compact_block_transactions_message, BOOST_PP_SEQ_NIL,
+                                (block_message_hash)
+                                (transaction_indexes) )
+FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::compact_block_transactions_message, BOOST_PP_SEQ_NIL,
+                                (block_message_hash)
+                                (transactions) )
 
 FC_REFLECT_DERIVED_NO_TYPENAME( graphene::net::item_id, BOOST_PP_SEQ_NIL,
                                (item_type)
@@ -131,6 +168,9 @@ FC_REFLECT_DERIVED_NO_TYPENAME(graphene::net::get_current_connections_reply_mess
 
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::trx_message )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::block_message )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::compact_block_message )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::fetch_compact_block_transactions_message )
+GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::compact_block_transactions_message )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::item_id )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::item_ids_inventory_message )
 GRAPHENE_IMPLEMENT_EXTERNAL_SERIALIZATION( graphene::net::blockchain_item_ids_inventory_message )
@@ -62,6 +62,20 @@
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES        (1024 * 1024)
 
+/**
+ * Messages which are waiting in a peer's send queue are written to the
+ * socket together, until a batch reaches this size.  The first message of a
+ * batch is always sent, even if it is larger.
+ */
+#define GRAPHENE_NET_MAX_SEND_BATCH_SIZE_IN_BYTES            (256 * 1024)
+
+/**
+ * A connection's send buffer grows to the largest batch it has sent.  If
+ * no batch larger than GRAPHENE_NET_MAX_SEND_BATCH_SIZE_IN_BYTES was sent
+ * for this many seconds, the buffer is shrunk back to that size.
+ */
+#define GRAPHENE_NET_SEND_BUFFER_SHRINK_DELAY_IN_SECONDS     60
+
 /**
  * When we receive a message from the network, we advertise it to
  * our peers and save a copy in a cache were we will find it if
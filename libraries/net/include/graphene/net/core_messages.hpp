@@ -85,6 +85,9 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    compact_block_message_type                   = 5018,
+    fetch_compact_block_transactions_message_type = 5019,
+    compact_block_transactions_message_type      = 5020,
     core_message_type_last                       = 5099
   };
 
@@ -114,6 +117,53 @@ namespace graphene { namespace net {
 
    };
 
+  /**
+   * A block in which every transaction is replaced by the first 8 bytes of its id. It is sent instead of a
+   * @ref block_message to peers which announced support for it in their hello message, because they usually
+   * have received most of the transactions already. The receiver rebuilds the block from the transactions it
+   * knows and fetches the missing ones with a @ref fetch_compact_block_transactions_message.
+   */
+  struct compact_block_message
+  {
+    static const core_message_type_enum type;
+
+    compact_block_message() {}
+    compact_block_message(const item_hash_t& block_message_hash, const signed_block& blk);
+
+    /// id of the @ref block_message this message stands for
+    item_hash_t                              block_message_hash;
+    graphene::protocol::signed_block_header  header;
+    std::vector<uint64_t>                    short_transaction_ids;
+    /// the results of the operations of each transaction, they are part of the block but not of the transaction
+    std::vector<std::vector<graphene::protocol::operation_result>> operation_results;
+
+    static uint64_t get_short_transaction_id(const transaction_id_type& id);
+  };
+
+  struct fetch_compact_block_transactions_message
+  {
+    static const core_message_type_enum type;
+
+    item_hash_t           block_message_hash;
+    std::vector<uint32_t> transaction_indexes;
+
+    fetch_compact_block_transactions_message() {}
+    fetch_compact_block_transactions_message(const item_hash_t& block_message_hash,
+                                             const std::vector<uint32_t>& transaction_indexes) :
+      block_message_hash(block_message_hash),
+      transaction_indexes(transaction_indexes)
+    {}
+  };
+
+  struct compact_block_transactions_message
+  {
+    static const core_message_type_enum type;
+
+    item_hash_t                                      block_message_hash;
+    /// the requested transactions, in the order of the request
+    std::vector<graphene::protocol::signed_transaction> transactions;
+  };
+
   struct item_ids_inventory_message
   {
     static const core_message_type_enum type;
@@ -422,6 +472,9 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (compact_block_message_type)
+                 (fetch_compact_block_transactions_message_type)
+                 (compact_block_transactions_message_type)
                  (core_message_type_last) )
 FC_REFLECT_ENUM(graphene::net::rejection_reason_code, (unspecified)
                                                  (different_chain)
@@ -443,6 +496,9 @@ FC_REFLECT_ENUM(graphene::net::firewall_check_result, (unable_to_check)
 
 FC_REFLECT_TYPENAME( graphene::net::trx_message )
 FC_REFLECT_TYPENAME( graphene::net::block_message )
+FC_REFLECT_TYPENAME( graphene::net::compact_block_message )
+FC_REFLECT_TYPENAME( graphene::net::fetch_compact_block_transactions_message )
+FC_REFLECT_TYPENAME( graphene::net::compact_block_transactions_message )
 FC_REFLECT_TYPENAME( graphene::net::item_id )
 FC_REFLECT_TYPENAME( graphene::net::item_ids_inventory_message )
 FC_REFLECT_TYPENAME( graphene::net::blockchain_item_ids_inventory_message )
@@ -466,6 +522,9 @@ FC_REFLECT_TYPENAME( graphene::net::get_current_connections_reply_message )
 
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::trx_message )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::block_message )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::compact_block_message )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::fetch_compact_block_transactions_message )
+GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::compact_block_transactions_message )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::item_id )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::item_ids_inventory_message )
 GRAPHENE_DECLARE_EXTERNAL_SERIALIZATION( graphene::net::blockchain_item_ids_inventory_message )
@@ -27,6 +27,7 @@
 #include <graphene/protocol/types.hpp>
 
 #include <fc/io/varint.hpp>
+#include <fc/optional.hpp>
 #include <fc/network/ip.hpp>
 #include <fc/io/raw_fwd.hpp>
 #include <fc/crypto/ripemd160.hpp>
@@ -64,10 +65,26 @@ namespace graphene { namespace net {
      message(){}
 
      message( message&& m )
-     :message_header(m),data( std::move(m.data) ){}
+     :message_header(m),data( std::move(m.data) ),_id( std::move(m._id) ){}
 
      message( const message& m )
-     :message_header(m),data( m.data ){}
+     :message_header(m),data( m.data ),_id( m._id ){}
+
+     message& operator=( message&& m )
+     {
+        message_header::operator=( m );
+        data = std::move( m.data );
+        _id = std::move( m._id );
+        return *this;
+     }
+
+     message& operator=( const message& m )
+     {
+        message_header::operator=( m );
+        data = m.data;
+        _id = m._id;
+        return *this;
+     }
 
      /**
       *  Assumes that T::type specifies the message type
@@ -78,11 +95,31 @@ namespace graphene { namespace net {
         msg_type = T::type;
         data     = fc::raw::pack(m);
         size     = (uint32_t)data.size();
+        _id      = hash_data();
+     }
+
+     /**
+      *  Wraps data that has already been packed as the given message type, e.g. a block
+      *  as it is stored on disk, without unpacking and repacking it.
+      */
+     message( uint32_t type, std::vector<char>&& packed_data )
+     :data( std::move(packed_data) )
+     {
+        msg_type = type;
+        size     = (uint32_t)data.size();
+        _id      = hash_data();
      }
 
+     /**
+      *  The id of a message built from a value or from packed data is computed when it is built, so data must
+      *  not be modified afterwards. A message which is filled in later, e.g. while it is received, hashes its
+      *  data on every call.
+      */
      message_hash_type id()const
      {
-        return fc::ripemd160::hash( data.data(), (uint32_t)data.size() );
+        if( _id.valid() )
+           return *_id;
+        return hash_data();
      }
 
      /**
@@ -114,6 +151,14 @@ namespace graphene { namespace net {
               ("msg_type", msg_type.value())
               );
      }
+
+  private:
+     message_hash_type hash_data()const
+     {
+        return fc::ripemd160::hash( data.data(), (uint32_t)data.size() );
+     }
+
+     fc::optional<message_hash_type> _id;
   };
 
 } } // graphene::net
@@ -52,11 +52,19 @@ namespace graphene { namespace net {
        void connect_to(const fc::ip::endpoint& remote_endpoint);
 
        void send_message(const message& message_to_send);
+       /** sends the messages with a single write to the socket, the peer receives them as if they were sent
+        * one by one
+        */
+       void send_messages(const std::vector<message>& messages_to_send);
        void close_connection();
        void destroy_connection();
 
        uint64_t       get_total_bytes_sent() const;
        uint64_t       get_total_bytes_received() const;
+       uint64_t       get_total_messages_sent() const;
+       uint64_t       get_total_messages_received() const;
+       /// the number of writes to the socket, each of them carries one or more messages
+       uint64_t       get_total_send_batches() const;
        fc::time_point get_last_message_sent_time() const;
        fc::time_point get_last_message_received_time() const;
        fc::time_point get_connection_time() const;
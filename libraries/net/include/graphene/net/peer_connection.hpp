@@ -37,6 +37,7 @@
 #include <boost/multi_index/tag.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 
+#include <list>
 #include <queue>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
@@ -58,6 +59,14 @@ namespace graphene { namespace net
       node_id_t        requesting_peer;
     };
 
+    /// a compact block which is waiting for transactions we had to fetch from the peer
+    struct partial_compact_block
+    {
+      compact_block_message compact_block;
+      std::vector<fc::optional<graphene::protocol::signed_transaction> > transactions;
+      std::vector<uint32_t> requested_indexes;
+    };
+
     class peer_connection;
     class peer_connection_delegate
     {
@@ -164,7 +173,7 @@ namespace graphene { namespace net
 
 
       size_t _total_queued_messages_size = 0;
-      std::queue<std::unique_ptr<queued_message>, std::list<std::unique_ptr<queued_message> > > _queued_messages;
+      std::list<std::unique_ptr<queued_message> > _queued_messages;
       fc::future<void> _send_queued_messages_done;
     public:
       fc::time_point connection_initiation_time;
@@ -204,6 +213,7 @@ namespace graphene { namespace net
       fc::optional<fc::time_point_sec> fc_git_revision_unix_timestamp;
       fc::optional<std::string> platform;
       fc::optional<uint32_t> bitness;
+      bool supports_compact_blocks = false;
 
       // for inbound connections, these fields record what the peer sent us in
       // its hello message.  For outbound, they record what we sent the peer
@@ -251,6 +261,7 @@ namespace graphene { namespace net
       timestamped_items_set_type inventory_advertised_to_peer;
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+      std::map<item_hash_t, partial_compact_block> partial_compact_blocks; /// compact blocks this peer sent us, by block message hash, waiting for missing transactions
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -289,6 +300,9 @@ namespace graphene { namespace net
 
       uint64_t get_total_bytes_sent() const;
       uint64_t get_total_bytes_received() const;
+      uint64_t get_total_messages_sent() const;
+      uint64_t get_total_messages_received() const;
+      uint64_t get_total_send_batches() const;
 
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
@@ -31,10 +31,15 @@ namespace graphene { namespace net {
 /**
  *  Uses ECDH to negotiate a aes key for communicating
  *  with other nodes on the network.
+ *
+ *  Data is encrypted and decrypted in chunks of up to @ref buffer_size bytes
+ *  through two buffers that are allocated once per socket.
  */
 class stcp_socket : public virtual fc::iostream
 {
   public:
+    static constexpr size_t buffer_size = 64 * 1024;
+
     stcp_socket();
     ~stcp_socket();
     fc::tcp_socket&  get_socket() { return _sock; }
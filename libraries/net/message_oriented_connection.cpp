@@ -58,10 +58,17 @@ namespace graphene { namespace net {
       fc::future<void> _read_loop_done;
       uint64_t _bytes_received;
       uint64_t _bytes_sent;
+      uint64_t _messages_received;
+      uint64_t _messages_sent;
+      uint64_t _send_batches;
+      /// holds the padded plaintext of the messages being sent, reused between calls
+      std::vector<char> _send_buffer;
 
       fc::time_point _connected_time;
       fc::time_point _last_message_received_time;
       fc::time_point _last_message_sent_time;
+      /// when a batch larger than GRAPHENE_NET_MAX_SEND_BATCH_SIZE_IN_BYTES was sent the last time
+      fc::time_point _last_large_batch_time;
 
       std::atomic_bool _send_message_in_progress;
       std::atomic_bool _read_loop_in_progress;
@@ -81,12 +88,15 @@ namespace graphene { namespace net {
                                        message_oriented_connection_delegate* delegate = nullptr);
       ~message_oriented_connection_impl();
 
-      void send_message(const message& message_to_send);
+      void send_messages(const message* messages_to_send, size_t count);
       void close_connection();
       void destroy_connection();
 
       uint64_t get_total_bytes_sent() const;
       uint64_t get_total_bytes_received() const;
+      uint64_t get_total_messages_sent() const { return _messages_sent; }
+      uint64_t get_total_messages_received() const { return _messages_received; }
+      uint64_t get_total_send_batches() const { return _send_batches; }
 
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
@@ -101,6 +111,9 @@ namespace graphene { namespace net {
       _ready_for_sending(fc::promise<void>::create()),
       _bytes_received(0),
       _bytes_sent(0),
+      _messages_received(0),
+      _messages_sent(0),
+      _send_batches(0),
       _send_message_in_progress(false),
       _read_loop_in_progress(false)
 #ifndef NDEBUG
@@ -195,6 +208,7 @@ namespace graphene { namespace net {
           m.data.resize(m.size.value()); // truncate off the padding bytes
 
           _last_message_received_time = fc::time_point::now();
+          ++_messages_received;
 
           try
           {
@@ -248,7 +262,7 @@ namespace graphene { namespace net {
         throw *exception_to_rethrow;
     }
 
-    void message_oriented_connection_impl::send_message(const message& message_to_send)
+    void message_oriented_connection_impl::send_messages(const message* messages_to_send, size_t count)
     {
       VERIFY_CORRECT_THREAD();
 #if 0 // this gets too verbose
@@ -258,32 +272,62 @@ namespace graphene { namespace net {
         remote_endpoint = _sock.get_socket().remote_endpoint();
       struct scope_logger {
         const fc::optional<fc::ip::endpoint>& endpoint;
-        scope_logger(const fc::optional<fc::ip::endpoint>& endpoint) : endpoint(endpoint) { dlog("entering message_oriented_connection::send_message() for peer ${endpoint}", ("endpoint", endpoint)); }
-        ~scope_logger() { dlog("leaving message_oriented_connection::send_message() for peer ${endpoint}", ("endpoint", endpoint)); }
+        scope_logger(const fc::optional<fc::ip::endpoint>& endpoint) : endpoint(endpoint) { dlog("entering message_oriented_connection::send_messages() for peer ${endpoint}", ("endpoint", endpoint)); }
+        ~scope_logger() { dlog("leaving message_oriented_connection::send_messages() for peer ${endpoint}", ("endpoint", endpoint)); }
       } send_message_scope_logger(remote_endpoint);
 #endif
 #endif
       no_parallel_execution_guard guard( &_send_message_in_progress );
       _ready_for_sending->wait();
 
+      if (count == 0)
+        return;
+
       try
       {
-        size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size.value();
-        if( message_to_send.size.value() > MAX_MESSAGE_SIZE )
-           elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
-        //pad the message we send to a multiple of 16 bytes
-        size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::vector<char> padded_message( size_with_padding );
-
-        memcpy( padded_message.data(), (const char*)&message_to_send, sizeof(message_header) );
-        memcpy( padded_message.data() + sizeof(message_header), message_to_send.data.data(),
-                message_to_send.size.value() );
-        char* padding_space = padded_message.data() + sizeof(message_header) + message_to_send.size.value();
-        memset(padding_space, 0, size_with_padding - size_of_message_and_header);
-        _sock.write( padded_message.data(), size_with_padding );
+        //pad each message we send to a multiple of 16 bytes
+        size_t total_size_with_padding = 0;
+        for (const message* message_to_send = messages_to_send; message_to_send != messages_to_send + count;
+             ++message_to_send)
+        {
+          if( message_to_send->size.value() > MAX_MESSAGE_SIZE )
+             elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
+          total_size_with_padding += 16 * ((sizeof(message_header) + message_to_send->size.value() + 15) / 16);
+        }
+
+        // the messages are written back to back, so the peer can't tell them apart from messages sent one by one,
+        // but they are encrypted and written to the socket in large chunks and flushed only once
+        if (_send_buffer.size() < total_size_with_padding)
+          _send_buffer.resize(total_size_with_padding);
+        char* position = _send_buffer.data();
+        for (const message* message_to_send = messages_to_send; message_to_send != messages_to_send + count;
+             ++message_to_send)
+        {
+          size_t size_of_message_and_header = sizeof(message_header) + message_to_send->size.value();
+          size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
+          memcpy( position, (const char*)message_to_send, sizeof(message_header) );
+          memcpy( position + sizeof(message_header), message_to_send->data.data(), message_to_send->size.value() );
+          memset( position + size_of_message_and_header, 0, size_with_padding - size_of_message_and_header );
+          position += size_with_padding;
+        }
+        _sock.write( _send_buffer.data(), total_size_with_padding );
         _sock.flush();
-        _bytes_sent += size_with_padding;
+        _bytes_sent += total_size_with_padding;
+        _messages_sent += count;
+        ++_send_batches;
         _last_message_sent_time = fc::time_point::now();
+
+        // keep the memory of large batches (e.g. full blocks) while they keep coming, but not for the lifetime
+        // of the connection
+        if (total_size_with_padding > GRAPHENE_NET_MAX_SEND_BATCH_SIZE_IN_BYTES)
+          _last_large_batch_time = _last_message_sent_time;
+        else if (_send_buffer.size() > GRAPHENE_NET_MAX_SEND_BATCH_SIZE_IN_BYTES &&
+                 _last_message_sent_time - _last_large_batch_time
+                    > fc::seconds(GRAPHENE_NET_SEND_BUFFER_SHRINK_DELAY_IN_SECONDS))
+        {
+          _send_buffer.resize(GRAPHENE_NET_MAX_SEND_BATCH_SIZE_IN_BYTES);
+          _send_buffer.shrink_to_fit();
+        }
       } FC_RETHROW_EXCEPTIONS( warn, "unable to send message" )
     }
 
@@ -386,7 +430,12 @@ namespace graphene { namespace net {
 
   void message_oriented_connection::send_message(const message& message_to_send)
   {
-    my->send_message(message_to_send);
+    my->send_messages(&message_to_send, 1);
+  }
+
+  void message_oriented_connection::send_messages(const std::vector<message>& messages_to_send)
+  {
+    my->send_messages(messages_to_send.data(), messages_to_send.size());
   }
 
   void message_oriented_connection::close_connection()
@@ -409,6 +458,21 @@ namespace graphene { namespace net {
     return my->get_total_bytes_received();
   }
 
+  uint64_t message_oriented_connection::get_total_messages_sent() const
+  {
+    return my->get_total_messages_sent();
+  }
+
+  uint64_t message_oriented_connection::get_total_messages_received() const
+  {
+    return my->get_total_messages_received();
+  }
+
+  uint64_t message_oriented_connection::get_total_send_batches() const
+  {
+    return my->get_total_send_batches();
+  }
+
   fc::time_point message_oriented_connection::get_last_message_sent_time() const
   {
     return my->get_last_message_sent_time();
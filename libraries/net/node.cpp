@@ -29,6 +29,7 @@
 #include <forward_list>
 #include <iostream>
 #include <algorithm>
+#include <numeric>
 #include <tuple>
 #include <string>
 #include <boost/tuple/tuple.hpp>
@@ -93,6 +94,18 @@
 
 namespace graphene { namespace net { namespace detail {
 
+   /// A block_message is packed as the block followed by its id, so the id can be read without unpacking the block
+   static block_id_type get_block_id_of_block_message( const message& msg )
+   {
+      FC_ASSERT( msg.msg_type.value() == block_message_type );
+      FC_ASSERT( msg.data.size() >= sizeof(block_id_type) );
+      fc::datastream<const char*> ds( msg.data.data() + msg.data.size() - sizeof(block_id_type),
+                                      sizeof(block_id_type) );
+      block_id_type block_id;
+      fc::raw::unpack( ds, block_id );
+      return block_id;
+   }
+
    void blockchain_tied_message_cache::block_accepted()
    {
       ++block_clock;
@@ -122,6 +135,27 @@ namespace graphene { namespace net { namespace detail {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
    }
 
+   fc::optional<graphene::protocol::signed_transaction> blockchain_tied_message_cache::get_transaction(
+         uint64_t short_transaction_id ) const
+   {
+      // the contents hash of a transaction message is the transaction id, start at the lowest id with the prefix
+      message_hash_type lowest_id;
+      unsigned char* bytes = reinterpret_cast<unsigned char*>( lowest_id.data() );
+      for( int i = 0; i < 8; ++i )
+         bytes[i] = static_cast<unsigned char>( short_transaction_id >> ( 8 * ( 7 - i ) ) );
+
+      const auto& index = _message_cache.get<message_contents_hash_index>();
+      for( auto iter = index.lower_bound( lowest_id );
+           iter != index.end()
+              && compact_block_message::get_short_transaction_id( iter->message_contents_hash ) == short_transaction_id;
+           ++iter )
+      {
+         if( iter->message_body.msg_type.value() == trx_message_type )
+            return graphene::protocol::signed_transaction( iter->message_body.as<trx_message>().trx );
+      }
+      return fc::optional<graphene::protocol::signed_transaction>();
+   }
+
     message_propagation_data blockchain_tied_message_cache::get_message_propagation_data(
              const message_hash_type& hash_of_msg_contents_to_lookup ) const
     {
@@ -1313,6 +1347,17 @@ namespace graphene { namespace net { namespace detail {
         break;
       case core_message_type_enum::get_current_connections_reply_message_type:
         break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+      case core_message_type_enum::fetch_compact_block_transactions_message_type:
+        on_fetch_compact_block_transactions_message(originating_peer,
+                                                    received_message.as<fetch_compact_block_transactions_message>());
+        break;
+      case core_message_type_enum::compact_block_transactions_message_type:
+        on_compact_block_transactions_message(originating_peer,
+                                              received_message.as<compact_block_transactions_message>());
+        break;
 
       default:
         // ignore any message in between core_message_type_first and _last that we don't handle above
@@ -1358,6 +1403,9 @@ namespace graphene { namespace net { namespace detail {
       if (!_hard_fork_block_numbers.empty())
         user_data["last_known_fork_block_number"] = _hard_fork_block_numbers.back();
 
+      if (_compact_blocks_enabled)
+        user_data["compact_blocks"] = 1;
+
       return user_data;
     }
     void node_impl::parse_hello_user_data_for_peer(peer_connection* originating_peer, const fc::variant_object& user_data)
@@ -1382,6 +1430,8 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->node_id = user_data["node_id"].as<node_id_t>(1);
       if (user_data.contains("last_known_fork_block_number"))
         originating_peer->last_known_fork_block_number = user_data["last_known_fork_block_number"].as<uint32_t>(1);
+      if (user_data.contains("compact_blocks"))
+        originating_peer->supports_compact_blocks = user_data["compact_blocks"].as<uint32_t>(1) >= 1;
     }
 
     void node_impl::on_hello_message( peer_connection* originating_peer, const hello_message& hello_message_received )
@@ -2292,9 +2342,18 @@ namespace graphene { namespace net { namespace detail {
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
                ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
+          {
             last_block_message_sent = requested_message;
+            // a new block, the peer has most likely seen its transactions already
+            if (_compact_blocks_enabled && originating_peer->supports_compact_blocks)
+            {
+              reply_messages.push_back(compact_block_message(item_hash,
+                                                             requested_message.as<block_message>().block));
+              continue;
+            }
+          }
+          reply_messages.push_back(requested_message);
           continue;
         }
         catch (fc::key_not_found_exception&)
@@ -2326,15 +2385,15 @@ namespace graphene { namespace net { namespace detail {
       // if we sent them a block, update our record of the last block they've seen accordingly
       if (last_block_message_sent)
       {
-        graphene::net::block_message block = last_block_message_sent->as<graphene::net::block_message>();
-        originating_peer->last_block_delegate_has_seen = block.block_id;
-        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+        const block_id_type block_id = get_block_id_of_block_message( *last_block_message_sent );
+        originating_peer->last_block_delegate_has_seen = block_id;
+        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block_id);
       }
 
       for (const message& reply : reply_messages)
       {
         if (reply.msg_type.value() == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+          originating_peer->send_item(item_id(block_message_type, get_block_id_of_block_message(reply)));
         else
           originating_peer->send_message(reply);
       }
@@ -2344,6 +2403,8 @@ namespace graphene { namespace net { namespace detail {
     {
       VERIFY_CORRECT_THREAD();
       const item_id& requested_item = item_not_available_message_received.requested_item;
+      if (requested_item.item_type == block_message_type)
+        originating_peer->partial_compact_blocks.erase(requested_item.item_hash);
       auto regular_item_iter = originating_peer->items_requested_from_peer.find(requested_item);
       if (regular_item_iter != originating_peer->items_requested_from_peer.end())
       {
@@ -3174,6 +3235,178 @@ namespace graphene { namespace net { namespace detail {
       disconnect_from_peer(originating_peer, "You sent me a block that I didn't ask for", true, detailed_error);
     }
 
+    void node_impl::on_compact_block_message(peer_connection* originating_peer,
+                                             const compact_block_message& compact_block_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t& block_message_hash = compact_block_message_received.block_message_hash;
+      if (originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_message_hash)) ==
+          originating_peer->items_requested_from_peer.end())
+      {
+        wlog("received a compact block ${hash} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+             ("endpoint", originating_peer->get_remote_endpoint())
+             ("hash", block_message_hash));
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me a compact block that I didn't ask for, hash: ${hash}",
+                                                    ("hash", block_message_hash)));
+        disconnect_from_peer(originating_peer, "You sent me a block that I didn't ask for", true, detailed_error);
+        return;
+      }
+
+      partial_compact_block partial_block;
+      partial_block.compact_block = compact_block_message_received;
+      const auto& short_ids = compact_block_message_received.short_transaction_ids;
+      if (compact_block_message_received.operation_results.size() != short_ids.size())
+      {
+        wlog("received a malformed compact block ${hash} from peer ${endpoint}, disconnecting from peer",
+             ("endpoint", originating_peer->get_remote_endpoint())
+             ("hash", block_message_hash));
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me an invalid compact block, hash: ${hash}",
+                                                    ("hash", block_message_hash)));
+        disconnect_from_peer(originating_peer, "You sent me an invalid compact block", true, detailed_error);
+        return;
+      }
+      partial_block.transactions.reserve(short_ids.size());
+      std::vector<uint32_t> missing_indexes;
+      for (uint32_t i = 0; i < short_ids.size(); ++i)
+      {
+        partial_block.transactions.push_back(_message_cache.get_transaction(short_ids[i]));
+        if (!partial_block.transactions.back())
+          missing_indexes.push_back(i);
+      }
+
+      if (missing_indexes.empty())
+      {
+        if (process_compact_block(originating_peer, partial_block))
+          return;
+        // one of the short ids matched a different transaction, fetch all of them
+        missing_indexes.resize(short_ids.size());
+        std::iota(missing_indexes.begin(), missing_indexes.end(), 0);
+      }
+      dlog("fetching ${n} of ${total} transactions of compact block ${hash} from peer ${endpoint}",
+           ("n", missing_indexes.size())("total", short_ids.size())("hash", block_message_hash)
+           ("endpoint", originating_peer->get_remote_endpoint()));
+      fetch_compact_block_transactions(originating_peer, std::move(partial_block), std::move(missing_indexes));
+    }
+
+    void node_impl::fetch_compact_block_transactions(peer_connection* originating_peer,
+                                                     partial_compact_block&& partial_block,
+                                                     std::vector<uint32_t>&& transaction_indexes)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t block_message_hash = partial_block.compact_block.block_message_hash;
+      originating_peer->send_message(fetch_compact_block_transactions_message(block_message_hash, transaction_indexes));
+      partial_block.requested_indexes = std::move(transaction_indexes);
+      originating_peer->partial_compact_blocks[block_message_hash] = std::move(partial_block);
+    }
+
+    void node_impl::on_fetch_compact_block_transactions_message(peer_connection* originating_peer,
+          const fetch_compact_block_transactions_message& fetch_compact_block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      const item_hash_t& block_message_hash = fetch_compact_block_transactions_message_received.block_message_hash;
+      const auto& transaction_indexes = fetch_compact_block_transactions_message_received.transaction_indexes;
+      block_message requested_block;
+      try
+      {
+        requested_block = _message_cache.get_message(block_message_hash).as<block_message>();
+      }
+      catch (const fc::exception&)
+      {
+        dlog("peer ${endpoint} asked for transactions of block ${hash} which I can't provide",
+             ("endpoint", originating_peer->get_remote_endpoint())("hash", block_message_hash));
+        originating_peer->send_message(item_not_available_message(item_id(block_message_type, block_message_hash)));
+        return;
+      }
+
+      // We only ask for increasing indexes within the block, so every transaction is sent at most once.
+      // Anything else would let a peer make the reply as large as it wants.
+      const size_t transaction_count = requested_block.block.transactions.size();
+      bool valid = transaction_indexes.size() <= transaction_count;
+      for (size_t i = 0; valid && i < transaction_indexes.size(); ++i)
+        valid = transaction_indexes[i] < transaction_count && (i == 0 || transaction_indexes[i] > transaction_indexes[i - 1]);
+      if (!valid)
+      {
+        wlog("peer ${endpoint} asked for invalid transaction indexes of block ${hash}, disconnecting from peer",
+             ("endpoint", originating_peer->get_remote_endpoint())("hash", block_message_hash));
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You asked for invalid transaction indexes of block ${hash}",
+                                                    ("hash", block_message_hash)));
+        disconnect_from_peer(originating_peer, "You asked for invalid transaction indexes", true, detailed_error);
+        return;
+      }
+
+      compact_block_transactions_message reply;
+      reply.block_message_hash = block_message_hash;
+      reply.transactions.reserve(transaction_indexes.size());
+      for (uint32_t index : transaction_indexes)
+        reply.transactions.push_back(requested_block.block.transactions[index]);
+      originating_peer->send_message(reply);
+    }
+
+    void node_impl::on_compact_block_transactions_message(peer_connection* originating_peer,
+          const compact_block_transactions_message& compact_block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      auto partial_iter = originating_peer->partial_compact_blocks.find(
+                                compact_block_transactions_message_received.block_message_hash);
+      if (partial_iter == originating_peer->partial_compact_blocks.end())
+      {
+        // the request has timed out or the block arrived in the meantime
+        dlog("received transactions of compact block ${hash} I'm not waiting for from peer ${endpoint}",
+             ("endpoint", originating_peer->get_remote_endpoint())
+             ("hash", compact_block_transactions_message_received.block_message_hash));
+        return;
+      }
+      partial_compact_block partial_block = std::move(partial_iter->second);
+      originating_peer->partial_compact_blocks.erase(partial_iter);
+
+      const auto& transactions = compact_block_transactions_message_received.transactions;
+      bool valid = transactions.size() == partial_block.requested_indexes.size();
+      for (size_t i = 0; valid && i < transactions.size(); ++i)
+        partial_block.transactions[partial_block.requested_indexes[i]] = transactions[i];
+      if (valid && process_compact_block(originating_peer, partial_block))
+        return;
+
+      if (valid && partial_block.requested_indexes.size() < partial_block.transactions.size())
+      {
+        // one of the transactions from our cache was not the one in the block, fetch all of them
+        std::vector<uint32_t> all_indexes(partial_block.transactions.size());
+        std::iota(all_indexes.begin(), all_indexes.end(), 0);
+        fetch_compact_block_transactions(originating_peer, std::move(partial_block), std::move(all_indexes));
+        return;
+      }
+
+      wlog("peer ${endpoint} sent me transactions which don't match its compact block ${hash}, disconnecting from peer",
+           ("endpoint", originating_peer->get_remote_endpoint())
+           ("hash", partial_block.compact_block.block_message_hash));
+      fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me an invalid compact block, hash: ${hash}",
+                                                  ("hash", partial_block.compact_block.block_message_hash)));
+      disconnect_from_peer(originating_peer, "You sent me an invalid compact block", true, detailed_error);
+    }
+
+    bool node_impl::process_compact_block(peer_connection* originating_peer, const partial_compact_block& partial_block)
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::time_point start_time = fc::time_point::now();
+      signed_block block;
+      static_cast<graphene::protocol::signed_block_header&>(block) = partial_block.compact_block.header;
+      block.transactions.reserve(partial_block.transactions.size());
+      for (size_t i = 0; i < partial_block.transactions.size(); ++i)
+      {
+        block.transactions.emplace_back(*partial_block.transactions[i]);
+        block.transactions.back().operation_results = partial_block.compact_block.operation_results[i];
+      }
+      message rebuilt_message = block_message(block);
+      const message_hash_type rebuilt_message_hash = rebuilt_message.id();
+      if (rebuilt_message_hash != partial_block.compact_block.block_message_hash)
+        return false;
+
+      dlog("rebuilt compact block ${hash} with ${n} transactions in ${t} us",
+           ("hash", rebuilt_message_hash)("n", block.transactions.size())
+           ("t", (fc::time_point::now() - start_time).count()));
+      process_block_message(originating_peer, rebuilt_message, rebuilt_message_hash);
+      return true;
+    }
+
     void node_impl::on_current_time_request_message(peer_connection* originating_peer,
                                                     const current_time_request_message& current_time_request_message_received)
     {
@@ -3428,6 +3661,8 @@ namespace graphene { namespace net { namespace detail {
           {
           // log common exceptions in debug level
           case graphene::chain::duplicate_transaction::code_enum::code_value :
+          case graphene::chain::pending_transaction_limit_exceeded::code_enum::code_value :
+          case graphene::chain::transaction_pool_full::code_enum::code_value :
           case graphene::chain::limit_order_create_kill_unfilled::code_enum::code_value :
           case graphene::chain::limit_order_create_market_not_whitelisted::code_enum::code_value :
           case graphene::chain::limit_order_create_market_blacklisted::code_enum::code_value :
@@ -4499,6 +4734,9 @@ namespace graphene { namespace net { namespace detail {
         peer_details["lastrecv"] = peer->get_last_message_received_time().sec_since_epoch();
         peer_details["bytessent"] = peer->get_total_bytes_sent();
         peer_details["bytesrecv"] = peer->get_total_bytes_received();
+        peer_details["messagessent"] = peer->get_total_messages_sent();
+        peer_details["messagesrecv"] = peer->get_total_messages_received();
+        peer_details["sendbatches"] = peer->get_total_send_batches();
         peer_details["conntime"] = peer->get_connection_time();
         peer_details["pingtime"] = "";
         peer_details["pingwait"] = "";
@@ -4545,6 +4783,7 @@ namespace graphene { namespace net { namespace detail {
 
         peer_details["peer_needs_sync_items_from_us"] = peer->peer_needs_sync_items_from_us;
         peer_details["we_need_sync_items_from_peer"] = peer->we_need_sync_items_from_peer;
+        peer_details["supports_compact_blocks"] = peer->supports_compact_blocks;
 
         this_peer_status.info = peer_details;
         statuses.push_back(this_peer_status);
@@ -4629,6 +4868,8 @@ namespace graphene { namespace net { namespace detail {
         _max_sync_blocks_to_prefetch = params["max_sync_blocks_to_prefetch"].as<uint32_t>(1);
       if (params.contains("max_sync_blocks_per_peer"))
         _max_sync_blocks_per_peer = params["max_sync_blocks_per_peer"].as<uint32_t>(1);
+      if (params.contains("compact_blocks"))
+        _compact_blocks_enabled = params["compact_blocks"].as<bool>(1);
 
       _desired_number_of_connections = std::min(_desired_number_of_connections, _maximum_number_of_connections);
 
@@ -4648,6 +4889,7 @@ namespace graphene { namespace net { namespace detail {
       result["max_blocks_to_handle_at_once"] = _max_blocks_to_handle_at_once;
       result["max_sync_blocks_to_prefetch"] = _max_sync_blocks_to_prefetch;
       result["max_sync_blocks_per_peer"] = _max_sync_blocks_per_peer;
+      result["compact_blocks"] = _compact_blocks_enabled;
       return result;
     }
 
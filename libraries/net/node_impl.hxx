@@ -201,6 +201,8 @@ public:
                        const message_propagation_data& propagation_data,
                        const message_hash_type& message_content_hash );
    message get_message( const message_hash_type& hash_of_message_to_lookup ) const;
+   /// @return a cached transaction whose id starts with the bytes of @p short_transaction_id
+   fc::optional<graphene::protocol::signed_transaction> get_transaction( uint64_t short_transaction_id ) const;
    message_propagation_data get_message_propagation_data(
          const message_hash_type& hash_of_msg_contents_to_lookup ) const;
    size_t size() const { return _message_cache.size(); }
@@ -587,6 +589,8 @@ class node_impl : public peer_connection_delegate, public std::enable_shared_fro
       size_t _max_sync_blocks_to_prefetch = MAX_SYNC_BLOCKS_TO_PREFETCH;
       /// Maximum number of blocks per peer during syncing
       size_t _max_sync_blocks_per_peer = GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING;
+      /// Whether to exchange blocks with compact_block_message with peers which support it
+      bool _compact_blocks_enabled = true;
 
       std::list<fc::future<void> > _handle_message_calls_in_progress;
 
@@ -672,6 +676,22 @@ class node_impl : public peer_connection_delegate, public std::enable_shared_fro
       void on_item_ids_inventory_message( peer_connection* originating_peer,
                                           const item_ids_inventory_message& item_ids_inventory_message_received );
 
+      void on_compact_block_message( peer_connection* originating_peer,
+                                     const compact_block_message& compact_block_message_received );
+
+      void on_fetch_compact_block_transactions_message( peer_connection* originating_peer,
+            const fetch_compact_block_transactions_message& fetch_compact_block_transactions_message_received );
+
+      void on_compact_block_transactions_message( peer_connection* originating_peer,
+            const compact_block_transactions_message& compact_block_transactions_message_received );
+
+      /// Requests the given transactions of a compact block from the peer which sent it
+      void fetch_compact_block_transactions( peer_connection* originating_peer, partial_compact_block&& partial_block,
+                                             std::vector<uint32_t>&& transaction_indexes );
+      /// Rebuilds the block of a compact block and processes it like a received block_message
+      /// @return false if the rebuilt block does not match the block message the compact block stands for
+      bool process_compact_block( peer_connection* originating_peer, const partial_compact_block& partial_block );
+
       void on_closing_connection_message( peer_connection* originating_peer,
                                           const closing_connection_message& closing_connection_message_received );
 
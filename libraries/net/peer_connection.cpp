@@ -298,22 +298,32 @@ namespace graphene { namespace net
         ~counter() { assert(_send_message_queue_tasks_counter == 1); --_send_message_queue_tasks_counter; /* dlog("leaving peer_connection::send_queued_messages_task()"); */ }
       } concurrent_invocation_counter(_send_message_queue_tasks_running);
 #endif
+      std::vector<message> messages_to_send;
       while (!_queued_messages.empty())
       {
-        _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        // everything that has piled up while the previous batch was being written goes out with one write
+        messages_to_send.clear();
+        size_t batch_size = 0;
+        for (auto iter = _queued_messages.begin();
+             iter != _queued_messages.end() && batch_size < GRAPHENE_NET_MAX_SEND_BATCH_SIZE_IN_BYTES;
+             ++iter)
+        {
+          (*iter)->transmission_start_time = fc::time_point::now();
+          messages_to_send.push_back((*iter)->get_message(_node));
+          batch_size += messages_to_send.back().size.value();
+        }
         try
         {
-          //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
-          //     "to send message of type ${type} for peer ${endpoint}",
-          //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-          _message_connection.send_message(message_to_send);
-          //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
+          //dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_messages() "
+          //     "to send ${count} messages for peer ${endpoint}",
+          //     ("count", messages_to_send.size())("endpoint", get_remote_endpoint()));
+          _message_connection.send_messages(messages_to_send);
+          //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_messages() completed normally for peer ${endpoint}",
           //     ("endpoint", get_remote_endpoint()));
         }
         catch (const fc::canceled_exception&)
         {
-          dlog("message_oriented_connection::send_message() was canceled, rethrowing canceled_exception");
+          dlog("message_oriented_connection::send_messages() was canceled, rethrowing canceled_exception");
           throw;
         }
         catch (const fc::exception& send_error)
@@ -331,15 +341,19 @@ namespace graphene { namespace net
         }
         catch (const std::exception& e)
         {
-          wlog("message_oriented_exception::send_message() threw a std::exception(): ${what}", ("what", e.what()));
+          wlog("message_oriented_exception::send_messages() threw a std::exception(): ${what}", ("what", e.what()));
         }
         catch (...)
         {
-          wlog("message_oriented_exception::send_message() threw an unhandled exception");
+          wlog("message_oriented_exception::send_messages() threw an unhandled exception");
+        }
+        const fc::time_point transmission_finish_time = fc::time_point::now();
+        for (size_t i = 0; i < messages_to_send.size(); ++i)
+        {
+          _queued_messages.front()->transmission_finish_time = transmission_finish_time;
+          _total_queued_messages_size -= _queued_messages.front()->get_size_in_queue();
+          _queued_messages.pop_front();
         }
-        _queued_messages.front()->transmission_finish_time = fc::time_point::now();
-        _total_queued_messages_size -= _queued_messages.front()->get_size_in_queue();
-        _queued_messages.pop();
       }
       //dlog("leaving peer_connection::send_queued_messages_task() due to queue exhaustion");
     }
@@ -348,7 +362,7 @@ namespace graphene { namespace net
     {
       VERIFY_CORRECT_THREAD();
       _total_queued_messages_size += message_to_send->get_size_in_queue();
-      _queued_messages.emplace(std::move(message_to_send));
+      _queued_messages.emplace_back(std::move(message_to_send));
       if (_total_queued_messages_size > GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES)
       {
         wlog("send queue exceeded maximum size of ${max} bytes (current size ${current} bytes)",
@@ -423,6 +437,24 @@ namespace graphene { namespace net
       return _message_connection.get_total_bytes_received();
     }
 
+    uint64_t peer_connection::get_total_messages_sent() const
+    {
+      VERIFY_CORRECT_THREAD();
+      return _message_connection.get_total_messages_sent();
+    }
+
+    uint64_t peer_connection::get_total_messages_received() const
+    {
+      VERIFY_CORRECT_THREAD();
+      return _message_connection.get_total_messages_received();
+    }
+
+    uint64_t peer_connection::get_total_send_batches() const
+    {
+      VERIFY_CORRECT_THREAD();
+      return _message_connection.get_total_send_batches();
+    }
+
     fc::time_point peer_connection::get_last_message_sent_time() const
     {
       VERIFY_CORRECT_THREAD();
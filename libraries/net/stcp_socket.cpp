@@ -36,10 +36,13 @@
 
 namespace graphene { namespace net {
 
+constexpr size_t stcp_socket::buffer_size;
+
 stcp_socket::stcp_socket()
-//:_buf_len(0)
+   : _read_buffer(new char[buffer_size], [](char* p){ delete[] p; }),
+     _write_buffer(new char[buffer_size], [](char* p){ delete[] p; })
 #ifndef NDEBUG
-   : _read_buffer_in_use(false),
+   , _read_buffer_in_use(false),
      _write_buffer_in_use(false)
 #endif
 {
@@ -100,11 +103,7 @@ size_t stcp_socket::readsome( char* buffer, size_t len )
     } buffer_in_use_checker(_read_buffer_in_use);
 #endif
 
-    const size_t read_buffer_length = 4096;
-    if (!_read_buffer)
-      _read_buffer.reset(new char[read_buffer_length], [](char* p){ delete[] p; });
-
-    len = std::min<size_t>(read_buffer_length, len);
+    len = std::min<size_t>(buffer_size, len);
 
     size_t s = _sock.readsome( _read_buffer, len, 0 );
     if( s % 16 ) 
@@ -141,17 +140,8 @@ size_t stcp_socket::writesome( const char* buffer, size_t len )
     } buffer_in_use_checker(_write_buffer_in_use);
 #endif
 
-    const std::size_t write_buffer_length = 4096;
-    if (!_write_buffer)
-      _write_buffer.reset(new char[write_buffer_length], [](char* p){ delete[] p; });
-    len = std::min<size_t>(write_buffer_length, len);
-    memset(_write_buffer.get(), 0, len); // just in case aes.encode screws up
-    /**
-     * every sizeof(crypt_buf) bytes the aes channel
-     * has an error and doesn't decrypt properly...  disable
-     * for now because we are going to upgrade to something
-     * better.
-     */
+    len = std::min<size_t>(buffer_size, len);
+    // the write buffer is owned by a shared_ptr so it outlives a write that is canceled half way
     uint32_t ciphertext_len = _send_aes.encode( buffer, len, _write_buffer.get() );
     assert(ciphertext_len == len);
     _sock.write( _write_buffer, ciphertext_len );
@@ -64,11 +64,17 @@ class elasticsearch_plugin_impl
       uint32_t _elasticsearch_start_es_after_block = 0;
       bool _elasticsearch_operation_string = false;
       mode _elasticsearch_mode = mode::only_save;
+      uint32_t _elasticsearch_max_queued_bulks = 32;
+      uint32_t _elasticsearch_parallel_requests = 2;
+      std::string _elasticsearch_spill_dir = "";
+      uint32_t _elasticsearch_max_retry_delay = 30;
+      uint32_t _elasticsearch_max_retries = 20;
       CURL *curl; // curl handler
       vector <string> bulk_lines; //  vector of op lines
+      uint32_t bulk_first_block = 0; // first block of the lines in bulk_lines
       vector<std::string> prepare;
 
-      graphene::utilities::ES es;
+      std::unique_ptr<graphene::utilities::es_bulk_exporter> exporter;
       uint32_t limit_documents;
       int16_t op_type;
       operation_history_struct os;
@@ -93,7 +99,6 @@ class elasticsearch_plugin_impl
       void cleanObjects(const account_transaction_history_id_type& ath, const account_id_type& account_id);
       void createBulkLine(const account_transaction_history_object& ath);
       void prepareBulk(const account_transaction_history_id_type& ath_id);
-      void populateESstruct();
 };
 
 elasticsearch_plugin_impl::~elasticsearch_plugin_impl()
@@ -107,6 +112,8 @@ elasticsearch_plugin_impl::~elasticsearch_plugin_impl()
 bool elasticsearch_plugin_impl::update_account_histories( const signed_block& b )
 {
    checkState(b.timestamp);
+   if(bulk_first_block == 0)
+      bulk_first_block = b.block_num();
    index_name = graphene::utilities::generateIndexName(b.timestamp, _elasticsearch_index_prefix);
 
    graphene::chain::database& db = database();
@@ -190,27 +197,14 @@ bool elasticsearch_plugin_impl::update_account_histories( const signed_block& b
          }
       }
    }
-   // we send bulk at end of block when we are in sync for better real time client experience
-   if(is_sync)
+   // we send bulk at end of block when we are in sync for better real time client experience,
+   // batches only end at block boundaries so that the exporter can keep reindexed blocks in order
+   if(is_sync || bulk_lines.size() >= limit_documents)
    {
-      populateESstruct();
-      if(es.bulk_lines.size() > 0)
-      {
-         prepare.clear();
-         if(!graphene::utilities::SendBulk(std::move(es)))
-         {
-            // Note: although called with `std::move()`, `es` is not updated in `SendBulk()`
-            elog( "Error sending ${n} lines of bulk data to Elastic Search, the first lines are:",
-                  ("n",es.bulk_lines.size()) );
-            for( size_t i = 0; i < es.bulk_lines.size() && i < 10; ++i )
-            {
-               edump( (es.bulk_lines[i]) );
-            }
-            return false;
-         }
-         else
-            bulk_lines.clear();
-      }
+      prepare.clear();
+      exporter->send(bulk_first_block, b.block_num(), std::move(bulk_lines));
+      bulk_lines.clear();
+      bulk_first_block = 0;
    }
 
    if(bulk_lines.size() != limit_documents)
@@ -319,24 +313,6 @@ bool elasticsearch_plugin_impl::add_elasticsearch( const account_id_type account
    }
    cleanObjects(ath.id, account_id);
 
-   if (curl && bulk_lines.size() >= limit_documents) { // we are in bulk time, ready to add data to elasticsearech
-      prepare.clear();
-      populateESstruct();
-      if(!graphene::utilities::SendBulk(std::move(es)))
-      {
-         // Note: although called with `std::move()`, `es` is not updated in `SendBulk()`
-         elog( "Error sending ${n} lines of bulk data to Elastic Search, the first lines are:",
-               ("n",es.bulk_lines.size()) );
-         for( size_t i = 0; i < es.bulk_lines.size() && i < 10; ++i )
-         {
-            edump( (es.bulk_lines[i]) );
-         }
-         return false;
-      }
-      else
-         bulk_lines.clear();
-   }
-
    return true;
 }
 
@@ -427,17 +403,6 @@ void elasticsearch_plugin_impl::cleanObjects(const account_transaction_history_i
    }
 }
 
-void elasticsearch_plugin_impl::populateESstruct()
-{
-   es.curl = curl;
-   es.bulk_lines = std::move(bulk_lines);
-   es.elasticsearch_url = _elasticsearch_node_url;
-   es.auth = _elasticsearch_basic_auth;
-   es.index_prefix = _elasticsearch_index_prefix;
-   es.endpoint = "";
-   es.query = "";
-}
-
 } // end namespace detail
 
 elasticsearch_plugin::elasticsearch_plugin(graphene::app::application& app) :
@@ -484,6 +449,19 @@ void elasticsearch_plugin::plugin_set_program_options(
                "Save operation as string. Needed to serve history api calls(false)")
          ("elasticsearch-mode", boost::program_options::value<uint16_t>(),
                "Mode of operation: only_save(0), only_query(1), all(2) - Default: 0")
+         ("elasticsearch-max-queued-bulks", boost::program_options::value<uint32_t>(),
+               "Number of bulk requests kept in memory while waiting to be sent(32)")
+         ("elasticsearch-parallel-requests", boost::program_options::value<uint32_t>(),
+               "Number of bulk requests sent in parallel(2)")
+         ("elasticsearch-spill-dir", boost::program_options::value<std::string>(),
+               "Directory for bulk requests which don't fit into the queue, which can not be sent or which are "
+               "left at shutdown, if not set block processing waits for the queue instead and failed bulk requests "
+               "are retried until they are sent('')")
+         ("elasticsearch-max-retry-delay", boost::program_options::value<uint32_t>(),
+               "Maximum delay in seconds between retries of a failed bulk request(30)")
+         ("elasticsearch-max-retries", boost::program_options::value<uint32_t>(),
+               "Number of retries of a bulk request which failed for a transient reason, before it is moved to "
+               "the failed subdirectory of the spill directory, requires elasticsearch-spill-dir(20)")
          ;
    cfg.add(cli);
 }
@@ -526,11 +504,43 @@ void elasticsearch_plugin::plugin_initialize(const boost::program_options::varia
          FC_THROW_EXCEPTION(graphene::chain::plugin_exception, "Elasticsearch mode not valid");
       my->_elasticsearch_mode = static_cast<mode>(options["elasticsearch-mode"].as<uint16_t>());
    }
+   if (options.count("elasticsearch-max-queued-bulks") > 0) {
+      my->_elasticsearch_max_queued_bulks = options["elasticsearch-max-queued-bulks"].as<uint32_t>();
+   }
+   if (options.count("elasticsearch-parallel-requests") > 0) {
+      my->_elasticsearch_parallel_requests = options["elasticsearch-parallel-requests"].as<uint32_t>();
+   }
+   if (options.count("elasticsearch-spill-dir") > 0) {
+      my->_elasticsearch_spill_dir = options["elasticsearch-spill-dir"].as<std::string>();
+   }
+   if (options.count("elasticsearch-max-retry-delay") > 0) {
+      my->_elasticsearch_max_retry_delay = options["elasticsearch-max-retry-delay"].as<uint32_t>();
+   }
+   if (options.count("elasticsearch-max-retries") > 0) {
+      // without a spill directory failed bulk requests would have to be dropped after the last retry
+      if (my->_elasticsearch_spill_dir.empty())
+         FC_THROW_EXCEPTION(graphene::chain::plugin_exception,
+               "elasticsearch-max-retries requires elasticsearch-spill-dir");
+      my->_elasticsearch_max_retries = options["elasticsearch-max-retries"].as<uint32_t>();
+   }
 
    if(my->_elasticsearch_mode != mode::only_query) {
       if (my->_elasticsearch_mode == mode::all && !my->_elasticsearch_operation_string)
          FC_THROW_EXCEPTION(graphene::chain::plugin_exception,
                "If elasticsearch-mode is set to all then elasticsearch-operation-string need to be true");
+      if (my->_elasticsearch_max_queued_bulks == 0 || my->_elasticsearch_parallel_requests == 0)
+         FC_THROW_EXCEPTION(graphene::chain::plugin_exception,
+               "elasticsearch-max-queued-bulks and elasticsearch-parallel-requests need to be greater than 0");
+
+      graphene::utilities::es_bulk_exporter::options exporter_options;
+      exporter_options.elasticsearch_url = my->_elasticsearch_node_url;
+      exporter_options.auth = my->_elasticsearch_basic_auth;
+      exporter_options.max_queued_batches = my->_elasticsearch_max_queued_bulks;
+      exporter_options.max_in_flight = my->_elasticsearch_parallel_requests;
+      exporter_options.spill_directory = my->_elasticsearch_spill_dir;
+      exporter_options.max_retry_delay = fc::seconds(my->_elasticsearch_max_retry_delay);
+      exporter_options.max_retries = my->_elasticsearch_max_retries;
+      my->exporter = std::make_unique<graphene::utilities::es_bulk_exporter>(exporter_options);
 
       database().applied_block.connect([this](const signed_block &b) {
          if (!my->update_account_histories(b))
@@ -552,6 +562,12 @@ void elasticsearch_plugin::plugin_startup()
    ilog("elasticsearch ACCOUNT HISTORY: plugin_startup() begin");
 }
 
+void elasticsearch_plugin::plugin_shutdown()
+{
+   if(my->exporter)
+      my->exporter->close();
+}
+
 operation_history_object elasticsearch_plugin::get_operation_by_id(operation_history_id_type id)
 {
    const string operation_id_string = std::string(object_id_type(id));
@@ -677,5 +693,12 @@ mode elasticsearch_plugin::get_running_mode()
    return my->_elasticsearch_mode;
 }
 
+graphene::utilities::es_bulk_exporter::metrics elasticsearch_plugin::get_export_metrics()
+{
+   if(my->exporter)
+      return my->exporter->get_metrics();
+   return graphene::utilities::es_bulk_exporter::metrics();
+}
+
 
 } }
@@ -27,6 +27,7 @@
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/operation_history_object.hpp>
 #include <graphene/utilities/elasticsearch.hpp>
+#include <graphene/utilities/es_bulk_exporter.hpp>
 
 namespace graphene { namespace elasticsearch {
    using namespace chain;
@@ -65,11 +66,14 @@ class elasticsearch_plugin : public graphene::app::plugin
          boost::program_options::options_description& cfg) override;
       void plugin_initialize(const boost::program_options::variables_map& options) override;
       void plugin_startup() override;
+      void plugin_shutdown() override;
 
       operation_history_object get_operation_by_id(operation_history_id_type id);
       vector<operation_history_object> get_account_history(const account_id_type account_id,
             operation_history_id_type stop, unsigned limit, operation_history_id_type start);
       mode get_running_mode();
+      /// Queue depth and lag of the export to Elasticsearch
+      graphene::utilities::es_bulk_exporter::metrics get_export_metrics();
 
       friend class detail::elasticsearch_plugin_impl;
       std::unique_ptr<detail::elasticsearch_plugin_impl> my;
@@ -0,0 +1,252 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <graphene/snapshot/binary_snapshot.hpp>
+
+#include <graphene/db/parallel.hpp>
+
+#include <fc/interprocess/file_mapping.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/endian/buffers.hpp>
+
+#include <cstring>
+#include <fstream>
+
+namespace graphene { namespace snapshot_plugin {
+
+using graphene::chain::block_log_checksum;
+using graphene::chain::compress_block_log_data;
+using graphene::chain::decompress_block_log_data;
+using graphene::chain::is_block_log_compression_supported;
+
+namespace detail {
+
+static const char snapshot_magic[8] = { 'R', 'P', 'S', 'N', 'A', 'P', '0', '1' };
+
+struct snapshot_file_header
+{
+   char                               magic[8];
+   boost::endian::little_uint32_buf_t compression;
+   boost::endian::little_uint32_buf_t section_count;
+   char                               chain_id[32];
+   boost::endian::little_uint32_buf_t head_block_num;
+   char                               head_block_id[20];
+   boost::endian::little_uint32_buf_t head_block_time;
+};
+
+struct snapshot_section_header
+{
+   boost::endian::little_uint8_buf_t  space_id;
+   boost::endian::little_uint8_buf_t  type_id;
+   boost::endian::little_uint64_buf_t next_instance;  ///< of the next object id of the index
+   boost::endian::little_uint64_buf_t object_count;
+   boost::endian::little_uint64_buf_t raw_size;
+   boost::endian::little_uint64_buf_t stored_size;
+   boost::endian::little_uint32_buf_t checksum;       ///< crc32 of the stored (compressed) data
+};
+
+static_assert( sizeof( snapshot_file_header::chain_id ) == sizeof( chain_id_type ), "chain id size" );
+static_assert( sizeof( snapshot_file_header::head_block_id ) == sizeof( block_id_type ), "block id size" );
+
+static void pack_index( const graphene::db::index& idx, snapshot_section& section )
+{
+   section.space_id = idx.object_space_id();
+   section.type_id = idx.object_type_id();
+   section.next_id = idx.get_next_id();
+   // the same layout as the files of the object database, so it can be loaded the same way
+   idx.inspect_all_objects( [&section]( const graphene::db::object& o ) {
+      const vector<char> packed = o.pack();
+      const vector<char> size = fc::raw::pack( fc::unsigned_int( packed.size() ) );
+      section.data.insert( section.data.end(), size.begin(), size.end() );
+      section.data.insert( section.data.end(), packed.begin(), packed.end() );
+      ++section.object_count;
+   });
+}
+
+static void load_section( graphene::chain::database& db, block_log_compression compression,
+                          const snapshot_section& section, const snapshot_section_header& header,
+                          const char* stored )
+{ try {
+   const size_t stored_size = header.stored_size.value();
+   FC_ASSERT( block_log_checksum( stored, stored_size ) == header.checksum.value(), "Checksum mismatch" );
+
+   uint64_t loaded;
+   if( compression == block_log_compression::none )
+   {
+      FC_ASSERT( stored_size == header.raw_size.value(), "Size mismatch" );
+      loaded = db.load_objects( section.space_id, section.type_id, section.next_id, stored, stored_size );
+   }
+   else
+   {
+      vector<char> raw( header.raw_size.value() );
+      decompress_block_log_data( compression, stored, stored_size, raw );
+      loaded = db.load_objects( section.space_id, section.type_id, section.next_id, raw.data(), raw.size() );
+   }
+   FC_ASSERT( loaded == section.object_count, "Expected ${e} objects, found ${n}",
+              ("e",section.object_count)("n",loaded) );
+} FC_CAPTURE_AND_RETHROW( (section.space_id)(section.type_id) ) }
+
+} // detail
+
+binary_snapshot capture_snapshot( const graphene::chain::database& db )
+{
+   binary_snapshot result;
+   result.chain_id = db.get_chain_id();
+   result.head_block_num = db.head_block_num();
+   result.head_block_id = db.head_block_id();
+   result.head_block_time = db.head_block_time();
+
+   vector<const graphene::db::index*> indexes;
+   db.inspect_all_indexes( [&indexes]( const graphene::db::index& idx ) { indexes.push_back( &idx ); } );
+   result.sections.resize( indexes.size() );
+
+   graphene::db::run_parallel( indexes.size(), [&indexes,&result] ( size_t i ) {
+      detail::pack_index( *indexes[i], result.sections[i] );
+   });
+   return result;
+}
+
+void write_snapshot( const binary_snapshot& snapshot, const fc::path& dest, block_log_compression compression )
+{ try {
+   FC_ASSERT( is_block_log_compression_supported( compression ),
+              "Compression ${c} is not supported by this build", ("c",compression) );
+
+   const size_t count = snapshot.sections.size();
+   vector<vector<char>> compressed( count );
+   vector<uint32_t> checksums( count );
+   graphene::db::run_parallel( count, [&snapshot,&compressed,&checksums,compression] ( size_t i ) {
+      const vector<char>& raw = snapshot.sections[i].data;
+      if( compression != block_log_compression::none )
+         compressed[i] = compress_block_log_data( compression, raw );
+      const vector<char>& stored = compression == block_log_compression::none ? raw : compressed[i];
+      checksums[i] = block_log_checksum( stored.data(), stored.size() );
+   });
+
+   const fc::path tmp = dest.generic_string() + ".tmp";
+   std::ofstream out( tmp.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+   FC_ASSERT( out, "Failed to open ${f}", ("f",tmp) );
+
+   detail::snapshot_file_header header;
+   std::memcpy( header.magic, detail::snapshot_magic, sizeof(header.magic) );
+   header.compression = uint32_t( compression );
+   header.section_count = uint32_t( count );
+   std::memcpy( header.chain_id, snapshot.chain_id.data(), sizeof(header.chain_id) );
+   header.head_block_num = snapshot.head_block_num;
+   std::memcpy( header.head_block_id, snapshot.head_block_id.data(), sizeof(header.head_block_id) );
+   header.head_block_time = snapshot.head_block_time.sec_since_epoch();
+   out.write( (const char*)&header, sizeof(header) );
+
+   for( size_t i = 0; i < count; ++i )
+   {
+      const snapshot_section& section = snapshot.sections[i];
+      const vector<char>& stored = compression == block_log_compression::none ? section.data : compressed[i];
+      detail::snapshot_section_header section_header;
+      section_header.space_id = section.space_id;
+      section_header.type_id = section.type_id;
+      section_header.next_instance = section.next_id.instance();
+      section_header.object_count = section.object_count;
+      section_header.raw_size = section.data.size();
+      section_header.stored_size = stored.size();
+      section_header.checksum = checksums[i];
+      out.write( (const char*)&section_header, sizeof(section_header) );
+      out.write( stored.data(), stored.size() );
+   }
+   out.close();
+   FC_ASSERT( out, "Failed to write ${f}", ("f",tmp) );
+
+   if( fc::exists( dest ) )
+      fc::remove( dest );
+   fc::rename( tmp, dest );
+} FC_CAPTURE_AND_RETHROW( (dest)(compression) ) }
+
+binary_snapshot load_snapshot( graphene::chain::database& db, const fc::path& src,
+                               const chain_id_type& chain_id )
+{ try {
+   FC_ASSERT( fc::exists( src ), "Snapshot file does not exist" );
+   const size_t file_size = fc::file_size( src );
+   FC_ASSERT( file_size >= sizeof(detail::snapshot_file_header), "Not a snapshot file" );
+
+   fc::file_mapping fm( src.generic_string().c_str(), fc::read_only );
+   fc::mapped_region mr( fm, fc::read_only, 0, file_size );
+   const char* pos = (const char*)mr.get_address();
+   const char* const end = pos + file_size;
+
+   detail::snapshot_file_header header;
+   std::memcpy( &header, pos, sizeof(header) );
+   pos += sizeof(header);
+   FC_ASSERT( std::memcmp( header.magic, detail::snapshot_magic, sizeof(header.magic) ) == 0,
+              "Not a snapshot file" );
+   const block_log_compression compression = block_log_compression( header.compression.value() );
+   FC_ASSERT( is_block_log_compression_supported( compression ),
+              "The snapshot uses compression ${c}, which is not supported by this build", ("c",compression) );
+
+   binary_snapshot result;
+   std::memcpy( result.chain_id.data(), header.chain_id, sizeof(header.chain_id) );
+   result.head_block_num = header.head_block_num.value();
+   std::memcpy( result.head_block_id.data(), header.head_block_id, sizeof(header.head_block_id) );
+   result.head_block_time = fc::time_point_sec( header.head_block_time.value() );
+   FC_ASSERT( result.chain_id == chain_id, "The snapshot is of chain ${s}, but the node is configured for ${c}",
+              ("s",result.chain_id)("c",chain_id) );
+
+   FC_ASSERT( header.section_count.value() <= size_t( end - pos ) / sizeof(detail::snapshot_section_header),
+              "The snapshot is truncated" );
+
+   // the section headers are read one after the other, the sections themselves are checked and loaded in parallel
+   vector<detail::snapshot_section_header> headers( header.section_count.value() );
+   vector<const char*> stored( headers.size() );
+   result.sections.resize( headers.size() );
+   for( size_t i = 0; i < headers.size(); ++i )
+   {
+      FC_ASSERT( size_t( end - pos ) >= sizeof(headers[i]), "The snapshot is truncated" );
+      std::memcpy( &headers[i], pos, sizeof(headers[i]) );
+      pos += sizeof(headers[i]);
+      FC_ASSERT( uint64_t( end - pos ) >= headers[i].stored_size.value(), "The snapshot is truncated" );
+      stored[i] = pos;
+      pos += headers[i].stored_size.value();
+
+      snapshot_section& section = result.sections[i];
+      section.space_id = headers[i].space_id.value();
+      section.type_id = headers[i].type_id.value();
+      section.next_id = object_id_type( section.space_id, section.type_id, headers[i].next_instance.value() );
+      section.object_count = headers[i].object_count.value();
+   }
+
+   vector<size_t> to_load;
+   to_load.reserve( headers.size() );
+   for( size_t i = 0; i < headers.size(); ++i )
+   {
+      const snapshot_section& section = result.sections[i];
+      if( db.find_index( section.space_id, section.type_id ) == nullptr )
+      {
+         wlog( "Skipping ${n} objects of ${s}.${t} in the snapshot, there is no such index",
+               ("n",section.object_count)("s",section.space_id)("t",section.type_id) );
+         continue;
+      }
+      to_load.push_back( i );
+   }
+   graphene::db::run_parallel( to_load.size(), [&db,&result,&headers,&stored,&to_load,compression] ( size_t n ) {
+      const size_t i = to_load[n];
+      detail::load_section( db, compression, result.sections[i], headers[i], stored[i] );
+   });
+   // the secondary indexes are filled here, one index after the other, not by the parallel tasks
+   db.notify_loaded();
+   return result;
+} FC_CAPTURE_AND_RETHROW( (src)(chain_id) ) }
+
+} } // graphene::snapshot_plugin
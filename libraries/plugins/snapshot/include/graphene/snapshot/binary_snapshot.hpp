@@ -0,0 +1,73 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <graphene/chain/block_log.hpp>
+#include <graphene/chain/database.hpp>
+
+namespace graphene { namespace snapshot_plugin {
+   using graphene::chain::block_log_compression;
+   using graphene::chain::block_id_type;
+   using graphene::chain::chain_id_type;
+   using graphene::db::object_id_type;
+
+   /// The objects of one index, packed back to back, each prefixed by its size
+   struct snapshot_section
+   {
+      uint8_t        space_id = 0;
+      uint8_t        type_id = 0;
+      object_id_type next_id;
+      uint64_t       object_count = 0;
+      vector<char>   data;
+   };
+
+   /// The state of a database after a block, serialized and ready to be written
+   struct binary_snapshot
+   {
+      chain_id_type            chain_id;
+      uint32_t                 head_block_num = 0;
+      block_id_type            head_block_id;
+      fc::time_point_sec       head_block_time;
+      vector<snapshot_section> sections;
+   };
+
+   /**
+    *  Serializes all indexes of @p db, each on a thread of its own. The database must not change meanwhile, so
+    *  this is called between blocks, but writing the result out can be left to another thread.
+    */
+   binary_snapshot capture_snapshot( const graphene::chain::database& db );
+
+   /**
+    *  Writes a snapshot to @p dest. The file starts with a header which identifies the chain and the head block,
+    *  followed by one section per index. Every section is compressed on its own, and its header holds the sizes,
+    *  the number of objects and a crc32 checksum of the stored data. The sections are compressed in parallel,
+    *  the file is written to a temporary name and renamed when it is complete.
+    */
+   void write_snapshot( const binary_snapshot& snapshot, const fc::path& dest, block_log_compression compression );
+
+   /**
+    *  Loads the objects of a snapshot written by @ref write_snapshot into @p db, which must be empty and not yet
+    *  open. A snapshot of another chain than @p chain_id is rejected before anything is loaded. The sections are
+    *  checked and loaded in parallel. Sections of indexes which do not exist in @p db, e.g. of plugins that are
+    *  not enabled, are skipped.
+    *  @return the snapshot without the section data
+    */
+   binary_snapshot load_snapshot( graphene::chain::database& db, const fc::path& src,
+                                  const chain_id_type& chain_id );
+
+} } // graphene::snapshot_plugin
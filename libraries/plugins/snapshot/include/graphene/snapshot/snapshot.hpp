@@ -24,10 +24,14 @@
 #pragma once
 
 #include <graphene/app/plugin.hpp>
+#include <graphene/chain/block_log.hpp>
 #include <graphene/chain/database.hpp>
 
+#include <fc/thread/thread.hpp>
 #include <fc/time.hpp>
 
+#include <memory>
+
 namespace graphene { namespace snapshot_plugin {
 
 class snapshot_plugin : public graphene::app::plugin {
@@ -43,13 +47,19 @@ class snapshot_plugin : public graphene::app::plugin {
       ) override;
 
       void plugin_initialize( const boost::program_options::variables_map& options ) override;
+      void plugin_shutdown() override;
 
    private:
        void check_snapshot( const graphene::chain::signed_block& b);
+       void create_binary_snapshot();
 
        uint32_t           snapshot_block = -1, last_block = 0;
        fc::time_point_sec snapshot_time = fc::time_point_sec::maximum(), last_time = fc::time_point_sec(1);
        fc::path           dest;
+       bool               json_format = true;
+       graphene::chain::block_log_compression compression = graphene::chain::block_log_compression::zlib;
+       std::unique_ptr<fc::thread> writer;
+       fc::future<void>   write_task;
 };
 
 } } //graphene::snapshot_plugin
@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <graphene/snapshot/snapshot.hpp>
+#include <graphene/snapshot/binary_snapshot.hpp>
 
 #include <graphene/chain/database.hpp>
 
@@ -36,6 +37,9 @@ namespace bpo = boost::program_options;
 static const char* OPT_BLOCK_NUM  = "snapshot-at-block";
 static const char* OPT_BLOCK_TIME = "snapshot-at-time";
 static const char* OPT_DEST       = "snapshot-to";
+static const char* OPT_FORMAT     = "snapshot-format";
+static const char* OPT_COMPRESS   = "snapshot-compression";
+static const char* OPT_LOAD       = "snapshot-load-from";
 
 void snapshot_plugin::plugin_set_program_options(
    boost::program_options::options_description& command_line_options,
@@ -44,7 +48,15 @@ void snapshot_plugin::plugin_set_program_options(
    command_line_options.add_options()
          (OPT_BLOCK_NUM, bpo::value<uint32_t>(), "Block number after which to do a snapshot")
          (OPT_BLOCK_TIME, bpo::value<string>(), "Block time (ISO format) after which to do a snapshot")
-         (OPT_DEST, bpo::value<string>(), "Pathname of JSON file where to store the snapshot")
+         (OPT_DEST, bpo::value<string>(), "Pathname of the file where to store the snapshot")
+         (OPT_FORMAT, bpo::value<string>()->default_value("json"),
+          "Format of the snapshot, 'json' or 'binary'. Binary snapshots are written in the background "
+          "and can be loaded with snapshot-load-from, JSON snapshots hold one object per line")
+         (OPT_COMPRESS, bpo::value<string>()->default_value("zlib"),
+          "Compression of binary snapshots, 'none', 'zlib' or 'zstd' (if supported by the build)")
+         (OPT_LOAD, bpo::value<string>(),
+          "Pathname of a binary snapshot to start from instead of replaying the chain, "
+          "the data directory must not contain a chain state yet")
          ;
    config_file_options.add(command_line_options);
 }
@@ -63,11 +75,35 @@ void snapshot_plugin::plugin_initialize(const boost::program_options::variables_
 { try {
    ilog("snapshot plugin: plugin_initialize() begin");
 
+   if( options.count(OPT_LOAD) > 0 )
+   {
+      const fc::path src = options[OPT_LOAD].as<std::string>();
+      ilog( "snapshot plugin: loading snapshot ${f}", ("f",src) );
+      const auto start = fc::time_point::now();
+      const binary_snapshot loaded = load_snapshot( database(), src, app().get_genesis_chain_id() );
+      ilog( "snapshot plugin: loaded the state of chain ${c} at block ${n} (${id}, ${t}) in ${ms}ms",
+            ("c",loaded.chain_id)("n",loaded.head_block_num)("id",loaded.head_block_id)
+            ("t",loaded.head_block_time)("ms",( fc::time_point::now() - start ).count() / 1000) );
+   }
+
    if( options.count(OPT_BLOCK_NUM) > 0 || options.count(OPT_BLOCK_TIME) > 0 )
    {
       FC_ASSERT( options.count(OPT_DEST) > 0,
                  "Must specify snapshot-to in addition to snapshot-at-block or snapshot-at-time!" );
       dest = options[OPT_DEST].as<std::string>();
+      if( options.count(OPT_FORMAT) > 0 )
+      {
+         const std::string format = options[OPT_FORMAT].as<std::string>();
+         FC_ASSERT( format == "binary" || format == "json", "Unknown snapshot format ${f}", ("f",format) );
+         json_format = ( format == "json" );
+      }
+      if( options.count(OPT_COMPRESS) > 0 )
+      {
+         compression = fc::reflector<graphene::chain::block_log_compression>::from_string(
+                             options[OPT_COMPRESS].as<std::string>().c_str() );
+         FC_ASSERT( graphene::chain::is_block_log_compression_supported( compression ),
+                    "Snapshot compression ${c} is not supported by this build", ("c",compression) );
+      }
       if( options.count(OPT_BLOCK_NUM) > 0 )
          snapshot_block = options[OPT_BLOCK_NUM].as<uint32_t>();
       if( options.count(OPT_BLOCK_TIME) > 0 )
@@ -95,32 +131,69 @@ static void create_snapshot( const graphene::chain::database& db, const fc::path
       wlog( "Failed to open snapshot destination: ${ex}", ("ex",e) );
       return;
    }
-   for( uint32_t space_id = 0; space_id < 256; space_id++ )
-      for( uint32_t type_id = 0; type_id < 256; type_id++ )
-      {
-         try
-         {
-            db.get_index( (uint8_t)space_id, (uint8_t)type_id );
-         }
-         catch (fc::assert_exception& e)
-         {
-            continue;
-         }
-         auto& index = db.get_index( (uint8_t)space_id, (uint8_t)type_id );
-         index.inspect_all_objects( [&out]( const graphene::db::object& o ) {
-            out << fc::json::to_string( o.to_variant() ) << '\n';
-         });
-      }
+   db.inspect_all_indexes( [&out]( const graphene::db::index& index ) {
+      index.inspect_all_objects( [&out]( const graphene::db::object& o ) {
+         out << fc::json::to_string( o.to_variant() ) << '\n';
+      });
+   });
    out.close();
    ilog("snapshot plugin: created snapshot");
 }
 
+void snapshot_plugin::create_binary_snapshot()
+{
+   if( write_task.valid() && !write_task.ready() )
+   {
+      wlog( "snapshot plugin: the previous snapshot is still being written, skipping this one" );
+      return;
+   }
+
+   // Only serializing the objects holds up block processing, compressing and writing them is done by the writer
+   ilog("snapshot plugin: creating snapshot");
+   const auto start = fc::time_point::now();
+   auto snapshot = std::make_shared<binary_snapshot>( capture_snapshot( database() ) );
+   ilog( "snapshot plugin: captured ${n} indexes at block ${b} in ${ms}ms",
+         ("n",snapshot->sections.size())("b",snapshot->head_block_num)
+         ("ms",( fc::time_point::now() - start ).count() / 1000) );
+
+   if( !writer )
+      writer = std::make_unique<fc::thread>( "snapshot" );
+   write_task = writer->async( [snapshot,file=dest,method=compression]() {
+      try
+      {
+         const auto write_start = fc::time_point::now();
+         write_snapshot( *snapshot, file, method );
+         ilog( "snapshot plugin: created snapshot ${f} in ${ms}ms",
+               ("f",file)("ms",( fc::time_point::now() - write_start ).count() / 1000) );
+      }
+      catch( const fc::exception& e )
+      {
+         elog( "Failed to write snapshot: ${e}", ("e",e.to_detail_string()) );
+      }
+   }, "write snapshot" );
+}
+
 void snapshot_plugin::check_snapshot( const graphene::chain::signed_block& b )
 { try {
     uint32_t current_block = b.block_num();
     if( (last_block < snapshot_block && snapshot_block <= current_block)
            || (last_time < snapshot_time && snapshot_time <= b.timestamp) )
-       create_snapshot( database(), dest );
+    {
+       if( json_format )
+          create_snapshot( database(), dest );
+       else
+          create_binary_snapshot();
+    }
     last_block = current_block;
     last_time = b.timestamp;
 } FC_LOG_AND_RETHROW() }
+
+void snapshot_plugin::plugin_shutdown()
+{
+   if( write_task.valid() && !write_task.ready() )
+   {
+      ilog( "snapshot plugin: waiting for the snapshot to be written" );
+      write_task.wait();
+   }
+   writer.reset();
+}
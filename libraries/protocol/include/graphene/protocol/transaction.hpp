@@ -91,6 +91,8 @@ namespace graphene { namespace protocol {
 
       /// Calculate the digest for a transaction
       digest_type                        digest()const;
+      /// Calculate the digest used for signature validation
+      digest_type                        sig_digest( const chain_id_type& chain_id )const;
       virtual const transaction_id_type& id()const;
       virtual void                       validate() const;
 
@@ -123,8 +125,6 @@ namespace graphene { namespace protocol {
       virtual uint64_t get_packed_size()const;
 
    protected:
-      // Calculate the digest used for signature validation
-      digest_type sig_digest( const chain_id_type& chain_id )const;
       mutable transaction_id_type _tx_id_buffer;
    };
 
@@ -241,6 +241,15 @@ namespace graphene { namespace protocol {
       virtual void                             validate()const override;
       virtual const flat_set<public_key_type>& get_signature_keys( const chain_id_type& chain_id )const override;
       virtual uint64_t                         get_packed_size()const override;
+
+      /**
+       * @brief Sets the public keys of the signatures, e.g. when they are known from a cache, so that
+       *        @ref get_signature_keys does not extract them again
+       * @param keys the public keys extracted from @ref signatures with the chain ID used by the caller
+       */
+      void set_signature_keys( flat_set<public_key_type> keys )const { _signees = std::move( keys ); }
+      /// @return true if the public keys of the signatures have been extracted or set already
+      bool has_signature_keys()const { return !_signees.empty(); }
    protected:
       mutable bool _validated = false;
       mutable uint64_t _packed_size = 0;
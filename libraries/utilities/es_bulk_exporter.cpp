@@ -0,0 +1,503 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <graphene/utilities/es_bulk_exporter.hpp>
+#include <graphene/utilities/elasticsearch.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace graphene { namespace utilities {
+
+namespace detail {
+
+struct es_bulk_batch
+{
+   uint64_t    sequence = 0;
+   uint32_t    first_block = 0;
+   uint32_t    last_block = 0;
+   bool        barrier = false;  ///< must wait until all batches queued before it are done
+   std::string payload;          ///< empty while the batch is kept on disk
+   fc::path    spill_file;
+};
+
+/// Whether a failed bulk request may succeed when it is sent again unchanged
+static bool is_transient_failure( long http_code, const std::string& response )
+{
+   // no response at all, a timeout, or Elasticsearch is overloaded or unavailable
+   if( http_code == 0 || http_code == 408 || http_code == 429 || http_code >= 500 )
+      return true;
+   if( http_code != 200 )
+      return false;
+   // some documents were rejected, e.g. because of a mapping error, or because a node was overloaded
+   try
+   {
+      const fc::variant result = fc::json::from_string( response );
+      for( const auto& item : result["items"].get_array() )
+         for( const auto& action : item.get_object() )
+         {
+            const int64_t status = action.value()["status"].as_int64();
+            if( status == 429 || status >= 500 )
+               return true;
+         }
+   }
+   catch( const fc::exception& )
+   {
+   }
+   return false;
+}
+
+class es_bulk_exporter_impl
+{
+   public:
+      explicit es_bulk_exporter_impl( const es_bulk_exporter::options& o )
+      : opts( o )
+      {
+         FC_ASSERT( opts.max_queued_batches > 0, "The queue must hold at least one batch" );
+         FC_ASSERT( opts.max_in_flight > 0, "At least one request must be allowed in flight" );
+         if( !opts.spill_directory.empty() )
+            load_spilled_batches();
+         for( uint32_t i = 0; i < opts.max_in_flight; ++i )
+            senders.emplace_back( [this]() { sender_loop(); } );
+      }
+
+      ~es_bulk_exporter_impl()
+      {
+         close( fc::seconds(10) );
+      }
+
+      void send( uint32_t first_block, uint32_t last_block, std::vector<std::string>&& bulk_lines )
+      {
+         es_bulk_batch batch;
+         batch.first_block = first_block;
+         batch.last_block = last_block;
+
+         std::unique_lock<std::mutex> lock( mtx );
+         FC_ASSERT( !closed, "The Elasticsearch exporter has been closed" );
+         if( all_done() && first_block > last_exported_block )
+            last_exported_block = first_block - 1; // nothing was queued for the blocks in between
+         batch.sequence = next_sequence++;
+         batch.barrier = ( first_block <= last_queued_block );
+         last_queued_block = last_block;
+         if( bulk_lines.empty() )
+         {
+            mark_done( batch.sequence, last_block );
+            cv.notify_all();
+            return;
+         }
+         lock.unlock();
+
+         batch.payload = joinBulkLines( bulk_lines );
+         bulk_lines.clear();
+
+         lock.lock();
+         if( in_memory >= opts.max_queued_batches )
+         {
+            if( opts.spill_directory.empty() )
+               cv.wait( lock, [this]() { return in_memory < opts.max_queued_batches; } );
+            else
+            {
+               const uint64_t counter = spill_counter++;
+               lock.unlock();
+               batch.spill_file = write_spill_file( counter, batch );
+               std::string().swap( batch.payload );
+               lock.lock();
+               ++spilled;
+               pending.push_back( std::move( batch ) );
+               cv.notify_all();
+               return;
+            }
+         }
+         ++in_memory;
+         pending.push_back( std::move( batch ) );
+         cv.notify_all();
+      }
+
+      bool flush( fc::microseconds timeout )
+      {
+         std::unique_lock<std::mutex> lock( mtx );
+         return cv.wait_for( lock, std::chrono::microseconds( timeout.count() ), [this]() { return all_done(); } );
+      }
+
+      void close( fc::microseconds timeout )
+      {
+         {
+            std::lock_guard<std::mutex> lock( mtx );
+            if( closed )
+               return;
+            closed = true;
+         }
+         if( !flush( timeout ) )
+         {
+            if( opts.spill_directory.empty() )
+            {
+               // there is nowhere to keep the remaining batches, so they are not given up
+               do
+                  wlog( "Waiting for ${n} bulk requests to be sent to Elasticsearch, set elasticsearch-spill-dir to "
+                        "keep them on disk instead", ("n", get_metrics().queued_batches) );
+               while( !flush( timeout ) );
+            }
+            else
+               wlog( "Not all bulk requests could be sent to Elasticsearch within ${t} seconds",
+                     ("t", timeout.to_seconds()) );
+         }
+         {
+            std::lock_guard<std::mutex> lock( mtx );
+            stopping = true;
+            cv.notify_all();
+         }
+         for( auto& sender : senders )
+            sender.join();
+         senders.clear();
+
+         // The senders are gone, the remaining batches are ours now. They are (re)written in the order they were
+         // queued, so that they are sent in the same order after a restart.
+         std::move( unsent.begin(), unsent.end(), std::back_inserter( pending ) );
+         unsent.clear();
+         std::sort( pending.begin(), pending.end(), []( const es_bulk_batch& a, const es_bulk_batch& b ) {
+            return a.sequence < b.sequence;
+         } );
+         uint32_t dropped = 0;
+         for( auto& batch : pending )
+         {
+            try
+            {
+               if( batch.spill_file.empty() )
+                  write_spill_file( spill_counter++, batch );
+               else
+                  fc::rename( batch.spill_file, spill_file_name( spill_counter++, batch ) );
+            }
+            catch( const fc::exception& e )
+            {
+               elog( "${e}", ("e", e.to_detail_string()) );
+               ++dropped;
+            }
+         }
+         if( dropped > 0 )
+            elog( "Dropped ${n} bulk requests which could not be sent to Elasticsearch", ("n", dropped) );
+         else if( !pending.empty() )
+            wlog( "${n} bulk requests are left in ${d}", ("n", pending.size())("d", opts.spill_directory) );
+         pending.clear();
+      }
+
+      es_bulk_exporter::metrics get_metrics()const
+      {
+         std::lock_guard<std::mutex> lock( mtx );
+         es_bulk_exporter::metrics result;
+         result.queued_batches = in_memory;
+         result.spilled_batches = spilled;
+         result.in_flight = in_flight;
+         result.sent_batches = sent_batches;
+         result.failed_requests = failed_requests;
+         result.dropped_batches = dropped_batches;
+         result.last_queued_block = last_queued_block;
+         result.last_exported_block = last_exported_block;
+         if( last_queued_block > last_exported_block )
+            result.lag_blocks = last_queued_block - last_exported_block;
+         return result;
+      }
+
+   private:
+      bool all_done()const
+      {
+         return exported_sequence + 1 == next_sequence;
+      }
+
+      /// Advances the exported block over all batches which are done without a gap
+      void mark_done( uint64_t sequence, uint32_t last_block )
+      {
+         completed[sequence] = last_block;
+         auto itr = completed.begin();
+         while( itr != completed.end() && itr->first == exported_sequence + 1 )
+         {
+            exported_sequence = itr->first;
+            last_exported_block = itr->second;
+            itr = completed.erase( itr );
+         }
+      }
+
+      fc::path spill_file_name( uint64_t counter, const es_bulk_batch& batch )const
+      {
+         char name[64];
+         std::snprintf( name, sizeof(name), "%020llu-%u-%u.bulk", static_cast<unsigned long long>( counter ),
+                        batch.first_block, batch.last_block );
+         return opts.spill_directory / name;
+      }
+
+      fc::path write_spill_file( uint64_t counter, const es_bulk_batch& batch )const
+      {
+         const fc::path file = spill_file_name( counter, batch );
+         const fc::path tmp_file = file.generic_string() + ".tmp";
+         {
+            std::ofstream out( tmp_file.generic_string(), std::ios::binary | std::ios::trunc );
+            out.write( batch.payload.data(), batch.payload.size() );
+            out.close();
+            FC_ASSERT( out, "Unable to write bulk request to ${f}", ("f", tmp_file) );
+         }
+         fc::rename( tmp_file, file );
+         return file;
+      }
+
+      void load_spilled_batches()
+      {
+         fc::create_directories( opts.spill_directory );
+         std::map<uint64_t, es_bulk_batch> found;
+         for( fc::directory_iterator itr( opts.spill_directory ), end; itr != end; ++itr )
+         {
+            const std::string name = (*itr).filename().generic_string();
+            unsigned long long counter;
+            es_bulk_batch batch;
+            if( name.size() < 5 || name.compare( name.size() - 5, 5, ".bulk" ) != 0
+                  || std::sscanf( name.c_str(), "%llu-%u-%u.bulk", &counter, &batch.first_block,
+                                  &batch.last_block ) != 3 )
+               continue;
+            batch.spill_file = *itr;
+            found[counter] = std::move( batch );
+         }
+         if( found.empty() )
+            return;
+
+         ilog( "Found ${n} bulk requests in ${d}", ("n", found.size())("d", opts.spill_directory) );
+         last_exported_block = found.begin()->second.first_block - 1;
+         for( auto& item : found )
+         {
+            es_bulk_batch& batch = item.second;
+            batch.sequence = next_sequence++;
+            batch.barrier = true; // their ranges may overlap
+            last_queued_block = batch.last_block;
+            pending.push_back( std::move( batch ) );
+            ++spilled;
+         }
+         spill_counter = found.rbegin()->first + 1;
+      }
+
+      enum class post_result { sent, retry, rejected };
+
+      post_result post( CurlRequest& request )
+      {
+         try
+         {
+            const std::string response = doCurl( request );
+            const long http_code = getResponseCode( request.handler );
+            if( handleBulkResponse( http_code, response ) )
+               return post_result::sent;
+            return is_transient_failure( http_code, response ) ? post_result::retry : post_result::rejected;
+         }
+         catch( const fc::exception& e )
+         {
+            elog( "Unexpected response to bulk request: ${e}", ("e", e.to_detail_string()) );
+            return post_result::retry;
+         }
+      }
+
+      /**
+       * Moves a batch which can not be sent to the "failed" subdirectory of the spill directory
+       * @return false if the batch could not be moved, it has to be kept then
+       */
+      bool set_aside( const es_bulk_batch& batch, const std::string& payload )const
+      {
+         try
+         {
+            const fc::path failed_dir = opts.spill_directory / "failed";
+            fc::create_directories( failed_dir );
+            const fc::path file = failed_dir / spill_file_name( batch.sequence, batch ).filename();
+            if( batch.spill_file.empty() )
+            {
+               std::ofstream out( file.generic_string(), std::ios::binary | std::ios::trunc );
+               out.write( payload.data(), payload.size() );
+               out.close();
+               FC_ASSERT( out, "Unable to write bulk request to ${f}", ("f", file) );
+            }
+            else
+               fc::rename( batch.spill_file, file );
+            elog( "Moved bulk request for blocks ${f} to ${l} aside to ${p}",
+                  ("f", batch.first_block)("l", batch.last_block)("p", file) );
+            return true;
+         }
+         catch( const fc::exception& e )
+         {
+            elog( "Unable to move bulk request for blocks ${f} to ${l} aside: ${e}",
+                  ("f", batch.first_block)("l", batch.last_block)("e", e.to_detail_string()) );
+         }
+         return false;
+      }
+
+      void sender_loop()
+      {
+         CURL* curl = curl_easy_init();
+         curl_easy_setopt( curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2 );
+         curl_easy_setopt( curl, CURLOPT_TIMEOUT_MS, static_cast<long>( opts.request_timeout.count() / 1000 ) );
+
+         std::unique_lock<std::mutex> lock( mtx );
+         while( true )
+         {
+            cv.wait( lock, [this]() {
+               return stopping || ( !pending.empty() && ( !pending.front().barrier || in_flight == 0 ) );
+            } );
+            if( stopping )
+               break;
+            es_bulk_batch batch = std::move( pending.front() );
+            pending.pop_front();
+            ++in_flight;
+            lock.unlock();
+
+            bool loaded = true;
+            if( !batch.spill_file.empty() )
+            {
+               try
+               {
+                  fc::read_file_contents( batch.spill_file, batch.payload );
+               }
+               catch( const fc::exception& e )
+               {
+                  elog( "Skipping bulk request which can not be read: ${e}", ("e", e.to_detail_string()) );
+                  loaded = false;
+               }
+            }
+
+            CurlRequest request;
+            request.handler = curl;
+            request.url = opts.elasticsearch_url + "_bulk";
+            request.auth = opts.auth;
+            request.type = "POST";
+            request.query = std::move( batch.payload );
+
+            // Without a spill directory a batch is retried until it is sent, however it failed. With one, only
+            // failures which may go away are retried, and only a limited number of times.
+            const bool can_set_aside = !opts.spill_directory.empty();
+            post_result result = post_result::rejected;
+            bool stopped = false;
+            bool moved_aside = ( !loaded && set_aside( batch, request.query ) );
+            uint32_t retries = 0;
+            fc::microseconds delay = opts.min_retry_delay;
+            // a spill file which can not be read nor moved is left where it is, it is found again after a restart
+            while( loaded && !moved_aside && ( result = post( request ) ) != post_result::sent )
+            {
+               if( can_set_aside && ( result == post_result::rejected || retries >= opts.max_retries )
+                     && set_aside( batch, request.query ) )
+                  moved_aside = true;
+               else if( result == post_result::rejected && retries == 0 )
+                  elog( "Bulk request for blocks ${f} to ${l} was rejected, retrying until it is accepted",
+                        ("f", batch.first_block)("l", batch.last_block) );
+               lock.lock();
+               ++failed_requests;
+               if( !moved_aside )
+                  stopped = cv.wait_for( lock, std::chrono::microseconds( delay.count() ),
+                                         [this]() { return stopping; } );
+               lock.unlock();
+               if( moved_aside || stopped )
+                  break;
+               ++retries;
+               delay = fc::microseconds( std::min( delay.count() * 2, opts.max_retry_delay.count() ) );
+            }
+            const bool sent = ( result == post_result::sent );
+            if( sent && !batch.spill_file.empty() )
+               fc::remove( batch.spill_file );
+
+            lock.lock();
+            --in_flight;
+            if( stopped )
+            {
+               batch.payload = std::move( request.query );
+               unsent.push_back( std::move( batch ) );
+               cv.notify_all();
+               break;
+            }
+            if( batch.spill_file.empty() )
+               --in_memory;
+            else
+               --spilled;
+            if( sent )
+               ++sent_batches;
+            else
+               ++dropped_batches;
+            mark_done( batch.sequence, batch.last_block );
+            cv.notify_all();
+         }
+         lock.unlock();
+
+         curl_easy_cleanup( curl );
+      }
+
+      const es_bulk_exporter::options  opts;
+
+      mutable std::mutex               mtx;
+      std::condition_variable          cv;
+      std::deque<es_bulk_batch>        pending;
+      std::vector<es_bulk_batch>       unsent;   ///< batches which were being retried when the senders stopped
+      std::vector<std::thread>         senders;
+      bool                             closed = false;
+      bool                             stopping = false;
+
+      uint32_t                         in_memory = 0;
+      uint32_t                         spilled = 0;
+      uint32_t                         in_flight = 0;
+      uint64_t                         sent_batches = 0;
+      uint64_t                         failed_requests = 0;
+      uint64_t                         dropped_batches = 0;
+      uint64_t                         spill_counter = 0;
+
+      uint64_t                         next_sequence = 1;
+      uint64_t                         exported_sequence = 0;
+      std::map<uint64_t, uint32_t>     completed;   ///< batches done out of order, sequence => last block
+      uint32_t                         last_queued_block = 0;
+      uint32_t                         last_exported_block = 0;
+};
+
+} // end namespace detail
+
+es_bulk_exporter::es_bulk_exporter( const options& opts )
+: my( std::make_unique<detail::es_bulk_exporter_impl>( opts ) )
+{
+}
+
+es_bulk_exporter::~es_bulk_exporter() = default;
+
+void es_bulk_exporter::send( uint32_t first_block, uint32_t last_block, std::vector<std::string>&& bulk_lines )
+{
+   my->send( first_block, last_block, std::move( bulk_lines ) );
+}
+
+bool es_bulk_exporter::flush( fc::microseconds timeout )
+{
+   return my->flush( timeout );
+}
+
+void es_bulk_exporter::close( fc::microseconds timeout )
+{
+   my->close( timeout );
+}
+
+es_bulk_exporter::metrics es_bulk_exporter::get_metrics()const
+{
+   return my->get_metrics();
+}
+
+} } // end namespace graphene::utilities
@@ -0,0 +1,124 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace graphene { namespace utilities {
+
+   namespace detail {
+      class es_bulk_exporter_impl;
+   }
+
+   /**
+    *  @brief Sends bulk requests to Elasticsearch on background threads
+    *
+    *  Batches of bulk lines are queued by @ref send and picked up by a number of sender threads, each of which
+    *  keeps at most one request in flight. A failed request is retried with exponential backoff. No batch is
+    *  ever dropped: without a spill directory every batch is retried until it is sent, so that a batch which
+    *  can not be sent eventually fills the queue and holds up the caller. With a spill directory, a batch which
+    *  is rejected for a reason that will not go away (e.g. a mapping error), or which still fails after
+    *  @ref options::max_retries retries, is moved to the "failed" subdirectory of the spill directory instead,
+    *  so that it does not stall the batches after it.
+    *
+    *  The caller never has to wait for Elasticsearch unless the queue is full. In that case @ref send blocks
+    *  until there is room again, or, if a spill directory is configured, writes the batch to that directory,
+    *  from where it is sent later. Batches left in the spill directory are picked up again
+    *  when an exporter is created on the same directory.
+    *
+    *  Batches are dispatched in the order they were queued but may complete in any order, with one exception:
+    *  a batch which does not start above the last block of the batch queued before it (e.g. after a chain
+    *  reorganization or a replay) waits until all earlier batches are done, so that documents which are indexed
+    *  again always replace the older ones.
+    *
+    *  @ref send must always be called from the same thread.
+    */
+   class es_bulk_exporter
+   {
+      public:
+         struct options
+         {
+            std::string      elasticsearch_url;
+            std::string      auth;
+            /// Maximum number of batches kept in memory, including the ones which are being sent
+            uint32_t         max_queued_batches = 32;
+            /// Number of bulk requests which are sent in parallel
+            uint32_t         max_in_flight = 2;
+            /// If set, batches which don't fit into the queue are written to this directory
+            fc::path         spill_directory;
+            fc::microseconds min_retry_delay = fc::milliseconds(100);
+            fc::microseconds max_retry_delay = fc::seconds(30);
+            /// Number of times a request which failed for a transient reason is sent again before it is moved
+            /// aside, only used with a spill directory
+            uint32_t         max_retries = 20;
+            /// Time limit of a single request
+            fc::microseconds request_timeout = fc::seconds(60);
+         };
+
+         struct metrics
+         {
+            uint32_t queued_batches = 0;       ///< batches in memory, waiting or being sent
+            uint32_t spilled_batches = 0;      ///< batches on disk, waiting or being sent
+            uint32_t in_flight = 0;            ///< requests being sent right now
+            uint64_t sent_batches = 0;
+            uint64_t failed_requests = 0;
+            uint64_t dropped_batches = 0;     ///< batches which were moved aside, see @ref options::max_retries
+            uint32_t last_queued_block = 0;
+            uint32_t last_exported_block = 0;  ///< all batches up to this block have been sent
+            uint32_t lag_blocks = 0;           ///< number of queued blocks which are not exported yet
+         };
+
+         explicit es_bulk_exporter( const options& opts );
+         /// Calls @ref close with the default timeout if it hasn't been called before
+         ~es_bulk_exporter();
+
+         /**
+          * Queues the bulk lines which were collected from blocks @p first_block to @p last_block. An empty batch
+          * is not sent, but counts as exported as soon as the batches queued before it are.
+          */
+         void send( uint32_t first_block, uint32_t last_block, std::vector<std::string>&& bulk_lines );
+         /**
+          * Waits until all queued batches have been sent or @p timeout has passed
+          * @return true if all batches have been sent
+          */
+         bool flush( fc::microseconds timeout );
+         /**
+          * Waits at most @p timeout for the queued batches to be sent, then stops the sender threads and writes the
+          * batches which could not be sent to the spill directory. Without a spill directory it keeps waiting
+          * until all batches have been sent.
+          */
+         void close( fc::microseconds timeout = fc::seconds(10) );
+
+         metrics get_metrics()const;
+
+      private:
+         std::unique_ptr<detail::es_bulk_exporter_impl> my;
+   };
+
+} } // end namespace graphene::utilities
+
+FC_REFLECT( graphene::utilities::es_bulk_exporter::metrics,
+            (queued_batches)(spilled_batches)(in_flight)(sent_batches)(failed_requests)(dropped_batches)
+            (last_queued_block)(last_exported_block)(lag_blocks) )
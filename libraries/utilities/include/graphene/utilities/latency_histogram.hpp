@@ -0,0 +1,54 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <fc/time.hpp>
+#include <fc/variant_object.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace graphene { namespace utilities {
+
+   /**
+    *  @brief Counts durations in buckets whose upper bounds are powers of two microseconds
+    *
+    *  Recording is a few instructions, so a histogram can be updated on hot paths. It is not thread safe.
+    */
+   class latency_histogram
+   {
+      public:
+         /// The last bucket counts everything above 2^(num_buckets-2) microseconds (about 4s)
+         static constexpr size_t num_buckets = 24;
+
+         void     record( const fc::microseconds& latency );
+         void     reset();
+
+         uint64_t count()const { return _count; }
+         /// @return the upper bound of the bucket which contains the given percentile (0-100), in microseconds
+         int64_t  percentile( double p )const;
+         /// @return the number of samples per non-empty bucket, keyed by the bucket's upper bound like "<=512us",
+         ///         and the 50th, 90th and 99th percentile
+         fc::variant_object to_variant_object()const;
+
+      private:
+         std::array<uint64_t, num_buckets> _buckets {};
+         uint64_t                          _count = 0;
+   };
+
+} } // graphene::utilities
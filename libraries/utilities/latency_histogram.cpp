@@ -0,0 +1,81 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <graphene/utilities/latency_histogram.hpp>
+
+#include <fc/variant.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace graphene { namespace utilities {
+
+constexpr size_t latency_histogram::num_buckets;
+
+void latency_histogram::record( const fc::microseconds& latency )
+{
+   uint64_t us = std::max<int64_t>( latency.count(), 0 );
+   size_t bucket = 0;
+   // bucket i takes (2^(i-1), 2^i]
+   while( bucket + 1 < num_buckets && ( uint64_t(1) << bucket ) < us )
+      ++bucket;
+   ++_buckets[bucket];
+   ++_count;
+}
+
+void latency_histogram::reset()
+{
+   _buckets.fill( 0 );
+   _count = 0;
+}
+
+int64_t latency_histogram::percentile( double p )const
+{
+   if( _count == 0 )
+      return 0;
+   const uint64_t rank = std::max<uint64_t>( 1, uint64_t( std::ceil( _count * p / 100 ) ) );
+   uint64_t seen = 0;
+   for( size_t bucket = 0; bucket < num_buckets; ++bucket )
+   {
+      seen += _buckets[bucket];
+      if( seen >= rank )
+         return int64_t(1) << bucket;
+   }
+   return int64_t(1) << ( num_buckets - 1 );
+}
+
+fc::variant_object latency_histogram::to_variant_object()const
+{
+   fc::mutable_variant_object buckets;
+   for( size_t bucket = 0; bucket < num_buckets; ++bucket )
+   {
+      if( _buckets[bucket] == 0 )
+         continue;
+      if( bucket + 1 < num_buckets )
+         buckets( "<=" + std::to_string( uint64_t(1) << bucket ) + "us", _buckets[bucket] );
+      else
+         buckets( ">" + std::to_string( uint64_t(1) << ( bucket - 1 ) ) + "us", _buckets[bucket] );
+   }
+   return fc::mutable_variant_object( "count", _count )
+                                    ( "p50_us", percentile( 50 ) )
+                                    ( "p90_us", percentile( 90 ) )
+                                    ( "p99_us", percentile( 99 ) )
+                                    ( "buckets", buckets );
+}
+
+} } // graphene::utilities
@@ -400,6 +400,16 @@ class wallet_api
        */
       pair<transaction_id_type,signed_transaction> broadcast_transaction(signed_transaction tx);
 
+      /** Broadcast a batch of signed transactions
+       *
+       * The transactions are sent to the node in batches, one batch after another, and the node applies them in
+       * the given order, so a transaction may depend on the ones before it. If a transaction fails, the ones
+       * before it stay broadcast and an error is thrown.
+       * @param txs signed transactions
+       * @returns the IDs of the transactions, in the same order
+       */
+      vector<transaction_id_type> broadcast_transactions(vector<signed_transaction> txs);
+
       /**
        * @ingroup Transaction Builder API
        *
@@ -1499,6 +1509,18 @@ class wallet_api
                                            const vector<public_key_type>& signing_keys = vector<public_key_type>(),
                                            bool broadcast = true);
 
+      /** Signs a batch of transactions.
+       *
+       * Does the same as @ref sign_transaction for each of the transactions, but the requests to the node
+       * are pipelined over the connection instead of waiting for each response in turn, the transactions
+       * are signed in parallel, and they are broadcast in order as with @ref broadcast_transactions. Use this to
+       * submit many transactions at once.
+       * @param txs the unsigned transactions
+       * @param broadcast true if you wish to broadcast the transactions
+       * @return the signed versions of the transactions, in the same order
+       */
+      vector<signed_transaction> sign_transactions(vector<signed_transaction> txs, bool broadcast = false);
+
 
       /** Get transaction signers.
        *
@@ -1979,6 +2001,7 @@ FC_API( graphene::wallet::wallet_api,
         (preview_builder_transaction)
         (sign_builder_transaction)
         (broadcast_transaction)
+        (broadcast_transactions)
         (propose_builder_transaction)
         (remove_builder_transaction)
         (is_new)
@@ -2063,6 +2086,7 @@ FC_API( graphene::wallet::wallet_api,
         (serialize_transaction)
         (sign_transaction)
         (sign_transaction2)
+        (sign_transactions)
         (add_transaction_signature)
         (get_transaction_signers)
         (get_key_references)
@@ -539,6 +539,11 @@ pair<transaction_id_type,signed_transaction> wallet_api::broadcast_transaction(s
     return my->broadcast_transaction(tx);
 }
 
+vector<transaction_id_type> wallet_api::broadcast_transactions(vector<signed_transaction> txs)
+{
+    return my->broadcast_transactions(txs);
+}
+
 signed_transaction wallet_api::propose_builder_transaction(
       transaction_handle_type handle,
       string account_name_or_id,
@@ -873,6 +878,11 @@ signed_transaction wallet_api::sign_transaction2(signed_transaction tx, const ve
    return my->sign_transaction2( tx, signing_keys, broadcast);
 } FC_CAPTURE_AND_RETHROW( (tx) ) }
 
+vector<signed_transaction> wallet_api::sign_transactions(vector<signed_transaction> txs, bool broadcast /* = false */)
+{ try {
+   return my->sign_transactions( std::move(txs), broadcast );
+} FC_CAPTURE_AND_RETHROW() }
+
 flat_set<public_key_type> wallet_api::get_transaction_signers(const signed_transaction &tx) const
 { try {
    return my->get_transaction_signers(tx);
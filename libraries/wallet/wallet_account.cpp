@@ -400,25 +400,32 @@ namespace graphene { namespace wallet { namespace detail {
       }
 
       vector< signed_transaction > result;
+      result.reserve( claim_txs.size() );
 
+      const auto fees = _remote_db->get_global_properties().parameters.get_current_fees();
       for( const claim_tx& ctx : claim_txs )
       {
          signed_transaction tx;
          tx.operations.reserve( ctx.ops.size() );
          for( const balance_claim_operation& op : ctx.ops )
             tx.operations.emplace_back( op );
-         set_operation_fees( tx, _remote_db->get_global_properties().parameters.get_current_fees() );
+         set_operation_fees( tx, fees );
          tx.validate();
-         signed_transaction signed_tx = sign_transaction( tx, false );
-         for( const address& addr : ctx.addrs )
+         result.push_back( tx );
+      }
+
+      result = sign_transactions( std::move( result ), false );
+      for( size_t i = 0; i < claim_txs.size(); ++i )
+      {
+         signed_transaction& signed_tx = result[i];
+         for( const address& addr : claim_txs[i].addrs )
             signed_tx.sign( keys[addr], _chain_id );
          // if the key for a balance object was the same as a key for the account we're importing it into,
          // we may end up with duplicate signatures, so remove those
          boost::erase(signed_tx.signatures, boost::unique<boost::return_found_end>(boost::sort(signed_tx.signatures)));
-         result.push_back( signed_tx );
-         if( broadcast )
-            _remote_net_broadcast->broadcast_transaction(signed_tx);
       }
+      if( broadcast )
+         broadcast_transactions( result );
 
       return result;
    } FC_CAPTURE_AND_RETHROW( (name_or_id) ) }
@@ -25,6 +25,10 @@
 #pragma once
 
 #include <fc/thread/mutex.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <algorithm>
+#include <exception>
 
 #include <graphene/app/api.hpp>
 
@@ -206,6 +210,12 @@ public:
    set<public_key_type> get_owned_required_keys( signed_transaction &tx,
          bool erase_existing_sigs = true);
 
+   /**
+    * Get the required public keys owned by us for each of the transactions, with pipelined requests.
+    * The existing signatures of the transactions are erased.
+    */
+   vector< set<public_key_type> > get_owned_required_keys( vector<signed_transaction>& txs );
+
    signed_transaction add_transaction_signature( signed_transaction tx,
          bool broadcast );
 
@@ -325,6 +335,51 @@ public:
                                         const vector<public_key_type>& signing_keys = vector<public_key_type>(),
                                         bool broadcast = false);
 
+   vector<signed_transaction> sign_transactions( vector<signed_transaction> txs, bool broadcast = false );
+
+   vector<transaction_id_type> broadcast_transactions( const vector<signed_transaction>& txs );
+
+   /**
+    * Runs @p call for the indices 0 to @p count - 1 as tasks on the current thread, so that the remote requests
+    * they make are in flight over the one connection at the same time instead of one round trip after another.
+    * At most @ref max_pipelined_calls requests are in flight at a time.
+    *
+    * @return the results of the calls, in the order of the indices
+    * @throws the exception of the first failed call, after all calls have finished
+    */
+   template<typename Call>
+   auto pipeline( size_t count, Call&& call ) -> vector< decltype( call( size_t() ) ) >
+   {
+      typedef decltype( call( size_t() ) ) result_type;
+      vector<result_type> results;
+      results.reserve( count );
+      vector< fc::future<result_type> > calls;
+      for( size_t base = 0; base < count; base += max_pipelined_calls )
+      {
+         const size_t end = std::min( count, base + max_pipelined_calls );
+         calls.clear();
+         for( size_t i = base; i < end; ++i )
+            calls.push_back( fc::async( [&call,i]() { return call( i ); }, "wallet pipelined call" ) );
+         // The calls refer to call, so all of them have to finish before an exception is passed on
+         std::exception_ptr failure;
+         for( auto& pending_call : calls )
+         {
+            try
+            {
+               results.push_back( pending_call.wait() );
+            }
+            catch( ... )
+            {
+               if( !failure )
+                  failure = std::current_exception();
+            }
+         }
+         if( failure )
+            std::rethrow_exception( failure );
+      }
+      return results;
+   }
+
    flat_set<public_key_type> get_transaction_signers(const signed_transaction &tx) const;
 
    vector<flat_set<account_id_type>> get_key_references(const vector<public_key_type> &keys) const;
@@ -474,6 +529,10 @@ public:
 
    operation get_prototype_operation( string operation_name );
 
+   static constexpr size_t max_pipelined_calls = 100;
+   /// The maximum number of transactions sent to the node in one broadcast_transactions call
+   static constexpr size_t max_broadcast_batch_size = 100;
+
    string                  _wallet_filename;
    wallet_data             _wallet;
 
@@ -556,6 +615,12 @@ private:
      > recently_generated_transaction_set_type;
    recently_generated_transaction_set_type _recently_generated_transactions;
 
+   /// Forgets the transactions generated long enough before @p now to be in a block already
+   void forget_old_generated_transactions( fc::time_point_sec now );
+   /// Sets the reference block and the earliest expiration which gives @p tx an id that has not been
+   /// generated recently, and records the id
+   void set_unique_reference( signed_transaction& tx, const dynamic_global_property_object& dyn_props );
+
 #ifdef __unix__
    mode_t                  _old_umask;
 #endif
@@ -23,8 +23,10 @@
  * THE SOFTWARE.
  */
 
+#include <fc/asio.hpp>
 #include <fc/crypto/aes.hpp>
 #include <fc/crypto/base64.hpp>
+#include <fc/thread/parallel.hpp>
 
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string.hpp>
@@ -350,26 +352,130 @@ namespace graphene { namespace wallet { namespace detail {
       }
 
       auto dyn_props = get_dynamic_global_properties();
-      tx.set_reference_block( dyn_props.head_block_id );
+      forget_old_generated_transactions( dyn_props.time );
+      set_unique_reference( tx, dyn_props );
+
+      tx.clear_signatures();
+      for( const public_key_type& key : approving_key_set )
+         tx.sign( get_private_key(key), _chain_id );
+
+      if( broadcast )
+      {
+         try
+         {
+            _remote_net_broadcast->broadcast_transaction( tx );
+         }
+         catch (const fc::exception& e)
+         {
+            elog("Caught exception while broadcasting tx ${id}:  ${e}",
+                 ("id", tx.id().str())("e", e.to_detail_string()) );
+            throw;
+         }
+      }
+
+      return tx;
+   }
+
+   vector<signed_transaction> wallet_api_impl::sign_transactions( vector<signed_transaction> txs, bool broadcast )
+   {
+      if( txs.empty() )
+         return txs;
+
+      vector< set<public_key_type> > approving_key_sets = get_owned_required_keys( txs );
+
+      auto dyn_props = get_dynamic_global_properties();
+      forget_old_generated_transactions( dyn_props.time );
+      vector< vector<fc::ecc::private_key> > signing_keys( txs.size() );
+      for( size_t i = 0; i < txs.size(); ++i )
+      {
+         set_unique_reference( txs[i], dyn_props );
+         signing_keys[i].reserve( approving_key_sets[i].size() );
+         for( const public_key_type& key : approving_key_sets[i] )
+            signing_keys[i].push_back( get_private_key(key) );
+      }
+
+      // Signing is what takes the time here, spread it over the thread pool
+      const size_t chunks = fc::asio::default_io_service_scope::get_num_threads();
+      const size_t chunk_size = ( txs.size() + chunks - 1 ) / chunks;
+      vector< fc::future<void> > workers;
+      workers.reserve( chunks );
+      for( size_t base = 0; base < txs.size(); base += chunk_size )
+      {
+         const size_t end = std::min( txs.size(), base + chunk_size );
+         workers.push_back( fc::do_parallel( [this,&txs,&signing_keys,base,end] () {
+            for( size_t i = base; i < end; ++i )
+               for( const fc::ecc::private_key& key : signing_keys[i] )
+                  txs[i].sign( key, _chain_id );
+         }) );
+      }
+      // the workers refer to txs, so all of them have to finish before an exception is passed on
+      std::exception_ptr failure;
+      for( auto& worker : workers )
+      {
+         try
+         {
+            worker.wait();
+         }
+         catch( ... )
+         {
+            if( !failure )
+               failure = std::current_exception();
+         }
+      }
+      if( failure )
+         std::rethrow_exception( failure );
+
+      if( broadcast )
+         broadcast_transactions( txs );
+
+      return txs;
+   }
 
-      // first, some bookkeeping, expire old items from _recently_generated_transactions
+   vector<transaction_id_type> wallet_api_impl::broadcast_transactions( const vector<signed_transaction>& txs )
+   {
+      // A transaction may depend on the ones before it, so the batches are sent one after another and the node
+      // applies the transactions of a batch in order
+      vector<transaction_id_type> ids;
+      ids.reserve( txs.size() );
+      for( size_t base = 0; base < txs.size(); base += max_broadcast_batch_size )
+      {
+         const size_t end = std::min( txs.size(), base + max_broadcast_batch_size );
+         vector<precomputable_transaction> batch( txs.begin() + base, txs.begin() + end );
+         try
+         {
+            _remote_net_broadcast->broadcast_transactions( batch );
+         }
+         catch( const fc::exception& e )
+         {
+            elog( "Caught exception while broadcasting txs ${first} to ${last}:  ${e}",
+                  ("first", txs[base].id().str())("last", txs[end-1].id().str())("e", e.to_detail_string()) );
+            throw;
+         }
+         for( const auto& tx : batch )
+            ids.push_back( tx.id() );
+      }
+      return ids;
+   }
+
+   void wallet_api_impl::forget_old_generated_transactions( fc::time_point_sec now )
+   {
       // since transactions include the head block id, we just need the index for keeping transactions unique
       // when there are multiple transactions in the same block.  choose a time period that should be at
       // least one block long, even in the worst case.  2 minutes ought to be plenty.
-      fc::time_point_sec oldest_transaction_ids_to_track(dyn_props.time - fc::minutes(2));
-      auto oldest_transaction_record_iter =
-            _recently_generated_transactions.get<timestamp_index>().lower_bound(oldest_transaction_ids_to_track);
-      auto begin_iter = _recently_generated_transactions.get<timestamp_index>().begin();
-      _recently_generated_transactions.get<timestamp_index>().erase(begin_iter, oldest_transaction_record_iter);
+      fc::time_point_sec oldest_transaction_ids_to_track(now - fc::minutes(2));
+      auto& by_time = _recently_generated_transactions.get<timestamp_index>();
+      by_time.erase( by_time.begin(), by_time.lower_bound(oldest_transaction_ids_to_track) );
+   }
+
+   void wallet_api_impl::set_unique_reference( signed_transaction& tx, const dynamic_global_property_object& dyn_props )
+   {
+      tx.set_reference_block( dyn_props.head_block_id );
 
+      // the id does not cover the signatures, so a dupe is found before the transaction is signed
       uint32_t expiration_time_offset = 0;
       for (;;)
       {
          tx.set_expiration( dyn_props.time + fc::seconds(30 + expiration_time_offset) );
-         tx.clear_signatures();
-
-         for( const public_key_type& key : approving_key_set )
-            tx.sign( get_private_key(key), _chain_id );
 
          graphene::chain::transaction_id_type this_transaction_id = tx.id();
          auto iter = _recently_generated_transactions.find(this_transaction_id);
@@ -380,28 +486,12 @@ namespace graphene { namespace wallet { namespace detail {
             this_transaction_record.generation_time = dyn_props.time;
             this_transaction_record.transaction_id = this_transaction_id;
             _recently_generated_transactions.insert(this_transaction_record);
-            break;
+            return;
          }
 
-         // else we've generated a dupe, increment expiration time and re-sign it
+         // else we've generated a dupe, increment expiration time
          ++expiration_time_offset;
       }
-
-      if( broadcast )
-      {
-         try
-         {
-            _remote_net_broadcast->broadcast_transaction( tx );
-         }
-         catch (const fc::exception& e)
-         {
-            elog("Caught exception while broadcasting tx ${id}:  ${e}",
-                 ("id", tx.id().str())("e", e.to_detail_string()) );
-            throw;
-         }
-      }
-
-      return tx;
    }
 
    fc::ecc::private_key wallet_api_impl::get_private_key(const public_key_type& id)const
@@ -487,6 +577,28 @@ namespace graphene { namespace wallet { namespace detail {
       return _remote_db->get_required_signatures( tx, owned_keys );
    }
 
+   vector< set<public_key_type> > wallet_api_impl::get_owned_required_keys( vector<signed_transaction>& txs )
+   {
+      vector< set<public_key_type> > pks = pipeline( txs.size(), [this,&txs]( size_t i ) {
+         return _remote_db->get_potential_signatures( txs[i] );
+      });
+      vector< flat_set<public_key_type> > owned_keys( txs.size() );
+      for( size_t i = 0; i < txs.size(); ++i )
+      {
+         owned_keys[i].reserve( pks[i].size() );
+         std::copy_if( pks[i].begin(), pks[i].end(),
+                       std::inserter( owned_keys[i], owned_keys[i].end() ),
+                       [this]( const public_key_type &pk ) {
+                          return _keys.find( pk ) != _keys.end();
+                       } );
+         txs[i].signatures.clear();
+      }
+
+      return pipeline( txs.size(), [this,&txs,&owned_keys]( size_t i ) {
+         return _remote_db->get_required_signatures( txs[i], owned_keys[i] );
+      });
+   }
+
    flat_set<public_key_type> wallet_api_impl::get_transaction_signers(const signed_transaction &tx) const
    {
       return tx.get_signature_keys(_chain_id);
@@ -0,0 +1,131 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/block_log.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <iostream>
+
+using namespace graphene::chain;
+namespace bpo = boost::program_options;
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      bpo::options_description cli_options("Converts the blocks of a block database into a compressed block log");
+      cli_options.add_options()
+            ("help,h", "Print this help message and exit.")
+            ("input,i", bpo::value<boost::filesystem::path>(),
+             "Block database directory to read from, i.e. <data-dir>/blockchain/database/block_num_to_block")
+            ("output,o", bpo::value<boost::filesystem::path>(), "New directory to write the converted block database to")
+            ("compression,c", bpo::value<std::string>()->default_value("zlib"), "Compression method: none, zlib or zstd")
+            ("chunk-size", bpo::value<uint32_t>()->default_value(block_log_writer::default_chunk_size),
+             "Uncompressed size of the chunks in the block log, in bytes")
+            ("archive-up-to", bpo::value<uint32_t>(),
+             "Number of the last block to put into the block log, all later blocks are copied to the output as they are. "
+             "Defaults to the last block of the input.")
+            ;
+
+      bpo::variables_map options;
+      try
+      {
+         bpo::store( bpo::parse_command_line(argc, argv, cli_options), options );
+      }
+      catch (const bpo::error& e)
+      {
+         std::cerr << "block_log_converter:  error parsing command line: " << e.what() << "\n";
+         return 1;
+      }
+
+      if( options.count("help") || !options.count("input") || !options.count("output") )
+      {
+         std::cout << cli_options << "\n";
+         return 1;
+      }
+
+      const fc::path input_dir = options["input"].as<boost::filesystem::path>();
+      const fc::path output_dir = options["output"].as<boost::filesystem::path>();
+      if( fc::exists( output_dir ) )
+      {
+         std::cerr << "Output directory " << output_dir.preferred_string() << " already exists\n";
+         return 1;
+      }
+      const auto compression = fc::reflector<block_log_compression>::from_string(
+                                     options["compression"].as<std::string>().c_str() );
+      if( !is_block_log_compression_supported( compression ) )
+      {
+         std::cerr << "Compression " << options["compression"].as<std::string>() << " is not supported by this build\n";
+         return 1;
+      }
+
+      block_database input;
+      input.open( input_dir );
+      const fc::optional<block_id_type> last_id = input.last_id();
+      if( !last_id.valid() )
+      {
+         std::cerr << "No blocks found in " << input_dir.preferred_string() << "\n";
+         return 1;
+      }
+      const uint32_t last_block_num = block_header::num_from_id( *last_id );
+      const uint32_t archive_up_to = options.count("archive-up-to") ?
+                                     std::min( options["archive-up-to"].as<uint32_t>(), last_block_num ) : last_block_num;
+
+      fc::create_directories( output_dir );
+      block_log_writer log( output_dir / "block_log", compression, options["chunk-size"].as<uint32_t>() );
+      for( uint32_t num = 1; num <= archive_up_to; ++num )
+      {
+         fc::optional<vector<char>> packed = input.fetch_packed_optional( input.fetch_block_id( num ) );
+         FC_ASSERT( packed.valid(), "Block ${n} is missing in the input", ("n",num) );
+         log.append_packed( num, *packed );
+         if( num % 100000 == 0 )
+            std::cerr << "Archived " << num << " of " << archive_up_to << " blocks\n";
+      }
+      log.close();
+
+      if( archive_up_to < last_block_num )
+      {
+         block_database output;
+         output.open( output_dir );
+         for( uint32_t num = archive_up_to + 1; num <= last_block_num; ++num )
+         {
+            fc::optional<signed_block> block = input.fetch_by_number( num );
+            FC_ASSERT( block.valid(), "Block ${n} is missing in the input", ("n",num) );
+            output.store( block->id(), *block );
+         }
+         output.close();
+      }
+      input.close();
+
+      const uint64_t input_size = fc::file_size( input_dir / "blocks" ) + fc::file_size( input_dir / "index" );
+      const uint64_t log_size = fc::file_size( output_dir / "block_log" );
+      std::cerr << "Archived " << archive_up_to << " blocks, " << input_size << " bytes of block database "
+                << "became a block log of " << log_size << " bytes\n";
+   }
+   catch ( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
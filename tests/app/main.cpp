@@ -385,6 +385,303 @@ BOOST_AUTO_TEST_CASE( two_node_network )
    }
 }
 
+BOOST_AUTO_TEST_CASE( compact_block_relay )
+{
+   using namespace graphene::chain;
+   using namespace graphene::app;
+   try {
+      BOOST_TEST_MESSAGE( "Creating and initializing app1" );
+
+      auto port = fc::network::get_available_port();
+      auto app1_p2p_endpoint_str = string("127.0.0.1:") + std::to_string(port);
+      auto seed_nodes_str = string("[\"") + app1_p2p_endpoint_str + "\"]";
+
+      fc::temp_directory app_dir( graphene::utilities::temp_directory_path() );
+      auto genesis_file = create_genesis_file(app_dir);
+
+      graphene::app::application app1;
+      app1.register_plugin< graphene::witness_plugin::witness_plugin >();
+      auto sharable_cfg = std::make_shared<boost::program_options::variables_map>();
+      auto& cfg = *sharable_cfg;
+      fc::set_option( cfg, "p2p-endpoint", app1_p2p_endpoint_str );
+      fc::set_option( cfg, "genesis-json", genesis_file );
+      fc::set_option( cfg, "seed-nodes", string("[]") );
+      app1.initialize(app_dir.path(), sharable_cfg);
+      app1.startup();
+
+      auto node_startup_wait_time = fc::seconds(15);
+
+      fc::wait_for( node_startup_wait_time, [&app1,port] () {
+         const auto status = app1.p2p_node()->network_get_info();
+         return status["listening_on"].as<fc::ip::endpoint>( 5 ).port() == port;
+      });
+
+      BOOST_TEST_MESSAGE( "Creating and initializing app2 and app3" );
+
+      fc::temp_directory app2_dir( graphene::utilities::temp_directory_path() );
+      graphene::app::application app2;
+      app2.register_plugin< graphene::witness_plugin::witness_plugin >();
+      auto sharable_cfg2 = std::make_shared<boost::program_options::variables_map>();
+      fc::set_option( *sharable_cfg2, "genesis-json", genesis_file );
+      fc::set_option( *sharable_cfg2, "seed-nodes", seed_nodes_str );
+      app2.initialize(app2_dir.path(), sharable_cfg2);
+      app2.startup();
+
+      fc::temp_directory app3_dir( graphene::utilities::temp_directory_path() );
+      graphene::app::application app3;
+      app3.register_plugin< graphene::witness_plugin::witness_plugin >();
+      auto sharable_cfg3 = std::make_shared<boost::program_options::variables_map>();
+      fc::set_option( *sharable_cfg3, "genesis-json", genesis_file );
+      fc::set_option( *sharable_cfg3, "seed-nodes", seed_nodes_str );
+      app3.initialize(app3_dir.path(), sharable_cfg3);
+      app3.startup();
+
+      fc::wait_for( node_startup_wait_time, [&app1] () {
+         if( app1.p2p_node()->get_connection_count() < 2 )
+            return false;
+         for( const auto& peer : app1.p2p_node()->get_connected_peers() )
+         {
+            auto itr = peer.info.find( "peer_needs_sync_items_from_us" );
+            if( itr == peer.info.end() || itr->value().as<bool>(1) )
+               return false;
+         }
+         return true;
+      });
+
+      BOOST_REQUIRE_EQUAL( app1.p2p_node()->get_connection_count(), 2u );
+      for( const auto& peer : app1.p2p_node()->get_connected_peers() )
+         BOOST_CHECK( peer.info["supports_compact_blocks"].as<bool>(1) );
+
+      std::shared_ptr<chain::database> db1 = app1.chain_database();
+      std::shared_ptr<chain::database> db2 = app2.chain_database();
+      std::shared_ptr<chain::database> db3 = app3.chain_database();
+
+      auto bytes_sent_by_app1 = [&app1] () {
+         uint64_t bytes_sent = 0;
+         for( const auto& peer : app1.p2p_node()->get_connected_peers() )
+            bytes_sent += peer.info["bytessent"].as<uint64_t>(1);
+         return bytes_sent;
+      };
+
+      account_id_type nathan_id = db1->get_index_type<account_index>().indices().get<by_name>().find( "nathan" )->id;
+      fc::ecc::private_key nathan_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("nathan")));
+      auto make_transfer = [&] ( int64_t amount ) {
+         graphene::chain::precomputable_transaction trx;
+         transfer_operation xfer_op;
+         xfer_op.from = nathan_id;
+         xfer_op.to = GRAPHENE_NULL_ACCOUNT;
+         xfer_op.amount = asset( amount );
+         trx.operations.push_back( xfer_op );
+         db1->current_fee_schedule().set_fee( trx.operations.back() );
+         trx.set_expiration( db1->get_slot_time( 10 ) );
+         trx.sign( nathan_key, db1->get_chain_id() );
+         trx.validate();
+         return trx;
+      };
+
+      {
+         graphene::chain::precomputable_transaction trx;
+         balance_claim_operation claim_op;
+         balance_id_type bid = balance_id_type();
+         claim_op.deposit_to_account = nathan_id;
+         claim_op.balance_to_claim = bid;
+         claim_op.balance_owner_key = nathan_key.get_public_key();
+         claim_op.total_claimed = bid(*db1).balance;
+         trx.operations.push_back( claim_op );
+         db1->current_fee_schedule().set_fee( trx.operations.back() );
+         trx.set_expiration( db1->get_slot_time( 10 ) );
+         trx.sign( nathan_key, db1->get_chain_id() );
+         trx.validate();
+         db1->push_transaction( trx );
+         app1.p2p_node()->broadcast( graphene::net::trx_message( trx ) );
+      }
+
+      BOOST_TEST_MESSAGE( "Broadcasting transfers" );
+      const int64_t num_transfers = 100;
+      int64_t transferred = 0;
+      for( int64_t i = 1; i <= num_transfers; ++i )
+      {
+         auto trx = make_transfer( i );
+         db1->push_transaction( trx );
+         app1.p2p_node()->broadcast( graphene::net::trx_message( trx ) );
+         transferred += i;
+      }
+
+      auto broadcast_wait_time = fc::seconds(15);
+      fc::wait_for( broadcast_wait_time, [db2,db3,transferred] () {
+         return db2->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value == transferred
+             && db3->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value == transferred;
+      });
+      BOOST_REQUIRE_EQUAL( db2->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, transferred );
+      BOOST_REQUIRE_EQUAL( db3->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, transferred );
+
+      fc::ecc::private_key committee_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("nathan")));
+      auto generate_and_broadcast_block = [&] () {
+         // the other nodes will reject the block if its timestamp is in the future, so we wait
+         fc::wait_for( broadcast_wait_time, [db1] () {
+            return db1->get_slot_time(1) <= fc::time_point::now();
+         });
+         auto block = db1->generate_block(
+            db1->get_slot_time(1),
+            db1->get_scheduled_witness(1),
+            committee_key,
+            database::skip_nothing);
+
+         uint64_t bytes_sent_before = bytes_sent_by_app1();
+         fc::time_point start = fc::time_point::now();
+         app1.p2p_node()->broadcast( graphene::net::block_message( block ) );
+         fc::wait_for( broadcast_wait_time, [db2,db3,&block] () {
+            return db2->head_block_id() == block.id() && db3->head_block_id() == block.id();
+         });
+         BOOST_TEST_MESSAGE( "Block " << block.block_num() << " with " << block.transactions.size()
+                             << " transactions of " << fc::raw::pack_size( block ) << " bytes reached all nodes in "
+                             << ( fc::time_point::now() - start ).count() << " us, app1 sent "
+                             << ( bytes_sent_by_app1() - bytes_sent_before ) << " bytes" );
+         BOOST_CHECK( db2->head_block_id() == block.id() );
+         BOOST_CHECK( db3->head_block_id() == block.id() );
+         // each peer got a compact block, which is much smaller than the block
+         BOOST_CHECK_LT( bytes_sent_by_app1() - bytes_sent_before, fc::raw::pack_size( block ) );
+      };
+
+      BOOST_TEST_MESSAGE( "Relaying a block whose transactions are known to all nodes" );
+      generate_and_broadcast_block();
+
+      BOOST_TEST_MESSAGE( "Relaying a block with a transaction the other nodes have to fetch" );
+      for( int64_t i = 1; i <= num_transfers; ++i )
+      {
+         auto trx = make_transfer( num_transfers + i );
+         db1->push_transaction( trx );
+         if( i != num_transfers / 2 )
+            app1.p2p_node()->broadcast( graphene::net::trx_message( trx ) );
+         transferred += num_transfers + i;
+      }
+      fc::wait_for( broadcast_wait_time, [db2,db3,transferred,num_transfers] () {
+         return db2->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value
+                   == transferred - num_transfers - num_transfers / 2
+             && db3->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value
+                   == transferred - num_transfers - num_transfers / 2;
+      });
+      generate_and_broadcast_block();
+
+      BOOST_CHECK_EQUAL( db2->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, transferred );
+      BOOST_CHECK_EQUAL( db3->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value, transferred );
+      BOOST_CHECK_EQUAL( app1.p2p_node()->get_connection_count(), 2u );
+
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+/////////////
+/// @brief transactions from the network are pushed in batches, when a batch is full or the oldest one waited long enough
+/////////////
+BOOST_AUTO_TEST_CASE( ingress_transaction_batches )
+{
+   using namespace graphene::chain;
+   using namespace graphene::app;
+   try {
+      BOOST_TEST_MESSAGE( "Creating and initializing app1, which batches the transactions it receives" );
+
+      auto port = fc::network::get_available_port();
+      auto app1_p2p_endpoint_str = string("127.0.0.1:") + std::to_string(port);
+      auto seed_nodes_str = string("[\"") + app1_p2p_endpoint_str + "\"]";
+
+      fc::temp_directory app_dir( graphene::utilities::temp_directory_path() );
+      auto genesis_file = create_genesis_file(app_dir);
+
+      graphene::app::application app1;
+      auto sharable_cfg = std::make_shared<boost::program_options::variables_map>();
+      auto& cfg = *sharable_cfg;
+      fc::set_option( cfg, "p2p-endpoint", app1_p2p_endpoint_str );
+      fc::set_option( cfg, "genesis-json", genesis_file );
+      fc::set_option( cfg, "seed-nodes", string("[]") );
+      fc::set_option( cfg, "transaction-ingress-batch-size", uint32_t(3) );
+      fc::set_option( cfg, "transaction-ingress-max-delay-ms", uint32_t(3000) );
+      app1.initialize(app_dir.path(), sharable_cfg);
+      app1.startup();
+
+      auto node_startup_wait_time = fc::seconds(15);
+
+      fc::wait_for( node_startup_wait_time, [&app1,port] () {
+         const auto status = app1.p2p_node()->network_get_info();
+         return status["listening_on"].as<fc::ip::endpoint>( 5 ).port() == port;
+      });
+
+      // a peer handles the transactions of another peer one after another, so a batch is filled by several peers
+      BOOST_TEST_MESSAGE( "Creating and initializing the peers which send transactions" );
+      const size_t num_senders = 3;
+      std::vector< std::unique_ptr<fc::temp_directory> > sender_dirs;
+      std::vector< std::unique_ptr<graphene::app::application> > senders;
+      for( size_t i = 0; i < num_senders; ++i )
+      {
+         sender_dirs.push_back( std::make_unique<fc::temp_directory>( graphene::utilities::temp_directory_path() ) );
+         senders.push_back( std::make_unique<graphene::app::application>() );
+         auto sender_cfg = std::make_shared<boost::program_options::variables_map>();
+         fc::set_option( *sender_cfg, "genesis-json", genesis_file );
+         fc::set_option( *sender_cfg, "seed-nodes", seed_nodes_str );
+         senders.back()->initialize( sender_dirs.back()->path(), sender_cfg );
+         senders.back()->startup();
+      }
+
+      fc::wait_for( node_startup_wait_time, [&app1,num_senders] () {
+         return app1.p2p_node()->get_connection_count() >= num_senders;
+      });
+
+      std::shared_ptr<chain::database> db = app1.chain_database();
+      account_id_type nathan_id = db->get_index_type<account_index>().indices().get<by_name>().find( "nathan" )->id;
+      fc::ecc::private_key nathan_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("nathan")));
+      {
+         signed_transaction trx;
+         balance_claim_operation claim_op;
+         balance_id_type bid = balance_id_type();
+         claim_op.deposit_to_account = nathan_id;
+         claim_op.balance_to_claim = bid;
+         claim_op.balance_owner_key = nathan_key.get_public_key();
+         claim_op.total_claimed = bid(*db).balance;
+         trx.operations.push_back( claim_op );
+         db->current_fee_schedule().set_fee( trx.operations.back() );
+         trx.set_expiration( db->get_slot_time( 10 ) );
+         trx.sign( nathan_key, db->get_chain_id() );
+         db->push_transaction( trx );
+      }
+
+      // transfers of different amounts, so that the transactions differ
+      auto transfer = [&]( int64_t amount ) {
+         signed_transaction trx;
+         transfer_operation xfer_op;
+         xfer_op.from = nathan_id;
+         xfer_op.to = GRAPHENE_NULL_ACCOUNT;
+         xfer_op.amount = asset( amount );
+         trx.operations.push_back( xfer_op );
+         db->current_fee_schedule().set_fee( trx.operations.back() );
+         trx.set_expiration( db->get_slot_time( 10 ) );
+         trx.sign( nathan_key, db->get_chain_id() );
+         return graphene::net::trx_message( trx );
+      };
+      auto null_balance = [db]() {
+         return db->get_balance( GRAPHENE_NULL_ACCOUNT, asset_id_type() ).amount.value;
+      };
+
+      BOOST_TEST_MESSAGE( "A full batch is pushed right away" );
+      auto start = fc::time_point::now();
+      for( size_t i = 0; i < num_senders; ++i )
+         senders[i]->p2p_node()->broadcast( transfer( i + 1 ) );
+      fc::wait_for( fc::seconds(15), [&null_balance]() { return null_balance() == 6; } );
+      BOOST_CHECK( fc::time_point::now() - start < fc::seconds(3) );
+
+      BOOST_TEST_MESSAGE( "A batch which does not fill up is pushed after the maximum delay" );
+      start = fc::time_point::now();
+      senders[0]->p2p_node()->broadcast( transfer( 4 ) );
+      fc::wait_for( fc::seconds(15), [&null_balance]() { return null_balance() == 10; } );
+      BOOST_CHECK( fc::time_point::now() - start >= fc::seconds(3) );
+
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 // a contrived example to test the breaking out of application_impl to a header file
 BOOST_AUTO_TEST_CASE(application_impl_breakout) {
 
@@ -746,6 +746,91 @@ BOOST_FIXTURE_TEST_CASE(cli_sign_tx_with_unnecessary_signature, cli_fixture) {
 }
 
 
+///////////////////////
+// Wallet RPC
+// Test signing and broadcasting a batch of transactions, and compare the result
+// with signing and broadcasting them one by one
+///////////////////////
+BOOST_FIXTURE_TEST_CASE(cli_sign_transactions_batch, cli_fixture) {
+   try {
+      auto db = app1->chain_database();
+
+      INVOKE(upgrade_nathan_account);
+      account_object nathan_acct = con.wallet_api_ptr->get_account("nathan");
+
+      const auto charlie_bki = con.wallet_api_ptr->suggest_brain_key();
+      con.wallet_api_ptr->register_account(
+              "charlie", charlie_bki.pub_key, charlie_bki.pub_key, "nathan", "nathan", 0, true
+      );
+      const account_object charlie_acc = con.wallet_api_ptr->get_account("charlie");
+
+      const uint32_t num_transfers = 200;
+      auto make_transfers = [&]() {
+         vector<signed_transaction> txs;
+         for( uint32_t i = 0; i < num_transfers; ++i )
+         {
+            transfer_operation top;
+            top.from = nathan_acct.id;
+            top.to = charlie_acc.id;
+            top.amount = asset(1);
+            top.fee = db->current_fee_schedule().calculate_fee(top);
+            txs.emplace_back();
+            txs.back().operations.push_back(top);
+         }
+         return txs;
+      };
+
+      BOOST_TEST_MESSAGE("Signing and broadcasting transfers one by one");
+      vector<signed_transaction> one_by_one = make_transfers();
+      for( signed_transaction& tx : one_by_one )
+         tx = con.wallet_api_ptr->sign_transaction(tx, true);
+      BOOST_CHECK_EQUAL( db->get_balance(charlie_acc.id, asset_id_type()).amount.value, int64_t(num_transfers) );
+
+      BOOST_TEST_MESSAGE("Signing and broadcasting transfers as a batch");
+      vector<signed_transaction> batch = make_transfers();
+      batch = con.wallet_api_ptr->sign_transactions(batch, true);
+      BOOST_CHECK_EQUAL( db->get_balance(charlie_acc.id, asset_id_type()).amount.value, int64_t(2 * num_transfers) );
+
+      // the identical transfers got distinct ids, and each is signed by nathan
+      flat_set<transaction_id_type> ids;
+      for( const signed_transaction& tx : batch )
+      {
+         ids.insert( tx.id() );
+         BOOST_CHECK_EQUAL( tx.signatures.size(), 1u );
+      }
+      for( const signed_transaction& tx : one_by_one )
+         ids.insert( tx.id() );
+      BOOST_CHECK_EQUAL( ids.size(), 2 * num_transfers );
+
+      // broadcasting the same transactions again is refused
+      BOOST_CHECK_THROW( con.wallet_api_ptr->broadcast_transactions(batch), fc::exception );
+
+      BOOST_TEST_MESSAGE("Broadcasting a batch in which a transaction depends on the one before it");
+      BOOST_CHECK(con.wallet_api_ptr->import_key("charlie", charlie_bki.wif_priv_key));
+      vector<signed_transaction> dependent(2);
+      transfer_operation to_charlie;
+      to_charlie.from = nathan_acct.id;
+      to_charlie.to = charlie_acc.id;
+      to_charlie.amount = asset(1000000);
+      to_charlie.fee = db->current_fee_schedule().calculate_fee(to_charlie);
+      dependent[0].operations.push_back(to_charlie);
+      // charlie can only pay this with the funds of the first transfer
+      transfer_operation to_nathan;
+      to_nathan.from = charlie_acc.id;
+      to_nathan.to = nathan_acct.id;
+      to_nathan.amount = asset(500000);
+      to_nathan.fee = db->current_fee_schedule().calculate_fee(to_nathan);
+      dependent[1].operations.push_back(to_nathan);
+      const share_type charlie_balance = db->get_balance(charlie_acc.id, asset_id_type()).amount;
+      con.wallet_api_ptr->sign_transactions(dependent, true);
+      BOOST_CHECK_EQUAL( db->get_balance(charlie_acc.id, asset_id_type()).amount.value,
+                         ( charlie_balance + 500000 - to_nathan.fee.amount ).value );
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 ///////////////////////
 // Wallet RPC
 // Test adding an unnecessary signature to a transaction builder
@@ -339,7 +339,8 @@ std::shared_ptr<boost::program_options::variables_map> database_fixture_base::in
    else if( fixture.current_suite_name == "content_cards_tests" ) {
       // fixture.app.register_plugin<graphene::content_cards::content_cards_plugin>(true);
    }
-   else if( fixture.current_suite_name != "performance_tests" )
+   // the snapshot tests compare the state with a database which has no plugins
+   else if( fixture.current_suite_name != "performance_tests" && fixture.current_suite_name != "snapshot_tests" )
    {
       fixture.app.register_plugin<graphene::account_history::account_history_plugin>(true);
    }
@@ -27,8 +27,17 @@
 #include <fc/crypto/digest.hpp>
 
 #include <graphene/utilities/elasticsearch.hpp>
+#include <graphene/utilities/es_bulk_exporter.hpp>
 #include <graphene/elasticsearch/elasticsearch_plugin.hpp>
 
+#include <boost/asio.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "../common/init_unit_test_suite.hpp"
 
 #include "../common/database_fixture.hpp"
@@ -228,3 +237,422 @@ BOOST_AUTO_TEST_CASE(elasticsearch_suite) {
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+namespace {
+
+/**
+ * A minimal HTTP server standing in for Elasticsearch. Requests are answered one at a time with the scripted
+ * status codes, then with 200. While the server is held, requests are received but not answered.
+ */
+class stub_es_server
+{
+   public:
+      explicit stub_es_server( std::vector<int> script = {} )
+      : _script( std::move(script) ),
+        _acceptor( _io, boost::asio::ip::tcp::endpoint( boost::asio::ip::address_v4::loopback(), 0 ) )
+      {
+         _thread = std::thread( [this]() { run(); } );
+      }
+
+      ~stub_es_server()
+      {
+         {
+            std::lock_guard<std::mutex> lock( _mtx );
+            _stopping = true;
+            _held = false;
+            _cv.notify_all();
+         }
+         // wake up the acceptor
+         boost::asio::io_service io;
+         boost::asio::ip::tcp::socket socket( io );
+         boost::system::error_code ec;
+         socket.connect( _acceptor.local_endpoint(), ec );
+         _thread.join();
+      }
+
+      std::string url()const
+      {
+         return "http://127.0.0.1:" + std::to_string( _acceptor.local_endpoint().port() ) + "/";
+      }
+
+      void hold( bool held )
+      {
+         std::lock_guard<std::mutex> lock( _mtx );
+         _held = held;
+         _cv.notify_all();
+      }
+
+      /// @return the number of requests received so far
+      uint32_t received()const
+      {
+         std::lock_guard<std::mutex> lock( _mtx );
+         return _received;
+      }
+
+      /// @return the bodies of the requests which were answered with 200, in the order they were received
+      std::vector<std::string> accepted()const
+      {
+         std::lock_guard<std::mutex> lock( _mtx );
+         return _accepted;
+      }
+
+   private:
+      void run()
+      {
+         while( true )
+         {
+            boost::asio::ip::tcp::socket socket( _io );
+            boost::system::error_code ec;
+            _acceptor.accept( socket, ec );
+            {
+               std::lock_guard<std::mutex> lock( _mtx );
+               if( _stopping )
+                  break;
+            }
+            if( ec )
+               continue;
+            try
+            {
+               handle( socket );
+            }
+            catch( const std::exception& ) {} // the client gave up
+         }
+      }
+
+      void handle( boost::asio::ip::tcp::socket& socket )
+      {
+         boost::asio::streambuf buffer;
+         const size_t header_size = boost::asio::read_until( socket, buffer, "\r\n\r\n" );
+         std::string headers( boost::asio::buffers_begin( buffer.data() ),
+                              boost::asio::buffers_begin( buffer.data() ) + header_size );
+         buffer.consume( header_size );
+         std::transform( headers.begin(), headers.end(), headers.begin(), ::tolower );
+
+         size_t content_length = 0;
+         const auto pos = headers.find( "content-length:" );
+         if( pos != std::string::npos )
+            content_length = std::stoul( headers.substr( pos + 15 ) );
+         if( headers.find( "expect: 100-continue" ) != std::string::npos )
+            boost::asio::write( socket, boost::asio::buffer( std::string( "HTTP/1.1 100 Continue\r\n\r\n" ) ) );
+         if( buffer.size() < content_length )
+            boost::asio::read( socket, buffer, boost::asio::transfer_exactly( content_length - buffer.size() ) );
+         std::string body( boost::asio::buffers_begin( buffer.data() ),
+                           boost::asio::buffers_begin( buffer.data() ) + content_length );
+
+         int status = 200;
+         {
+            std::unique_lock<std::mutex> lock( _mtx );
+            ++_received;
+            _cv.wait( lock, [this]() { return !_held; } );
+            if( _stopping )
+               return;
+            if( _next < _script.size() )
+               status = _script[_next++];
+            if( status == 200 )
+               _accepted.push_back( body );
+         }
+
+         const std::string content = ( status == 200 ? R"({"errors":false})" : R"({"error":"stub"})" );
+         const std::string response = "HTTP/1.1 " + std::to_string( status ) + " Stub\r\n"
+                                      "Content-Type: application/json\r\n"
+                                      "Content-Length: " + std::to_string( content.size() ) + "\r\n"
+                                      "Connection: close\r\n\r\n" + content;
+         boost::asio::write( socket, boost::asio::buffer( response ) );
+         boost::system::error_code ec;
+         socket.shutdown( boost::asio::ip::tcp::socket::shutdown_both, ec );
+      }
+
+      std::vector<int>                 _script;
+      size_t                           _next = 0;
+      boost::asio::io_service          _io;
+      boost::asio::ip::tcp::acceptor   _acceptor;
+      std::thread                      _thread;
+      mutable std::mutex               _mtx;
+      std::condition_variable          _cv;
+      bool                             _held = false;
+      bool                             _stopping = false;
+      uint32_t                         _received = 0;
+      std::vector<std::string>         _accepted;
+};
+
+template<typename Condition>
+bool wait_until( Condition condition, fc::microseconds timeout = fc::seconds(10) )
+{
+   const auto until = fc::time_point::now() + timeout;
+   while( !condition() )
+   {
+      if( fc::time_point::now() > until )
+         return false;
+      std::this_thread::sleep_for( std::chrono::milliseconds(5) );
+   }
+   return true;
+}
+
+graphene::utilities::es_bulk_exporter::options exporter_options( const stub_es_server& server )
+{
+   graphene::utilities::es_bulk_exporter::options opts;
+   opts.elasticsearch_url = server.url();
+   opts.min_retry_delay = fc::milliseconds(10);
+   opts.max_retry_delay = fc::milliseconds(40);
+   return opts;
+}
+
+size_t count_bulk_files( const fc::path& dir )
+{
+   size_t count = 0;
+   for( fc::directory_iterator itr( dir ), end; itr != end; ++itr )
+      if( (*itr).extension() == ".bulk" )
+         ++count;
+   return count;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE( es_bulk_exporter_tests )
+
+BOOST_AUTO_TEST_CASE( retry_failed_bulk_requests )
+{ try {
+   stub_es_server server( { 500, 503, 200 } );
+   auto opts = exporter_options( server );
+   opts.max_in_flight = 1;
+   graphene::utilities::es_bulk_exporter exporter( opts );
+
+   exporter.send( 1, 2, { "a", "b" } );
+   exporter.send( 3, 3, { "c" } );
+   BOOST_REQUIRE( exporter.flush( fc::seconds(10) ) );
+
+   BOOST_CHECK_EQUAL( server.received(), 4u );
+   BOOST_REQUIRE_EQUAL( server.accepted().size(), 2u );
+   BOOST_CHECK_EQUAL( server.accepted()[0], "a\nb\n" );
+   BOOST_CHECK_EQUAL( server.accepted()[1], "c\n" );
+
+   const auto metrics = exporter.get_metrics();
+   BOOST_CHECK_EQUAL( metrics.failed_requests, 2u );
+   BOOST_CHECK_EQUAL( metrics.sent_batches, 2u );
+   BOOST_CHECK_EQUAL( metrics.queued_batches, 0u );
+   BOOST_CHECK_EQUAL( metrics.last_exported_block, 3u );
+   BOOST_CHECK_EQUAL( metrics.lag_blocks, 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( set_aside_rejected_bulk_requests )
+{ try {
+   fc::temp_directory spill_dir( graphene::utilities::temp_directory_path() );
+   stub_es_server server( { 400, 200 } );
+   auto opts = exporter_options( server );
+   opts.max_in_flight = 1;
+   opts.spill_directory = spill_dir.path();
+   graphene::utilities::es_bulk_exporter exporter( opts );
+
+   // the first batch is not retried and does not hold up the second one
+   exporter.send( 1, 2, { "a" } );
+   exporter.send( 3, 3, { "b" } );
+   BOOST_REQUIRE( exporter.flush( fc::seconds(10) ) );
+
+   BOOST_CHECK_EQUAL( server.received(), 2u );
+   BOOST_REQUIRE_EQUAL( server.accepted().size(), 1u );
+   BOOST_CHECK_EQUAL( server.accepted()[0], "b\n" );
+
+   const auto metrics = exporter.get_metrics();
+   BOOST_CHECK_EQUAL( metrics.failed_requests, 1u );
+   BOOST_CHECK_EQUAL( metrics.sent_batches, 1u );
+   BOOST_CHECK_EQUAL( metrics.dropped_batches, 1u );
+   BOOST_CHECK_EQUAL( metrics.last_exported_block, 3u );
+   BOOST_CHECK_EQUAL( count_bulk_files( spill_dir.path() ), 0u );
+   BOOST_CHECK_EQUAL( count_bulk_files( spill_dir.path() / "failed" ), 1u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( give_up_after_max_retries )
+{ try {
+   fc::temp_directory spill_dir( graphene::utilities::temp_directory_path() );
+   stub_es_server server( { 503, 503, 503 } );
+   auto opts = exporter_options( server );
+   opts.max_in_flight = 1;
+   opts.max_retries = 2;
+   opts.spill_directory = spill_dir.path();
+   graphene::utilities::es_bulk_exporter exporter( opts );
+
+   exporter.send( 1, 1, { "a" } );
+   BOOST_REQUIRE( exporter.flush( fc::seconds(10) ) );
+   BOOST_CHECK_EQUAL( server.received(), 3u );
+   BOOST_CHECK( server.accepted().empty() );
+
+   exporter.send( 2, 2, { "b" } );
+   BOOST_REQUIRE( exporter.flush( fc::seconds(10) ) );
+   BOOST_REQUIRE_EQUAL( server.accepted().size(), 1u );
+   BOOST_CHECK_EQUAL( server.accepted()[0], "b\n" );
+
+   const auto metrics = exporter.get_metrics();
+   BOOST_CHECK_EQUAL( metrics.failed_requests, 3u );
+   BOOST_CHECK_EQUAL( metrics.dropped_batches, 1u );
+   BOOST_CHECK_EQUAL( metrics.sent_batches, 1u );
+   BOOST_CHECK_EQUAL( metrics.last_exported_block, 2u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( keep_retrying_without_spill_directory )
+{ try {
+   stub_es_server server( { 503, 503, 503, 400, 200 } );
+   auto opts = exporter_options( server );
+   opts.max_in_flight = 1;
+   opts.max_retries = 2;
+   graphene::utilities::es_bulk_exporter exporter( opts );
+
+   // there is nowhere to put the batch aside, so neither the retry limit nor a rejection gives it up
+   exporter.send( 1, 1, { "a" } );
+   BOOST_REQUIRE( exporter.flush( fc::seconds(10) ) );
+   BOOST_CHECK_EQUAL( server.received(), 5u );
+   BOOST_REQUIRE_EQUAL( server.accepted().size(), 1u );
+   BOOST_CHECK_EQUAL( server.accepted()[0], "a\n" );
+
+   const auto metrics = exporter.get_metrics();
+   BOOST_CHECK_EQUAL( metrics.failed_requests, 4u );
+   BOOST_CHECK_EQUAL( metrics.dropped_batches, 0u );
+   BOOST_CHECK_EQUAL( metrics.sent_batches, 1u );
+   BOOST_CHECK_EQUAL( metrics.last_exported_block, 1u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( close_sends_everything_without_spill_directory )
+{ try {
+   stub_es_server server;
+   auto opts = exporter_options( server );
+   opts.max_in_flight = 1;
+   graphene::utilities::es_bulk_exporter exporter( opts );
+
+   server.hold( true );
+   exporter.send( 1, 1, { "a" } );
+   exporter.send( 2, 2, { "b" } );
+
+   std::atomic<bool> closed( false );
+   std::thread closer( [&]() {
+      exporter.close( fc::milliseconds(50) );
+      closed = true;
+   } );
+   std::this_thread::sleep_for( std::chrono::milliseconds(200) );
+   BOOST_CHECK( !closed );
+
+   server.hold( false );
+   closer.join();
+   BOOST_CHECK( closed );
+   const auto accepted = server.accepted();
+   BOOST_REQUIRE_EQUAL( accepted.size(), 2u );
+   BOOST_CHECK_EQUAL( accepted[0], "a\n" );
+   BOOST_CHECK_EQUAL( accepted[1], "b\n" );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( queue_depth_lag_and_reindexing_order )
+{ try {
+   stub_es_server server;
+   auto opts = exporter_options( server );
+   opts.max_in_flight = 2;
+   graphene::utilities::es_bulk_exporter exporter( opts );
+
+   server.hold( true );
+   exporter.send( 101, 102, { "a" } );
+   exporter.send( 103, 103, { "b" } );
+   exporter.send( 104, 105, { "c" } );
+   exporter.send( 106, 106, {} );
+   BOOST_REQUIRE( wait_until( [&]() { return exporter.get_metrics().in_flight == 2; } ) );
+
+   auto metrics = exporter.get_metrics();
+   BOOST_CHECK_EQUAL( metrics.queued_batches, 3u );
+   BOOST_CHECK_EQUAL( metrics.last_queued_block, 106u );
+   BOOST_CHECK_EQUAL( metrics.last_exported_block, 100u );
+   BOOST_CHECK_EQUAL( metrics.lag_blocks, 6u );
+
+   server.hold( false );
+   BOOST_REQUIRE( exporter.flush( fc::seconds(10) ) );
+   metrics = exporter.get_metrics();
+   BOOST_CHECK_EQUAL( metrics.sent_batches, 3u );
+   BOOST_CHECK_EQUAL( metrics.last_exported_block, 106u );
+   BOOST_CHECK_EQUAL( metrics.lag_blocks, 0u );
+
+   // block 107 is reindexed after a chain reorganization, the second batch must wait for the first one
+   server.hold( true );
+   exporter.send( 107, 107, { "d" } );
+   exporter.send( 107, 108, { "e" } );
+   BOOST_REQUIRE( wait_until( [&]() { return server.received() == 4; } ) );
+   std::this_thread::sleep_for( std::chrono::milliseconds(100) );
+   metrics = exporter.get_metrics();
+   BOOST_CHECK_EQUAL( metrics.in_flight, 1u );
+   BOOST_CHECK_EQUAL( metrics.queued_batches, 2u );
+
+   server.hold( false );
+   BOOST_REQUIRE( exporter.flush( fc::seconds(10) ) );
+   const auto accepted = server.accepted();
+   BOOST_REQUIRE_EQUAL( accepted.size(), 5u );
+   BOOST_CHECK_EQUAL( accepted[3], "d\n" );
+   BOOST_CHECK_EQUAL( accepted[4], "e\n" );
+   BOOST_CHECK_EQUAL( exporter.get_metrics().last_exported_block, 108u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_when_queue_is_full )
+{ try {
+   stub_es_server server;
+   auto opts = exporter_options( server );
+   opts.max_in_flight = 1;
+   opts.max_queued_batches = 1;
+   graphene::utilities::es_bulk_exporter exporter( opts );
+
+   server.hold( true );
+   exporter.send( 1, 1, { "a" } );
+
+   std::atomic<bool> returned( false );
+   std::thread producer( [&]() {
+      exporter.send( 2, 2, { "b" } );
+      returned = true;
+   } );
+   std::this_thread::sleep_for( std::chrono::milliseconds(200) );
+   BOOST_CHECK( !returned );
+   BOOST_CHECK_EQUAL( exporter.get_metrics().queued_batches, 1u );
+
+   server.hold( false );
+   producer.join();
+   BOOST_CHECK( returned );
+   BOOST_REQUIRE( exporter.flush( fc::seconds(10) ) );
+   BOOST_CHECK_EQUAL( server.accepted().size(), 2u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( spill_when_queue_is_full )
+{ try {
+   fc::temp_directory spill_dir( graphene::utilities::temp_directory_path() );
+   {
+      stub_es_server server;
+      auto opts = exporter_options( server );
+      opts.max_in_flight = 1;
+      opts.max_queued_batches = 1;
+      opts.spill_directory = spill_dir.path();
+      opts.request_timeout = fc::milliseconds(300);
+      graphene::utilities::es_bulk_exporter exporter( opts );
+
+      server.hold( true );
+      exporter.send( 1, 1, { "a" } );
+      exporter.send( 2, 2, { "b" } );
+      exporter.send( 3, 4, { "c" } );
+
+      const auto metrics = exporter.get_metrics();
+      BOOST_CHECK_EQUAL( metrics.queued_batches, 1u );
+      BOOST_CHECK_EQUAL( metrics.spilled_batches, 2u );
+      BOOST_CHECK_EQUAL( metrics.lag_blocks, 4u );
+      BOOST_CHECK_EQUAL( count_bulk_files( spill_dir.path() ), 2u );
+
+      // nothing gets through, the batch in memory is written to disk as well
+      exporter.close( fc::milliseconds(100) );
+      BOOST_CHECK_EQUAL( count_bulk_files( spill_dir.path() ), 3u );
+      BOOST_CHECK( server.accepted().empty() );
+   }
+
+   stub_es_server server;
+   auto opts = exporter_options( server );
+   opts.spill_directory = spill_dir.path();
+   graphene::utilities::es_bulk_exporter exporter( opts );
+   BOOST_REQUIRE( exporter.flush( fc::seconds(10) ) );
+
+   const auto accepted = server.accepted();
+   BOOST_REQUIRE_EQUAL( accepted.size(), 3u );
+   BOOST_CHECK_EQUAL( accepted[0], "a\n" );
+   BOOST_CHECK_EQUAL( accepted[1], "b\n" );
+   BOOST_CHECK_EQUAL( accepted[2], "c\n" );
+   BOOST_CHECK_EQUAL( exporter.get_metrics().last_exported_block, 4u );
+   BOOST_CHECK_EQUAL( count_bulk_files( spill_dir.path() ), 0u );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -24,22 +24,121 @@
 
 #include "../common/init_unit_test_suite.hpp"
 
+#include <graphene/app/api_read_pool.hpp>
+#include <graphene/app/application.hpp>
+#include <graphene/app/changed_objects_cache.hpp>
+#include <graphene/app/database_api.hpp>
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/exceptions.hpp>
 
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/proposal_object.hpp>
+#include <graphene/chain/ticket_object.hpp>
 
 #include <graphene/db/simple_index.hpp>
 
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message_oriented_connection.hpp>
+#include <graphene/net/stcp_socket.hpp>
+
+#include <graphene/utilities/latency_histogram.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <graphene/wallet/wallet.hpp>
+
+#include <fc/crypto/aes.hpp>
+#include <fc/crypto/city.hpp>
 #include <fc/crypto/digest.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/network/http/websocket.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/rpc/websocket_api.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/endian/buffers.hpp>
 
 #include "../common/database_fixture.hpp"
+#include "../common/genesis_file_util.hpp"
+#include "../common/utils.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
 
 using namespace graphene::chain;
 
+namespace {
+
+/** Reads a block_database directory the way block_database did before it was memory mapped */
+class fstream_block_reader
+{
+   struct entry
+   {
+      boost::endian::little_uint64_buf_t block_pos;
+      boost::endian::little_uint32_buf_t block_size;
+      block_id_type                      block_id;
+   };
+
+   mutable std::fstream _index;
+   mutable std::fstream _blocks;
+
+public:
+   explicit fstream_block_reader( const fc::path& dir )
+   {
+      _index.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+      _blocks.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+      _index.open( (dir / "index").generic_string().c_str(), std::fstream::binary | std::fstream::in );
+      _blocks.open( (dir / "blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in );
+   }
+
+   optional<signed_block> fetch_by_number( uint32_t block_num )const
+   {
+      entry e;
+      int64_t index_pos = sizeof(e) * int64_t(block_num);
+      _index.seekg( 0, _index.end );
+      if ( _index.tellg() <= index_pos )
+         return {};
+      _index.seekg( index_pos, _index.beg );
+      _index.read( (char*)&e, sizeof(e) );
+
+      vector<char> data( e.block_size.value() );
+      _blocks.seekg( e.block_pos.value() );
+      _blocks.read( data.data(), e.block_size.value() );
+      auto result = fc::raw::unpack<signed_block>(data);
+      FC_ASSERT( result.id() == e.block_id );
+      return result;
+   }
+};
+
+template<typename Reader>
+uint64_t fetch_blocks( const Reader& reader, const std::vector<uint32_t>& order )
+{
+   auto start = fc::time_point::now();
+   for( uint32_t num : order )
+      FC_ASSERT( reader.fetch_by_number( num ).valid() );
+   return std::max<int64_t>( 1, (fc::time_point::now() - start).count() );
+}
+
+class counting_connection_delegate : public graphene::net::message_oriented_connection_delegate
+{
+public:
+   uint64_t messages = 0;
+
+   void on_message( graphene::net::message_oriented_connection*, const graphene::net::message& ) override
+   {
+      ++messages;
+   }
+   void on_connection_closed( graphene::net::message_oriented_connection* ) override {}
+};
+
+} // anonymous namespace
+
 BOOST_FIXTURE_TEST_SUITE( performance_tests, database_fixture )
 
 BOOST_AUTO_TEST_CASE( sigcheck_benchmark )
@@ -208,4 +307,897 @@ BOOST_AUTO_TEST_CASE( one_hundred_k_benchmark )
    db._undo_db.enable();
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( block_database_fetch_benchmark )
+{ try {
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const uint32_t num_blocks = 100000;
+
+   {
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      signed_block b;
+      b.transactions.resize( 1 ); // some payload
+      b.transactions[0].operations.emplace_back( transfer_operation() );
+      for( uint32_t i = 0; i < num_blocks; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.timestamp = fc::time_point_sec( i * 3 );
+         bdb.store( b.id(), b );
+      }
+      bdb.close();
+   }
+
+   std::vector<uint32_t> sequential( num_blocks );
+   std::iota( sequential.begin(), sequential.end(), 1 );
+   std::vector<uint32_t> random = sequential;
+   std::shuffle( random.begin(), random.end(), std::mt19937( 42 ) );
+
+   block_database bdb;
+   bdb.open( data_dir.path() );
+   fstream_block_reader legacy( data_dir.path() );
+
+   for( const auto& pattern : { std::make_pair( "sequential", &sequential ), std::make_pair( "random", &random ) } )
+   {
+      const uint64_t fstream_time = fetch_blocks( legacy, *pattern.second );
+      const uint64_t mmap_time = fetch_blocks( bdb, *pattern.second );
+      wlog( "Benchmark: ${p} fetch: fstream ${f} blocks/s, mmap ${m} blocks/s",
+            ("p",pattern.first)
+            ("f",(uint64_t(num_blocks)*1000000)/fstream_time)
+            ("m",(uint64_t(num_blocks)*1000000)/mmap_time) );
+   }
+
+   // the mapped store can be read from several threads at once
+   const uint32_t num_threads = std::max( 2u, std::thread::hardware_concurrency() );
+   std::vector<std::thread> readers;
+   auto start = fc::time_point::now();
+   for( uint32_t t = 0; t < num_threads; ++t )
+      readers.emplace_back( [&bdb,&random]() { fetch_blocks( bdb, random ); } );
+   for( auto& reader : readers )
+      reader.join();
+   auto elapsed = std::max<int64_t>( 1, (fc::time_point::now() - start).count() );
+   wlog( "Benchmark: random fetch with ${t} threads: mmap ${m} blocks/s",
+         ("t",num_threads)("m",(uint64_t(num_threads)*num_blocks*1000000)/elapsed) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_log_replay_benchmark )
+{ try {
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const uint32_t num_blocks = 100000;
+   const fc::path bdb_dir = data_dir.path() / "block_database";
+
+   {
+      block_database bdb;
+      bdb.open( bdb_dir );
+      signed_block b;
+      transfer_operation op;
+      op.from = account_id_type(17);
+      for( uint32_t i = 0; i < num_blocks; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.timestamp = fc::time_point_sec( i * 3 );
+         b.witness = witness_id_type( i % 21 );
+         b.transactions.clear();
+         for( uint32_t t = 0; t < i % 8; ++t )
+         {
+            op.to = account_id_type( 100 + ( i * 7 + t ) % 5000 );
+            op.amount = asset( 1000 * t + i % 100 );
+            signed_transaction trx;
+            trx.ref_block_num = i;
+            trx.expiration = b.timestamp + 60;
+            trx.operations.push_back( op );
+            b.transactions.push_back( trx );
+         }
+         bdb.store( b.id(), b );
+      }
+      bdb.close();
+   }
+   const uint64_t bdb_size = fc::file_size( bdb_dir / "blocks" ) + fc::file_size( bdb_dir / "index" );
+
+   auto replay = []( const block_database& bdb, uint32_t count ) {
+      auto start = fc::time_point::now();
+      for( uint32_t num = 1; num <= count; ++num )
+         FC_ASSERT( bdb.fetch_by_number( num ).valid() );
+      return std::max<int64_t>( 1, (fc::time_point::now() - start).count() );
+   };
+
+   {
+      block_database bdb;
+      bdb.open( bdb_dir );
+      const int64_t elapsed = replay( bdb, num_blocks );
+      wlog( "Benchmark: block_database replay ${b} blocks/s, ${s} bytes on disk",
+            ("b",(uint64_t(num_blocks)*1000000)/elapsed)("s",bdb_size) );
+   }
+
+   for( auto compression : { block_log_compression::none, block_log_compression::zlib, block_log_compression::zstd } )
+   {
+      if( !is_block_log_compression_supported( compression ) )
+         continue;
+      const fc::path log_dir = data_dir.path() / fc::reflector<block_log_compression>::to_string( compression );
+      fc::create_directories( log_dir );
+      {
+         block_database bdb;
+         bdb.open( bdb_dir );
+         block_log_writer log( log_dir / "block_log", compression );
+         auto start = fc::time_point::now();
+         for( uint32_t num = 1; num <= num_blocks; ++num )
+            log.append_packed( num, *bdb.fetch_packed_optional( bdb.fetch_block_id( num ) ) );
+         log.close();
+         auto elapsed = std::max<int64_t>( 1, (fc::time_point::now() - start).count() );
+         wlog( "Benchmark: converted to ${c} block log at ${b} blocks/s",
+               ("c",compression)("b",(uint64_t(num_blocks)*1000000)/elapsed) );
+      }
+      const uint64_t log_size = fc::file_size( log_dir / "block_log" )
+                                + fc::file_size( fc::path( (log_dir / "block_log").generic_string() + ".index" ) );
+
+      block_database bdb;
+      bdb.open( log_dir );
+      const int64_t elapsed = replay( bdb, num_blocks );
+      wlog( "Benchmark: ${c} block log replay ${b} blocks/s, ${s} bytes on disk (${p}%)",
+            ("c",compression)("b",(uint64_t(num_blocks)*1000000)/elapsed)("s",log_size)
+            ("p",log_size * 100 / bdb_size) );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( push_transaction_benchmark )
+{ try {
+   const uint32_t num_accounts = 200;
+   const uint32_t cycles = 50000;
+   const uint32_t rounds = 3;
+   const uint32_t skip = database::skip_transaction_signatures | database::skip_tapos_check;
+
+   transfer_operation op;
+   op.amount = asset( cycles / num_accounts + 1 );
+   db.current_fee_schedule().set_fee( op );
+   const asset funding( ( op.fee.amount.value + op.amount.amount.value ) * ( 2 * cycles / num_accounts ) );
+
+   std::vector<account_id_type> accounts;
+   accounts.reserve( num_accounts );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      accounts.push_back( create_account( "pt" + fc::to_string( i ) ).id );
+      fund( accounts.back()(db), funding );
+   }
+   generate_block();
+
+   std::vector<signed_transaction> transactions;
+   transactions.reserve( cycles );
+   for( uint32_t i = 0; i < cycles; ++i )
+   {
+      op.from = accounts[i % num_accounts];
+      op.to = accounts[(i + 1) % num_accounts];
+      op.amount = asset( 1 + i / num_accounts );
+      trx.clear();
+      test::set_expiration( db, trx );
+      trx.operations.push_back( op );
+      transactions.push_back( trx );
+   }
+   trx.clear();
+
+   // Every pushed transaction runs in a temporary undo session that is merged into the pending session,
+   // clearing the pending transactions undoes the merged session.
+   for( uint32_t round = 0; round < rounds; ++round )
+   {
+      auto start = fc::time_point::now();
+      for( const auto& tx : transactions )
+         db.push_transaction( tx, skip );
+      auto pushed = fc::time_point::now();
+      db.clear_pending();
+      auto cleared = fc::time_point::now();
+
+      const int64_t push_time = std::max<int64_t>( 1, ( pushed - start ).count() );
+      wlog( "Benchmark: round ${r} pushed ${tps} transactions/s, undone in ${u}ms",
+            ("r",round)("tps",(uint64_t(cycles)*1000000)/push_time)("u",(cleared - pushed).count()/1000) );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( generate_block_benchmark )
+{ try {
+   const uint32_t num_accounts = 200;
+   const std::vector<uint32_t> mempool_sizes = { 1000, 5000, 10000, 50000 };
+   const uint32_t skip = database::skip_transaction_signatures | database::skip_tapos_check;
+
+   uint32_t total_transactions = 0;
+   uint32_t max_amount = 0;
+   for( uint32_t size : mempool_sizes )
+   {
+      total_transactions += size;
+      max_amount = std::max( max_amount, size / num_accounts + 1 );
+   }
+
+   transfer_operation op;
+   op.amount = asset( max_amount );
+   db.current_fee_schedule().set_fee( op );
+   const asset funding( ( op.fee.amount.value + max_amount ) * ( total_transactions / num_accounts + 1 ) );
+
+   std::vector<account_id_type> accounts;
+   accounts.reserve( num_accounts );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      accounts.push_back( create_account( "gb" + fc::to_string( i ) ).id );
+      fund( accounts.back()(db), funding );
+   }
+   generate_block();
+
+   for( uint32_t size : mempool_sizes )
+   {
+      for( uint32_t i = 0; i < size; ++i )
+      {
+         op.from = accounts[i % num_accounts];
+         op.to = accounts[(i + 1) % num_accounts];
+         op.amount = asset( 1 + i / num_accounts );
+         trx.clear();
+         test::set_expiration( db, trx );
+         trx.operations.push_back( op );
+         db.push_transaction( trx, skip );
+      }
+      trx.clear();
+
+      // The pending transactions have been applied already, the block is made of those that fit into it.
+      // Whatever is postponed is pushed again on top of the new block.
+      auto start = fc::time_point::now();
+      signed_block b = generate_block();
+      auto end = fc::time_point::now();
+
+      wlog( "Benchmark: generated block from ${n} pending transactions in ${t}ms, ${i} included, ${p} postponed",
+            ("n",size)("t",(end - start).count()/1000)("i",b.transactions.size())
+            ("p",size - b.transactions.size()) );
+      db.clear_pending();
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( transaction_pool_benchmark )
+{ try {
+   const uint32_t num_transactions = 2000000;
+   const uint32_t num_accounts = 1000;
+   const uint32_t block_transactions = 10000;
+   const uint64_t max_size = 64 * 1024 * 1024;
+
+   transaction_pool pool;
+   pool.set_limits( max_size, 1000 );
+
+   signed_transaction tx;
+   transfer_operation op;
+   op.amount = asset( 1 );
+   tx.operations.push_back( op );
+   test::set_expiration( db, tx );
+   const uint32_t size = fc::raw::pack_size( processed_transaction( tx ) );
+
+   // Synthetic transactions with random fees, each fee payer sends one in every num_accounts transactions
+   std::mt19937_64 rng( 42 );
+   uint64_t too_many = 0;
+   uint64_t too_cheap = 0;
+   uint64_t evicted = 0;
+   auto start = fc::time_point::now();
+   for( uint32_t i = 0; i < num_transactions; ++i )
+   {
+      tx.ref_block_prefix = i;
+      const account_id_type payer( i % num_accounts );
+      const uint64_t fee_per_kb = rng() % 100000;
+      try
+      {
+         pool.check_admission( payer, size, fee_per_kb );
+         pool.insert( processed_transaction( tx ), payer, size, fee_per_kb );
+         evicted += pool.evict();
+      }
+      catch( const pending_transaction_limit_exceeded& )
+      {
+         ++too_many;
+      }
+      catch( const transaction_pool_full& )
+      {
+         ++too_cheap;
+      }
+   }
+   auto inserted = fc::time_point::now();
+   wlog( "Benchmark: offered ${n} transactions at ${tps} transactions/s, ${p} pending (${s} bytes), ${e} evicted, "
+         "${m} rejected for the account limit, ${c} rejected for low fees",
+         ("n",num_transactions)("tps",(uint64_t(num_transactions)*1000000)/std::max<int64_t>(1,(inserted-start).count()))
+         ("p",pool.size())("s",pool.total_size())("e",evicted)("m",too_many)("c",too_cheap) );
+
+   // Fill blocks by priority, then remove their transactions like a received block would
+   uint32_t blocks = 0;
+   fc::microseconds select_time;
+   fc::microseconds remove_time;
+   while( !pool.empty() )
+   {
+      auto select_start = fc::time_point::now();
+      vector<transaction_id_type> ids;
+      ids.reserve( block_transactions );
+      const auto& by_priority = pool.indices().get<transaction_pool::by_priority>();
+      for( auto itr = by_priority.begin(); itr != by_priority.end() && ids.size() < block_transactions; ++itr )
+         ids.push_back( itr->id );
+      auto remove_start = fc::time_point::now();
+      for( const auto& id : ids )
+         pool.erase( id );
+      auto end = fc::time_point::now();
+      select_time += remove_start - select_start;
+      remove_time += end - remove_start;
+      ++blocks;
+   }
+   wlog( "Benchmark: drained the pool in ${b} blocks of ${n} transactions, selecting took ${s}us and "
+         "removing ${r}us per block",
+         ("b",blocks)("n",block_transactions)("s",select_time.count()/blocks)("r",remove_time.count()/blocks) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( ticket_update_benchmark )
+{ try {
+   const uint32_t num_accounts = 1000;
+   const uint32_t num_tickets = 1000000;
+   const uint32_t tickets_per_trx = 100;
+   const uint32_t trxs_per_block = 100;
+   const uint32_t skip = database::skip_transaction_signatures | database::skip_tapos_check;
+
+   ticket_create_operation op = make_ticket_create_op( account_id_type(), lock_180_days, asset( 1 ) );
+   db.current_fee_schedule().set_fee( op );
+   const asset funding( ( op.fee.amount.value + 1 ) * ( num_tickets / num_accounts + 1 ) );
+
+   std::vector<account_id_type> accounts;
+   accounts.reserve( num_accounts );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      accounts.push_back( create_account( "tu" + fc::to_string( i ) ).id );
+      fund( accounts.back()(db), funding );
+   }
+   generate_block();
+
+   // All tickets are created within a few blocks, so that most of them are updated at the same time
+   auto start = fc::time_point::now();
+   for( uint32_t i = 0; i < num_tickets; )
+   {
+      for( uint32_t t = 0; t < trxs_per_block && i < num_tickets; ++t )
+      {
+         trx.clear();
+         for( uint32_t n = 0; n < tickets_per_trx && i < num_tickets; ++n, ++i )
+         {
+            op.account = accounts[i % num_accounts];
+            trx.operations.push_back( op );
+         }
+         test::set_expiration( db, trx );
+         db.push_transaction( trx, skip );
+      }
+      generate_block();
+   }
+   trx.clear();
+   wlog( "Benchmark: created ${n} tickets in ${t}ms", ("n",num_tickets)("t",(fc::time_point::now() - start).count()/1000) );
+
+   // Jump to the end of the charging step, then generate blocks until all tickets have been updated
+   const auto& by_next_update = db.get_index_type<ticket_index>().indices().get<by_next_update>();
+   const fc::time_point_sec first_update = by_next_update.begin()->next_auto_update_time;
+   generate_blocks( first_update - db.get_global_properties().parameters.block_interval );
+   uint32_t blocks = 0;
+   fc::microseconds update_time;
+   fc::microseconds max_block_time;
+   while( by_next_update.begin()->next_auto_update_time <= first_update + fc::days(1) )
+   {
+      auto block_start = fc::time_point::now();
+      generate_block();
+      auto block_time = fc::time_point::now() - block_start;
+      update_time += block_time;
+      max_block_time = std::max( max_block_time, block_time );
+      ++blocks;
+   }
+   wlog( "Benchmark: updated ${n} tickets in ${b} blocks and ${t}ms, ${tps} tickets/s, the slowest block took ${m}ms",
+         ("n",num_tickets)("b",blocks)("t",update_time.count()/1000)
+         ("tps",(uint64_t(num_tickets)*1000000)/std::max<int64_t>(1,update_time.count()))
+         ("m",max_block_time.count()/1000) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( api_read_concurrency_benchmark )
+{ try {
+   const uint32_t num_accounts = 100;
+   const uint32_t num_orders = 500;
+   const uint32_t num_clients = 8;
+   const uint32_t blocks = 100;
+   const std::vector<uint16_t> read_thread_counts = { 0, 1, 4 };
+
+   transfer_operation op;
+   op.amount = asset( 1 );
+   db.current_fee_schedule().set_fee( op );
+   // one run without API calls and one for every number of read threads
+   const asset funding( ( op.fee.amount.value + op.amount.amount.value ) * blocks * ( read_thread_counts.size() + 1 ) );
+
+   std::vector<account_id_type> accounts;
+   std::vector<string> names;
+   accounts.reserve( num_accounts );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      names.push_back( "ar" + fc::to_string( i ) );
+      accounts.push_back( create_account( names.back() ).id );
+      fund( accounts.back()(db), funding );
+   }
+   names.resize( 10 );
+
+   const account_object& seller = create_account( "arseller" );
+   const asset_object& uia = create_user_issued_asset( "APIREAD", seller, 0 );
+   const asset_id_type uia_id = uia.id;
+   const string core_symbol = asset_id_type()(db).symbol;
+   fund( seller, asset( 10000000 ) );
+   issue_uia( seller, uia.amount( 100 * num_orders ) );
+   for( uint32_t i = 0; i < num_orders; ++i )
+      create_sell_order( seller, asset( 100, uia_id ), asset( 100 + i ) );
+   generate_block();
+
+   auto p99 = []( std::vector<int64_t>& latencies ) {
+      std::sort( latencies.begin(), latencies.end() );
+      return latencies.empty() ? int64_t(0) : latencies[ ( latencies.size() - 1 ) * 99 / 100 ];
+   };
+
+   // generates the blocks, returns the time taken by each of them
+   auto apply_blocks = [&]() {
+      std::vector<int64_t> block_times;
+      for( uint32_t b = 0; b < blocks; ++b )
+      {
+         for( uint32_t i = 0; i < num_accounts; ++i )
+         {
+            op.from = accounts[i];
+            op.to = accounts[(i + 1) % num_accounts];
+            trx.clear();
+            test::set_expiration( db, trx );
+            trx.operations.push_back( op );
+            PUSH_TX( db, trx, ~0 );
+         }
+         trx.clear();
+
+         auto start = fc::time_point::now();
+         generate_block();
+         block_times.push_back( ( fc::time_point::now() - start ).count() );
+         fc::usleep( fc::milliseconds(1) );
+      }
+      return block_times;
+   };
+
+   // lets the clients call the API while body runs, returns the latencies of all calls
+   fc::thread& main_thread = fc::thread::current();
+   auto call_api = [&]( graphene::app::database_api& api, uint16_t read_threads, const std::function<void()>& body ) {
+      std::atomic<bool> done( false );
+      std::vector< std::vector<int64_t> > latencies( num_clients );
+      std::vector< std::unique_ptr<fc::thread> > clients;
+      std::vector< fc::future<void> > loops;
+      for( uint32_t c = 0; c < num_clients; ++c )
+      {
+         clients.push_back( std::make_unique<fc::thread>( "api_client_" + fc::to_string( c ) ) );
+         loops.push_back( clients.back()->async( [&,c]() {
+            auto call = [&api,&names,&core_symbol,c]() {
+               if( c % 2 == 0 )
+                  api.get_order_book( "APIREAD", core_symbol, 50 );
+               else
+                  api.get_full_accounts( names, false );
+            };
+            while( !done )
+            {
+               auto start = fc::time_point::now();
+               if( read_threads > 0 )
+                  call();
+               else
+                  main_thread.async( call, "api call" ).wait();
+               latencies[c].push_back( ( fc::time_point::now() - start ).count() );
+            }
+         }, "api client" ) );
+      }
+
+      body();
+
+      done = true;
+      for( auto& loop : loops )
+         loop.wait();
+      std::vector<int64_t> all;
+      for( const auto& client_latencies : latencies )
+         all.insert( all.end(), client_latencies.begin(), client_latencies.end() );
+      return all;
+   };
+
+   std::vector<int64_t> block_times_alone = apply_blocks();
+   const int64_t block_p99_alone = p99( block_times_alone );
+   wlog( "Benchmark: without API calls, block p99 ${p}us", ("p",block_p99_alone) );
+
+   for( const uint16_t read_threads : read_thread_counts )
+   {
+      // Without read threads the calls are handled by the thread which also applies the blocks,
+      // like before the read threads existed.
+      graphene::app::application_options options;
+      if( read_threads > 0 )
+         options.read_pool = std::make_shared<graphene::app::api_read_pool>( db, read_threads );
+      graphene::app::database_api api( db, &options );
+
+      std::vector<int64_t> api_times_alone = call_api( api, read_threads, []() {
+         fc::usleep( fc::seconds(1) );
+      });
+      std::vector<int64_t> block_times;
+      std::vector<int64_t> api_times = call_api( api, read_threads, [&]() {
+         block_times = apply_blocks();
+      });
+
+      const int64_t api_p99_alone = p99( api_times_alone );
+      const int64_t api_p99 = p99( api_times );
+      const int64_t block_p99 = p99( block_times );
+      wlog( "Benchmark: ${t} API read threads, ${n} calls, API p99 ${a}us (${s}us without blocks), "
+            "block p99 ${p}us, ${b}us per block on average",
+            ("t",read_threads)("n",api_times.size())("a",api_p99)("s",api_p99_alone)("p",block_p99)
+            ("b",std::accumulate( block_times.begin(), block_times.end(), int64_t(0) ) / blocks) );
+
+      // With read threads, each side waits for at most one call or block of the other, so neither the API
+      // latency nor the block time may grow much beyond that while both run together
+      if( read_threads > 0 )
+      {
+         BOOST_CHECK_LE( block_p99, 2 * ( block_p99_alone + api_p99_alone ) );
+         BOOST_CHECK_LE( api_p99, 2 * ( api_p99_alone + block_p99_alone ) );
+      }
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( object_database_open_benchmark )
+{ try {
+   const uint32_t num_accounts = 200000;
+   db._undo_db.disable();
+
+   const fc::ecc::public_key key = fc::ecc::private_key::generate().get_public_key();
+   account_create_operation aco;
+   aco.registrar = account_id_type();
+   aco.owner = authority( 1, public_key_type(key), 1 );
+   aco.active = authority( 1, public_key_type(key), 1 );
+   aco.options.memo_key = key;
+   aco.options.voting_account = GRAPHENE_PROXY_TO_SELF_ACCOUNT;
+   aco.fee = db.current_fee_schedule().calculate_fee( aco );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      aco.name = "od" + fc::to_string( i );
+      trx.clear();
+      test::set_expiration( db, trx );
+      trx.operations.push_back( aco );
+      db.apply_transaction( trx, ~0 );
+   }
+   trx.clear();
+   db._undo_db.enable();
+
+   db.flush();
+
+   // Each index file is mapped and divided into chunks, the chunks of all indexes are unpacked in parallel,
+   // then every index is filled by one thread.
+   database reopened;
+   auto start = fc::time_point::now();
+   reopened.graphene::db::object_database::open( db.get_data_dir() );
+   auto end = fc::time_point::now();
+
+   std::vector<graphene::db::index_load_timing> timings = reopened.get_load_timings();
+   std::sort( timings.begin(), timings.end(), []( const auto& a, const auto& b ) {
+      return a.decode_time + a.insert_time > b.decode_time + b.insert_time;
+   });
+   uint64_t objects = 0;
+   for( const auto& timing : timings )
+      objects += timing.objects;
+   wlog( "Benchmark: opened ${n} objects in ${t}ms", ("n",objects)("t",(end - start).count()/1000) );
+   for( size_t i = 0; i < std::min<size_t>( 10, timings.size() ); ++i )
+   {
+      const auto& timing = timings[i];
+      wlog( "Benchmark: index ${s}.${t}, ${n} objects in ${c} chunks, mapped in ${m}ms, "
+            "unpacked in ${d}ms (all chunks), inserted in ${i}ms",
+            ("s",timing.space_id)("t",timing.type_id)("n",timing.objects)("c",timing.chunks)
+            ("m",timing.map_time.count()/1000)("d",timing.decode_time.count()/1000)
+            ("i",timing.insert_time.count()/1000) );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( block_write_behind_benchmark )
+{ try {
+   const uint32_t num_accounts = 100;
+   const uint32_t blocks = 50;
+
+   transfer_operation op;
+   op.amount = asset( 1 );
+   db.current_fee_schedule().set_fee( op );
+   const asset funding( ( op.fee.amount.value + 1 ) * blocks * 4 + 1 );
+
+   std::vector<account_id_type> accounts;
+   accounts.reserve( num_accounts );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      accounts.push_back( create_account( "wb" + fc::to_string( i ) ).id );
+      fund( accounts.back()(db), funding );
+   }
+   generate_block();
+
+   // slow storage is simulated by delaying every write of a block
+   const fc::path blocks_dir = db.get_data_dir() / "database" / "block_num_to_block";
+   block_database& bdb = db.get_block_database();
+   for( const int64_t write_latency : { int64_t(0), int64_t(20000) } )
+   {
+      for( const bool write_behind : { false, true } )
+      {
+         bdb.close();
+         bdb.enable_write_behind( write_behind );
+         bdb.simulate_write_latency( fc::microseconds( write_latency ) );
+         bdb.open( blocks_dir );
+
+         graphene::utilities::latency_histogram block_times;
+         fc::microseconds elapsed;
+         for( uint32_t b = 0; b < blocks; ++b )
+         {
+            for( uint32_t i = 0; i < num_accounts; ++i )
+            {
+               op.from = accounts[i];
+               op.to = accounts[(i + 1) % num_accounts];
+               trx.clear();
+               test::set_expiration( db, trx );
+               trx.operations.push_back( op );
+               PUSH_TX( db, trx, ~0 );
+            }
+            trx.clear();
+
+            auto start = fc::time_point::now();
+            generate_block();
+            const fc::microseconds block_time = fc::time_point::now() - start;
+            block_times.record( block_time );
+            elapsed += block_time;
+         }
+
+         auto start = fc::time_point::now();
+         bdb.flush();
+         const fc::microseconds flush_time = fc::time_point::now() - start;
+
+         wlog( "Benchmark: write latency ${l}us, write-behind ${w}: block p99 <=${p}us, ${b}us per block "
+               "on average, ${f}us to write out the remaining blocks",
+               ("l",write_latency)("w",write_behind)("p",block_times.percentile( 99 ))
+               ("b",elapsed.count()/blocks)("f",flush_time.count()) );
+      }
+   }
+   bdb.simulate_write_latency( fc::microseconds() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( subscription_fanout_benchmark )
+{ try {
+   const uint32_t num_accounts = 100;
+   const uint32_t blocks = 50;
+   const std::vector<uint32_t> session_counts = { 0, 1, 10, 100, 500 };
+
+   transfer_operation op;
+   op.amount = asset( 1 );
+   db.current_fee_schedule().set_fee( op );
+   const asset funding( ( op.fee.amount.value + op.amount.amount.value ) * blocks * session_counts.size() );
+
+   std::vector<account_id_type> accounts;
+   accounts.reserve( num_accounts );
+   for( uint32_t i = 0; i < num_accounts; ++i )
+   {
+      accounts.push_back( create_account( "pt" + fc::to_string( i ) ).id );
+      fund( accounts.back()(db), funding );
+   }
+   generate_block();
+
+   // every session subscribes to all accounts, their statistics and their balances
+   std::vector<object_id_type> subscribed;
+   for( const auto& id : accounts )
+   {
+      subscribed.push_back( id );
+      subscribed.push_back( id(db).statistics );
+   }
+   for( const auto& balance : db.get_index_type<account_balance_index>().indices() )
+      if( std::find( accounts.begin(), accounts.end(), balance.owner ) != accounts.end() )
+         subscribed.push_back( balance.id );
+
+   // the sessions share the converted objects like the sessions of an application
+   graphene::app::application_options app_options;
+   app_options.changed_objects = std::make_shared<graphene::app::changed_objects_cache>( db );
+
+   uint64_t notices = 0;
+   for( const uint32_t sessions : session_counts )
+   {
+      notices = 0;
+      std::vector< std::shared_ptr<graphene::app::database_api> > apis;
+      for( uint32_t i = 0; i < sessions; ++i )
+      {
+         apis.push_back( std::make_shared<graphene::app::database_api>( std::ref( db ), &app_options ) );
+         apis.back()->set_subscribe_callback( [&notices]( const variant& ) { ++notices; }, false );
+         apis.back()->get_objects( subscribed, true );
+      }
+
+      fc::microseconds elapsed;
+      for( uint32_t b = 0; b < blocks; ++b )
+      {
+         for( uint32_t i = 0; i < num_accounts; ++i )
+         {
+            op.from = accounts[i];
+            op.to = accounts[(i + 1) % num_accounts];
+            trx.clear();
+            test::set_expiration( db, trx );
+            trx.operations.push_back( op );
+            PUSH_TX( db, trx, ~0 );
+         }
+         trx.clear();
+
+         // the notifications are converted while the block is applied and delivered afterwards
+         auto start = fc::time_point::now();
+         generate_block();
+         elapsed += fc::time_point::now() - start;
+         fc::usleep( fc::milliseconds(1) );
+      }
+
+      wlog( "Benchmark: ${s} sessions, ${t}us per block, ${n} notices delivered",
+            ("s",sessions)("t",elapsed.count()/blocks)("n",notices) );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( message_send_benchmark )
+{ try {
+   const uint32_t bytes_per_round = 64 * 1024 * 1024;
+   const std::vector<uint32_t> message_sizes = { 256, 4096, 65536 };
+   const std::vector<uint32_t> batch_lengths = { 1, 16, 128 };
+
+   for( const uint32_t message_size : message_sizes )
+      for( const uint32_t batch_length : batch_lengths )
+      {
+         fc::tcp_server server;
+         server.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+         counting_connection_delegate sender_delegate;
+         counting_connection_delegate receiver_delegate;
+         graphene::net::message_oriented_connection sender( &sender_delegate );
+         graphene::net::message_oriented_connection receiver( &receiver_delegate );
+         auto accepted = fc::async( [&server,&receiver]() {
+            server.accept( receiver.get_socket() );
+            receiver.accept();
+         } );
+         sender.connect_to( server.get_local_endpoint() );
+         accepted.wait();
+
+         // a batch of queued messages is written like a single message that is as large as the whole batch
+         const uint32_t num_messages = bytes_per_round / message_size;
+         const std::vector<graphene::net::message> batch( batch_length,
+               graphene::net::message( graphene::net::block_message_type, std::vector<char>( message_size, 'x' ) ) );
+         auto start = fc::time_point::now();
+         for( uint32_t sent = 0; sent < num_messages; sent += batch_length )
+            sender.send_messages( batch );
+         while( receiver_delegate.messages < num_messages )
+            fc::usleep( fc::microseconds( 100 ) );
+         const int64_t elapsed = std::max<int64_t>( 1, ( fc::time_point::now() - start ).count() );
+
+         wlog( "Benchmark: ${s} byte messages in batches of ${b}, ${m} messages/s, ${t} MiB/s, ${w} writes",
+               ("s",message_size)("b",batch_length)("m",uint64_t(num_messages)*1000000/elapsed)
+               ("t",sender.get_total_bytes_sent()*1000000/elapsed/(1024*1024))
+               ("w",sender.get_total_send_batches()) );
+      }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( stcp_encryption_benchmark )
+{ try {
+   const uint32_t message_size = 2 * 1024 * 1024;
+   const uint32_t num_messages = 100;
+   const std::vector<uint32_t> chunk_sizes = { 4096, graphene::net::stcp_socket::buffer_size };
+
+   const fc::sha256 key = fc::sha256::hash( std::string( "stcp_encryption_benchmark" ) );
+   const auto init_value = fc::city_hash_crc_128( key.data(), key.data_size() );
+   std::vector<char> plaintext( message_size, 'x' );
+   std::vector<char> ciphertext( message_size );
+   std::vector<char> decrypted( message_size );
+
+   // the cipher alone, with the chunk size of the old and of the current stcp_socket
+   for( const uint32_t chunk_size : chunk_sizes )
+   {
+      fc::aes_encoder encoder;
+      fc::aes_decoder decoder;
+      encoder.init( key, init_value );
+      decoder.init( key, init_value );
+
+      fc::microseconds encrypt_time;
+      fc::microseconds decrypt_time;
+      for( uint32_t i = 0; i < num_messages; ++i )
+      {
+         auto start = fc::time_point::now();
+         for( uint32_t pos = 0; pos < message_size; pos += chunk_size )
+            encoder.encode( plaintext.data() + pos, chunk_size, ciphertext.data() + pos );
+         auto encrypted = fc::time_point::now();
+         for( uint32_t pos = 0; pos < message_size; pos += chunk_size )
+            decoder.decode( ciphertext.data() + pos, chunk_size, decrypted.data() + pos );
+         encrypt_time += encrypted - start;
+         decrypt_time += fc::time_point::now() - encrypted;
+      }
+      FC_ASSERT( decrypted == plaintext );
+
+      const uint64_t total_mib = uint64_t(message_size) * num_messages / (1024 * 1024);
+      wlog( "Benchmark: ${c} byte chunks, encrypt ${e} MiB/s, decrypt ${d} MiB/s",
+            ("c",chunk_size)("e",total_mib*1000000/std::max<int64_t>(1,encrypt_time.count()))
+            ("d",total_mib*1000000/std::max<int64_t>(1,decrypt_time.count())) );
+   }
+
+   // block messages through an encrypted loopback connection
+   fc::tcp_server server;
+   server.listen( fc::ip::endpoint( fc::ip::address( "127.0.0.1" ), 0 ) );
+   counting_connection_delegate sender_delegate;
+   counting_connection_delegate receiver_delegate;
+   graphene::net::message_oriented_connection sender( &sender_delegate );
+   graphene::net::message_oriented_connection receiver( &receiver_delegate );
+   auto accepted = fc::async( [&server,&receiver]() {
+      server.accept( receiver.get_socket() );
+      receiver.accept();
+   } );
+   sender.connect_to( server.get_local_endpoint() );
+   accepted.wait();
+
+   // stay below MAX_MESSAGE_SIZE with the message header
+   const graphene::net::message block( graphene::net::block_message_type,
+                                       std::vector<char>( message_size - 16, 'x' ) );
+   auto start = fc::time_point::now();
+   for( uint32_t i = 0; i < num_messages; ++i )
+      sender.send_message( block );
+   while( receiver_delegate.messages < num_messages )
+      fc::usleep( fc::microseconds( 100 ) );
+   const int64_t elapsed = std::max<int64_t>( 1, ( fc::time_point::now() - start ).count() );
+   wlog( "Benchmark: ${n} block messages over loopback, ${t} MiB/s",
+         ("n",num_messages)("t",sender.get_total_bytes_sent()*1000000/elapsed/(1024*1024)) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( wallet_broadcast_benchmark )
+{ try {
+   const uint32_t num_transfers = 2000;
+
+   // a local node with an RPC endpoint and a P2P node, like a witness_node without peers
+   fc::temp_directory node_dir( graphene::utilities::temp_directory_path() );
+   auto node = std::make_shared<graphene::app::application>();
+   auto node_cfg = std::make_shared<boost::program_options::variables_map>();
+   const int rpc_port = fc::network::get_available_port();
+   int p2p_port = rpc_port;
+   for( size_t i = 0; i < 10 && p2p_port == rpc_port; ++i )
+      p2p_port = fc::network::get_available_port();
+   BOOST_REQUIRE( p2p_port != rpc_port );
+   fc::set_option( *node_cfg, "rpc-endpoint", string("127.0.0.1:") + std::to_string(rpc_port) );
+   fc::set_option( *node_cfg, "p2p-endpoint", string("127.0.0.1:") + std::to_string(p2p_port) );
+   fc::set_option( *node_cfg, "genesis-json", create_genesis_file(node_dir) );
+   fc::set_option( *node_cfg, "seed-nodes", string("[]") );
+   // all transfers are paid by one account and stay pending
+   fc::set_option( *node_cfg, "pending-transactions-max-per-account", uint32_t(0) );
+   node->initialize( node_dir.path(), node_cfg );
+   node->startup();
+
+   // a wallet connected to it over a websocket, like the cli_wallet
+   graphene::wallet::wallet_data wdata;
+   wdata.chain_id = node->chain_database()->get_chain_id();
+   wdata.ws_server = "ws://127.0.0.1:" + std::to_string(rpc_port);
+   fc::http::websocket_client ws_client;
+   auto ws_connection = ws_client.connect( wdata.ws_server );
+   auto api_connection = std::make_shared<fc::rpc::websocket_api_connection>( ws_connection,
+                                                                              GRAPHENE_MAX_NESTED_OBJECTS );
+   auto remote_login = api_connection->get_remote_api< graphene::app::login_api >(1);
+   BOOST_REQUIRE( remote_login->login( "", "" ) );
+   graphene::wallet::wallet_api wallet( wdata, remote_login );
+   wallet.set_wallet_filename( ( node_dir.path() / "wallet.json" ).generic_string() );
+   wallet.set_password( "supersecret" );
+   wallet.unlock( "supersecret" );
+
+   const string nathan_key = "5KQwrPbwdL6PhXujxW37FSSQZ1JiwsST4cqQzDeyXtP79zkvFD3";
+   BOOST_REQUIRE( wallet.import_key( "nathan", nathan_key ) );
+   wallet.import_balance( "nathan", { nathan_key }, true );
+   wallet.upgrade_account( "nathan", true );
+   const auto receiver_key = wallet.suggest_brain_key();
+   wallet.register_account( "receiver", receiver_key.pub_key, receiver_key.pub_key, "nathan", "nathan", 0, true );
+   const account_id_type nathan_id = wallet.get_account( "nathan" ).id;
+   const account_id_type receiver_id = wallet.get_account( "receiver" ).id;
+
+   transfer_operation op;
+   op.from = nathan_id;
+   op.to = receiver_id;
+   op.amount = asset( 1 );
+   op.fee = node->chain_database()->current_fee_schedule().calculate_fee( op );
+   auto make_transfers = [&op,num_transfers]() {
+      vector<signed_transaction> txs( num_transfers );
+      for( signed_transaction& tx : txs )
+         tx.operations.push_back( op );
+      return txs;
+   };
+
+   vector<signed_transaction> txs = make_transfers();
+   auto start = fc::time_point::now();
+   for( signed_transaction& tx : txs )
+      wallet.sign_transaction( tx, true );
+   const int64_t one_by_one = std::max<int64_t>( 1, ( fc::time_point::now() - start ).count() );
+
+   txs = make_transfers();
+   start = fc::time_point::now();
+   wallet.sign_transactions( txs, true );
+   const int64_t batch = std::max<int64_t>( 1, ( fc::time_point::now() - start ).count() );
+
+   BOOST_CHECK_EQUAL( node->chain_database()->get_balance( receiver_id, asset_id_type() ).amount.value,
+                      int64_t( 2 * num_transfers ) );
+   wlog( "Benchmark: ${n} transfers signed and broadcast one by one at ${o} tx/s, as a batch at ${b} tx/s",
+         ("n",num_transfers)("o",uint64_t(num_transfers)*1000000/one_by_one)
+         ("b",uint64_t(num_transfers)*1000000/batch) );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -27,6 +27,7 @@
 #include "../common/database_fixture.hpp"
 
 #include <graphene/app/util.hpp>
+#include <graphene/utilities/latency_histogram.hpp>
 
 using namespace graphene::chain;
 using namespace graphene::chain::test;
@@ -278,4 +279,35 @@ BOOST_AUTO_TEST_CASE(price_to_string_verify)
    }
 }
 
+BOOST_AUTO_TEST_CASE(latency_histogram_test)
+{
+   graphene::utilities::latency_histogram histogram;
+   BOOST_CHECK_EQUAL( histogram.count(), 0u );
+   BOOST_CHECK_EQUAL( histogram.percentile( 50 ), 0 );
+
+   // 90 samples up to 1us, 9 in (512us,1024us] and one beyond the last bound
+   for( int i = 0; i < 90; ++i )
+      histogram.record( fc::microseconds( i % 2 ) );
+   for( int i = 0; i < 9; ++i )
+      histogram.record( fc::microseconds( 1000 ) );
+   histogram.record( fc::seconds( 100 ) );
+
+   BOOST_CHECK_EQUAL( histogram.count(), 100u );
+   BOOST_CHECK_EQUAL( histogram.percentile( 50 ), 1 );
+   BOOST_CHECK_EQUAL( histogram.percentile( 90 ), 1 );
+   BOOST_CHECK_EQUAL( histogram.percentile( 99 ), 1024 );
+   BOOST_CHECK_EQUAL( histogram.percentile( 100 ),
+                      int64_t(1) << ( graphene::utilities::latency_histogram::num_buckets - 1 ) );
+
+   const fc::variant_object report = histogram.to_variant_object();
+   BOOST_CHECK_EQUAL( report["count"].as_uint64(), 100u );
+   const fc::variant_object& buckets = report["buckets"].get_object();
+   BOOST_CHECK_EQUAL( buckets.size(), 3u );
+   BOOST_CHECK_EQUAL( buckets["<=1us"].as_uint64(), 90u );
+   BOOST_CHECK_EQUAL( buckets["<=1024us"].as_uint64(), 9u );
+
+   histogram.reset();
+   BOOST_CHECK_EQUAL( histogram.count(), 0u );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -24,6 +24,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <graphene/app/database_api.hpp>
+
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/exceptions.hpp>
 
@@ -2292,4 +2294,69 @@ BOOST_AUTO_TEST_CASE( self_deleting_proposal )
    GRAPHENE_REQUIRE_THROW(PUSH_TX( db, trx, ~0 ), fc::exception);
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( signature_cache_reuses_recovered_keys )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice );
+
+   trx.clear();
+   set_expiration( db, trx );
+   transfer_operation op;
+   op.from = alice_id;
+   op.to = bob_id;
+   op.amount = asset( 1 );
+   trx.operations.push_back( op );
+   sign( trx, alice_private_key );
+
+   signature_cache cache;
+   const chain_id_type& chain_id = db.get_chain_id();
+
+   // the same transaction received twice, e.g. from the network and inside a block
+   precomputable_transaction first( trx );
+   precomputable_transaction second( trx );
+   const flat_set<public_key_type> expected = { alice_private_key.get_public_key() };
+   BOOST_CHECK( cache.get_signature_keys( first, chain_id ) == expected );
+   BOOST_CHECK( cache.get_signature_keys( second, chain_id ) == expected );
+   BOOST_CHECK_EQUAL( cache.get_statistics().misses, 1u );
+   BOOST_CHECK_EQUAL( cache.get_statistics().hits, 1u );
+   BOOST_CHECK_EQUAL( cache.get_statistics().size, 1u );
+
+   // keys which are known already are not looked up again
+   cache.get_signature_keys( second, chain_id );
+   BOOST_CHECK_EQUAL( cache.get_statistics().hits + cache.get_statistics().misses, 2u );
+
+   // the same transaction with other signatures is recovered
+   sign( trx, bob_private_key );
+   precomputable_transaction third( trx );
+   const flat_set<public_key_type> both = { alice_private_key.get_public_key(), bob_private_key.get_public_key() };
+   BOOST_CHECK( cache.get_signature_keys( third, chain_id ) == both );
+   BOOST_CHECK_EQUAL( cache.get_statistics().misses, 2u );
+
+   // duplicate signatures are still rejected
+   trx.signatures.push_back( trx.signatures.front() );
+   precomputable_transaction duplicate( trx );
+   GRAPHENE_REQUIRE_THROW( cache.get_signature_keys( duplicate, chain_id ), tx_duplicate_sig );
+
+   // the cache stays within its capacity
+   signature_cache small_cache( 64 );
+   for( uint32_t i = 0; i < 1000; ++i )
+   {
+      trx.clear();
+      set_expiration( db, trx );
+      op.amount = asset( i + 1 );
+      trx.operations.push_back( op );
+      sign( trx, alice_private_key );
+      precomputable_transaction ptrx( trx );
+      small_cache.get_signature_keys( ptrx, chain_id );
+   }
+   BOOST_CHECK_LE( small_cache.get_statistics().size, 2 * 64u );
+
+   // the database recovers each signature once, whether it is pushed or verified through the API
+   const uint64_t misses = db.get_signature_cache().get_statistics().misses;
+   PUSH_TX( db, trx );
+   graphene::app::database_api db_api( db );
+   BOOST_CHECK( db_api.verify_authority( trx ) );
+   BOOST_CHECK_EQUAL( db.get_signature_cache().get_statistics().misses, misses + 1 );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
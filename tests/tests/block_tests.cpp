@@ -36,11 +36,16 @@
 #include <graphene/chain/witness_schedule_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 
+#include <graphene/net/core_messages.hpp>
+
 #include <graphene/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/io/fstream.hpp>
 
+#include <atomic>
+#include <thread>
+
 #include "../common/database_fixture.hpp"
 
 using namespace graphene::chain;
@@ -133,6 +138,360 @@ BOOST_AUTO_TEST_CASE( block_database_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( packed_block_message_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+
+      clearable_block b;
+      b.witness = witness_id_type(1);
+      b.transactions.resize( 1 );
+      b.transactions[0].operations.emplace_back( transfer_operation() );
+      b.clear();
+      bdb.store( b.id(), b );
+
+      BOOST_CHECK( !bdb.fetch_packed_optional( block_id_type() ).valid() );
+      auto packed = bdb.fetch_packed_optional( b.id() );
+      BOOST_REQUIRE( packed.valid() );
+      BOOST_CHECK( *packed == fc::raw::pack( static_cast<const signed_block&>( b ) ) );
+
+      // a message built from the stored bytes must be identical to one built from the block
+      const graphene::net::message expected = graphene::net::block_message( b );
+      const auto packed_id = fc::raw::pack( b.id() );
+      packed->insert( packed->end(), packed_id.begin(), packed_id.end() );
+      const graphene::net::message msg( graphene::net::block_message::type, std::move(*packed) );
+      BOOST_CHECK_EQUAL( msg.msg_type.value(), expected.msg_type.value() );
+      BOOST_CHECK_EQUAL( msg.size.value(), expected.size.value() );
+      BOOST_CHECK( msg.data == expected.data );
+      BOOST_CHECK( msg.id() == expected.id() );
+      BOOST_CHECK( msg.as<graphene::net::block_message>().block_id == b.id() );
+
+      // a message which is filled in while it is received is hashed for the data it holds at the time
+      graphene::net::message received;
+      received.data = expected.data;
+      BOOST_CHECK( received.id() == expected.id() );
+      received.data = packed_id;
+      BOOST_CHECK( received.id() == fc::ripemd160::hash( packed_id.data(), (uint32_t)packed_id.size() ) );
+
+      bdb.remove( b.id() );
+      BOOST_CHECK( !bdb.fetch_packed_optional( b.id() ).valid() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_concurrent_read_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+
+      const uint32_t num_blocks = 2000;
+      std::atomic<uint32_t> stored( 0 );
+      std::atomic<bool> failed( false );
+
+      // readers only ever fetch blocks that have been published, while the writer keeps appending
+      std::vector<std::thread> readers;
+      for( uint32_t t = 0; t < 4; ++t )
+         readers.emplace_back( [&bdb,&stored,&failed,t,num_blocks]() {
+            uint32_t seen = 0;
+            while( seen < num_blocks && !failed )
+            {
+               const uint32_t top = stored.load();
+               for( uint32_t i = seen + 1 + t % 2; i <= top; i += 2 )
+               {
+                  auto blk = bdb.fetch_by_number( i );
+                  if( !blk.valid() || blk->witness != witness_id_type(i) || !bdb.contains( blk->id() ) )
+                     failed = true;
+               }
+               seen = top;
+            }
+         });
+
+      clearable_block b;
+      for( uint32_t i = 0; i < num_blocks; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         b.clear();
+         bdb.store( b.id(), b );
+         stored = i + 1;
+      }
+
+      for( auto& reader : readers )
+         reader.join();
+
+      BOOST_CHECK( !failed );
+      BOOST_CHECK( bdb.last_id().valid() && *bdb.last_id() == b.id() );
+      BOOST_CHECK_EQUAL( bdb.total_block_size(), fc::file_size( data_dir.path() / "blocks" ) );
+
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_overwrite_read_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.enable_write_behind( false );
+      bdb.open( data_dir.path() );
+
+      clearable_block first;
+      first.witness = witness_id_type(1);
+      first.clear();
+      bdb.store( first.id(), first );
+
+      // two blocks of different forks are stored alternately at the same number
+      clearable_block a;
+      a.previous = first.id();
+      a.witness = witness_id_type(2);
+      a.clear();
+      clearable_block b = a;
+      b.witness = witness_id_type(3);
+      b.clear();
+      bdb.store( a.id(), a );
+
+      std::atomic<bool> done( false );
+      std::atomic<bool> failed( false );
+      std::thread reader( [&]() {
+         while( !done )
+         {
+            const block_id_type id = bdb.fetch_block_id( 2 );
+            if( id != a.id() && id != b.id() )
+               failed = true;
+         }
+      });
+      for( uint32_t i = 0; i < 2000; ++i )
+      {
+         const clearable_block& next = ( i % 2 == 0 ? b : a );
+         bdb.store( next.id(), next );
+      }
+      done = true;
+      reader.join();
+
+      BOOST_CHECK( !failed );
+      BOOST_CHECK( bdb.contains( a.id() ) );
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_write_behind_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.enable_write_behind( true );
+      bdb.simulate_write_latency( fc::milliseconds( 50 ) );
+      bdb.open( data_dir.path() );
+
+      // queued blocks are served before they reach the disk
+      std::vector<block_id_type> ids;
+      clearable_block b;
+      for( uint32_t i = 0; i < 5; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i+1);
+         b.clear();
+         bdb.store( b.id(), b );
+         ids.push_back( b.id() );
+      }
+      BOOST_CHECK_LT( bdb.total_block_size(), 5 * fc::raw::pack_size( static_cast<const signed_block&>( b ) ) );
+      for( uint32_t i = 1; i <= 5; ++i )
+      {
+         BOOST_CHECK( bdb.contains( ids[i-1] ) );
+         BOOST_CHECK( bdb.fetch_block_id( i ) == ids[i-1] );
+         BOOST_REQUIRE( bdb.fetch_by_number( i ).valid() );
+         BOOST_CHECK( bdb.fetch_by_number( i )->witness == witness_id_type(i) );
+         BOOST_CHECK( bdb.fetch_optional( ids[i-1] ).valid() );
+         BOOST_CHECK( bdb.fetch_packed_optional( ids[i-1] ).valid() );
+      }
+
+      // a block stored again for the same number replaces the queued one
+      clearable_block fork;
+      fork.previous = ids[3];
+      fork.witness = witness_id_type(10);
+      fork.clear();
+      bdb.store( fork.id(), fork );
+      BOOST_CHECK( !bdb.contains( ids[4] ) );
+      BOOST_CHECK( !bdb.fetch_optional( ids[4] ).valid() );
+      BOOST_CHECK( !bdb.fetch_packed_optional( ids[4] ).valid() );
+      BOOST_CHECK( bdb.fetch_by_number( 5 )->id() == fork.id() );
+
+      bdb.wait_for_writes( 2 );
+      BOOST_CHECK_GE( fc::file_size( data_dir.path() / "blocks" ),
+                      2 * fc::raw::pack_size( static_cast<const signed_block&>( b ) ) );
+
+      // closing writes out the queue
+      bdb.close();
+      bdb.simulate_write_latency( fc::microseconds() );
+      bdb.enable_write_behind( false );
+      bdb.open( data_dir.path() );
+      BOOST_REQUIRE( bdb.last_id().valid() );
+      BOOST_CHECK( *bdb.last_id() == fork.id() );
+      BOOST_CHECK( bdb.fetch_by_number( 4 )->id() == ids[3] );
+
+      // without write-behind, blocks are on disk when store() returns
+      clearable_block next;
+      next.previous = fork.id();
+      next.witness = witness_id_type(11);
+      next.clear();
+      bdb.store( next.id(), next );
+      BOOST_CHECK_EQUAL( bdb.total_block_size(), fc::file_size( data_dir.path() / "blocks" ) );
+      BOOST_CHECK( *bdb.last_id() == next.id() );
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_write_retry_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+
+      block_database bdb;
+      bdb.enable_write_behind( true );
+      bdb.open( data_dir.path() );
+
+      clearable_block first;
+      first.witness = witness_id_type(1);
+      first.clear();
+      bdb.simulate_write_errors( 2 );
+      bdb.store( first.id(), first );
+
+      // the error is reported while the block is retried, and the block is still served from the queue
+      BOOST_CHECK_THROW( bdb.wait_for_writes( 1 ), fc::exception );
+      BOOST_CHECK( bdb.fetch_block_id( 1 ) == first.id() );
+
+      // once the block is written, the error is cleared
+      bool written = false;
+      for( uint32_t i = 0; i < 100 && !written; ++i )
+      {
+         try
+         {
+            bdb.wait_for_writes( 1 );
+            written = true;
+         }
+         catch( const fc::exception& )
+         {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+         }
+      }
+      BOOST_REQUIRE( written );
+      BOOST_CHECK_EQUAL( bdb.total_block_size(), fc::file_size( data_dir.path() / "blocks" ) );
+
+      clearable_block second;
+      second.previous = first.id();
+      second.witness = witness_id_type(2);
+      second.clear();
+      bdb.store( second.id(), second );
+      bdb.close();
+
+      bdb.enable_write_behind( false );
+      bdb.open( data_dir.path() );
+      BOOST_REQUIRE( bdb.last_id().valid() );
+      BOOST_CHECK( *bdb.last_id() == second.id() );
+      BOOST_CHECK( bdb.fetch_by_number( 1 )->id() == first.id() );
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_log_test )
+{
+   try {
+      for( auto compression : { block_log_compression::none, block_log_compression::zlib, block_log_compression::zstd } )
+      {
+         if( !is_block_log_compression_supported( compression ) )
+            continue;
+         BOOST_TEST_MESSAGE( "Testing block log with compression " + fc::reflector<block_log_compression>::to_string( compression ) );
+
+         fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+         const fc::path log_file = data_dir.path() / "block_log";
+
+         std::vector<block_id_type> ids;
+         {
+            block_log_writer log( log_file, compression, 4096 );
+            clearable_block b;
+            for( uint32_t i = 0; i < 500; ++i )
+            {
+               if( i > 0 ) b.previous = b.id();
+               b.witness = witness_id_type(i+1);
+               b.clear();
+               log.append( b );
+               ids.push_back( b.id() );
+            }
+            BOOST_CHECK_THROW( log.append( b ), fc::exception );
+         }
+
+         {
+            block_log_reader reader( log_file );
+            BOOST_CHECK_EQUAL( reader.last_block_num(), 500u );
+            BOOST_CHECK( reader.compression() == compression );
+            BOOST_CHECK( !reader.fetch_by_number( 0 ).valid() );
+            BOOST_CHECK( !reader.fetch_by_number( 501 ).valid() );
+            for( uint32_t num = 1; num <= 500; ++num )
+            {
+               auto blk = reader.fetch_by_number( num );
+               BOOST_REQUIRE( blk.valid() );
+               BOOST_CHECK( blk->id() == ids[num-1] );
+            }
+            for( uint32_t num : { 377u, 2u, 499u, 1u, 250u } )
+               BOOST_CHECK( fc::raw::unpack<signed_block>( *reader.fetch_packed( num ) ).id() == ids[num-1] );
+         }
+
+         // the chunk index is rebuilt if it is missing
+         fc::remove( fc::path( log_file.generic_string() + ".index" ) );
+         {
+            block_log_reader reader( log_file );
+            BOOST_CHECK_EQUAL( reader.last_block_num(), 500u );
+            BOOST_CHECK( reader.fetch_by_number( 321 )->id() == ids[320] );
+         }
+
+         // block_database serves archived blocks, and stores new ones after them
+         block_database bdb;
+         bdb.open( data_dir.path() );
+         BOOST_REQUIRE( bdb.last_id().valid() );
+         BOOST_CHECK( *bdb.last_id() == ids.back() );
+         BOOST_CHECK( bdb.contains( ids[41] ) );
+         BOOST_CHECK( bdb.fetch_block_id( 42 ) == ids[41] );
+         BOOST_CHECK( bdb.fetch_optional( ids[41] ).valid() );
+         BOOST_CHECK( bdb.fetch_packed_optional( ids[41] ).valid() );
+
+         clearable_block b;
+         b.previous = ids.back();
+         b.witness = witness_id_type(501);
+         b.clear();
+         bdb.store( b.id(), b );
+         BOOST_CHECK( *bdb.last_id() == b.id() );
+         BOOST_CHECK( bdb.fetch_by_number( 501 )->id() == b.id() );
+         BOOST_CHECK( bdb.fetch_by_number( 500 )->id() == ids.back() );
+         bdb.close();
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( generate_empty_blocks )
 {
    try {
@@ -192,6 +551,36 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
    }
 }
 
+BOOST_AUTO_TEST_CASE( reindex_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      block_id_type head_id;
+      fc::sha256 head_state;
+      {
+         database db;
+         db.open(data_dir.path(), make_genesis, "TEST" );
+         // enough blocks for the replay queue to adapt at least once
+         for( uint32_t i = 0; i < 1500; ++i )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         head_id = db.head_block_id();
+         head_state = fc::sha256::hash( fc::raw::pack( db.get_dynamic_global_properties() ) );
+         db.close( false );
+      }
+      {
+         database db;
+         db.wipe( data_dir.path(), false );
+         db.open(data_dir.path(), make_genesis, "TEST" );
+         BOOST_CHECK( db.head_block_id() == head_id );
+         BOOST_CHECK( fc::sha256::hash( fc::raw::pack( db.get_dynamic_global_properties() ) ) == head_state );
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( undo_block )
 {
    try {
@@ -1347,6 +1736,193 @@ BOOST_FIXTURE_TEST_CASE( transaction_invalidated_in_cache, database_fixture )
    }
 }
 
+/**
+ * Applies the same blocks with and without speculative authority checks and compares the results
+ */
+BOOST_FIXTURE_TEST_CASE( speculative_authority_checks, database_fixture )
+{ try {
+   ACTORS( (alice)(bob)(carol) );
+   fund( alice );
+   fund( bob );
+   fund( carol );
+   generate_block();
+   const uint32_t setup_blocks = db.head_block_num();
+
+   const auto alice_new_key = generate_private_key( "alice new key" );
+   const auto bob_new_key = generate_private_key( "bob new key" );
+
+   auto push_signed = [this]( const operation& op, const fc::ecc::private_key& key, uint32_t skip ) {
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      db.current_fee_schedule().set_fee( tx.operations.back() );
+      set_expiration( db, tx );
+      sign( tx, key );
+      PUSH_TX( db, tx, skip );
+   };
+   auto make_transfer = []( account_id_type from, account_id_type to, int64_t amount ) {
+      transfer_operation op;
+      op.from = from;
+      op.to = to;
+      op.amount = asset( amount );
+      return op;
+   };
+   auto make_key_update = []( account_id_type account, const fc::ecc::private_key& key ) {
+      account_update_operation op;
+      op.account = account;
+      op.active = authority( 1, public_key_type( key.get_public_key() ), 1 );
+      return op;
+   };
+
+   // A valid block: bob signs with a key he has set earlier in the block, so his transfer fails the
+   // speculative check. Alice's second transfer passes it, but reads her account after it has been changed.
+   account_update_operation memo_update;
+   memo_update.account = alice_id;
+   memo_update.new_options = alice_id(db).options;
+   memo_update.new_options->memo_key = alice_new_key.get_public_key();
+
+   push_signed( make_transfer( alice_id, bob_id, 100 ), alice_private_key, database::skip_nothing );
+   push_signed( make_key_update( bob_id, bob_new_key ), bob_private_key, database::skip_nothing );
+   push_signed( make_transfer( bob_id, carol_id, 50 ), bob_new_key, database::skip_nothing );
+   push_signed( make_transfer( carol_id, alice_id, 30 ), carol_private_key, database::skip_nothing );
+   push_signed( memo_update, alice_private_key, database::skip_nothing );
+   push_signed( make_transfer( alice_id, carol_id, 20 ), alice_private_key, database::skip_nothing );
+   generate_block();
+
+   // An invalid block: the transfer is signed with the key alice has replaced earlier in the block,
+   // so it passes the speculative check against the state before the block
+   push_signed( make_key_update( alice_id, alice_new_key ), alice_private_key, database::skip_nothing );
+   push_signed( make_transfer( alice_id, bob_id, 10 ), alice_private_key, database::skip_transaction_signatures );
+   generate_block();
+
+   auto state_digest = []( const database& other ) {
+      fc::sha256::encoder enc;
+      const vector<std::pair<uint8_t,uint8_t>> types = {
+         { protocol_ids, account_object_type },
+         { implementation_ids, impl_account_balance_object_type },
+         { implementation_ids, impl_account_statistics_object_type },
+         { implementation_ids, impl_transaction_history_object_type },
+         { implementation_ids, impl_dynamic_global_property_object_type } };
+      for( const auto& type : types )
+         other.get_index( type.first, type.second ).inspect_all_objects( [&enc]( const object& obj ) {
+            auto packed = obj.pack();
+            enc.write( packed.data(), packed.size() );
+         });
+      return enc.result();
+   };
+   auto replay = [&]( bool speculative ) {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      database other;
+      other.open( data_dir.path(), [this]{ return genesis_state; }, "TEST" );
+      other.enable_speculative_authority_checks( speculative );
+      for( uint32_t num = 1; num <= setup_blocks; ++num )
+         PUSH_BLOCK( other, *db.fetch_block_by_number( num ), database::skip_transaction_signatures );
+      PUSH_BLOCK( other, *db.fetch_block_by_number( setup_blocks + 1 ), database::skip_nothing );
+      BOOST_CHECK_THROW( PUSH_BLOCK( other, *db.fetch_block_by_number( setup_blocks + 2 ), database::skip_nothing ),
+                         fc::exception );
+      BOOST_CHECK( other.head_block_id() == db.fetch_block_by_number( setup_blocks + 1 )->id() );
+      return state_digest( other );
+   };
+
+   BOOST_CHECK( replay( true ) == replay( false ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( pending_transaction_priority, database_fixture )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice );
+   fund( bob );
+   generate_block();
+
+   uint64_t amount = 0;
+   auto push_transfer = [&]( account_id_type from, int64_t fee ) {
+      transfer_operation op;
+      op.from = from;
+      op.to = from == alice_id ? bob_id : alice_id;
+      op.amount = asset( ++amount );
+      op.fee = asset( fee );
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      set_expiration( db, tx );
+      return PUSH_TX( db, tx, ~0 );
+   };
+   const auto& pool = db.get_pending_transactions();
+
+   BOOST_TEST_MESSAGE( "Limit the number of pending transactions per account" );
+   db.set_pending_transaction_limits( 0, 2 );
+   push_transfer( alice_id, 1000 );
+   push_transfer( alice_id, 1000 );
+   BOOST_CHECK_THROW( push_transfer( alice_id, 1000 ), pending_transaction_limit_exceeded );
+   push_transfer( bob_id, 1000 );
+   BOOST_CHECK_EQUAL( pool.size(), 3u );
+   generate_block();
+   BOOST_CHECK( pool.empty() );
+
+   BOOST_TEST_MESSAGE( "Evict the transactions with the lowest fees" );
+   auto total_balance = [&]() {
+      return get_balance( alice_id, asset_id_type() ) + get_balance( bob_id, asset_id_type() );
+   };
+   const int64_t balance_before = total_balance();
+   const processed_transaction low = push_transfer( alice_id, 1000 );
+   const uint32_t trx_size = pool.total_size();
+   db.set_pending_transaction_limits( 3 * trx_size, 0 );
+   push_transfer( alice_id, 1000 );
+   push_transfer( alice_id, 2000 );
+   uint32_t notifications = 0;
+   boost::signals2::scoped_connection counter = db.on_pending_transaction.connect(
+         [&notifications]( const signed_transaction& ) { ++notifications; } );
+   const processed_transaction high = push_transfer( bob_id, 5000 );
+   counter.disconnect();
+   // the pool is evicted down to 90% of its limit
+   BOOST_CHECK_EQUAL( pool.size(), 2u );
+   BOOST_CHECK( !pool.contains( low.id() ) );
+   BOOST_CHECK( pool.contains( high.id() ) );
+   BOOST_CHECK_EQUAL( notifications, 1u );
+   BOOST_CHECK_EQUAL( high.operation_results.size(), 1u );
+   // the evicted transactions are undone right away
+   BOOST_CHECK_EQUAL( total_balance(), balance_before - 2000 - 5000 );
+   push_transfer( alice_id, 1500 );
+   BOOST_CHECK_THROW( push_transfer( alice_id, 1000 ), transaction_pool_full );
+   BOOST_CHECK_EQUAL( pool.size(), 3u );
+   BOOST_CHECK_EQUAL( total_balance(), balance_before - 2000 - 5000 - 1500 );
+   generate_block();
+   BOOST_CHECK( pool.empty() );
+   // the block is made of the remaining transactions only
+   BOOST_CHECK_EQUAL( total_balance(), balance_before - 2000 - 5000 - 1500 );
+   db.set_pending_transaction_limits( 0, 0 );
+
+   BOOST_TEST_MESSAGE( "Prune expired transactions" );
+   transaction_pool expiring;
+   processed_transaction early;
+   early.expiration = db.head_block_time();
+   processed_transaction late = early;
+   late.expiration += 60;
+   expiring.insert( early, alice_id, 100, 1000 );
+   expiring.insert( late, bob_id, 100, 1000 );
+   BOOST_CHECK_EQUAL( expiring.remove_expired( early.expiration ), 0u );
+   BOOST_CHECK_EQUAL( expiring.remove_expired( early.expiration + 1 ), 1u );
+   BOOST_CHECK_EQUAL( expiring.size(), 1u );
+   BOOST_CHECK_EQUAL( expiring.total_size(), 100u );
+   BOOST_CHECK( expiring.contains( late.id() ) );
+
+   BOOST_TEST_MESSAGE( "Fill blocks by priority" );
+   const auto& gpo = db.get_global_properties();
+   db._undo_db.disable();
+   db.modify( gpo, [trx_size]( global_property_object& p ) {
+      p.parameters.maximum_block_size = fc::raw::pack_size( signed_block_header() ) + 3 + trx_size + trx_size / 2;
+   });
+   db._undo_db.enable();
+   const processed_transaction first = push_transfer( alice_id, 1000 );
+   const processed_transaction second = push_transfer( bob_id, 3000 );
+   signed_block b = generate_block();
+   BOOST_REQUIRE_EQUAL( b.transactions.size(), 1u );
+   BOOST_CHECK( b.transactions[0].id() == second.id() );
+   BOOST_CHECK( pool.contains( first.id() ) );
+   b = generate_block();
+   BOOST_REQUIRE_EQUAL( b.transactions.size(), 1u );
+   BOOST_CHECK( b.transactions[0].id() == first.id() );
+   BOOST_CHECK( pool.empty() );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( genesis_reserve_ids )
 {
    try
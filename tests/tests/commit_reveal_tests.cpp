@@ -0,0 +1,125 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/commit_reveal_v2_object.hpp>
+#include <graphene/chain/hardfork.hpp>
+
+#include "../common/database_fixture.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+
+BOOST_FIXTURE_TEST_SUITE( commit_reveal_tests, database_fixture )
+
+/// The seed and the participants of the commit-reveal window must be the same as those of the lookup per account
+/// which was used before the window was summarized in one pass
+BOOST_AUTO_TEST_CASE( summarize_commit_reveal_window_v2_test )
+{ try {
+   const vector<account_id_type> accounts = { account_id_type(11), account_id_type(12), account_id_type(13),
+                                              account_id_type(14), account_id_type(15), account_id_type(16),
+                                              account_id_type(17) };
+   // not asked for, but revealed within the window
+   const account_id_type other( 18 );
+
+   auto lookup_per_account = [this]( const vector<account_id_type>& wanted ) {
+      const auto& by_account_idx = db.get_index_type<commit_reveal_v2_index>().indices().get<by_account>();
+      const uint32_t maintenance_time = db.get_dynamic_global_properties().next_maintenance_time.sec_since_epoch();
+      const uint32_t prev_maintenance_time = maintenance_time
+                                             - db.get_global_properties().parameters.maintenance_interval;
+      commit_reveal_window_summary result;
+      for( const auto& acc : wanted )
+      {
+         auto itr = by_account_idx.lower_bound( acc );
+         if( itr == by_account_idx.end() || itr->account != acc )
+            continue;
+         const bool in_window = HARDFORK_REVPOP_13_PASSED( db.head_block_time() )
+                                ? ( prev_maintenance_time <= itr->maintenance_time
+                                    && itr->maintenance_time < maintenance_time )
+                                : itr->maintenance_time == maintenance_time;
+         if( !in_window )
+            continue;
+         result.seed += itr->value;
+         if( itr->value != 0 )
+            result.participants.insert( itr->account );
+      }
+      return result;
+   };
+
+   auto reveal = [this]( account_id_type account, uint64_t value, uint32_t maintenance_time ) {
+      db.create<commit_reveal_v2_object>( [&]( commit_reveal_v2_object& o ) {
+         o.account = account;
+         o.hash = fc::to_string( value );
+         o.value = value;
+         o.maintenance_time = maintenance_time;
+      });
+   };
+
+   auto remove_reveals = [this]() {
+      vector<object_id_type> reveals;
+      for( const auto& obj : db.get_index_type<commit_reveal_v2_index>().indices() )
+         reveals.push_back( obj.id );
+      for( const auto& id : reveals )
+         db.remove( db.get_object( id ) );
+   };
+
+   // reveals around both windows, the values are powers of 2 so that the seed tells which of them were counted
+   auto reveal_around_windows = [&]() {
+      const uint32_t next = db.get_dynamic_global_properties().next_maintenance_time.sec_since_epoch();
+      const uint32_t interval = db.get_global_properties().parameters.maintenance_interval;
+      reveal( accounts[0], 1, next );                   // the next maintenance
+      reveal( accounts[1], 2, next - interval );        // the beginning of the current interval
+      reveal( accounts[2], 4, next - interval / 2 );    // within the current interval
+      reveal( accounts[3], 8, next - interval - 1 );    // the previous interval
+      reveal( accounts[4], 16, next + interval );       // the interval after the next maintenance
+      reveal( accounts[5], 0, next );                   // a revealed 0
+      reveal( accounts[6], 0, next - interval / 2 );
+      reveal( other, 32, next );
+      reveal( account_id_type( other.instance.value + 1 ), 64, next - interval / 2 );
+   };
+
+   auto check_window = [&]( uint64_t expected_seed, const flat_set<account_id_type>& expected_participants ) {
+      const commit_reveal_window_summary summary = db.summarize_commit_reveal_window_v2( accounts );
+      const commit_reveal_window_summary expected = lookup_per_account( accounts );
+      BOOST_CHECK_EQUAL( summary.seed, expected.seed );
+      BOOST_CHECK( summary.participants == expected.participants );
+      BOOST_CHECK_EQUAL( summary.seed, expected_seed );
+      BOOST_CHECK( summary.participants == expected_participants );
+   };
+
+   BOOST_TEST_MESSAGE( "Before REVPOP_13 the window holds the reveals for the next maintenance" );
+   BOOST_REQUIRE( !HARDFORK_REVPOP_13_PASSED( db.head_block_time() ) );
+   reveal_around_windows();
+   check_window( 1, { accounts[0] } );
+   BOOST_CHECK( db.summarize_commit_reveal_window_v2( {} ).participants.empty() );
+
+   // the reveals must not change the witnesses while the blocks are generated
+   remove_reveals();
+   generate_blocks( HARDFORK_REVPOP_13_TIME );
+   generate_block();
+
+   BOOST_TEST_MESSAGE( "Since REVPOP_13 the window holds the reveals of the current maintenance interval" );
+   BOOST_REQUIRE( HARDFORK_REVPOP_13_PASSED( db.head_block_time() ) );
+   reveal_around_windows();
+   check_window( 2 + 4, { accounts[1], accounts[2] } );
+   BOOST_CHECK_EQUAL( db.summarize_commit_reveal_window_v2( {} ).seed, 0u );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
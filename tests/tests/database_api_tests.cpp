@@ -24,6 +24,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <graphene/app/api_read_pool.hpp>
+#include <graphene/app/application.hpp>
 #include <graphene/app/database_api.hpp>
 #include <graphene/chain/hardfork.hpp>
 
@@ -32,6 +34,7 @@
 
 #include "../common/database_fixture.hpp"
 
+#include <atomic>
 #include <random>
 
 using namespace graphene::chain;
@@ -1325,4 +1328,71 @@ BOOST_AUTO_TEST_CASE( verify_authority_multiple_accounts )
    }
 }
 
+BOOST_AUTO_TEST_CASE( validate_transaction_during_pool_reads )
+{ try {
+   ACTORS( (alice)(bob) );
+   const share_type alice_funds = 1000000;
+   fund( alice, asset( alice_funds ) );
+   generate_block();
+
+   transfer_operation op;
+   op.from = alice_id;
+   op.to = bob_id;
+   op.amount = asset( 1000 );
+   db.current_fee_schedule().set_fee( op );
+   trx.operations.push_back( op );
+   test::set_expiration( db, trx );
+   sign( trx, alice_private_key );
+   const signed_transaction validated = trx;
+   trx.clear();
+
+   graphene::app::application_options options;
+   options.read_pool = std::make_shared<graphene::app::api_read_pool>( db, 2 );
+   graphene::app::database_api api( db, &options );
+
+   // The readers run on the pool threads while the transfer is applied and undone by validate_transaction,
+   // they must never see the balances in between.
+   std::atomic<bool> done( false );
+   std::atomic<uint32_t> reads( 0 );
+   std::atomic<uint32_t> wrong_reads( 0 );
+   const vector<string> names = { "alice", "bob" };
+   std::vector< std::unique_ptr<fc::thread> > clients;
+   std::vector< fc::future<void> > loops;
+   for( uint32_t c = 0; c < 2; ++c )
+   {
+      clients.push_back( std::make_unique<fc::thread>( "api_client_" + fc::to_string( c ) ) );
+      loops.push_back( clients.back()->async( [&]() {
+         while( !done )
+         {
+            const auto accounts = api.get_full_accounts( names, false );
+            share_type alice_balance;
+            share_type bob_balance;
+            for( const account_balance_object& balance : accounts.at( "alice" ).balances )
+               if( balance.asset_type == asset_id_type() )
+                  alice_balance = balance.balance;
+            for( const account_balance_object& balance : accounts.at( "bob" ).balances )
+               if( balance.asset_type == asset_id_type() )
+                  bob_balance = balance.balance;
+            if( alice_balance != alice_funds || bob_balance != 0 )
+               ++wrong_reads;
+            ++reads;
+         }
+      }, "api client" ) );
+   }
+
+   for( uint32_t i = 0; i < 500 || reads < 100; ++i )
+   {
+      const processed_transaction result = api.validate_transaction( validated );
+      BOOST_REQUIRE_EQUAL( result.operation_results.size(), 1u );
+   }
+
+   done = true;
+   for( auto& loop : loops )
+      loop.wait();
+
+   BOOST_CHECK_EQUAL( wrong_reads.load(), 0u );
+   BOOST_CHECK_EQUAL( get_balance( alice_id, asset_id_type() ), alice_funds.value );
+   BOOST_CHECK_EQUAL( get_balance( bob_id, asset_id_type() ), 0 );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -31,6 +31,8 @@
 
 #include <fc/crypto/digest.hpp>
 
+#include <fstream>
+
 #include "../common/database_fixture.hpp"
 
 using namespace graphene::chain;
@@ -108,6 +110,74 @@ BOOST_AUTO_TEST_CASE( merge_test )
    }
 }
 
+/**
+ * Merge and undo sessions that record enough changes to grow their hash tables and arenas
+ */
+BOOST_AUTO_TEST_CASE( undo_state_merge_test )
+{ try {
+   const int64_t count = 2000;
+   vector<account_balance_id_type> ids;
+   ids.reserve( count );
+
+   auto setup = db._undo_db.start_undo_session();
+   for( int64_t i = 0; i < count; ++i )
+      ids.push_back( db.create<account_balance_object>( [i]( account_balance_object& obj ){
+         obj.owner = account_id_type( 1000 + i );
+         obj.balance = i;
+      }).id );
+
+   {
+      auto outer = db._undo_db.start_undo_session();
+      {
+         auto inner = db._undo_db.start_undo_session();
+         for( int64_t i = 0; i < count; ++i )
+         {
+            if( i % 3 == 0 )
+               db.remove( ids[i](db) );
+            else
+               db.modify( ids[i](db), [count]( account_balance_object& obj ){ obj.balance += count; } );
+         }
+         inner.merge();
+      }
+      {
+         auto inner = db._undo_db.start_undo_session();
+         for( int64_t i = 0; i < count; ++i )
+         {
+            if( i % 3 == 0 )
+               continue;
+            if( i % 3 == 1 )
+               db.remove( ids[i](db) );
+            else
+               db.modify( ids[i](db), []( account_balance_object& obj ){ obj.balance *= 2; } );
+         }
+         inner.merge();
+      }
+
+      const auto& head = db._undo_db.head();
+      BOOST_CHECK_EQUAL( head.removed.size(), size_t( count - count / 3 ) );
+      BOOST_CHECK_EQUAL( head.old_values.size(), size_t( count / 3 ) );
+      for( int64_t i = 0; i < count; ++i )
+      {
+         if( i % 3 == 2 )
+            BOOST_CHECK_EQUAL( ids[i](db).balance.value, 2 * ( i + count ) );
+         else
+            BOOST_CHECK( db.find( ids[i] ) == nullptr );
+      }
+      outer.undo();
+   }
+
+   for( int64_t i = 0; i < count; ++i )
+   {
+      BOOST_REQUIRE( db.find( ids[i] ) != nullptr );
+      BOOST_CHECK_EQUAL( ids[i](db).balance.value, i );
+      BOOST_CHECK( ids[i](db).owner == account_id_type( 1000 + i ) );
+   }
+
+   setup.undo();
+   for( const auto& id : ids )
+      BOOST_CHECK( db.find( id ) == nullptr );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE( direct_index_test )
 { try {
    try {
@@ -280,4 +350,143 @@ BOOST_AUTO_TEST_CASE( required_approval_index_test ) // see https://github.com/b
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( object_database_reopen_test )
+{ try {
+   ACTORS( (alice)(bob) );
+   transfer( committee_account, alice_id, asset( 10000 ) );
+   generate_block();
+   db.flush();
+
+   database reopened;
+   reopened.graphene::db::object_database::open( db.get_data_dir() );
+
+   uint64_t loaded = 0;
+   for( const auto& timing : reopened.get_load_timings() )
+      loaded += timing.objects;
+   BOOST_CHECK_GT( loaded, 0u );
+
+   const auto& accounts = db.get_index( account_object::space_id, account_object::type_id );
+   const auto& reopened_accounts = reopened.get_index( account_object::space_id, account_object::type_id );
+   BOOST_CHECK( reopened_accounts.get_next_id() == accounts.get_next_id() );
+   accounts.inspect_all_objects( [&reopened_accounts]( const object& o ) {
+      const object* copy = reopened_accounts.find( o.id );
+      BOOST_REQUIRE( copy != nullptr );
+      BOOST_CHECK( copy->pack() == o.pack() );
+   });
+   BOOST_CHECK( reopened.get( alice_id ).name == "alice" );
+
+   // the objects of a file can be unpacked in chunks, and are inserted in the order of the file
+   database chunked;
+   auto& chunked_accounts = const_cast<graphene::db::index&>(
+         chunked.get_index( account_object::space_id, account_object::type_id ) );
+   const fc::path file = db.get_data_dir() / "object_database" / fc::to_string( uint32_t( account_object::space_id ) )
+                                           / fc::to_string( uint32_t( account_object::type_id ) );
+   const uint32_t chunks = chunked_accounts.begin_load( file, 3 );
+   BOOST_CHECK_GT( chunks, 1u );
+   BOOST_CHECK_LE( chunks, 3u );
+   for( uint32_t chunk = chunks; chunk > 0; --chunk )
+      chunked_accounts.decode_chunk( chunk - 1 );
+   uint64_t count = 0;
+   accounts.inspect_all_objects( [&count]( const object& ) { ++count; } );
+   BOOST_CHECK_EQUAL( chunked_accounts.end_load(), count );
+   chunked_accounts.notify_loaded();
+   BOOST_CHECK( chunked.get( alice_id ).name == "alice" );
+   BOOST_CHECK( chunked_accounts.get_next_id() == accounts.get_next_id() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( object_database_change_log_test )
+{ try {
+   ACTORS( (alice)(bob) );
+   generate_block();
+   db.track_changes( true );
+   db.flush();
+   BOOST_CHECK_EQUAL( db.change_log_size(), 0u );
+
+   // created, modified and removed objects, and a creation which is undone
+   const auto balance_id = db.create<account_balance_object>( []( account_balance_object& obj ){
+      obj.owner = account_id_type( 1000 );
+      obj.balance = 1;
+   }).id;
+   transfer( committee_account, alice_id, asset( 10000 ) );
+   ACTOR( carol );
+   generate_block();
+   const uint32_t first_block = db.head_block_num();
+   db.capture_changes( first_block );
+   BOOST_CHECK( !db.has_captured_changes( first_block - 1 ) );
+   BOOST_CHECK( db.has_captured_changes( first_block ) );
+
+   // records are not written before their block is irreversible
+   db.write_changes( first_block - 1 );
+   BOOST_CHECK_EQUAL( db.change_log_size(), 0u );
+   db.write_changes( first_block );
+   BOOST_CHECK( !db.has_captured_changes( first_block ) );
+   const uint64_t first_size = db.change_log_size();
+   BOOST_CHECK_GT( first_size, 0u );
+
+   // the objects of a discarded record are saved with the next one
+   transfer( alice_id, bob_id, asset( 100 ) );
+   generate_block();
+   db.capture_changes( db.head_block_num() );
+   db.discard_changes_after( db.head_block_num() - 1 );
+   BOOST_CHECK( !db.has_captured_changes( db.head_block_num() ) );
+
+   db.remove( db.get_object( balance_id ) );
+   {
+      auto session = db._undo_db.start_undo_session();
+      db.create<account_balance_object>( []( account_balance_object& obj ){
+         obj.owner = account_id_type( 1001 );
+      });
+   }
+   transfer( alice_id, bob_id, asset( 500 ) );
+   generate_block();
+   db.capture_changes( db.head_block_num() );
+   db.write_changes( db.head_block_num() );
+   BOOST_CHECK_GT( db.change_log_size(), first_size );
+
+   // a record that has been written only partially is dropped
+   const fc::path log_file = db.get_data_dir() / "object_database" / "changes.log";
+   {
+      std::ofstream log( log_file.generic_string(), std::ofstream::binary | std::ofstream::app );
+      log.write( "torn record", 11 );
+   }
+
+   const auto check_reopened = [this]( uint32_t records ) {
+      database reopened;
+      reopened.graphene::db::object_database::open( db.get_data_dir() );
+      BOOST_CHECK_EQUAL( reopened.get_change_log_records(), records );
+      db.inspect_all_indexes( [&reopened]( const graphene::db::index& idx ) {
+         const auto& copy = reopened.get_index( idx.object_space_id(), idx.object_type_id() );
+         BOOST_CHECK( copy.get_next_id() == idx.get_next_id() );
+         uint64_t count = 0;
+         idx.inspect_all_objects( [&copy,&count]( const object& o ) {
+            const object* found = copy.find( o.id );
+            BOOST_REQUIRE( found != nullptr );
+            BOOST_CHECK( found->pack() == o.pack() );
+            ++count;
+         });
+         copy.inspect_all_objects( [&count]( const object& ) { --count; } );
+         BOOST_CHECK_EQUAL( count, 0u );
+      });
+   };
+   check_reopened( 2u );
+   BOOST_CHECK_EQUAL( fc::file_size( log_file ), db.change_log_size() );
+   {
+      database reopened;
+      reopened.graphene::db::object_database::open( db.get_data_dir() );
+      BOOST_CHECK( reopened.find_object( balance_id ) == nullptr );
+      BOOST_CHECK( reopened.get( carol_id ).name == "carol" );
+   }
+
+   // a log which has reached its compaction size is merged into one record before the next one is appended
+   db.set_change_log_compaction_size( 1 );
+   transfer( alice_id, carol_id, asset( 100 ) );
+   generate_block();
+   db.capture_changes( db.head_block_num() );
+   db.write_changes( db.head_block_num() );
+   check_reopened( 2u );
+   db.compact_change_log();
+   BOOST_CHECK_EQUAL( fc::file_size( log_file ), db.change_log_size() );
+   check_reopened( 1u );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3462,4 +3462,88 @@ BOOST_AUTO_TEST_CASE( multiple_tickets )
    }
 }
 
+BOOST_AUTO_TEST_CASE( tickets_of_many_accounts_updated_together )
+{ try {
+
+      generate_block();
+      set_expiration( db, trx );
+
+      ACTORS((sam)(ted)(ann));
+      const vector<account_id_type> accounts = { sam_id, ted_id, ann_id };
+
+      auto init_amount = 10000000 * GRAPHENE_BLOCKCHAIN_PRECISION;
+      for( const account_id_type& account : accounts )
+         fund( account(db), asset(init_amount) );
+
+      // The statistics of every account must match its tickets
+      auto check_stats = [&]() {
+         for( const account_id_type& account : accounts )
+         {
+            share_type core_inactive;
+            share_type core_pob;
+            share_type core_pol;
+            share_type pob_value;
+            share_type pol_value;
+            for( const ticket_object& to : db.get_index_type< ticket_index >().indices() )
+            {
+               if( to.account != account )
+                  continue;
+               if( to.current_type == lock_forever && to.value == 0 )
+                  core_inactive += to.amount.amount;
+               else if( to.current_type == lock_forever )
+               {
+                  core_pob += to.amount.amount;
+                  pob_value += to.value;
+               }
+               else
+               {
+                  core_pol += to.amount.amount;
+                  pol_value += to.value;
+               }
+            }
+            const account_statistics_object& stats = db.get_account_stats_by_owner( account );
+            BOOST_CHECK_EQUAL( stats.total_core_inactive.value, core_inactive.value );
+            BOOST_CHECK_EQUAL( stats.total_core_pob.value, core_pob.value );
+            BOOST_CHECK_EQUAL( stats.total_core_pol.value, core_pol.value );
+            BOOST_CHECK_EQUAL( stats.total_pob_value.value, pob_value.value );
+            BOOST_CHECK_EQUAL( stats.total_pol_value.value, pol_value.value );
+         }
+         verify_asset_supplies( db );
+      };
+
+      // Every account creates several tickets in the same block, so they are updated in the same block as well
+      vector<ticket_id_type> to_cancel;
+      for( const account_id_type& account : accounts )
+      {
+         create_ticket( account, lock_180_days, asset(100) );
+         create_ticket( account, lock_180_days, asset(200) );
+         create_ticket( account, lock_forever, asset(300) );
+         to_cancel.push_back( create_ticket( account, lock_360_days, asset(400) ).id );
+      }
+      generate_block();
+      check_stats();
+
+      // 8 days passed, cancel charging, the tickets will be freed after 7 more days
+      generate_blocks( db.head_block_time() + fc::days(8) );
+      set_expiration( db, trx );
+      for( const ticket_id_type& id : to_cancel )
+         update_ticket( id(db), liquid, {} );
+      generate_block();
+      check_stats();
+
+      int64_t sam_balance = db.get_balance( sam_id, asset_id_type() ).amount.value;
+
+      // 8 more days passed, the tickets have been charged or freed
+      generate_blocks( db.head_block_time() + fc::days(8) );
+      set_expiration( db, trx );
+      for( const ticket_id_type& id : to_cancel )
+         BOOST_CHECK( !db.find( id ) );
+      BOOST_CHECK_EQUAL( db.get_balance( sam_id, asset_id_type() ).amount.value, sam_balance + 400 );
+      for( const ticket_object& to : db.get_index_type< ticket_index >().indices() )
+         BOOST_CHECK( to.status == stable || to.current_type != liquid );
+      check_stats();
+
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,208 @@
+/**
+ * The Revolution Populi Project
+ * Copyright (c) 2018-2026 Revolution Populi Limited, and contributors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/chain/database.hpp>
+
+#include <graphene/snapshot/binary_snapshot.hpp>
+
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fstream>
+
+#include "../common/database_fixture.hpp"
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+using namespace graphene::snapshot_plugin;
+
+BOOST_FIXTURE_TEST_SUITE( snapshot_tests, database_fixture )
+
+BOOST_AUTO_TEST_CASE( binary_snapshot_round_trip )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice, asset( 1000000 ) );
+   transfer( alice_id, bob_id, asset( 1000 ) );
+   generate_block();
+
+   for( auto compression : { block_log_compression::none, block_log_compression::zlib, block_log_compression::zstd } )
+   {
+      if( !is_block_log_compression_supported( compression ) )
+         continue;
+      BOOST_TEST_MESSAGE( "Testing snapshot with compression " + fc::reflector<block_log_compression>::to_string( compression ) );
+
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path file = data_dir.path() / "snapshot.bin";
+      const binary_snapshot snapshot = capture_snapshot( db );
+      write_snapshot( snapshot, file, compression );
+      BOOST_CHECK( !fc::exists( fc::path( file.generic_string() + ".tmp" ) ) );
+
+      database loaded_db;
+      const binary_snapshot loaded = load_snapshot( loaded_db, file, db.get_chain_id() );
+      BOOST_CHECK( loaded.chain_id == db.get_chain_id() );
+      BOOST_CHECK_EQUAL( loaded.head_block_num, db.head_block_num() );
+      BOOST_CHECK( loaded.head_block_id == db.head_block_id() );
+      BOOST_CHECK( loaded.head_block_time == db.head_block_time() );
+      BOOST_CHECK_EQUAL( loaded.sections.size(), snapshot.sections.size() );
+
+      auto check_same_state = [this,&loaded_db]() {
+         BOOST_CHECK( loaded_db.head_block_id() == db.head_block_id() );
+         db.inspect_all_indexes( [&loaded_db]( const graphene::db::index& idx ) {
+            const auto& loaded_idx = loaded_db.get_index( idx.object_space_id(), idx.object_type_id() );
+            BOOST_CHECK( loaded_idx.get_next_id() == idx.get_next_id() );
+            idx.inspect_all_objects( [&loaded_idx]( const graphene::db::object& o ) {
+               const graphene::db::object* copy = loaded_idx.find( o.id );
+               BOOST_REQUIRE( copy != nullptr );
+               BOOST_CHECK( copy->pack() == o.pack() );
+            });
+         });
+      };
+      check_same_state();
+
+      // a node can start from the loaded state without genesis and without blocks
+      loaded_db.open( data_dir.path() / "blockchain", []() -> genesis_state_type {
+         FC_THROW( "The genesis state must not be needed" );
+      }, GRAPHENE_CURRENT_DB_VERSION );
+      BOOST_CHECK( loaded_db.get_chain_id() == db.get_chain_id() );
+      BOOST_CHECK( loaded_db.head_block_id() == db.head_block_id() );
+      BOOST_CHECK( loaded_db.get_balance( bob_id, asset_id_type() ) == db.get_balance( bob_id, asset_id_type() ) );
+
+      // The loaded node has neither the head block nor a fork database, it continues with the next block
+      // of the source node, with a transaction in it.
+      const uint32_t skip = database::skip_undo_history_check;
+      const uint32_t source_head = db.head_block_num();
+      transfer_operation op;
+      op.from = alice_id;
+      op.to = bob_id;
+      op.amount = asset( 100 + uint32_t( compression ) );
+      db.current_fee_schedule().set_fee( op );
+      trx.operations.push_back( op );
+      test::set_expiration( db, trx );
+      sign( trx, alice_private_key );
+      PUSH_TX( db, trx );
+      trx.clear();
+      const signed_block next = generate_block( skip );
+      BOOST_REQUIRE_EQUAL( next.transactions.size(), 1u );
+      loaded_db.push_block( next, skip );
+      BOOST_CHECK_EQUAL( loaded_db.head_block_num(), source_head + 1 );
+      BOOST_CHECK( loaded_db.get_balance( bob_id, asset_id_type() ) == db.get_balance( bob_id, asset_id_type() ) );
+      check_same_state();
+
+      // and it can produce the block after that, which the source node accepts
+      const signed_block produced = loaded_db.generate_block( loaded_db.get_slot_time(1),
+                                                              loaded_db.get_scheduled_witness(1),
+                                                              init_account_priv_key, skip );
+      loaded_db.clear_pending();
+      db.push_block( produced, skip );
+      BOOST_CHECK_EQUAL( db.head_block_num(), source_head + 2 );
+      check_same_state();
+      loaded_db.close();
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( binary_snapshot_change_log_after_crash )
+{ try {
+   ACTORS( (alice)(bob) );
+   fund( alice, asset( 1000000 ) );
+   generate_block();
+
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const fc::path file = data_dir.path() / "snapshot.bin";
+   const fc::path blockchain_dir = data_dir.path() / "blockchain";
+   write_snapshot( capture_snapshot( db ), file, block_log_compression::none );
+   auto no_genesis = []() -> genesis_state_type {
+      FC_THROW( "The genesis state must not be needed" );
+   };
+
+   const uint32_t skip = database::skip_undo_history_check;
+   {
+      database loaded_db;
+      load_snapshot( loaded_db, file, db.get_chain_id() );
+      loaded_db.set_change_log_interval( 1 );
+      loaded_db.open( blockchain_dir, no_genesis, GRAPHENE_CURRENT_DB_VERSION );
+
+      for( uint32_t i = 0; i < 30; ++i )
+      {
+         transfer( alice_id, bob_id, asset( 100 + i ) );
+         loaded_db.push_block( generate_block( skip ), skip );
+      }
+      BOOST_REQUIRE( loaded_db.head_block_id() == db.head_block_id() );
+      BOOST_REQUIRE_GT( loaded_db.change_log_size(), 0u );
+      // the node crashes, close() is not called
+   }
+
+   database reopened;
+   reopened.set_change_log_interval( 1 );
+   reopened.open( blockchain_dir, no_genesis, GRAPHENE_CURRENT_DB_VERSION );
+   BOOST_CHECK_GT( reopened.get_change_log_records(), 0u );
+   BOOST_CHECK( reopened.head_block_id() == db.head_block_id() );
+   db.inspect_all_indexes( [&reopened]( const graphene::db::index& idx ) {
+      const auto& reopened_idx = reopened.get_index( idx.object_space_id(), idx.object_type_id() );
+      BOOST_CHECK( reopened_idx.get_next_id() == idx.get_next_id() );
+      uint64_t count = 0;
+      idx.inspect_all_objects( [&reopened_idx,&count]( const graphene::db::object& o ) {
+         const graphene::db::object* copy = reopened_idx.find( o.id );
+         BOOST_REQUIRE( copy != nullptr );
+         BOOST_CHECK( copy->pack() == o.pack() );
+         ++count;
+      });
+      reopened_idx.inspect_all_objects( [&count]( const graphene::db::object& ) { --count; } );
+      BOOST_CHECK_EQUAL( count, 0u );
+   });
+   reopened.close();
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( binary_snapshot_damaged )
+{ try {
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   const fc::path file = data_dir.path() / "snapshot.bin";
+   write_snapshot( capture_snapshot( db ), file, block_log_compression::none );
+
+   // a snapshot of another chain is rejected before anything is loaded
+   {
+      database loaded_db;
+      BOOST_CHECK_THROW( load_snapshot( loaded_db, file, chain_id_type( fc::sha256::hash( "other" ) ) ),
+                         fc::exception );
+      BOOST_CHECK( loaded_db.find( global_property_id_type() ) == nullptr );
+   }
+
+   // flip the last byte, which belongs to the data of the last section
+   {
+      std::fstream f( file.generic_string(), std::ios::in | std::ios::out | std::ios::binary );
+      f.seekg( -1, std::ios::end );
+      char c = 0;
+      f.read( &c, 1 );
+      c = char( ~c );
+      f.seekp( -1, std::ios::end );
+      f.write( &c, 1 );
+   }
+   {
+      database loaded_db;
+      BOOST_CHECK_THROW( load_snapshot( loaded_db, file, db.get_chain_id() ), fc::exception );
+   }
+
+   // a truncated file is detected before anything is loaded
+   fc::resize_file( file, fc::file_size( file ) - 1 );
+   {
+      database loaded_db;
+      BOOST_CHECK_THROW( load_snapshot( loaded_db, file, db.get_chain_id() ), fc::exception );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -27,8 +27,10 @@
 #include <graphene/app/database_api.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/hardfork.hpp>
+#include <graphene/chain/witness_object.hpp>
 
 #include <iostream>
+#include <random>
 
 #include "../common/database_fixture.hpp"
 
@@ -950,4 +952,314 @@ BOOST_AUTO_TEST_CASE( committee_votes_calculation )
    } FC_LOG_AND_RETHROW()
 }
 
+/**
+ * The vote tally during chain maintenance can be split into shards which are counted in parallel and merged.
+ * Whatever the number of shards, the result of the maintenance must be exactly the same as when all votes are
+ * counted on one thread.
+ */
+BOOST_AUTO_TEST_CASE( parallel_vote_tally_test )
+{
+   try
+   {
+      ACTOR(sponsor);
+      fund( sponsor );
+      upgrade_to_lifetime_member( sponsor_id );
+
+      vector<vote_id_type> worker_votes;
+      for( int i = 0; i < 5; ++i )
+         worker_votes.push_back( create_worker( sponsor_id ).vote_for );
+      vector<vote_id_type> witness_votes;
+      for( const witness_object& wit : db.get_index_type<witness_index>().indices() )
+         witness_votes.push_back( wit.vote_id );
+      vector<vote_id_type> committee_votes;
+      for( const committee_member_object& cm : db.get_index_type<committee_member_index>().indices() )
+         committee_votes.push_back( cm.vote_id );
+
+      std::mt19937_64 rng( 20260301 );
+      auto random_options = [&rng,&worker_votes,&witness_votes,&committee_votes]( account_options& options ) {
+         options.votes.clear();
+         uint16_t num_witness = 0;
+         for( const vote_id_type& id : witness_votes )
+            if( rng() % 3 == 0 && options.votes.insert( id ).second )
+               ++num_witness;
+         uint16_t num_committee = 0;
+         for( const vote_id_type& id : committee_votes )
+            if( rng() % 3 == 0 && options.votes.insert( id ).second )
+               ++num_committee;
+         for( const vote_id_type& id : worker_votes )
+            if( rng() % 2 == 0 )
+               options.votes.insert( id );
+         options.num_witness = rng() % ( num_witness + 1 );
+         options.num_committee = rng() % ( num_committee + 1 );
+      };
+
+      // Create a large set of voters with random votes and balances, some of them voting through a proxy
+      const uint32_t num_voters = 4000;
+      const uint32_t batch_size = 50;
+      vector<account_id_type> voters;
+      voters.reserve( num_voters );
+      for( uint32_t base = 0; base < num_voters; base += batch_size )
+      {
+         trx.operations.clear();
+         for( uint32_t i = base; i < base + batch_size; ++i )
+         {
+            account_create_operation op = make_account( "voter" + std::to_string( i ) );
+            random_options( op.options );
+            if( !voters.empty() && rng() % 5 == 0 )
+               op.options.voting_account = voters[ rng() % voters.size() ];
+            trx.operations.push_back( op );
+         }
+         set_expiration( db, trx );
+         processed_transaction ptx = PUSH_TX( db, trx, ~0 );
+
+         trx.operations.clear();
+         for( const operation_result& result : ptx.operation_results )
+         {
+            voters.push_back( account_id_type( result.get<object_id_type>() ) );
+            transfer_operation op;
+            op.from = account_id_type();
+            op.to = voters.back();
+            op.amount = asset( 1 + rng() % 1000000 );
+            trx.operations.push_back( op );
+         }
+         PUSH_TX( db, trx, ~0 );
+         trx.clear();
+         generate_block();
+      }
+
+      // Let the committee members vote for workers, too
+      for( const committee_member_id_type& cm_id : db.get_global_properties().active_committee_members )
+      {
+         const account_object& cm_account = cm_id(db).committee_member_account(db);
+         transfer_operation top;
+         top.from = account_id_type();
+         top.to = cm_account.id;
+         top.amount = asset( 1 + rng() % 1000000 );
+         account_update_operation uop;
+         uop.account = cm_account.id;
+         uop.new_options = cm_account.options;
+         random_options( *uop.new_options );
+         uop.new_options->votes.insert( worker_votes.front() );
+         trx.operations.push_back( top );
+         trx.operations.push_back( uop );
+      }
+      set_expiration( db, trx );
+      PUSH_TX( db, trx, ~0 );
+      trx.clear();
+      generate_block();
+
+      struct tally_result
+      {
+         vector<uint64_t>                witness_votes;
+         vector<uint64_t>                committee_votes;
+         vector<uint64_t>                worker_votes;
+         vector<uint64_t>                worker_cm_votes;
+         vector<vector<account_id_type>> worker_cm_support;
+         vector<witness_id_type>         active_witnesses;
+         vector<committee_member_id_type> active_committee_members;
+         authority                       witness_authority;
+         authority                       committee_authority;
+      };
+
+      // Runs the next maintenance with the given number of shards, records the result and reverts the block.
+      // All votes are counted each time instead of only the changed ones.
+      db.enable_incremental_vote_tally( false );
+      auto maintenance_with_shards = [this]( uint32_t shards ) {
+         db.set_vote_tally_shards( shards );
+         const auto next_maintenance_time = db.get_dynamic_global_properties().next_maintenance_time;
+         const auto slots_to_maintenance = db.get_slot_at_time( next_maintenance_time );
+         generate_block( ~0, init_account_priv_key, slots_to_maintenance > 0 ? slots_to_maintenance - 1 : 0 );
+         BOOST_REQUIRE( db.get_dynamic_global_properties().next_maintenance_time > next_maintenance_time );
+
+         tally_result result;
+         for( const witness_object& wit : db.get_index_type<witness_index>().indices() )
+            result.witness_votes.push_back( wit.total_votes );
+         for( const committee_member_object& cm : db.get_index_type<committee_member_index>().indices() )
+            result.committee_votes.push_back( cm.total_votes );
+         for( const worker_object& worker : db.get_index_type<worker_index>().indices() )
+         {
+            result.worker_votes.push_back( worker.total_votes_for );
+            result.worker_cm_votes.push_back( worker.total_cm_votes_for );
+            result.worker_cm_support.push_back( worker.cm_support );
+         }
+         const auto& active_witnesses = db.get_global_properties().active_witnesses;
+         result.active_witnesses.assign( active_witnesses.begin(), active_witnesses.end() );
+         result.active_committee_members = db.get_global_properties().active_committee_members;
+         result.witness_authority = db.get( GRAPHENE_WITNESS_ACCOUNT ).active;
+         result.committee_authority = db.get( GRAPHENE_COMMITTEE_ACCOUNT ).active;
+
+         db.pop_block();
+         return result;
+      };
+
+      const tally_result serial = maintenance_with_shards( 1 );
+      BOOST_CHECK( !serial.worker_cm_support.front().empty() );
+
+      for( uint32_t shards : { 2u, 3u, 7u, 16u, 0u } )
+      {
+         BOOST_TEST_MESSAGE( "Comparing vote tally with " << shards << " shards" );
+         const tally_result parallel = maintenance_with_shards( shards );
+         BOOST_CHECK( parallel.witness_votes == serial.witness_votes );
+         BOOST_CHECK( parallel.committee_votes == serial.committee_votes );
+         BOOST_CHECK( parallel.worker_votes == serial.worker_votes );
+         BOOST_CHECK( parallel.worker_cm_votes == serial.worker_cm_votes );
+         BOOST_CHECK( parallel.worker_cm_support == serial.worker_cm_support );
+         BOOST_CHECK( parallel.active_witnesses == serial.active_witnesses );
+         BOOST_CHECK( parallel.active_committee_members == serial.active_committee_members );
+         BOOST_CHECK( parallel.witness_authority == serial.witness_authority );
+         BOOST_CHECK( parallel.committee_authority == serial.committee_authority );
+      }
+
+   } FC_LOG_AND_RETHROW()
+}
+
+/**
+ * With only the votes of changed accounts being counted again at each maintenance, the tally must always be the
+ * same as a full recount, including when voting power decays over time and when a maintenance block is replaced.
+ */
+BOOST_AUTO_TEST_CASE( incremental_vote_tally_test )
+{
+   try
+   {
+      // compare with a full recount at every maintenance, a difference makes the maintenance fail
+      db.enable_vote_tally_check( true );
+
+      ACTOR(sponsor);
+      fund( sponsor );
+      upgrade_to_lifetime_member( sponsor_id );
+
+      vector<vote_id_type> votes;
+      for( int i = 0; i < 3; ++i )
+         votes.push_back( create_worker( sponsor_id, 1000, fc::days(5000) ).vote_for );
+      for( const witness_object& wit : db.get_index_type<witness_index>().indices() )
+         votes.push_back( wit.vote_id );
+      for( const committee_member_object& cm : db.get_index_type<committee_member_index>().indices() )
+         votes.push_back( cm.vote_id );
+
+      std::mt19937_64 rng( 20260302 );
+      auto random_options = [&rng,&votes]( account_options& options ) {
+         options.votes.clear();
+         for( const vote_id_type& id : votes )
+            if( rng() % 3 == 0 )
+               options.votes.insert( id );
+         uint16_t num_witness = 0;
+         uint16_t num_committee = 0;
+         for( const vote_id_type& id : options.votes )
+         {
+            if( id.type() == vote_id_type::witness )
+               ++num_witness;
+            else if( id.type() == vote_id_type::committee )
+               ++num_committee;
+         }
+         options.num_witness = rng() % ( num_witness + 1 );
+         options.num_committee = rng() % ( num_committee + 1 );
+      };
+
+      const uint32_t num_voters = 500;
+      vector<account_id_type> voters;
+      for( uint32_t base = 0; base < num_voters; base += 50 )
+      {
+         for( uint32_t i = base; i < base + 50; ++i )
+         {
+            account_create_operation op = make_account( "voter" + std::to_string( i ) );
+            random_options( op.options );
+            trx.operations.push_back( op );
+         }
+         set_expiration( db, trx );
+         processed_transaction ptx = PUSH_TX( db, trx, ~0 );
+         trx.clear();
+         for( const operation_result& result : ptx.operation_results )
+         {
+            voters.push_back( account_id_type( result.get<object_id_type>() ) );
+            transfer_operation op;
+            op.from = account_id_type();
+            op.to = voters.back();
+            op.amount = asset( 1 + rng() % 1000000 );
+            trx.operations.push_back( op );
+         }
+         set_expiration( db, trx );
+         PUSH_TX( db, trx, ~0 );
+         trx.clear();
+         generate_block();
+      }
+      generate_blocks( db.get_dynamic_global_properties().next_maintenance_time );
+
+      for( uint32_t round = 0; round < 24; ++round )
+      {
+         BOOST_TEST_MESSAGE( "Changing accounts, round " << round );
+         for( uint32_t i = 0; i < 25; ++i )
+         {
+            const account_object& voter = voters[ rng() % voters.size() ](db);
+            switch( rng() % 4 )
+            {
+               case 0:
+               {
+                  transfer_operation op;
+                  op.from = account_id_type();
+                  op.to = voter.id;
+                  op.amount = asset( 1 + rng() % 1000000 );
+                  trx.operations.push_back( op );
+                  break;
+               }
+               case 1:
+               {
+                  const int64_t balance = get_balance( voter, asset_id_type()(db) );
+                  if( balance == 0 )
+                     continue;
+                  transfer_operation op;
+                  op.from = voter.id;
+                  op.to = account_id_type();
+                  op.amount = asset( rng() % 2 == 0 || balance < 2 ? balance : balance / 2 );
+                  trx.operations.push_back( op );
+                  break;
+               }
+               case 2:
+               {
+                  account_update_operation op;
+                  op.account = voter.id;
+                  op.new_options = voter.options;
+                  random_options( *op.new_options );
+                  trx.operations.push_back( op );
+                  break;
+               }
+               default:
+               {
+                  account_update_operation op;
+                  op.account = voter.id;
+                  op.new_options = voter.options;
+                  op.new_options->voting_account = ( rng() % 3 == 0 ? GRAPHENE_PROXY_TO_SELF_ACCOUNT
+                                                                      : voters[ rng() % voters.size() ] );
+                  if( op.new_options->voting_account == voter.id )
+                     op.new_options->voting_account = GRAPHENE_PROXY_TO_SELF_ACCOUNT;
+                  trx.operations.push_back( op );
+                  break;
+               }
+            }
+            set_expiration( db, trx );
+            PUSH_TX( db, trx, ~0 );
+            trx.clear();
+         }
+
+         const auto next_maintenance_time = db.get_dynamic_global_properties().next_maintenance_time;
+         if( round % 6 == 5 )
+         {
+            // replace the maintenance block by one produced earlier or later
+            const uint32_t slot = db.get_slot_at_time( next_maintenance_time );
+            BOOST_REQUIRE( slot > 0 );
+            const uint32_t later = ( round % 12 == 5 ? 2 : 0 );
+            generate_block( ~0, init_account_priv_key, slot - 1 + later );
+            db.pop_block();
+            generate_block( ~0, init_account_priv_key, slot - 1 + 2 - later );
+         }
+         else
+            generate_blocks( next_maintenance_time );
+         BOOST_REQUIRE( db.get_dynamic_global_properties().next_maintenance_time > next_maintenance_time );
+
+         // let voting power decay, some accounts have not voted for a year after a few rounds
+         generate_blocks( db.head_block_time() + fc::days( 25 ) );
+      }
+
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()